@@ -53,6 +53,18 @@ class CSQLResult
 		virtual unsigned int asUInt(std::string fieldName) = 0;
     // return the value as an integer
 		virtual int asInt(std::string fieldName) = 0;
+
+    // column index based access
+    //
+    // column() resolves a field name to its index. the index is the same for
+    // all rows of a query so callers that read many rows should resolve the
+    // columns once and use the index based accessors.
+    // unknown fields return -1. the accessors treat -1 like a NULL value
+    virtual int column(const std::string fieldName) = 0;
+    virtual bool isNull(int column) = 0;
+    virtual std::string asString(int column) = 0;
+    virtual unsigned int asUInt(int column) = 0;
+    virtual int asInt(int column) = 0;
     
 		virtual CSQLResult* clone() = 0;
 };
@@ -75,6 +87,20 @@ class ISQLQuery
 		virtual CDatabaseConnection* connection() = 0;
 
    virtual unsigned int size() = 0;
+
+    // prepared statements
+    //
+    // the sql may contain numbered parameters (?1, ?2, ...) that are set via bind().
+    // prepared statements are cached by the connection so preparing the same
+    // sql again does not parse it again.
+    // execute() runs the statement. the rows are fetched one by one via
+    // eof(), next() and result() and the result is only valid until the next
+    // call to next(). use clone() to keep a row.
+    // clear() releases the statement.
+    virtual bool prepare(const std::string sql) = 0;
+    virtual void bind(int index, const std::string value) = 0;
+    virtual void bind(int index, fuppes_off_t value) = 0;
+    virtual bool execute() = 0;
 };
 
 struct CConnectionParams
@@ -125,7 +151,15 @@ enum fuppes_sql_no {
   SQL_CREATE_INDICES              = 14,
   
   // status
-  SQL_GET_OBJECT_TYPE_COUNT = 15
+  SQL_GET_OBJECT_TYPE_COUNT = 15,
+
+  // full text search (optional. empty if not supported)
+  SQL_FULL_TEXT_INDEX_EXISTS  = 16,
+  SQL_CREATE_FULL_TEXT_INDEX  = 17,
+  SQL_DROP_FULL_TEXT_INDEX    = 18,
+  SQL_SEARCH_FULL_TEXT        = 19,
+
+  SQL_MAX
 };
 
 struct fuppes_sql
@@ -48,7 +48,9 @@
 
 #ifndef WIN32
 #include <dlfcn.h>
+#include <sys/time.h>
 #endif
+#include <time.h>
 
 #ifdef HAVE_ICONV
 #include <iconv.h>
@@ -476,6 +478,36 @@ void fuppesSleep(unsigned int p_nMilliseconds)
   #endif
 }
 
+unsigned int fuppesTicks()
+{
+  #if defined(WIN32)
+  return GetTickCount();
+  #elif defined(HAVE_CLOCK_GETTIME)
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec * 1000) + (now.tv_nsec / 1000000);
+  #else
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return (now.tv_sec * 1000) + (now.tv_usec / 1000);
+  #endif
+}
+
+unsigned long long fuppesMicroTicks()
+{
+  #if defined(WIN32)
+  return (unsigned long long)GetTickCount() * 1000;
+  #elif defined(HAVE_CLOCK_GETTIME)
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((unsigned long long)now.tv_sec * 1000000) + (now.tv_nsec / 1000);
+  #else
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return ((unsigned long long)now.tv_sec * 1000000) + now.tv_usec;
+  #endif
+}
+
 
 fuppes_off_t getFileSize(std::string fileName)
 {
@@ -111,6 +111,10 @@ std::string ToUTF8(std::string p_sValue, std::string p_sEncoding = "");
 std::string URLEncodeValueToPlain(std::string p_sValue);
 
 void fuppesSleep(unsigned int p_nMilliseconds);
+// monotonic milliseconds. wraps around so only use it for differences
+unsigned int fuppesTicks();
+// monotonic microseconds
+unsigned long long fuppesMicroTicks();
 
 fuppes_off_t getFileSize(std::string fileName);
 
@@ -165,6 +165,16 @@ fuppes_off_t File::write(char* buffer, fuppes_off_t length)
 #endif
 }
 
+#ifndef WIN32
+int File::descriptor()
+{
+  if(!isOpen())
+    return -1;
+
+  return fileno(m_file);
+}
+#endif
+
 fuppes_off_t File::size()
 {
 	struct stat Stat;  
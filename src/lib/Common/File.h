@@ -79,6 +79,10 @@ class File
     fuppes_off_t  read(char* buffer, fuppes_off_t length);
     bool          getline(std::string& line);
     fuppes_off_t  write(char* buffer, fuppes_off_t length);
+#ifndef WIN32
+    // the underlying file descriptor or -1 if the file is not open
+    int           descriptor();
+#endif
 
     static bool remove(std::string fileName);
     
@@ -36,6 +36,11 @@ using namespace fuppes;
 #ifndef WIN32
 #include <errno.h>
 #include <sys/errno.h>
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_SENDFILE
+#include <sys/sendfile.h>
 #endif
 
 // win32 and os x have no MSG_NOSIGNAL
@@ -184,6 +189,73 @@ fuppes_off_t SocketBase::send(const char* buffer, fuppes_off_t size)
   return fullSend;	
 }
 
+#ifndef WIN32
+#define SENDFILE_FALLBACK_BUFFER_SIZE 65536 // 64 kbyte
+
+fuppes_off_t SocketBase::sendFile(int fd, fuppes_off_t offset, fuppes_off_t size)
+{
+  fuppes_off_t fullSend = 0;
+
+#ifdef HAVE_SENDFILE
+  off_t   pos = offset;
+  ssize_t lastSend;
+
+  while(fullSend < size) {
+    lastSend = ::sendfile(m_socket, fd, &pos, size - fullSend);
+
+    if(lastSend > 0) {
+      fullSend += lastSend;
+      continue;
+    }
+
+    // eof
+    if(lastSend == 0)
+      return fullSend;
+
+    if(errno == EINTR)
+      continue;
+    if(errno == EAGAIN) {
+      socketSleep(10);
+      continue;
+    }
+
+    // the source does not support sendfile (e.g. some fuse filesystems).
+    // continue with the read/send loop below
+    if((errno == EINVAL || errno == ENOSYS) && fullSend == 0)
+      break;
+
+    return -1;
+  }
+
+  if(fullSend == size)
+    return fullSend;
+#endif
+
+  char         buffer[SENDFILE_FALLBACK_BUFFER_SIZE];
+  fuppes_off_t length;
+  fuppes_off_t sent;
+
+  while(fullSend < size) {
+    length = size - fullSend;
+    if(length > SENDFILE_FALLBACK_BUFFER_SIZE)
+      length = SENDFILE_FALLBACK_BUFFER_SIZE;
+
+    length = ::pread(fd, buffer, length, offset + fullSend);
+    if(length < 0 && errno == EINTR)
+      continue;
+    if(length <= 0)
+      break;
+
+    sent = send(buffer, length);
+    if(sent < 0)
+      return -1;
+    fullSend += sent;
+  }
+
+  return fullSend;
+}
+#endif
+
 fuppes_off_t SocketBase::receive(int timeout /*= 0*/)
 {
 	#ifdef HAVE_SELECT
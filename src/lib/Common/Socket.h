@@ -73,6 +73,11 @@ class SocketBase
 
 		fuppes_off_t	send(std::string message);
 		fuppes_off_t	send(const char* buffer, fuppes_off_t size);
+#ifndef WIN32
+		// sends size bytes starting at offset from the file descriptor fd.
+		// uses sendfile() if available and falls back to a read/send loop
+		fuppes_off_t	sendFile(int fd, fuppes_off_t offset, fuppes_off_t size);
+#endif
 		// timeout works only on nonblocking sockets and if "select()" is available
 		fuppes_off_t	receive(int timeout = 0);
 		
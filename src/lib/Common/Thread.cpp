@@ -90,6 +90,87 @@ void Mutex::unlock()
 
 
 
+Condition::Condition(Mutex* mutex)
+{
+  m_mutex = mutex;
+
+  #ifdef WIN32
+  m_waiters = 0;
+  m_semaphore = CreateSemaphore(NULL, 0, 0x7fffffff, NULL);
+  #else
+  pthread_cond_init(&m_condition, NULL);
+  #endif
+}
+
+Condition::~Condition()
+{
+  #ifdef WIN32
+  CloseHandle(m_semaphore);
+  #else
+  pthread_cond_destroy(&m_condition);
+  #endif
+}
+
+bool Condition::wait(unsigned int timeoutMs /*= 0*/)
+{
+  bool result = true;
+
+#ifdef WIN32
+  m_waiters++;
+  m_mutex->unlock();
+  result = (WaitForSingleObject(m_semaphore, (timeoutMs > 0 ? timeoutMs : INFINITE)) == WAIT_OBJECT_0);
+  m_mutex->lock();
+  m_waiters--;
+#else
+  if(timeoutMs == 0) {
+    pthread_cond_wait(&m_condition, &m_mutex->m_mutex);
+  }
+  else {
+    timespec timeout;
+#ifdef HAVE_CLOCK_GETTIME
+    clock_gettime(CLOCK_REALTIME, &timeout);
+#else
+    timeval time;
+    gettimeofday(&time, NULL);
+    timeout.tv_sec = time.tv_sec;
+    timeout.tv_nsec = time.tv_usec * 1000;
+#endif
+    timeout.tv_sec += timeoutMs / 1000;
+    timeout.tv_nsec += (timeoutMs % 1000) * 1000000;
+    if(timeout.tv_nsec >= 1000000000) {
+      timeout.tv_sec++;
+      timeout.tv_nsec -= 1000000000;
+    }
+
+    result = (pthread_cond_timedwait(&m_condition, &m_mutex->m_mutex, &timeout) != ETIMEDOUT);
+  }
+  m_mutex->m_locked = true;
+#endif
+
+  return result;
+}
+
+void Condition::signal()
+{
+  #ifdef WIN32
+  if(m_waiters > 0)
+    ReleaseSemaphore(m_semaphore, 1, NULL);
+  #else
+  pthread_cond_signal(&m_condition);
+  #endif
+}
+
+void Condition::broadcast()
+{
+  #ifdef WIN32
+  if(m_waiters > 0)
+    ReleaseSemaphore(m_semaphore, m_waiters, NULL);
+  #else
+  pthread_cond_broadcast(&m_condition);
+  #endif
+}
+
+
 
 Thread::Thread(std::string name) 
 {
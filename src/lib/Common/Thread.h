@@ -42,8 +42,12 @@
 
 namespace fuppes {
 
+class Condition;
+
 class Mutex
 {
+  friend class Condition;
+
 	public:
 		Mutex();
 		~Mutex();
@@ -79,6 +83,34 @@ class MutexLocker
 };
 
 
+/**
+ * a condition variable bound to a mutex.
+ * wait(), signal() and broadcast() must be called with the mutex locked.
+ * wakeups may be spurious so waiters have to recheck their predicate.
+ */
+class Condition
+{
+	public:
+		Condition(Mutex* mutex);
+		~Condition();
+
+		// waits until signaled or timeoutMs elapsed (0 = no timeout).
+		// returns false on timeout
+		bool wait(unsigned int timeoutMs = 0);
+		void signal();
+		void broadcast();
+
+	private:
+		Mutex*            m_mutex;
+		#ifdef WIN32
+		HANDLE            m_semaphore;
+		unsigned int      m_waiters;
+		#else
+		pthread_cond_t    m_condition;
+		#endif
+};
+
+
 class Thread
 {
 	public:
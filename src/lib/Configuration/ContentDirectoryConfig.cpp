@@ -1,4 +1,5 @@
 #include <cassert>
+#include <stdlib.h>
 
 #include "ContentDirectoryConfig.h"
 #include "../SharedConfig.h"
@@ -8,6 +9,15 @@ using namespace std;
 
 void ContentDirectory::InitVariables(void) {
   m_sLocalCharset = "UTF-8";
+  m_nBrowseCacheSize = 4;
+  m_nImageCacheSize = 8;
+  m_nImageDiskCacheSize = 256;
+  m_nThumbnailWorkers = 1;
+  m_nThumbnailsPerSecond = 2;
+  m_nMetadataWorkers = 0;
+  m_nMetadataFilesPerSecond = 0;
+  m_nDirectoryReaders = 4;
+  m_nFamQuietPeriod = 500;
 }
 
 bool ContentDirectory::Read(void)
@@ -20,6 +30,51 @@ bool ContentDirectory::Read(void)
     if(pTmp->Name().compare("local_charset") == 0) {
       m_sLocalCharset = pTmp->Value();
     }
+    else if(pTmp->Name().compare("browse_cache_size") == 0) {
+      if(pTmp->Value().length() > 0) {
+        m_nBrowseCacheSize = atoi(pTmp->Value().c_str());
+      }
+    }
+    else if(pTmp->Name().compare("image_cache_size") == 0) {
+      if(pTmp->Value().length() > 0) {
+        m_nImageCacheSize = atoi(pTmp->Value().c_str());
+      }
+    }
+    else if(pTmp->Name().compare("image_disk_cache_size") == 0) {
+      if(pTmp->Value().length() > 0) {
+        m_nImageDiskCacheSize = atoi(pTmp->Value().c_str());
+      }
+    }
+    else if(pTmp->Name().compare("thumbnail_workers") == 0) {
+      if(pTmp->Value().length() > 0) {
+        m_nThumbnailWorkers = atoi(pTmp->Value().c_str());
+      }
+    }
+    else if(pTmp->Name().compare("thumbnails_per_second") == 0) {
+      if(pTmp->Value().length() > 0) {
+        m_nThumbnailsPerSecond = atoi(pTmp->Value().c_str());
+      }
+    }
+    else if(pTmp->Name().compare("metadata_workers") == 0) {
+      if(pTmp->Value().length() > 0) {
+        m_nMetadataWorkers = atoi(pTmp->Value().c_str());
+      }
+    }
+    else if(pTmp->Name().compare("metadata_files_per_second") == 0) {
+      if(pTmp->Value().length() > 0) {
+        m_nMetadataFilesPerSecond = atoi(pTmp->Value().c_str());
+      }
+    }
+    else if(pTmp->Name().compare("directory_readers") == 0) {
+      if(pTmp->Value().length() > 0) {
+        m_nDirectoryReaders = atoi(pTmp->Value().c_str());
+      }
+    }
+    else if(pTmp->Name().compare("fam_quiet_period") == 0) {
+      if(pTmp->Value().length() > 0) {
+        m_nFamQuietPeriod = atoi(pTmp->Value().c_str());
+      }
+    }
   }
 
   return true;
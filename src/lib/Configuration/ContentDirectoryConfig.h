@@ -16,6 +16,26 @@ class ContentDirectory : public ConfigSettings
     std::string GetLocalCharset() { return m_sLocalCharset; }
     void        SetLocalCharset(std::string p_sLocalCharset);
 
+    // max. memory (in MB) used to cache browse responses. 0 = disabled
+    unsigned int BrowseCacheSize() { return m_nBrowseCacheSize; }
+    // max. memory (in MB) used to cache scaled images. 0 = disabled
+    unsigned int ImageCacheSize() { return m_nImageCacheSize; }
+    // max. disk space (in MB) used to cache scaled images. 0 = disabled
+    unsigned int ImageDiskCacheSize() { return m_nImageDiskCacheSize; }
+    // number of threads pre-rendering thumbnails of new items. 0 = disabled
+    unsigned int ThumbnailWorkers() { return m_nThumbnailWorkers; }
+    // max. number of thumbnails per second rendered in the background. 0 = unlimited
+    unsigned int ThumbnailsPerSecond() { return m_nThumbnailsPerSecond; }
+
+    // number of threads extracting metadata. 0 = number of cpus
+    unsigned int MetadataWorkers() { return m_nMetadataWorkers; }
+    // max. number of files per second read by the metadata workers. 0 = unlimited
+    unsigned int MetadataFilesPerSecond() { return m_nMetadataFilesPerSecond; }
+    // number of threads reading directories during a database rebuild
+    unsigned int DirectoryReaders() { return m_nDirectoryReaders; }
+    // ms without file system events before the collected events are applied
+    unsigned int FamQuietPeriod() { return m_nFamQuietPeriod; }
+
     /*
     bool UseImageMagick() { return m_pConfigFile->UseImageMagick(); }
     bool UseTaglib()      { return m_pConfigFile->UseTaglib(); }
@@ -26,6 +46,15 @@ class ContentDirectory : public ConfigSettings
     virtual void InitVariables(void);
 
     std::string             m_sLocalCharset;
+    unsigned int            m_nBrowseCacheSize;
+    unsigned int            m_nImageCacheSize;
+    unsigned int            m_nImageDiskCacheSize;
+    unsigned int            m_nThumbnailWorkers;
+    unsigned int            m_nThumbnailsPerSecond;
+    unsigned int            m_nMetadataWorkers;
+    unsigned int            m_nMetadataFilesPerSecond;
+    unsigned int            m_nDirectoryReaders;
+    unsigned int            m_nFamQuietPeriod;
 };
 
 #endif
@@ -15,6 +15,10 @@ DatabaseSettings::DatabaseSettings()
   m_dbConnectionParams.readonly = false;
   m_dbConnectionParams.filename = "";
   m_dbConnectionParams.type = "sqlite3";
+  m_scanBatchSize = 1000;
+  m_fullTextSearch = true;
+  m_updateOnStart = true;
+  m_readConnections = 4;
 }
 
 DatabaseSettings::~DatabaseSettings()
@@ -72,6 +76,20 @@ bool DatabaseSettings::Read(void)
     else if(pTmp->Name().compare("readonly") == 0) {
       m_dbConnectionParams.readonly = (pTmp->Value() == "true");
     }
+    else if(pTmp->Name().compare("scan_batch_size") == 0) {
+      if(pTmp->Value().length() > 0)
+        m_scanBatchSize = atoi(pTmp->Value().c_str());
+    }
+    else if(pTmp->Name().compare("full_text_search") == 0) {
+      m_fullTextSearch = (pTmp->Value() != "false");
+    }
+    else if(pTmp->Name().compare("update_on_start") == 0) {
+      m_updateOnStart = (pTmp->Value() != "false");
+    }
+    else if(pTmp->Name().compare("read_connections") == 0) {
+      if(pTmp->Value().length() > 0)
+        m_readConnections = atoi(pTmp->Value().c_str());
+    }
   }
 
   return true;
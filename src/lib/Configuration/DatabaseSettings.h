@@ -19,6 +19,14 @@ class DatabaseSettings : public ConfigSettings
 
     CConnectionParams dbConnectionParams() { return m_dbConnectionParams; }
     void setDbFilename(std::string filename) { m_dbConnectionParams.filename = filename; }
+    // number of objects inserted per transaction when scanning the shared dirs. 0 = no transactions
+    unsigned int scanBatchSize() { return m_scanBatchSize; }
+    // use a full text index for "contains" searches if the database supports it
+    bool fullTextSearch() { return m_fullTextSearch; }
+    // rescan the modified directories of an existing database on startup
+    bool updateOnStart() { return m_updateOnStart; }
+    // max. number of read only connections used by browse and search requests. 0 = none
+    unsigned int readConnections() { return m_readConnections; }
 
     bool UseDefaultSettings(void);
 
@@ -27,6 +35,10 @@ class DatabaseSettings : public ConfigSettings
     virtual bool InitPostRead(void);
 
     CConnectionParams m_dbConnectionParams;
+    unsigned int      m_scanBatchSize;
+    bool              m_fullTextSearch;
+    bool              m_updateOnStart;
+    unsigned int      m_readConnections;
 };
 
 #endif
@@ -81,6 +81,11 @@ bool WriteDefaultConfigFile(std::string p_sFileName)
       xmlTextWriterWriteComment(pWriter, BAD_CAST "empty or 0 = random port");
       xmlTextWriterStartElement(pWriter, BAD_CAST "http_port");
       xmlTextWriterEndElement(pWriter); 
+
+      xmlTextWriterWriteComment(pWriter, BAD_CAST "number of threads handling HTTP requests. 0 = one thread per connection");
+      xmlTextWriterStartElement(pWriter, BAD_CAST "http_workers");
+      xmlTextWriterWriteString(pWriter, BAD_CAST "4");
+      xmlTextWriterEndElement(pWriter); 
   
       xmlTextWriterWriteComment(pWriter, BAD_CAST "list of ip addresses allowed to access fuppes. if empty all ips are allowed");
       xmlTextWriterStartElement(pWriter, BAD_CAST "allowed_ips");        
@@ -121,6 +126,26 @@ bool WriteDefaultConfigFile(std::string p_sFileName)
       xmlTextWriterStartElement(pWriter, BAD_CAST "readonly");
       xmlTextWriterWriteString(pWriter, BAD_CAST "false");
       xmlTextWriterEndElement(pWriter); 
+
+      xmlTextWriterWriteComment(pWriter, BAD_CAST "number of objects inserted per transaction when scanning the shared dirs. 0 = no transactions");
+      xmlTextWriterStartElement(pWriter, BAD_CAST "scan_batch_size");
+      xmlTextWriterWriteString(pWriter, BAD_CAST "1000");
+      xmlTextWriterEndElement(pWriter); 
+
+      xmlTextWriterWriteComment(pWriter, BAD_CAST "use a full text index for \"contains\" searches (sqlite3 only)");
+      xmlTextWriterStartElement(pWriter, BAD_CAST "full_text_search");
+      xmlTextWriterWriteString(pWriter, BAD_CAST "true");
+      xmlTextWriterEndElement(pWriter); 
+
+      xmlTextWriterWriteComment(pWriter, BAD_CAST "rescan the directories modified since the last scan on startup");
+      xmlTextWriterStartElement(pWriter, BAD_CAST "update_on_start");
+      xmlTextWriterWriteString(pWriter, BAD_CAST "true");
+      xmlTextWriterEndElement(pWriter); 
+
+      xmlTextWriterWriteComment(pWriter, BAD_CAST "max. number of read only connections for browse and search requests. 0 = none");
+      xmlTextWriterStartElement(pWriter, BAD_CAST "read_connections");
+      xmlTextWriterWriteString(pWriter, BAD_CAST "4");
+      xmlTextWriterEndElement(pWriter); 
   
     // end database
     xmlTextWriterEndElement(pWriter);
@@ -139,6 +164,54 @@ bool WriteDefaultConfigFile(std::string p_sFileName)
       xmlTextWriterStartElement(pWriter, BAD_CAST "local_charset");
       xmlTextWriterWriteString(pWriter, BAD_CAST "UTF-8");
       xmlTextWriterEndElement(pWriter); 
+
+      // browse cache
+      xmlTextWriterWriteComment(pWriter, BAD_CAST "max. memory (in MB) used to cache browse responses. 0 = disabled");
+      xmlTextWriterStartElement(pWriter, BAD_CAST "browse_cache_size");
+      xmlTextWriterWriteString(pWriter, BAD_CAST "4");
+      xmlTextWriterEndElement(pWriter); 
+
+      // image cache
+      xmlTextWriterWriteComment(pWriter, BAD_CAST "max. memory (in MB) used to cache scaled images. 0 = disabled");
+      xmlTextWriterStartElement(pWriter, BAD_CAST "image_cache_size");
+      xmlTextWriterWriteString(pWriter, BAD_CAST "8");
+      xmlTextWriterEndElement(pWriter); 
+      xmlTextWriterWriteComment(pWriter, BAD_CAST "max. disk space (in MB) used to cache scaled images. 0 = disabled");
+      xmlTextWriterStartElement(pWriter, BAD_CAST "image_disk_cache_size");
+      xmlTextWriterWriteString(pWriter, BAD_CAST "256");
+      xmlTextWriterEndElement(pWriter); 
+
+      // thumbnail pre-rendering
+      xmlTextWriterWriteComment(pWriter, BAD_CAST "number of threads pre-rendering thumbnails of new items. 0 = disabled");
+      xmlTextWriterStartElement(pWriter, BAD_CAST "thumbnail_workers");
+      xmlTextWriterWriteString(pWriter, BAD_CAST "1");
+      xmlTextWriterEndElement(pWriter); 
+      xmlTextWriterWriteComment(pWriter, BAD_CAST "max. number of thumbnails per second rendered in the background. 0 = unlimited");
+      xmlTextWriterStartElement(pWriter, BAD_CAST "thumbnails_per_second");
+      xmlTextWriterWriteString(pWriter, BAD_CAST "2");
+      xmlTextWriterEndElement(pWriter); 
+
+      // metadata extraction
+      xmlTextWriterWriteComment(pWriter, BAD_CAST "number of threads extracting metadata. 0 = number of cpus");
+      xmlTextWriterStartElement(pWriter, BAD_CAST "metadata_workers");
+      xmlTextWriterWriteString(pWriter, BAD_CAST "0");
+      xmlTextWriterEndElement(pWriter); 
+      xmlTextWriterWriteComment(pWriter, BAD_CAST "max. number of files per second read by the metadata workers. 0 = unlimited");
+      xmlTextWriterStartElement(pWriter, BAD_CAST "metadata_files_per_second");
+      xmlTextWriterWriteString(pWriter, BAD_CAST "0");
+      xmlTextWriterEndElement(pWriter); 
+
+      // directory scan
+      xmlTextWriterWriteComment(pWriter, BAD_CAST "number of threads reading directories during a database rebuild");
+      xmlTextWriterStartElement(pWriter, BAD_CAST "directory_readers");
+      xmlTextWriterWriteString(pWriter, BAD_CAST "4");
+      xmlTextWriterEndElement(pWriter); 
+
+      // file alteration monitor
+      xmlTextWriterWriteComment(pWriter, BAD_CAST "ms without file system events before the collected events are written to the database");
+      xmlTextWriterStartElement(pWriter, BAD_CAST "fam_quiet_period");
+      xmlTextWriterWriteString(pWriter, BAD_CAST "500");
+      xmlTextWriterEndElement(pWriter); 
     
       // libs for metadata extraction
       /*xmlTextWriterWriteComment(pWriter, BAD_CAST "libs used for metadata extraction when building the database. [true|false]");
@@ -169,6 +242,18 @@ bool WriteDefaultConfigFile(std::string p_sFileName)
       xmlTextWriterWriteString(pWriter, BAD_CAST "false");
       xmlTextWriterEndElement(pWriter);
 
+      // transcoding_memory_limit
+			xmlTextWriterWriteComment(pWriter, BAD_CAST "max. memory (in MB) used by a transcoding stream. older data is moved to temp_dir. 0 = unlimited");
+      xmlTextWriterStartElement(pWriter, BAD_CAST "transcoding_memory_limit");
+      xmlTextWriterWriteString(pWriter, BAD_CAST "8");
+      xmlTextWriterEndElement(pWriter);
+
+      // transcoding_deadline
+			xmlTextWriterWriteComment(pWriter, BAD_CAST "seconds a stream waits for new data from the transcoder before it is aborted");
+      xmlTextWriterStartElement(pWriter, BAD_CAST "transcoding_deadline");
+      xmlTextWriterWriteString(pWriter, BAD_CAST "10");
+      xmlTextWriterEndElement(pWriter);
+
     // end global_settings
     xmlTextWriterEndElement(pWriter);
     
@@ -11,6 +11,8 @@ using namespace fuppes;
 
 void GlobalSettings::InitVariables(void) {
 	m_useFixedUUID 	= false;
+	m_nTranscodingMemoryLimit = 8;
+	m_nTranscodingDeadline = 10;
 
   // setup temp dir
   if(m_sTempDir.empty()) {
@@ -56,6 +58,16 @@ bool GlobalSettings::Read(void)
 		else if(pTmp->Name().compare("use_fixed_uuid") == 0) {
       m_useFixedUUID = (pTmp->Value().compare("true") == 0);
     }	
+    else if(pTmp->Name().compare("transcoding_memory_limit") == 0) {
+      if(pTmp->Value().length() > 0) {
+        m_nTranscodingMemoryLimit = atoi(pTmp->Value().c_str());
+      }
+    }
+    else if(pTmp->Name().compare("transcoding_deadline") == 0) {
+      if(pTmp->Value().length() > 0) {
+        m_nTranscodingDeadline = atoi(pTmp->Value().c_str());
+      }
+    }
     else if(pTmp->Name().compare("trash_dir") == 0) {
       if(pTmp->Value().length() > 0) {
         m_sTrashDir = pTmp->Value();
@@ -21,6 +21,10 @@ class GlobalSettings : public ConfigSettings
     void        SetFriendlyName(std::string p_sFriendlyName) { m_sFriendlyName = p_sFriendlyName; }
 
     bool        UseFixedUUID(void) { return m_useFixedUUID; }
+    // max. memory (in MB) a transcoding stream may use. 0 = unlimited
+    unsigned int TranscodingMemoryLimit(void) { return m_nTranscodingMemoryLimit; }
+    // seconds a stream waits for the transcoder before it is aborted
+    unsigned int TranscodingDeadline(void) { return m_nTranscodingDeadline; }
   private:
     virtual void InitVariables(void);
 
@@ -28,6 +32,8 @@ class GlobalSettings : public ConfigSettings
 		std::string		m_sTempDir;
 		bool					m_useFixedUUID;
 		std::string   m_sTrashDir;
+		unsigned int  m_nTranscodingMemoryLimit;
+		unsigned int  m_nTranscodingDeadline;
 };
 
 #endif
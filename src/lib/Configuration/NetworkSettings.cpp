@@ -30,6 +30,7 @@ NetworkSettings::NetworkSettings()
   #else
   m_nHTTPPort = 0;
   #endif
+  m_nHTTPWorkers = 4;
   m_sNetInterface = "";  
 }
 
@@ -256,6 +257,11 @@ bool NetworkSettings::Read(void)
         m_nHTTPPort = atoi(pStart->ChildNode(i)->Value().c_str());
       } 
     }
+    else if(pStart->ChildNode(i)->Name().compare("http_workers") == 0) {
+      if(pStart->ChildNode(i)->Value().length() > 0) {
+        m_nHTTPWorkers = atoi(pStart->ChildNode(i)->Value().c_str());
+      } 
+    }
     else if(pStart->ChildNode(i)->Name().compare("allowed_ips") == 0) {
       for(j = 0; j < pStart->ChildNode(i)->ChildCount(); j++) {
         if(pStart->ChildNode(i)->ChildNode(j)->Name().compare("ip") == 0) {
@@ -28,6 +28,9 @@ class NetworkSettings : public ConfigSettings
   
     unsigned int GetHTTPPort() { return m_nHTTPPort; }
     bool SetHTTPPort(unsigned int p_nHTTPPort);
+
+    // number of HTTP worker threads (0 = one thread per connection)
+    unsigned int GetHTTPWorkers() { return m_nHTTPWorkers; }
     
     //  allowed ip
     unsigned int AllowedIPCount() { return m_lAllowedIps.size(); }
@@ -44,6 +47,7 @@ class NetworkSettings : public ConfigSettings
     std::string   m_sIP;
     std::string   m_sNetInterface;    
     unsigned int  m_nHTTPPort;
+    unsigned int  m_nHTTPWorkers;
 
     std::vector<std::string>  m_lAllowedIps;
   
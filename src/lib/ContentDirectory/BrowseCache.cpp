@@ -0,0 +1,149 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            BrowseCache.cpp
+ * 
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "BrowseCache.h"
+#include "ContentDatabase.h"
+#include "../UPnPActions/UPnPBrowse.h"
+#include "../SharedConfig.h"
+
+#include <sstream>
+
+using namespace std;
+using namespace fuppes;
+
+BrowseCache* BrowseCache::m_instance = NULL;
+
+BrowseCache* BrowseCache::Shared() // static
+{
+  if(m_instance == NULL)
+    m_instance = new BrowseCache();
+  return m_instance;
+}
+
+BrowseCache::BrowseCache()
+{
+  m_updateId  = CContentDatabase::systemUpdateId();
+  m_size      = 0;
+  m_maxSize   = CSharedConfig::Shared()->contentDirectory->BrowseCacheSize() * 1024 * 1024;
+  m_hits      = 0;
+  m_misses    = 0;
+}
+
+std::string BrowseCache::key(CUPnPBrowse* browse) // static
+{
+  stringstream result;
+  result << browse->objectId() << "\n" <<
+    browse->browseFlag() << "\n" <<
+    browse->virtualFolderLayout() << "\n" <<
+    (browse->DeviceSettings() ? browse->DeviceSettings()->name() : "") << "\n" <<
+    browse->m_sFilter << "\n" <<
+    browse->m_sortCriteria << "\n" <<
+    browse->m_nStartingIndex << "\n" <<
+    browse->m_nRequestedCount;
+  return result.str();
+}
+
+bool BrowseCache::get(const std::string& key, std::string* result)
+{
+  if(m_maxSize == 0)
+    return false;
+
+  MutexLocker locker(&m_mutex);
+  validate();
+
+  std::map<std::string, std::list<Entry>::iterator>::iterator iter = m_index.find(key);
+  if(iter == m_index.end()) {
+    m_misses++;
+    return false;
+  }
+
+  // move to the front
+  m_entries.splice(m_entries.begin(), m_entries, iter->second);
+  *result = iter->second->response;
+  m_hits++;
+  return true;
+}
+
+void BrowseCache::put(const std::string& key, const std::string& response, unsigned int updateId)
+{
+  unsigned int entrySize = (key.length() * 2) + response.length();
+  if(m_maxSize == 0 || entrySize > m_maxSize)
+    return;
+
+  MutexLocker locker(&m_mutex);
+  validate();
+
+  // the database changed while the response was built
+  if(updateId != m_updateId)
+    return;
+
+  if(m_index.find(key) != m_index.end())
+    return;
+
+  while(!m_entries.empty() && (m_size + entrySize) > m_maxSize) {
+    removeOldest();
+  }
+
+  Entry entry;
+  entry.key = key;
+  m_entries.push_front(entry);
+  m_entries.front().response = response;
+  m_index[key] = m_entries.begin();
+  m_size += entrySize;
+}
+
+void BrowseCache::clear()
+{
+  MutexLocker locker(&m_mutex);
+  m_entries.clear();
+  m_index.clear();
+  m_size = 0;
+}
+
+unsigned int BrowseCache::count()
+{
+  MutexLocker locker(&m_mutex);
+  return m_index.size();
+}
+
+void BrowseCache::validate()
+{
+  unsigned int updateId = CContentDatabase::systemUpdateId();
+  if(updateId == m_updateId)
+    return;
+
+  m_entries.clear();
+  m_index.clear();
+  m_size = 0;
+  m_updateId = updateId;
+}
+
+void BrowseCache::removeOldest()
+{
+  Entry& oldest = m_entries.back();
+  m_size -= (oldest.key.length() * 2) + oldest.response.length();
+  m_index.erase(oldest.key);
+  m_entries.pop_back();
+}
@@ -0,0 +1,94 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            BrowseCache.h
+ * 
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+ 
+#ifndef _BROWSECACHE_H
+#define _BROWSECACHE_H
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#include "../Common/Thread.h"
+
+#include <string>
+#include <list>
+#include <map>
+
+class CUPnPBrowse;
+
+/**
+ * LRU cache of complete Browse responses.
+ *
+ * renderers repeat the same Browse requests while the user scrolls.
+ * the responses are keyed by everything that changes their content.
+ * all entries are dropped as soon as the SystemUpdateID changes.
+ */
+class BrowseCache
+{
+  public:
+    static BrowseCache* Shared();
+
+    // the cache key for a browse request
+    static std::string key(CUPnPBrowse* browse);
+
+    // copies the cached response to result. returns false on a miss
+    bool get(const std::string& key, std::string* result);
+    // stores a response that was built with the given update id
+    void put(const std::string& key, const std::string& response, unsigned int updateId);
+    void clear();
+
+    unsigned int  hits() { return m_hits; }
+    unsigned int  misses() { return m_misses; }
+    unsigned int  count();
+    unsigned int  size() { return m_size; }
+    // max. memory in bytes. 0 = disabled
+    unsigned int  maxSize() { return m_maxSize; }
+
+  private:
+    BrowseCache();
+    static BrowseCache* m_instance;
+
+    struct Entry {
+      std::string key;
+      std::string response;
+    };
+
+    // drops everything if the SystemUpdateID changed. m_mutex must be locked
+    void validate();
+    void removeOldest();
+
+    fuppes::Mutex                     m_mutex;
+    // most recently used first
+    std::list<Entry>                  m_entries;
+    std::map<std::string, std::list<Entry>::iterator> m_index;
+
+    unsigned int                      m_updateId;
+    unsigned int                      m_size;
+    unsigned int                      m_maxSize;
+    unsigned int                      m_hits;
+    unsigned int                      m_misses;
+};
+
+#endif // _BROWSECACHE_H
@@ -28,7 +28,7 @@
 #endif
 
 // increment this value if the database structure has changed
-#define DB_VERSION 4
+#define DB_VERSION 7
 
 #include "ContentDatabase.h"
 #include "../SharedConfig.h"
@@ -44,11 +44,13 @@
 
 #include "DatabaseObject.h"
 #include "VirtualContainerMgr.h"
+#include "DirectoryWalker.h"
 
 #include <sstream>
 #include <string>
 #include <fstream>
 #include <cstdio>
+#include <cstring>
 #ifndef WIN32
 #include <dirent.h>
 #endif
@@ -84,6 +86,8 @@ CContentDatabase::CContentDatabase()
 	m_rebuildThread		= NULL;
   m_objectId				= 0;
   m_systemUpdateId  = 0;
+  m_rootUpdateId    = 0;
+  m_fullTextSearch  = false;
   m_fileAlterationHandler = new FileAlterationHandler();
   m_pFileAlterationMonitor = CFileAlterationMgr::CreateMonitor(m_fileAlterationHandler);
   m_fileAlterationHandler->setMonitor(m_pFileAlterationMonitor);
@@ -161,6 +165,27 @@ bool CContentDatabase::Init(bool* p_bIsNewDB)
 		return false;
 	}
 
+  // full text index
+  if(strlen(qry.connection()->getStatement(SQL_FULL_TEXT_INDEX_EXISTS)) > 0) {
+    qry.select(qry.build(SQL_FULL_TEXT_INDEX_EXISTS, 0));
+    bool exists = !qry.eof();
+    bool enabled = CSharedConfig::Shared()->databaseSettings->fullTextSearch();
+
+    if(CDatabase::connectionParams().readonly) {
+      m_fullTextSearch = exists;
+    }
+    else if(enabled && !exists) {
+      CSharedLog::Print("[ContentDatabase] creating full text index");
+      m_fullTextSearch = createFullTextIndex(&qry);
+    }
+    else if(!enabled) {
+      // also removes an index of an older format
+      dropFullTextIndex(&qry);
+    }
+    else {
+      m_fullTextSearch = exists;
+    }
+  }
 
 	
 
@@ -204,6 +229,91 @@ void CContentDatabase::incSystemUpdateId() // static
   // todo: execute "Service Reset Procedure" if m_systemUpdateId reaches it's max value
 }
 
+void CContentDatabase::incContainerUpdateId(object_id_t containerId, bool incSystem /*= true*/) // static
+{
+  unsigned int updateId;
+  if(containerId > 0) {
+    SQLQuery qry;
+    qry.prepare("update OBJECTS set UPDATE_ID = UPDATE_ID + 1 where OBJECT_ID = ?1 and DEVICE is NULL");
+    qry.bind(1, (fuppes_off_t)containerId);
+    qry.execute();
+    qry.clear();
+    updateId = containerUpdateId(containerId);
+  }
+
+  fuppes::MutexLocker locker(&m_Instance->m_containerUpdateMutex);
+  if(containerId == 0) {
+    updateId = ++m_Instance->m_rootUpdateId;
+  }
+  m_Instance->m_changedContainers[containerId] = updateId;
+  if(incSystem)
+    incSystemUpdateId();
+}
+
+bool CContentDatabase::createFullTextIndex(SQLQuery* qry) // static
+{
+  std::string sql = qry->connection()->getStatement(SQL_CREATE_FULL_TEXT_INDEX);
+  if(sql.empty())
+    return false;
+
+  // an index of an older format has the same name
+  dropFullTextIndex(qry);
+  if(!qry->exec(sql)) {
+    // e.g. sqlite built without fts5 or the trigram tokenizer
+    CSharedLog::Log(L_NORM, __FILE__, __LINE__, "unable to create the full text index. using plain searches");
+    dropFullTextIndex(qry);
+    return false;
+  }
+  return true;
+}
+
+void CContentDatabase::dropFullTextIndex(SQLQuery* qry) // static
+{
+  std::string sql = qry->connection()->getStatement(SQL_DROP_FULL_TEXT_INDEX);
+  if(!sql.empty())
+    qry->exec(sql);
+}
+
+unsigned int CContentDatabase::containerUpdateId(object_id_t containerId, std::string device /*= ""*/) // static
+{
+  if(containerId == 0)
+    return m_Instance->m_rootUpdateId;
+
+  SQLQuery qry;
+  qry.execute(SQL_GET_OBJECT_TYPE, containerId, device);
+  unsigned int updateId = m_Instance->m_systemUpdateId;
+  if(!qry.eof() && qry.result()->asInt("TYPE") < CONTAINER_MAX)
+    updateId = qry.result()->asUInt("UPDATE_ID");
+  qry.clear();
+  return updateId;
+}
+
+std::string CContentDatabase::takeContainerUpdateIds() // static
+{
+  std::stringstream result;
+  char id[11];
+
+  fuppes::MutexLocker locker(&m_Instance->m_containerUpdateMutex);
+  std::map<object_id_t, unsigned int>::iterator iter;
+  for(iter = m_Instance->m_changedContainers.begin(); iter != m_Instance->m_changedContainers.end(); iter++) {
+    if(iter != m_Instance->m_changedContainers.begin())
+      result << ",";
+
+    // same format as the object ids in the DIDL-Lite
+    if(iter->first > 0) {
+      sprintf(id, "%010X", (unsigned int)iter->first);
+      result << id;
+    }
+    else {
+      result << "0";
+    }
+    result << "," << iter->second;
+  }
+  m_Instance->m_changedContainers.clear();
+
+  return result.str();
+}
+
 
 void BuildPlaylists();
 void ParsePlaylist(CSQLResult* pResult);
@@ -292,17 +402,19 @@ unsigned int CContentDatabase::GetObjId() // static
 
 
 
-unsigned int CContentDatabase::insertFile(std::string fileName, object_id_t parentId /*= 0*/, SQLQuery* qry /*= NULL*/, bool lock /*= false*/) // static
+unsigned int CContentDatabase::insertFile(std::string fileName, object_id_t parentId /*= 0*/, SQLQuery* qry /*= NULL*/, bool lock /*= false*/, bool checkExisting /*= true*/, const fuppes::ScannedFile* file /*= NULL*/) // static
 {
   if(lock) {
     MutexLocker locker(&m_Instance->m_insertMutex);
   }
-  
-  DbObject* file = DbObject::createFromFileName(fileName, qry);
-  if(file) {
-    object_id_t result = file->objectId();
-    delete file;
-    return result;
+
+  if(checkExisting) {
+    DbObject* file = DbObject::createFromFileName(fileName, qry);
+    if(file) {
+      object_id_t result = file->objectId();
+      delete file;
+      return result;
+    }
   }
   
 
@@ -315,6 +427,18 @@ unsigned int CContentDatabase::insertFile(std::string fileName, object_id_t pare
   }
 
   bool visible = !CSharedConfig::isAlbumArtFile(fileName);
+
+  // the file's state for the next update
+  ScannedFile fingerprint;
+  if(file == NULL) {
+    struct stat info;
+    if(stat(fileName.c_str(), &info) == 0) {
+      fingerprint.size = info.st_size;
+      fingerprint.modified = info.st_mtime;
+      fingerprint.inode = info.st_ino;
+    }
+    file = &fingerprint;
+  }
   
   // split path and filename
   string path = ExtractFilePath(fileName);
@@ -343,6 +467,7 @@ unsigned int CContentDatabase::insertFile(std::string fileName, object_id_t pare
   obj.setFileName(fileName);
   obj.setTitle(title);  
   obj.setVisible(visible);
+  obj.setFingerprint(file->size, file->modified, file->inode);
   obj.save(qry);
 
   
@@ -437,135 +562,162 @@ void ScanDirectoryThread::scanDir(SQLQuery* qry, std::string path, unsigned int
 
 
 
-void RebuildThread::DbScanDir(CContentDatabase* db, SQLQuery* qry, std::string p_sDirectory, long long int p_nParentId)
+void RebuildThread::DbScanDir(CContentDatabase* db, SQLQuery* qry, DirectoryWalker* walker)
 {
-	p_sDirectory = appendTrailingSlash(p_sDirectory);
+  DbObject obj;
+  ScannedDirectory* dir;
+  std::map<std::string, object_id_t>::iterator iter;
+  std::map<std::string, DbObject*> files;
+  std::map<std::string, DbObject*>::iterator file;
+  std::string albumArt;
+  object_id_t objectId;
+  bool update = (m_rebuildType & RebuildThread::addNew);
+  bool removeMissing = (m_rebuildType & RebuildThread::removeMissing);
+
+  // a directory modified during the scan may change again within the
+  // same second. we don't store its time so it is read again next time
+  time_t modified;
+
+  if(update)
+    walker->setKnownDirectories(&m_knownDirectories);
+  walker->start();
+  while((dir = walker->next()) != NULL) {
+
+    if(stopRequested()) {
+      delete dir;
+      walker->stop();
+      break;
+    }
 
-	if(!Directory::exists(p_sDirectory))
-		return;
+    FUPPES_LOG(Log::contentdb, Log::extended, "read dir \"%s\"", dir->path.c_str());
 
-  Log::log(Log::contentdb, Log::extended, __FILE__, __LINE__, "read dir \"%s\"", p_sDirectory.c_str());
+    modified = (dir->modified < m_scanStart) ? dir->modified : 0;
 
+    // the shared directories are inserted by run() and every other
+    // directory is passed after its parent
+    objectId = 0;
+    if(dir->root || update) {
+      iter = m_directories.find(dir->path);
+      if(iter != m_directories.end())
+        objectId = iter->second;
+    }
 
-  DbObject obj;
-  
-  #ifdef WIN32
-  char szTemp[MAX_PATH];
-  strcpy(szTemp, p_sDirectory.c_str());
-  
-  // Add search criteria
-  strcat(szTemp, "*");
+    if(dir->unchanged && objectId > 0) {
+      m_unchangedDirCount++;
+      delete dir;
+      continue;
+    }
 
-  /* Find first file */
-  WIN32_FIND_DATA data;
-  HANDLE hFile = FindFirstFile(szTemp, &data);
-  if(NULL == hFile)
-    return;
+    albumArt = "";
+    if(objectId == 0) {
 
-  /* Loop trough all subdirectories and files */
-  while(TRUE == FindNextFile(hFile, &data))
-  {
-    if(((string(".").compare(data.cFileName) != 0) && 
-      (string("..").compare(data.cFileName) != 0)))
-    {        
-      
-      /* Save current filename */
-      strcpy(szTemp, p_sDirectory.c_str());
-      //strcat(szTemp, upnpPathDelim);
-      strcat(szTemp, data.cFileName);
-      
-      string sTmp;
-      sTmp = szTemp;
-      
-      string sTmpFileName = data.cFileName;
-  #else
-      
-  DIR*    pDir;
-  dirent* pDirEnt;
-  string  sTmp;
-  
-  if((pDir = opendir(p_sDirectory.c_str())) != NULL)
-  {    
-    CSharedLog::Log(L_EXT, __FILE__, __LINE__, "read directory: %s",  p_sDirectory.c_str());
-    while((pDirEnt = readdir(pDir)) != NULL)
-    {
-      if(((string(".").compare(pDirEnt->d_name) != 0) && 
-         (string("..").compare(pDirEnt->d_name) != 0)))
-      {        
-        sTmp = p_sDirectory + pDirEnt->d_name;        
-        string sTmpFileName = pDirEnt->d_name;        
-  #endif  
-                
-        string sExt = ExtractFileExt(sTmp);
-        unsigned int nObjId = 0;
-        
-        /* directory */
-        if(Directory::exists(sTmp) && !Directory::hidden(sTmp)) {
-					
-          sTmpFileName = ToUTF8(sTmpFileName);          
-          sTmpFileName = SQLEscape(sTmpFileName);        
-          
-          stringstream sSql;
-          
-          appendTrailingSlash(&sTmp);
-          
-          if(m_rebuildType & RebuildThread::addNew) {
-            nObjId = GetObjectIDFromFileName(qry, sTmp);
-          }
-          
-          if(nObjId == 0) {
+      iter = m_directories.find(dir->parent);
+      if(dir->root || iter == m_directories.end()) {
+        delete dir;
+        continue;
+      }
 
-            nObjId = db->GetObjId();
-						OBJECT_TYPE folderType = CONTAINER_STORAGE_FOLDER;
-	
-						// check for album art
-						string albumArt = findAlbumArtFile(sTmp);
-						if(albumArt.length() > 0) {
-							
-							unsigned int artId = GetObjectIDFromFileName(qry, albumArt);
+      objectId = db->GetObjId();
+      OBJECT_TYPE folderType = CONTAINER_STORAGE_FOLDER;
+
+      // check for album art
+      if(!dir->albumArt.empty()) {
+        unsigned int artId = 0;
+        if(update)
+          artId = GetObjectIDFromFileName(qry, dir->path + dir->albumArt);
 #warning device compatibility!?
-							folderType = CONTAINER_ALBUM_MUSIC_ALBUM;
-							if(artId == 0) {
-								InsertFile(db, qry, nObjId, albumArt, true);
-							}
-						}
-
-            
-            obj.reset();
-            obj.setObjectId(nObjId);
-            obj.setParentId(p_nParentId);
-            obj.setType(folderType);
-            obj.setPath(sTmp);
-            obj.setTitle(sTmpFileName);
-            obj.save(qry);
-
-            
-            db->fileAlterationMonitor()->addWatch(sTmp);
+        folderType = CONTAINER_ALBUM_MUSIC_ALBUM;
+        if(artId == 0) {
+          // album art files are inserted together with their directory
+          albumArt = dir->albumArt;
+          for(size_t i = 0; i < dir->files.size(); i++) {
+            if(dir->files[i].name == albumArt)
+              InsertFile(db, qry, objectId, dir->path + albumArt, true, &dir->files[i]);
           }
-            
-          // recursively scan subdirectories
-          DbScanDir(db, qry, sTmp, nObjId);          
         }
-        else if(File::exists(sTmp) && CFileDetails::Shared()->IsSupportedFileExtension(sExt)) {
-          
-          unsigned int objId = 0;
-          if(m_rebuildType & RebuildThread::addNew)
-            objId = GetObjectIDFromFileName(qry, sTmp);
-
-					if(objId == 0) {
-	          InsertFile(db, qry, p_nParentId, sTmp);
-            msleep(1);
-					}
-
-          
-        }         
-       
       }
-    }  /* while */  
-  #ifndef WIN32
-    closedir(pDir);
-  } /* if opendir */
-  #endif         
+
+      obj.reset();
+      obj.setObjectId(objectId);
+      obj.setParentId(iter->second);
+      obj.setType(folderType);
+      obj.setPath(dir->path);
+      obj.setTitle(ToUTF8(dir->name));
+      obj.setFingerprint(0, modified, 0);
+      obj.save(qry);
+
+      m_directories[dir->path] = objectId;
+      inserted(qry, false);
+
+      db->fileAlterationMonitor()->addWatch(dir->path);
+    }
+    else if(update) {
+      // the directory has been modified since the last scan
+      qry->prepare("update OBJECTS set FILE_MTIME = ?1 where OBJECT_ID = ?2 and DEVICE is NULL");
+      qry->bind(1, (fuppes_off_t)modified);
+      qry->bind(2, (fuppes_off_t)objectId);
+      qry->execute();
+      qry->clear();
+    }
+
+    // the files that are already in the db
+    files.clear();
+    if(update) {
+      loadFiles(qry, objectId, &files);
+    }
+
+    for(size_t i = 0; i < dir->files.size(); i++) {
+      if(dir->files[i].name == albumArt)
+        continue;
+
+      file = files.find(dir->files[i].name);
+      if(file == files.end()) {
+        InsertFile(db, qry, objectId, dir->path + dir->files[i].name, false, &dir->files[i]);
+        continue;
+      }
+
+      // the file has changed. the update thread reads the metadata again
+      if(file->second->fileSize() != dir->files[i].size ||
+         file->second->fileModified() != dir->files[i].modified ||
+         file->second->fileInode() != dir->files[i].inode) {
+        file->second->setFingerprint(dir->files[i].size, dir->files[i].modified, dir->files[i].inode);
+        file->second->setLastModified(DateTime::now().toInt());
+        file->second->save(qry);
+        m_changedFileCount++;
+      }
+
+      delete file->second;
+      files.erase(file);
+    }
+
+    // the remaining files and the subdirectories that are no longer there
+    if(update && removeMissing) {
+      for(file = files.begin(); file != files.end(); file++) {
+        removeObject(qry, file->second);
+      }
+
+      KnownDirectoryMap::iterator known = m_knownDirectories.find(dir->path);
+      if(known != m_knownDirectories.end()) {
+        std::set<std::string> directories(dir->directories.begin(), dir->directories.end());
+        for(size_t i = 0; i < known->second.directories.size(); i++) {
+          if(directories.find(known->second.directories[i]) != directories.end())
+            continue;
+          DbObject* missing = DbObject::createFromFileName(dir->path + known->second.directories[i] + upnpPathDelim, qry);
+          if(missing) {
+            removeObject(qry, missing);
+            delete missing;
+          }
+        }
+      }
+    }
+    for(file = files.begin(); file != files.end(); file++) {
+      delete file->second;
+    }
+
+    delete dir;
+  }
+
+  m_readDirCount += walker->directoryCount();
 }
 
 std::string findAlbumArtFile(std::string dir)
@@ -625,32 +777,129 @@ unsigned int findAlbumArt(std::string dir, std::string* ext, SQLQuery* qry)
 	string path = ExtractFilePath(file);
 	file = file.substr(path.length(), file.length());
 
-	qry->select("select * from OBJECTS "
-							"where PATH = '" + SQLEscape(path) + "' and "
-							"FILE_NAME = '" + SQLEscape(file) + "' and "
-							"DEVICE is NULL");
+	qry->prepare("select OBJECT_ID from OBJECTS "
+							 "where PATH = ?1 and "
+							 "FILE_NAME = ?2 and "
+							 "DEVICE is NULL");
+  qry->bind(1, path);
+  qry->bind(2, file);
+  qry->execute();
 	if(qry->eof()) {
 		return 0;
 	}
 
 	*ext = ExtractFileExt(file);
-	return qry->result()->asUInt("OBJECT_ID");
+	unsigned int result = qry->result()->asUInt("OBJECT_ID");
+  qry->clear();
+  return result;
 }
 
 
 
-unsigned int RebuildThread::InsertFile(CContentDatabase* pDb, SQLQuery* qry, unsigned int p_nParentId, std::string p_sFileName, bool hidden /* = false*/)
+// the caller has to make sure the file is not in the db
+unsigned int RebuildThread::InsertFile(CContentDatabase* pDb, SQLQuery* qry, unsigned int p_nParentId, std::string p_sFileName, bool hidden /* = false*/, const fuppes::ScannedFile* file /*= NULL*/)
 {
-  unsigned int nObjId = 0;
- 
-  if(m_rebuildType & RebuildThread::addNew) {
-    nObjId = GetObjectIDFromFileName(qry, p_sFileName);
-    if(nObjId > 0) {
-      return nObjId;
+  unsigned int nObjId = CContentDatabase::insertFile(p_sFileName, p_nParentId, qry, false, false, file);
+  if(nObjId > 0)
+    inserted(qry, true);
+  return nObjId;
+}
+
+void RebuildThread::loadDirectories(SQLQuery* qry)
+{
+  m_directories.clear();
+  m_knownDirectories.clear();
+
+  std::string path;
+  std::string parent;
+  qry->prepare("select OBJECT_ID, PATH, FILE_MTIME from OBJECTS where "
+               "TYPE < ?1 and REF_ID = 0 and DEVICE is NULL and FILE_NAME is NULL");
+  qry->bind(1, (fuppes_off_t)CONTAINER_MAX);
+  qry->execute();
+  while(!qry->eof()) {
+    path = qry->result()->asString("PATH");
+    m_directories[path] = qry->result()->asUInt("OBJECT_ID");
+    m_knownDirectories[path].modified = qry->result()->asInt("FILE_MTIME");
+
+    // register the directory with its parent
+    parent = ExtractFilePath(path.substr(0, path.length() - 1));
+    if(!parent.empty() && parent.length() < path.length()) {
+      m_knownDirectories[parent].directories.push_back(path.substr(parent.length(), path.length() - parent.length() - 1));
     }
-  } 
+    qry->next();
+  }
+  qry->clear();
+}
 
-  return CContentDatabase::insertFile(p_sFileName);
+void RebuildThread::loadFiles(SQLQuery* qry, object_id_t parentId, std::map<std::string, DbObject*>* files)
+{
+  qry->prepare("select * from OBJECTS where "
+               "PARENT_ID = ?1 and REF_ID = 0 and DEVICE is NULL and FILE_NAME is not NULL");
+  qry->bind(1, (fuppes_off_t)parentId);
+  qry->execute();
+  while(!qry->eof()) {
+    (*files)[qry->result()->asString("FILE_NAME")] = new DbObject(qry->result());
+    qry->next();
+  }
+  qry->clear();
+}
+
+void RebuildThread::removeObject(SQLQuery* qry, DbObject* object)
+{
+  // the virtual folders are updated on the default connection
+  // so we have to commit the current batch first
+  if(m_batchSize > 0 && !qry->connection()->commit())
+    m_failedBatchCount++;
+
+  if(object->type() < CONTAINER_MAX)
+    VirtualContainerMgr::deleteDirectory(object);
+  else
+    VirtualContainerMgr::deleteFile(object);
+
+  if(m_batchSize > 0)
+    qry->connection()->startTransaction();
+  m_batchCount = 0;
+
+  object->remove(qry);
+  m_removedCount++;
+}
+
+void RebuildThread::inserted(SQLQuery* qry, bool file)
+{
+  if(file)
+    m_fileCount++;
+  else
+    m_dirCount++;
+
+  m_batchCount++;
+  if(m_batchSize > 0 && m_batchCount >= m_batchSize)
+    commit(qry);
+}
+
+void RebuildThread::commit(SQLQuery* qry, bool last /*= false*/)
+{
+  if(m_batchSize > 0) {
+    if(!qry->connection()->commit())
+      m_failedBatchCount++;
+    if(!last)
+      qry->connection()->startTransaction();
+  }
+  m_batchCount = 0;
+
+  unsigned int now = fuppesTicks();
+  if(!last && (now - m_progressTicks) < 10000)
+    return;
+  m_progressTicks = now;
+
+  unsigned int seconds = (now - m_startTicks) / 1000;
+  if(seconds == 0)
+    seconds = 1;
+  CSharedLog::Print("[ContentDatabase] %u files, %u directories (%u files/s, %u directories/s)",
+                    m_fileCount, m_dirCount, m_fileCount / seconds, m_dirCount / seconds);
+  if(last) {
+    CSharedLog::Print("[ContentDatabase] %u directories read (%u directories/s)",
+                      m_readDirCount, m_readDirCount / seconds);
+  }
 }
 
 unsigned int InsertURL(std::string p_sURL,
@@ -698,7 +947,7 @@ void BuildPlaylists()
 unsigned int GetObjectIDFromFileName(SQLQuery* qry, std::string p_sFileName)
 {
   unsigned int nResult = 0;
-  stringstream sSQL;
+  string sql;
 	
 	string path = ExtractFilePath(p_sFileName);
 	string fileName;
@@ -706,24 +955,29 @@ unsigned int GetObjectIDFromFileName(SQLQuery* qry, std::string p_sFileName)
 		fileName = p_sFileName.substr(path.length(), p_sFileName.length());
 	}
 	
-  sSQL << 
+  sql =
 		"select OBJECT_ID "
 		"from OBJECTS "
 		"where "
     "  REF_ID = 0 and "
-    "  PATH = '" << SQLEscape(path) << "' ";
+    "  PATH = ?1 ";
 	
 	if(fileName.empty())
-		sSQL << " and FILE_NAME is NULL ";
+		sql += " and FILE_NAME is NULL ";
 	else
-		sSQL << " and FILE_NAME = '" + SQLEscape(fileName) + "' ";
+		sql += " and FILE_NAME = ?2 ";
 	
-	sSQL <<
+	sql +=
 		"and DEVICE is NULL";
   
-  qry->select(sSQL.str());
+  qry->prepare(sql);
+  qry->bind(1, path);
+  if(!fileName.empty())
+    qry->bind(2, fileName);
+  qry->execute();
   if(!qry->eof())
     nResult = qry->result()->asUInt("OBJECT_ID");
+  qry->clear();
   
   return nResult;
 }
@@ -801,9 +1055,14 @@ void RebuildThread::run()
   stringstream sSql;
 		
   if(m_rebuildType & RebuildThread::rebuild) {
+    // recreating the empty index is cheaper than a trigger call per deleted row
+    if(CContentDatabase::fullTextSearch())
+      CContentDatabase::dropFullTextIndex(&qry);
     qry.exec("delete from OBJECTS");
     qry.exec("delete from OBJECT_DETAILS");
     //qry.exec("delete from MAP_OBJECTS");
+    if(CContentDatabase::fullTextSearch())
+      CContentDatabase::createFullTextIndex(&qry);
   }
 
 	/*pDb->Execute("drop index IDX_OBJECTS_OBJECT_ID");
@@ -812,7 +1071,8 @@ void RebuildThread::run()
 	pDb->Execute("drop index IDX_OBJECTS_DETAIL_ID");
 	pDb->Execute("drop index IDX_OBJECT_DETAILS_ID");*/
 
-  if(m_rebuildType & RebuildThread::removeMissing) {
+  // an update removes the missing objects while scanning the modified directories
+  if((m_rebuildType & RebuildThread::removeMissing) && !(m_rebuildType & RebuildThread::addNew)) {
 	
 		CSharedLog::Print("remove missing");		
 		//CContentDatabase* pDel = new CContentDatabase();
@@ -869,6 +1129,41 @@ void RebuildThread::run()
 
 	CContentDatabase* db = CContentDatabase::Shared();
   SharedObjects* so = CSharedConfig::Shared()->sharedObjects();
+
+  // the scan uses its own connection so the inserts can be batched
+  // into transactions without affecting other queries
+  m_batchSize = CSharedConfig::Shared()->databaseSettings->scanBatchSize();
+  CDatabaseConnection* connection = NULL;
+  if(m_batchSize > 0) {
+    connection = CDatabase::connection(true);
+    if(!connection)
+      m_batchSize = 0;
+  }
+  SQLQuery* scan = new SQLQuery(connection);
+
+  m_batchCount = 0;
+  m_fileCount = 0;
+  m_dirCount = 0;
+  m_readDirCount = 0;
+  m_unchangedDirCount = 0;
+  m_changedFileCount = 0;
+  m_removedCount = 0;
+  m_failedBatchCount = 0;
+  m_scanStart = time(NULL);
+  m_startTicks = fuppesTicks();
+  m_progressTicks = m_startTicks;
+
+  if(m_rebuildType & RebuildThread::addNew)
+    loadDirectories(scan);
+  else
+    m_directories.clear();
+
+  if(m_batchSize > 0)
+    connection->startTransaction();
+
+  // the directories are read by a pool of threads and
+  // inserted by this thread once all shared directories are added
+  DirectoryWalker walker(CSharedConfig::Shared()->contentDirectory->DirectoryReaders());
 	
   for(i = 0; i < so->SharedDirCount(); i++) {
     string tempSharedDir = so->GetSharedDir(i);
@@ -880,7 +1175,9 @@ void RebuildThread::run()
       ExtractFolderFromPath(tempSharedDir, &sFileName);
       bInsert = true;
       if(m_rebuildType & RebuildThread::addNew) {
-        if((nObjId = GetObjectIDFromFileName(&qry, tempSharedDir)) > 0) {
+        std::map<std::string, object_id_t>::iterator dir = m_directories.find(tempSharedDir);
+        if(dir != m_directories.end()) {
+          nObjId = dir->second;
           bInsert = false;
         }
       }
@@ -897,7 +1194,10 @@ void RebuildThread::run()
         obj.setType(CONTAINER_STORAGE_FOLDER);
         obj.setPath(tempSharedDir);
         obj.setTitle(sFileName);
-        obj.save(&qry);
+        obj.save(scan);
+
+        m_directories[tempSharedDir] = nObjId;
+        inserted(scan, false);
 				
         /*sSql << 
           "insert into OBJECTS (OBJECT_ID, TYPE, PATH, TITLE) values " <<
@@ -915,13 +1215,42 @@ void RebuildThread::run()
         qry->insert(sSql.str());*/
       }
       
-      DbScanDir(db, &qry, tempSharedDir, nObjId);
+      walker.add(tempSharedDir);
     }
     else {      
-      CSharedLog::Log(L_EXT, __FILE__, __LINE__,
+      SHARED_LOG(L_EXT,
         "shared directory: \" %s \" not found", tempSharedDir.c_str());
+
+      if((m_rebuildType & RebuildThread::addNew) && (m_rebuildType & RebuildThread::removeMissing)) {
+        DbObject* missing = DbObject::createFromFileName(Directory::appendTrailingSlash(tempSharedDir), scan);
+        if(missing) {
+          removeObject(scan, missing);
+          delete missing;
+        }
+      }
     }
   } // for
+
+  DbScanDir(db, scan, &walker);
+
+  if(m_rebuildType & RebuildThread::addNew) {
+    CSharedLog::Print("[ContentDatabase] %u directories unchanged, %u rescanned. %u files added, %u changed, %u objects removed",
+                      m_unchangedDirCount, m_readDirCount - m_unchangedDirCount,
+                      m_fileCount, m_changedFileCount, m_removedCount);
+  }
+
+  commit(scan, true);
+  delete scan;
+  if(connection)
+    delete connection;
+
+  // the objects of a rolled back batch are missing until the next rebuild
+  if(m_failedBatchCount > 0) {
+    CSharedLog::Print("[ContentDatabase] writing %u batches failed. the database is incomplete, please rebuild it",
+                      m_failedBatchCount);
+  }
+  m_directories.clear();
+  m_knownDirectories.clear();
   CSharedLog::Print("[DONE] read shared directories");
  
 	/*if( !pDb->Execute("CREATE INDEX IDX_OBJECTS_OBJECT_ID ON OBJECTS(OBJECT_ID);") )
@@ -32,12 +32,14 @@
 
 #include <string>
 #include <map>
+#include <set>
 #include <list>
 #include "../Common/Common.h"
 #include "../Common/Thread.h"
 #include "FileAlterationMonitor.h"
 #include "FileAlterationHandler.h"
 #include "UpdateThread.h"
+#include "DirectoryWalker.h"
 
 #include "DatabaseConnection.h"
 
@@ -68,10 +70,44 @@ class RebuildThread: public fuppes::Thread
 	private:
 		void run();
 
-    void DbScanDir(CContentDatabase* db, SQLQuery* qry, std::string p_sDirectory, long long int p_nParentId);
-    unsigned int InsertFile(CContentDatabase* pDb, SQLQuery* qry, unsigned int p_nParentId, std::string p_sFileName, bool hidden = false);
+    // inserts the directories read by the walker and their files.
+    // on an update only the files of modified directories are compared
+    void DbScanDir(CContentDatabase* db, SQLQuery* qry, fuppes::DirectoryWalker* walker);
+    unsigned int InsertFile(CContentDatabase* pDb, SQLQuery* qry, unsigned int p_nParentId, std::string p_sFileName, bool hidden = false, const fuppes::ScannedFile* file = NULL);
+
+    // reads the ids, modification times and subdirectories of all
+    // directories in the db into m_directories and m_knownDirectories
+    void loadDirectories(SQLQuery* qry);
+    // reads the files in a directory. the caller has to delete the objects
+    void loadFiles(SQLQuery* qry, object_id_t parentId, std::map<std::string, fuppes::DbObject*>* files);
+    // removes a missing file or directory (including its content)
+    void removeObject(SQLQuery* qry, fuppes::DbObject* object);
+    // counts an inserted object and commits the transaction if the batch is full
+    void inserted(SQLQuery* qry, bool file);
+    // commits the current batch and starts a new one
+    void commit(SQLQuery* qry, bool last = false);
     
     int m_rebuildType;
+
+    // directory path -> object id
+    std::map<std::string, object_id_t>  m_directories;
+    // the directories of the last scan
+    fuppes::KnownDirectoryMap           m_knownDirectories;
+    time_t                              m_scanStart;
+
+    unsigned int  m_batchSize;
+    unsigned int  m_batchCount;
+    unsigned int  m_fileCount;
+    unsigned int  m_dirCount;
+    // read directories including the ones that are already in the db
+    unsigned int  m_readDirCount;
+    unsigned int  m_unchangedDirCount;
+    unsigned int  m_changedFileCount;
+    unsigned int  m_removedCount;
+    // batches that were rolled back or failed to commit
+    unsigned int  m_failedBatchCount;
+    unsigned int  m_startTicks;
+    unsigned int  m_progressTicks;
 };
 
 
@@ -115,7 +151,9 @@ class CContentDatabase
 
 
 
-    static unsigned int insertFile(std::string fileName, object_id_t parentId = 0, SQLQuery* qry = NULL, bool lock = true);
+    // if checkExisting is false the caller has to make sure the file is not in the db
+    // if file is NULL the fingerprint is read from the file
+    static unsigned int insertFile(std::string fileName, object_id_t parentId = 0, SQLQuery* qry = NULL, bool lock = true, bool checkExisting = true, const fuppes::ScannedFile* file = NULL);
     static unsigned int insertDirectory(std::string path, std::string title, object_id_t parentId, SQLQuery* qry = NULL, bool lock = true);
 
     static void scanDirectory(std::string path);
@@ -123,6 +161,21 @@ class CContentDatabase
     static int systemUpdateId();
     static void incSystemUpdateId();
 
+    // increments the container's update id (and the system update id)
+    // and queues it for the next ContainerUpdateIDs event
+    static void incContainerUpdateId(object_id_t containerId, bool incSystem = true);
+    // the root container's update id is not stored in the db.
+    // returns the system update id for items
+    static unsigned int containerUpdateId(object_id_t containerId, std::string device = "");
+    // returns the containers changed since the last call as "id,updateId,..."
+    static std::string takeContainerUpdateIds();
+
+    // the full text index is enabled and supported by the db plugin
+    static bool fullTextSearch() { return m_Instance != NULL && m_Instance->m_fullTextSearch; }
+    // (re)creates the full text index. returns false if the db does not support it
+    static bool createFullTextIndex(SQLQuery* qry);
+    static void dropFullTextIndex(SQLQuery* qry);
+
     /* export all objects in path to fileName and remove from local db*/
     static bool exportData(std::string fileName, std::string path, bool remove);
     /* import all objects from fileName with path */
@@ -142,6 +195,11 @@ class CContentDatabase
 
 		unsigned int	m_objectId;
     unsigned int  m_systemUpdateId;
+    unsigned int  m_rootUpdateId;
+    bool          m_fullTextSearch;
+
+    fuppes::Mutex                       m_containerUpdateMutex;
+    std::map<object_id_t, unsigned int> m_changedContainers;
 
     std::list<ScanDirectoryThread*>     m_scanDirThreadList;
     fuppes::Mutex                       m_insertMutex;
@@ -24,6 +24,8 @@
  */
 
 #include "ContentDirectory.h" 
+#include "DIDLResultWriter.h"
+#include "BrowseCache.h"
 #include "ContentDirectoryDescription.cpp"
 #include "../UPnPActions/UPnPBrowse.h"
 #include "../SharedConfig.h"
@@ -43,10 +45,56 @@
 using namespace std;
 using namespace fuppes;
 
+// the field names in the order of ObjectRow::Column
+static const char* objectRowColumns[ObjectRow::COL_MAX] = {
+  "OBJECT_ID",
+  "TYPE",
+  "REF_ID",
+  "VREF_ID",
+  "PATH",
+  "FILE_NAME",
+  "TITLE",
+  "DATE",
+  "SIZE",
+  "AV_ARTIST",
+  "AV_ALBUM",
+  "AV_GENRE",
+  "AV_DURATION",
+  "A_TRACK_NUMBER",
+  "A_CHANNELS",
+  "A_BITRATE",
+  "A_SAMPLERATE",
+  "A_BITS_PER_SAMPLE",
+  "AUDIO_CODEC",
+  "VIDEO_CODEC",
+  "V_BITRATE",
+  "V_HAS_SUBTITLES_FILE",
+  "IV_WIDTH",
+  "IV_HEIGHT",
+  "ALBUM_ART_ID",
+  "ALBUM_ART_EXT",
+  "ALBUM_ART_WIDTH",
+  "ALBUM_ART_HEIGHT"
+};
+
+void ObjectRow::set(CSQLResult* result)
+{
+  m_result = result;
+  if(m_resolved)
+    return;
+
+  for(int i = 0; i < COL_MAX; i++) {
+    m_columns[i] = result->column(objectRowColumns[i]);
+  }
+  m_resolved = true;
+}
+
 CContentDirectory::CContentDirectory(std::string p_sHTTPServerURL):
 CUPnPService(UPNP_SERVICE_CONTENT_DIRECTORY, 1, p_sHTTPServerURL)
 {
   m_hasSubtitles = false;
+  // create the cache before the http workers access it
+  BrowseCache::Shared();
 }
 
 CContentDirectory::~CContentDirectory()
@@ -100,7 +148,7 @@ void CContentDirectory::HandleUPnPAction(CUPnPAction* pUPnPAction, CHTTPMessage*
   
   if(!sContent.empty()) {    
     pMessageOut->SetMessage(HTTP_MESSAGE_TYPE_200_OK, "text/xml; charset=\"utf-8\"");
-    pMessageOut->SetContent(sContent);
+    pMessageOut->SwapContent(sContent);
   }
   else {
     pMessageOut->SetMessage(HTTP_MESSAGE_TYPE_500_INTERNAL_SERVER_ERROR, "text/xml; charset=\"utf-8\"");            
@@ -131,117 +179,42 @@ void CContentDirectory::HandleUPnPAction(CUPnPAction* pUPnPAction, CHTTPMessage*
 /* HandleUPnPBrowse */
 void CContentDirectory::DbHandleUPnPBrowse(CUPnPBrowse* pUPnPBrowse, std::string* p_psResult)
 { 
-  xmlTextWriterPtr writer;
-	xmlBufferPtr buf;
-	
-	buf    = xmlBufferCreate();   
-	writer = xmlNewTextWriterMemory(buf, 0);    
-	xmlTextWriterStartDocument(writer, NULL, "UTF-8", NULL);
-  
-  // root
-  xmlTextWriterStartElementNS(writer, BAD_CAST "s", BAD_CAST "Envelope", NULL);    
-  xmlTextWriterWriteAttributeNS(writer, BAD_CAST "s", 
-    BAD_CAST "encodingStyle", 
-    BAD_CAST  "http://schemas.xmlsoap.org/soap/envelope/", 
-    BAD_CAST "http://schemas.xmlsoap.org/soap/encoding/");
-   
-    // body
-    xmlTextWriterStartElementNS(writer, BAD_CAST "s", BAD_CAST "Body", NULL);    
-  
-      // browse response
-      xmlTextWriterStartElementNS(writer, BAD_CAST "u",        
-        BAD_CAST "BrowseResponse", 
-        BAD_CAST "urn:schemas-upnp-org:service:ContentDirectory:1");
-          
-      // result
-      xmlTextWriterStartElement(writer, BAD_CAST "Result");
-          
-      // build result xml
-      xmlTextWriterPtr resWriter;
-      xmlBufferPtr resBuf;
-      resBuf    = xmlBufferCreate();   
-      resWriter = xmlNewTextWriterMemory(resBuf, 0);    
-      xmlTextWriterStartDocument(resWriter, NULL, "UTF-8", NULL);
-  
-      xmlTextWriterStartElementNS(resWriter, NULL, BAD_CAST "DIDL-Lite", BAD_CAST "urn:schemas-upnp-org:metadata-1-0/DIDL-Lite/");    
-      xmlTextWriterWriteAttribute(resWriter, BAD_CAST "xmlns:dc", BAD_CAST "http://purl.org/dc/elements/1.1/");
-      xmlTextWriterWriteAttribute(resWriter, BAD_CAST "xmlns:upnp", BAD_CAST "urn:schemas-upnp-org:metadata-1-0/upnp/");
-      xmlTextWriterWriteAttribute(resWriter, BAD_CAST "xmlns:sec", BAD_CAST "http://www.sec.co.kr/");
+  std::string key = BrowseCache::key(pUPnPBrowse);
+  if(BrowseCache::Shared()->get(key, p_psResult))
+    return;
+  unsigned int updateId = CContentDatabase::systemUpdateId();
 
+  // the DIDL-Lite result is written directly into the soap envelope
+  DIDLResultWriter result("Browse");
                                   
-      unsigned int nNumberReturned = 0;
-      unsigned int nTotalMatches   = 0;
+  unsigned int nNumberReturned = 0;
+  unsigned int nTotalMatches   = 0;
 
-      bool valid = true;
-      switch(pUPnPBrowse->browseFlag()) {
-        
-        case UPNP_BROWSE_FLAG_METADATA:          
-          BrowseMetadata(resWriter, &nTotalMatches, &nNumberReturned, pUPnPBrowse);
-          break;
-        case UPNP_BROWSE_FLAG_DIRECT_CHILDREN:                    
-          BrowseDirectChildren(resWriter, &nTotalMatches, &nNumberReturned, pUPnPBrowse);
-          break;
-        default:
-          valid = false;
-          break;
-      }
+  bool valid = true;
+  switch(pUPnPBrowse->browseFlag()) {
+    
+    case UPNP_BROWSE_FLAG_METADATA:          
+      BrowseMetadata(result.writer(), &nTotalMatches, &nNumberReturned, pUPnPBrowse);
+      break;
+    case UPNP_BROWSE_FLAG_DIRECT_CHILDREN:                    
+      BrowseDirectChildren(result.writer(), &nTotalMatches, &nNumberReturned, pUPnPBrowse);
+      break;
+    default:
+      valid = false;
+      break;
+  }
 
-      if(m_hasSubtitles) {
-        //xmlTextWriterWriteAttribute(resWriter, BAD_CAST "xmlns:sec", BAD_CAST "http://www.sec.co.kr/");
-      }
-              
-      // finalize result xml
-      xmlTextWriterEndElement(resWriter);
-      xmlTextWriterEndDocument(resWriter);
-      xmlFreeTextWriter(resWriter);
-
-      std::string sResOutput;
-      sResOutput = (const char*)resBuf->content;
-
-      xmlBufferFree(resBuf);        
-      sResOutput = sResOutput.substr(strlen("<?xml version=\"1.0\" encoding=\"UTF-8\"?> "));
-      xmlTextWriterWriteString(writer, BAD_CAST sResOutput.c_str());
-      
-      // end result
-      xmlTextWriterEndElement(writer);
-        
-      // number returned
-      xmlTextWriterStartElement(writer, BAD_CAST "NumberReturned");      
-      xmlTextWriterWriteFormatString(writer, "%u", nNumberReturned);      
-      xmlTextWriterEndElement(writer);
-      
-      // total matches
-      xmlTextWriterStartElement(writer, BAD_CAST "TotalMatches");      
-      xmlTextWriterWriteFormatString(writer, "%u", nTotalMatches);      
-      xmlTextWriterEndElement(writer);
-      
-      // update id
-      xmlTextWriterStartElement(writer, BAD_CAST "UpdateID");
-      xmlTextWriterWriteFormatString(writer, "%u", CContentDatabase::systemUpdateId()); 
-      xmlTextWriterEndElement(writer);
-  
-      // end browse response
-      xmlTextWriterEndElement(writer);
-      
-    // end body
-    xmlTextWriterEndElement(writer);
-   
-	// end root
-	xmlTextWriterEndElement(writer);
-  xmlTextWriterEndDocument(writer);
-	xmlFreeTextWriter(writer);
-	
-	//std::stringstream output;
-	//string sResult
+  // renderers compare the UpdateID of a container with the ContainerUpdateIDs events.
+  // the cache is still invalidated by the system update id
+  unsigned int containerUpdateId = updateId;
   if(valid)
-    *p_psResult = (const char*)buf->content;
-	//output << (const char*)buf->content;  
-	xmlBufferFree(buf);  
-
-//cout << *p_psResult << endl;
-			  
-  /**p_psResult = sResult;  
-  CSharedLog::Shared()->Log(L_DEBUG, sResult, __FILE__, __LINE__);*/
+    containerUpdateId = CContentDatabase::containerUpdateId(pUPnPBrowse->GetObjectIDAsUInt(), pUPnPBrowse->virtualFolderLayout());
+
+  std::string& output = result.finish(nNumberReturned, nTotalMatches, containerUpdateId);
+  if(valid) {
+    BrowseCache::Shared()->put(key, output, updateId);
+    p_psResult->swap(output);
+  }
 }
 
 void CContentDirectory::BrowseMetadata(xmlTextWriterPtr pWriter, 
@@ -258,15 +231,13 @@ void CContentDirectory::BrowseMetadata(xmlTextWriterPtr pWriter,
   *p_pnTotalMatches   = 1;
   *p_pnNumberReturned = 1;
 
-	SQLQuery qry;
-	string sql;
+	SQLQuery qry(SQLQuery::ReadOnly);
 	
   
   // get container type
   OBJECT_TYPE nContainerType = CONTAINER_STORAGE_FOLDER;
   if(pUPnPBrowse->GetObjectIDAsUInt() > 0) {
-		sql = qry.build(SQL_GET_OBJECT_TYPE, pUPnPBrowse->GetObjectIDAsUInt(), pUPnPBrowse->virtualFolderLayout());
-		qry.select(sql);
+		qry.execute(SQL_GET_OBJECT_TYPE, pUPnPBrowse->GetObjectIDAsUInt(), pUPnPBrowse->virtualFolderLayout());
     ASSERT(!qry.eof());
     nContainerType = (OBJECT_TYPE)qry.result()->asInt("TYPE");
   }
@@ -275,8 +246,7 @@ void CContentDirectory::BrowseMetadata(xmlTextWriterPtr pWriter,
   // get child count
   string sChildCount = "0";
   if(nContainerType < CONTAINER_MAX) {
-		sql = qry.build(SQL_COUNT_CHILD_OBJECTS, pUPnPBrowse->GetObjectIDAsUInt(), pUPnPBrowse->virtualFolderLayout());
-		qry.select(sql);
+		qry.execute(SQL_COUNT_CHILD_OBJECTS, pUPnPBrowse->GetObjectIDAsUInt(), pUPnPBrowse->virtualFolderLayout());
     sChildCount = qry.result()->asString("COUNT");
   }
 
@@ -321,8 +291,7 @@ void CContentDirectory::BrowseMetadata(xmlTextWriterPtr pWriter,
   // sub folders
   else
   {
-		sql = qry.build(SQL_GET_OBJECT_DETAILS, pUPnPBrowse->GetObjectIDAsUInt(), pUPnPBrowse->virtualFolderLayout());
-		qry.select(sql);
+		qry.execute(SQL_GET_OBJECT_DETAILS, pUPnPBrowse->GetObjectIDAsUInt(), pUPnPBrowse->virtualFolderLayout());
 		
 
     char szParentId[11];
@@ -336,7 +305,9 @@ void CContentDirectory::BrowseMetadata(xmlTextWriterPtr pWriter,
       sParentId = "0";
     } 
     
-    BuildDescription(pWriter, qry.result(), pUPnPBrowse, sParentId);
+    ObjectRow row;
+    row.set(qry.result());
+    BuildDescription(pWriter, &row, pUPnPBrowse, sParentId);
   }
 
 }
@@ -347,49 +318,48 @@ void CContentDirectory::BrowseDirectChildren(xmlTextWriterPtr pWriter,
                           unsigned int* p_pnNumberReturned,
                           CUPnPBrowse*  pUPnPBrowse)
 { 
-  std::stringstream sSql;
-	SQLQuery qry;
+	SQLQuery qry(SQLQuery::ReadOnly);
   //OBJECT_TYPE nContainerType = CONTAINER_STORAGE_FOLDER;
  
 	//cout << "BrowseDirectChildren VIRTUAL LAYOUT: " << pUPnPBrowse->virtualFolderLayout() << ":" << endl;
 
   
   // get total matches
-	string sql = qry.build(SQL_COUNT_CHILD_OBJECTS, pUPnPBrowse->GetObjectIDAsUInt(), pUPnPBrowse->virtualFolderLayout());
-	qry.select(sql);
+	qry.execute(SQL_COUNT_CHILD_OBJECTS, pUPnPBrowse->GetObjectIDAsUInt(), pUPnPBrowse->virtualFolderLayout());
  	*p_pnTotalMatches = 0;
   if(!qry.eof()) {
     *p_pnTotalMatches = qry.result()->asInt("COUNT");
   }
-  sSql.str("");
-  sSql.clear();  
 
   //cout << "DONE get total matches " << *p_pnTotalMatches << endl; fflush(stdout);  
 
 
-	sql = qry.build(SQL_GET_CHILD_OBJECTS, pUPnPBrowse->GetObjectIDAsUInt(), pUPnPBrowse->virtualFolderLayout());
-	sql +=  pUPnPBrowse->m_sortCriteriaSQL;
+  // the limit is bound as ?3 and ?4 so the statement
+  // only depends on the sort criteria
+	string append = pUPnPBrowse->m_sortCriteriaSQL;
     //"  o.TYPE, o.FILE_NAME ";
-  
-  
-  if((pUPnPBrowse->m_nRequestedCount > 0) || (pUPnPBrowse->m_nStartingIndex > 0))  {
-    
-    sSql << " limit " << pUPnPBrowse->m_nStartingIndex << ", ";    
+  bool limit = ((pUPnPBrowse->m_nRequestedCount > 0) || (pUPnPBrowse->m_nStartingIndex > 0));
+  if(limit)
+    append += " limit ?3, ?4";
+
+  qry.prepare(SQL_GET_CHILD_OBJECTS, pUPnPBrowse->GetObjectIDAsUInt(), pUPnPBrowse->virtualFolderLayout(), append);
+  if(limit) {
+    qry.bind(3, (fuppes_off_t)pUPnPBrowse->m_nStartingIndex);
     if(pUPnPBrowse->m_nRequestedCount == 0)
-      sSql << "-1";
+      qry.bind(4, (fuppes_off_t)-1);
     else
-      sSql << pUPnPBrowse->m_nRequestedCount;
-
-		sql += sSql.str();		
+      qry.bind(4, (fuppes_off_t)pUPnPBrowse->m_nRequestedCount);
   }
+  qry.execute();
   
   unsigned int tmpInt = *p_pnNumberReturned;
   
-
-  qry.select(sql);
+  // the column indices are resolved once for all rows
+  ObjectRow row;
   while(!qry.eof()) {
 	  
-    BuildDescription(pWriter, qry.result(), pUPnPBrowse, pUPnPBrowse->objectId());
+    row.set(qry.result());
+    BuildDescription(pWriter, &row, pUPnPBrowse, pUPnPBrowse->objectId());
 
 		qry.next();
     tmpInt++;
@@ -400,11 +370,11 @@ void CContentDirectory::BrowseDirectChildren(xmlTextWriterPtr pWriter,
 }
 
 void CContentDirectory::BuildDescription(xmlTextWriterPtr pWriter,
-                                         CSQLResult* pSQLResult,
+                                         ObjectRow* pSQLResult,
                                          CUPnPBrowseSearchBase* pUPnPBrowse,
                                          std::string p_sParentId)
 {
-  OBJECT_TYPE nObjType = (OBJECT_TYPE)pSQLResult->asInt("TYPE");
+  OBJECT_TYPE nObjType = (OBJECT_TYPE)pSQLResult->asInt(ObjectRow::COL_TYPE);
   
   // container
   if(nObjType < CONTAINER_MAX) {
@@ -425,7 +395,7 @@ void CContentDirectory::BuildDescription(xmlTextWriterPtr pWriter,
 
 
 void CContentDirectory::BuildContainerDescription(xmlTextWriterPtr pWriter, 
-                                                  CSQLResult* pSQLResult, 
+                                                  ObjectRow* pSQLResult, 
                                                   CUPnPBrowseSearchBase* pUPnPBrowse, 
                                                   std::string p_sParentId,
                                                   OBJECT_TYPE p_nContainerType)
@@ -435,25 +405,24 @@ void CContentDirectory::BuildContainerDescription(xmlTextWriterPtr pWriter,
   string sChildCount = "0";
   //CContentDatabase* pDb = new CContentDatabase();
   stringstream sSql;
-	SQLQuery qry;
+	SQLQuery qry(SQLQuery::ReadOnly);
 	
   string sDevice = pUPnPBrowse->virtualFolderLayout();
   //cout << "BuildContainerDescription DEVICE: " << sDevice << "*" << endl;
   
   /*sSql = string("select count(*) as COUNT from MAP_OBJECTS ") +
-    "where PARENT_ID = " + pSQLResult->asString("OBJECT_ID") + " and " + sDevice;*/
+    "where PARENT_ID = " + pSQLResult->asString(ObjectRow::COL_OBJECT_ID) + " and " + sDevice;*/
 
 	/*sSql <<
       "select count(*) as COUNT " <<
       "from OBJECTS o, MAP_OBJECTS m " <<
       "where " <<
-			"m.PARENT_ID = " << pSQLResult->asString("OBJECT_ID") << " and " << 
+			"m.PARENT_ID = " << pSQLResult->asString(ObjectRow::COL_OBJECT_ID) << " and " << 
 			"o.OBJECT_ID = m.OBJECT_ID and " <<
 			"o.HIDDEN = 0 and " <<
 			"m." << sDevice << " and o." << sDevice;*/
 
-	string sql = qry.build(SQL_COUNT_CHILD_OBJECTS, pSQLResult->asString("OBJECT_ID"), sDevice);
-	qry.select(sql);
+	qry.execute(SQL_COUNT_CHILD_OBJECTS, pSQLResult->asUInt(ObjectRow::COL_OBJECT_ID), sDevice);
 	if(!qry.eof())
 		sChildCount = qry.result()->asString("COUNT");
   
@@ -462,7 +431,7 @@ void CContentDirectory::BuildContainerDescription(xmlTextWriterPtr pWriter,
 
     // id
     char szObjId[11];    
-    unsigned int nObjId = pSQLResult->asUInt("OBJECT_ID");
+    unsigned int nObjId = pSQLResult->asUInt(ObjectRow::COL_OBJECT_ID);
     sprintf(szObjId, "%010X", nObjId);
   
     xmlTextWriterWriteAttribute(pWriter, BAD_CAST "id", BAD_CAST szObjId); 
@@ -476,7 +445,7 @@ void CContentDirectory::BuildContainerDescription(xmlTextWriterPtr pWriter,
     xmlTextWriterWriteAttribute(pWriter, BAD_CAST "childCount", BAD_CAST sChildCount.c_str());   
      
     // title
-    string sTitle = pSQLResult->asString("TITLE");
+    string sTitle = pSQLResult->asString(ObjectRow::COL_TITLE);
     int nLen = pUPnPBrowse->DeviceSettings()->DisplaySettings()->nMaxFileNameLength;
     if(nLen > 0 && pUPnPBrowse->DeviceSettings()->DisplaySettings()->bShowChildCountInTitle) {
       nLen -= (sChildCount.length() + 3); // "_(n)"
@@ -507,15 +476,15 @@ void CContentDirectory::BuildContainerDescription(xmlTextWriterPtr pWriter,
 
 		if(p_nContainerType == CONTAINER_ALBUM_MUSIC_ALBUM) {
 
-      if(pUPnPBrowse->IncludeProperty("upnp:artist") && !pSQLResult->isNull("AV_ARTIST")) {
+      if(pUPnPBrowse->IncludeProperty("upnp:artist") && !pSQLResult->isNull(ObjectRow::COL_AV_ARTIST)) {
         xmlTextWriterStartElement(pWriter, BAD_CAST "upnp:artist");    
-          xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString("AV_ARTIST").c_str());
+          xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString(ObjectRow::COL_AV_ARTIST).c_str());
       	xmlTextWriterEndElement(pWriter); 
       }
 
-      if(pUPnPBrowse->IncludeProperty("upnp:genre") && !pSQLResult->isNull("AV_GENRE")) {
+      if(pUPnPBrowse->IncludeProperty("upnp:genre") && !pSQLResult->isNull(ObjectRow::COL_AV_GENRE)) {
         xmlTextWriterStartElement(pWriter, BAD_CAST "upnp:genre");
-          xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString("AV_GENRE").c_str());
+          xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString(ObjectRow::COL_AV_GENRE).c_str());
       	xmlTextWriterEndElement(pWriter);
       }
 
@@ -530,7 +499,7 @@ void CContentDirectory::BuildContainerDescription(xmlTextWriterPtr pWriter,
       xmlTextWriterStartElement(pWriter, BAD_CAST "res");
       
       string sTmp;
-      string ext = ExtractFileExt(pSQLResult->asString("FILE_NAME"));
+      string ext = ExtractFileExt(pSQLResult->asString(ObjectRow::COL_FILE_NAME));
         
       //sTmp = "http-get:*:" + pSQLResult->asString("MIME_TYPE") + ":*";
 			#warning todo MIME TYPE
@@ -553,7 +522,7 @@ void CContentDirectory::BuildContainerDescription(xmlTextWriterPtr pWriter,
 
 
 void CContentDirectory::BuildItemDescription(xmlTextWriterPtr pWriter, 
-                                             CSQLResult* pSQLResult, 
+                                             ObjectRow* pSQLResult, 
                                              CUPnPBrowseSearchBase* pUPnPBrowse, 
                                              OBJECT_TYPE p_nObjectType, 
                                              std::string p_sParentId)
@@ -563,24 +532,24 @@ void CContentDirectory::BuildItemDescription(xmlTextWriterPtr pWriter,
 
     // id
     char szObjId[11];
-    sprintf(szObjId, "%010X", pSQLResult->asUInt("OBJECT_ID"));  
+    sprintf(szObjId, "%010X", pSQLResult->asUInt(ObjectRow::COL_OBJECT_ID));  
     xmlTextWriterWriteAttribute(pWriter, BAD_CAST "id", BAD_CAST szObjId); 
     // parentID
     xmlTextWriterWriteAttribute(pWriter, BAD_CAST "parentID", BAD_CAST p_sParentId.c_str()); 
     // restricted 
     xmlTextWriterWriteAttribute(pWriter, BAD_CAST "restricted", BAD_CAST "true");
     // ref id
-    if(pSQLResult->asUInt("REF_ID") != 0) {
+    if(pSQLResult->asUInt(ObjectRow::COL_REF_ID) != 0) {
       char refId[11];
-      sprintf(refId, "%010X", pSQLResult->asUInt("REF_ID"));
+      sprintf(refId, "%010X", pSQLResult->asUInt(ObjectRow::COL_REF_ID));
       xmlTextWriterWriteAttribute(pWriter, BAD_CAST "refID", BAD_CAST refId); 
     }
   
     // date
-    if(pUPnPBrowse->IncludeProperty("dc:date") && !pSQLResult->isNull("DATE")) {
+    if(pUPnPBrowse->IncludeProperty("dc:date") && !pSQLResult->isNull(ObjectRow::COL_DATE)) {
       //CSharedLog::Shared()->Log(L_DBG, "Writing date to stream", __FILE__, __LINE__);
       xmlTextWriterStartElementNS(pWriter, BAD_CAST "dc", BAD_CAST "date", BAD_CAST "http://purl.org/dc/elements/1.1/");    
-      xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString("DATE").c_str());
+      xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString(ObjectRow::COL_DATE).c_str());
       xmlTextWriterEndElement(pWriter);
     }
     
@@ -625,18 +594,18 @@ void CContentDirectory::BuildItemDescription(xmlTextWriterPtr pWriter,
   
 
 void CContentDirectory::BuildAudioItemDescription(xmlTextWriterPtr pWriter,
-                                                  CSQLResult* pSQLResult,
+                                                  ObjectRow* pSQLResult,
                                                   CUPnPBrowseSearchBase*  pUPnPBrowse,
                                                   std::string p_sObjectID)
 {                 
-  string sExt = ExtractFileExt(pSQLResult->asString("FILE_NAME"));
+  string sExt = ExtractFileExt(pSQLResult->asString(ObjectRow::COL_FILE_NAME));
                                           
   // title  
   xmlTextWriterStartElement(pWriter, BAD_CAST "dc:title");
 
     string sFileName;
-		if(!pSQLResult->isNull("TITLE")) {
-		  sFileName = pSQLResult->asString("TITLE");
+		if(!pSQLResult->isNull(ObjectRow::COL_TITLE)) {
+		  sFileName = pSQLResult->asString(ObjectRow::COL_TITLE);
 
 			// trim filename				
 			if(pUPnPBrowse->DeviceSettings()->DisplaySettings()->nMaxFileNameLength > 0) {
@@ -652,27 +621,27 @@ void CContentDirectory::BuildAudioItemDescription(xmlTextWriterPtr pWriter,
     xmlTextWriterWriteString(pWriter, BAD_CAST pUPnPBrowse->DeviceSettings()->ObjectTypeAsStr(sExt).c_str());    
   xmlTextWriterEndElement(pWriter);                                                    
 
-	if(pUPnPBrowse->IncludeProperty("upnp:artist") && !pSQLResult->isNull("AV_ARTIST")) {
+	if(pUPnPBrowse->IncludeProperty("upnp:artist") && !pSQLResult->isNull(ObjectRow::COL_AV_ARTIST)) {
     xmlTextWriterStartElement(pWriter, BAD_CAST "upnp:artist");    
-      xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString("AV_ARTIST").c_str());
+      xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString(ObjectRow::COL_AV_ARTIST).c_str());
   	xmlTextWriterEndElement(pWriter); 
   }
 	
-	if(pUPnPBrowse->IncludeProperty("upnp:album") && !pSQLResult->isNull("AV_ALBUM")) {
+	if(pUPnPBrowse->IncludeProperty("upnp:album") && !pSQLResult->isNull(ObjectRow::COL_AV_ALBUM)) {
     xmlTextWriterStartElement(pWriter, BAD_CAST "upnp:album");
-      xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString("AV_ALBUM").c_str());
+      xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString(ObjectRow::COL_AV_ALBUM).c_str());
     xmlTextWriterEndElement(pWriter);
   }
 
-  if(pUPnPBrowse->IncludeProperty("upnp:genre") && !pSQLResult->isNull("AV_GENRE")) {
+  if(pUPnPBrowse->IncludeProperty("upnp:genre") && !pSQLResult->isNull(ObjectRow::COL_AV_GENRE)) {
     xmlTextWriterStartElement(pWriter, BAD_CAST "upnp:genre");
-      xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString("AV_GENRE").c_str());
+      xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString(ObjectRow::COL_AV_GENRE).c_str());
   	xmlTextWriterEndElement(pWriter);
   }
   
-  if(pUPnPBrowse->IncludeProperty("upnp:originalTrackNumber") && !pSQLResult->isNull("A_TRACK_NUMBER")) {	
+  if(pUPnPBrowse->IncludeProperty("upnp:originalTrackNumber") && !pSQLResult->isNull(ObjectRow::COL_A_TRACK_NUMBER)) {	
     xmlTextWriterStartElement(pWriter, BAD_CAST "upnp:originalTrackNumber");    
-      xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString("A_TRACK_NUMBER").c_str());
+      xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString(ObjectRow::COL_A_TRACK_NUMBER).c_str());
 	  xmlTextWriterEndElement(pWriter);
   }
 
@@ -694,8 +663,8 @@ void CContentDirectory::BuildAudioItemDescription(xmlTextWriterPtr pWriter,
     int channels = 0;
     int bitrate = 0;
     if(!bTranscode) {
-      channels = pSQLResult->asInt("A_CHANNELS");
-      bitrate = pSQLResult->asInt("A_BITRATE");
+      channels = pSQLResult->asInt(ObjectRow::COL_A_CHANNELS);
+      bitrate = pSQLResult->asInt(ObjectRow::COL_A_BITRATE);
     }
     
     DLNA::getAudioProfile(targetExt, channels, bitrate, profile, sMimeType);
@@ -706,20 +675,20 @@ void CContentDirectory::BuildAudioItemDescription(xmlTextWriterPtr pWriter,
 	
 																											
   // res@duration
-  if(pUPnPBrowse->IncludeProperty("res@duration") && !pSQLResult->isNull("AV_DURATION")) {
-    string dur = FormatHelper::msToUpnpDuration(pSQLResult->asInt("AV_DURATION"));
+  if(pUPnPBrowse->IncludeProperty("res@duration") && !pSQLResult->isNull(ObjectRow::COL_AV_DURATION)) {
+    string dur = FormatHelper::msToUpnpDuration(pSQLResult->asInt(ObjectRow::COL_AV_DURATION));
     xmlTextWriterWriteAttribute(pWriter, BAD_CAST "duration", BAD_CAST dur.c_str());
   }
 	
 	// res@nrAudioChannels 
-  if(pUPnPBrowse->IncludeProperty("res@nrAudioChannels") && !pSQLResult->isNull("A_CHANNELS")) {		
-    xmlTextWriterWriteAttribute(pWriter, BAD_CAST "nrAudioChannels", BAD_CAST pSQLResult->asString("A_CHANNELS").c_str());
+  if(pUPnPBrowse->IncludeProperty("res@nrAudioChannels") && !pSQLResult->isNull(ObjectRow::COL_A_CHANNELS)) {		
+    xmlTextWriterWriteAttribute(pWriter, BAD_CAST "nrAudioChannels", BAD_CAST pSQLResult->asString(ObjectRow::COL_A_CHANNELS).c_str());
   }
 
   // res@sampleFrequency (Hz)
   if(pUPnPBrowse->IncludeProperty("res@sampleFrequency")) {    
-    if(!bTranscode && !pSQLResult->isNull("A_SAMPLERATE")) {		  
-      xmlTextWriterWriteAttribute(pWriter, BAD_CAST "sampleFrequency", BAD_CAST pSQLResult->asString("A_SAMPLERATE").c_str());
+    if(!bTranscode && !pSQLResult->isNull(ObjectRow::COL_A_SAMPLERATE)) {		  
+      xmlTextWriterWriteAttribute(pWriter, BAD_CAST "sampleFrequency", BAD_CAST pSQLResult->asString(ObjectRow::COL_A_SAMPLERATE).c_str());
     }    
     else if(bTranscode && pUPnPBrowse->DeviceSettings()->TargetAudioSampleRate(sExt) > 0) {      
       xmlTextWriterWriteFormatAttribute(pWriter, BAD_CAST "sampleFrequency", "%d", pUPnPBrowse->DeviceSettings()->TargetAudioSampleRate(sExt));
@@ -728,8 +697,8 @@ void CContentDirectory::BuildAudioItemDescription(xmlTextWriterPtr pWriter,
 
 	// res@bitrate (bytes! per second)
   if(pUPnPBrowse->IncludeProperty("res@bitrate")) {    
-    if(!bTranscode && !pSQLResult->isNull("A_BITRATE")) {
-      xmlTextWriterWriteFormatAttribute(pWriter, BAD_CAST "bitrate", "%d", (pSQLResult->asInt("A_BITRATE") / 8));
+    if(!bTranscode && !pSQLResult->isNull(ObjectRow::COL_A_BITRATE)) {
+      xmlTextWriterWriteFormatAttribute(pWriter, BAD_CAST "bitrate", "%d", (pSQLResult->asInt(ObjectRow::COL_A_BITRATE) / 8));
     }
     else if(bTranscode && pUPnPBrowse->DeviceSettings()->TargetAudioBitRate(sExt) > 0) {      
       xmlTextWriterWriteFormatAttribute(pWriter, BAD_CAST "bitrate", "%d", (pUPnPBrowse->DeviceSettings()->TargetAudioBitRate(sExt) / 8));
@@ -737,13 +706,13 @@ void CContentDirectory::BuildAudioItemDescription(xmlTextWriterPtr pWriter,
   }
 
   // res@bitsPerSample 
-  if(!bTranscode && pUPnPBrowse->IncludeProperty("res@bitsPerSample") && !pSQLResult->isNull("A_BITS_PER_SAMPLE")) {
-    xmlTextWriterWriteAttribute(pWriter, BAD_CAST "bitsPerSample", BAD_CAST pSQLResult->asString("A_BITS_PER_SAMPLE").c_str());
+  if(!bTranscode && pUPnPBrowse->IncludeProperty("res@bitsPerSample") && !pSQLResult->isNull(ObjectRow::COL_A_BITS_PER_SAMPLE)) {
+    xmlTextWriterWriteAttribute(pWriter, BAD_CAST "bitsPerSample", BAD_CAST pSQLResult->asString(ObjectRow::COL_A_BITS_PER_SAMPLE).c_str());
   }
                                                     
   // res@size
-  if(!bTranscode && pUPnPBrowse->IncludeProperty("res@size") && !pSQLResult->isNull("SIZE")) {
-    xmlTextWriterWriteAttribute(pWriter, BAD_CAST "size", BAD_CAST pSQLResult->asString("SIZE").c_str());
+  if(!bTranscode && pUPnPBrowse->IncludeProperty("res@size") && !pSQLResult->isNull(ObjectRow::COL_SIZE)) {
+    xmlTextWriterWriteAttribute(pWriter, BAD_CAST "size", BAD_CAST pSQLResult->asString(ObjectRow::COL_SIZE).c_str());
   }                                                    
 
   sExt = pUPnPBrowse->DeviceSettings()->Extension(sExt);
@@ -756,14 +725,14 @@ void CContentDirectory::BuildAudioItemDescription(xmlTextWriterPtr pWriter,
 
 
 void CContentDirectory::BuildAudioBroadcastItemDescription(xmlTextWriterPtr pWriter,
-                                                  CSQLResult* pSQLResult,
+                                                  ObjectRow* pSQLResult,
                                                   CUPnPBrowseSearchBase*  pUPnPBrowse,
                                                   std::string /*p_sObjectID*/)
 {
   // title
 	xmlTextWriterStartElement(pWriter, BAD_CAST "dc:title");
     // trim filename
-    string title = TrimFileName(pSQLResult->asString("TITLE"), pUPnPBrowse->DeviceSettings()->DisplaySettings()->nMaxFileNameLength);    
+    string title = TrimFileName(pSQLResult->asString(ObjectRow::COL_TITLE), pUPnPBrowse->DeviceSettings()->DisplaySettings()->nMaxFileNameLength);    
     //sFileName = TruncateFileExt(title);
     xmlTextWriterWriteString(pWriter, BAD_CAST title.c_str());    
 	xmlTextWriterEndElement(pWriter);
@@ -774,16 +743,16 @@ void CContentDirectory::BuildAudioBroadcastItemDescription(xmlTextWriterPtr pWri
   xmlTextWriterEndElement(pWriter);      
 
   // genre (item.audioItem)
-  if(pUPnPBrowse->IncludeProperty("upnp:genre") && !pSQLResult->isNull("AV_GENRE")) {
+  if(pUPnPBrowse->IncludeProperty("upnp:genre") && !pSQLResult->isNull(ObjectRow::COL_AV_GENRE)) {
     xmlTextWriterStartElement(pWriter, BAD_CAST "upnp:genre");
-      xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString("AV_GENRE").c_str());
+      xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString(ObjectRow::COL_AV_GENRE).c_str());
   	xmlTextWriterEndElement(pWriter);
   }
 
   // dc:description
   if(pUPnPBrowse->IncludeProperty("dc:description")) {
     xmlTextWriterStartElement(pWriter, BAD_CAST "dc:description");
-      xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString("TITLE").c_str());
+      xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString(ObjectRow::COL_TITLE).c_str());
   	xmlTextWriterEndElement(pWriter);
   }
   
@@ -797,24 +766,24 @@ void CContentDirectory::BuildAudioBroadcastItemDescription(xmlTextWriterPtr pWri
   string protocolInfo = "http-get:*:audio/mpeg:*";
   xmlTextWriterWriteAttribute(pWriter, BAD_CAST "protocolInfo", BAD_CAST protocolInfo.c_str());
   
-  xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString("PATH").c_str());
+  xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString(ObjectRow::COL_PATH).c_str());
   xmlTextWriterEndElement(pWriter);  
 }
 
 
 
 void CContentDirectory::BuildImageItemDescription(xmlTextWriterPtr pWriter,
-                                                  CSQLResult* pSQLResult,
+                                                  ObjectRow* pSQLResult,
                                                   CUPnPBrowseSearchBase*  pUPnPBrowse,
                                                   std::string p_sObjectID)
 {
-  string sExt = ExtractFileExt(pSQLResult->asString("FILE_NAME"));
+  string sExt = ExtractFileExt(pSQLResult->asString(ObjectRow::COL_FILE_NAME));
   bool bTranscode = pUPnPBrowse->DeviceSettings()->DoTranscode(sExt);
 																										
   // title
   xmlTextWriterStartElement(pWriter, BAD_CAST "dc:title");
     // trim filename
-		string sFileName = pSQLResult->asString("TITLE");
+		string sFileName = pSQLResult->asString(ObjectRow::COL_TITLE);
 		if(pUPnPBrowse->DeviceSettings()->DisplaySettings()->nMaxFileNameLength > 0) {
 			sFileName = TrimFileName(sFileName, pUPnPBrowse->DeviceSettings()->DisplaySettings()->nMaxFileNameLength);
 		}
@@ -844,10 +813,10 @@ void CContentDirectory::BuildImageItemDescription(xmlTextWriterPtr pWriter,
     // date
     if(pUPnPBrowse->IncludeProperty("dc:date"))
     {
-    	if(!pSQLResult->isNull("DATE"))
+    	if(!pSQLResult->isNull(ObjectRow::COL_DATE))
     	{
     		xmlTextWriterStartElementNS(pWriter, BAD_CAST "dc", BAD_CAST "date", BAD_CAST "http://purl.org/dc/elements/1.1/");    
-        	xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString("DATE").c_str());
+        	xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString(ObjectRow::COL_DATE).c_str());
         	xmlTextWriterEndElement(pWriter);
     	}
     }
@@ -861,7 +830,7 @@ void CContentDirectory::BuildImageItemDescription(xmlTextWriterPtr pWriter,
   string targetExt = pUPnPBrowse->DeviceSettings()->Extension(sExt);
   
 	if(pUPnPBrowse->DeviceSettings()->dlnaVersion() != CMediaServerSettings::dlna_none) {  
-    DLNA::getImageProfile(targetExt, pSQLResult->asInt("IV_WIDTH"), pSQLResult->asInt("IV_HEIGHT"), profile, sMimeType);
+    DLNA::getImageProfile(targetExt, pSQLResult->asInt(ObjectRow::COL_IV_WIDTH), pSQLResult->asInt(ObjectRow::COL_IV_HEIGHT), profile, sMimeType);
 	}	
 
   string sTmp = BuildProtocolInfo(bTranscode, sMimeType, profile, pUPnPBrowse);
@@ -872,8 +841,8 @@ void CContentDirectory::BuildImageItemDescription(xmlTextWriterPtr pWriter,
 	if(pUPnPBrowse->IncludeProperty("res@resolution")) {
     #warning todo rescaling
 
-		if(!pSQLResult->isNull("IV_WIDTH") && !pSQLResult->isNull("IV_HEIGHT")) {
-			sTmp = pSQLResult->asString("IV_WIDTH") + "x" + pSQLResult->asString("IV_HEIGHT");
+		if(!pSQLResult->isNull(ObjectRow::COL_IV_WIDTH) && !pSQLResult->isNull(ObjectRow::COL_IV_HEIGHT)) {
+			sTmp = pSQLResult->asString(ObjectRow::COL_IV_WIDTH) + "x" + pSQLResult->asString(ObjectRow::COL_IV_HEIGHT);
 			xmlTextWriterWriteAttribute(pWriter, BAD_CAST "resolution", BAD_CAST sTmp.c_str());
 		}
 		else if(pUPnPBrowse->DeviceSettings()->ShowEmptyResolution()) {
@@ -882,8 +851,8 @@ void CContentDirectory::BuildImageItemDescription(xmlTextWriterPtr pWriter,
 	}
 
 	// res@size
-  if(!bTranscode && pUPnPBrowse->IncludeProperty("res@size") && !pSQLResult->isNull("SIZE")) {
-    xmlTextWriterWriteAttribute(pWriter, BAD_CAST "size", BAD_CAST pSQLResult->asString("SIZE").c_str());
+  if(!bTranscode && pUPnPBrowse->IncludeProperty("res@size") && !pSQLResult->isNull(ObjectRow::COL_SIZE)) {
+    xmlTextWriterWriteAttribute(pWriter, BAD_CAST "size", BAD_CAST pSQLResult->asString(ObjectRow::COL_SIZE).c_str());
   }
   
 	sExt = pUPnPBrowse->DeviceSettings()->Extension(sExt);
@@ -895,18 +864,18 @@ void CContentDirectory::BuildImageItemDescription(xmlTextWriterPtr pWriter,
 }
 
 void CContentDirectory::BuildVideoItemDescription(xmlTextWriterPtr pWriter,
-                                                  CSQLResult* pSQLResult,
+                                                  ObjectRow* pSQLResult,
                                                   CUPnPBrowseSearchBase*  pUPnPBrowse,
                                                   std::string p_sObjectID)
 {                                                     
-  string sExt = ExtractFileExt(pSQLResult->asString("FILE_NAME"));
+  string sExt = ExtractFileExt(pSQLResult->asString(ObjectRow::COL_FILE_NAME));
     
-  bool bTranscode = pUPnPBrowse->DeviceSettings()->DoTranscode(sExt, pSQLResult->asString("AUDIO_CODEC"), pSQLResult->asString("VIDEO_CODEC"));
+  bool bTranscode = pUPnPBrowse->DeviceSettings()->DoTranscode(sExt, pSQLResult->asString(ObjectRow::COL_AUDIO_CODEC), pSQLResult->asString(ObjectRow::COL_VIDEO_CODEC));
 
   // title
   xmlTextWriterStartElement(pWriter, BAD_CAST "dc:title");
     // trim filename
-    string sFileName = pSQLResult->asString("TITLE");
+    string sFileName = pSQLResult->asString(ObjectRow::COL_TITLE);
 		if(pUPnPBrowse->DeviceSettings()->DisplaySettings()->nMaxFileNameLength > 0) {
 			sFileName = TrimFileName(sFileName, pUPnPBrowse->DeviceSettings()->DisplaySettings()->nMaxFileNameLength);
 		}
@@ -923,7 +892,7 @@ void CContentDirectory::BuildVideoItemDescription(xmlTextWriterPtr pWriter,
   writeAlbumArtUrl(pWriter, pUPnPBrowse, pSQLResult);
   
   // subtitle
-  if(pSQLResult->asInt("V_HAS_SUBTITLES_FILE") == 1) {
+  if(pSQLResult->asInt(ObjectRow::COL_V_HAS_SUBTITLES_FILE) == 1) {
     //<sec:CaptionInfoEx sec:type="srt">http://subtile.url.srt</sec:CaptionInfoEx>    
     xmlTextWriterStartElement(pWriter, BAD_CAST "sec:CaptionInfoEx");    
       xmlTextWriterWriteAttribute(pWriter, BAD_CAST "sec:typ", BAD_CAST "srt");
@@ -934,15 +903,15 @@ void CContentDirectory::BuildVideoItemDescription(xmlTextWriterPtr pWriter,
   }
   
   /*
-	if(pSQLResult->asUInt("ALBUM_ART_ID") > 0 || CPluginMgr::hasMetadataPlugin("ffmpegthumbnailer")) {
+	if(pSQLResult->asUInt(ObjectRow::COL_ALBUM_ART_ID) > 0 || CPluginMgr::hasMetadataPlugin("ffmpegthumbnailer")) {
 		xmlTextWriterStartElement(pWriter, BAD_CAST "upnp:albumArtURI");
 		  xmlTextWriterWriteAttribute(pWriter, BAD_CAST "xmlns:dlna", BAD_CAST "urn:schemas-dlna-org:metadata-1-0/");
 			xmlTextWriterWriteAttribute(pWriter, BAD_CAST "dlna:profileID", BAD_CAST "JPEG_SM");
     
 			string url = "http://" + m_sHTTPServerURL + "/ImageItems/";
-      if(pSQLResult->asUInt("ALBUM_ART_ID") > 0) {
+      if(pSQLResult->asUInt(ObjectRow::COL_ALBUM_ART_ID) > 0) {
         char szArtId[11];
-			  sprintf(szArtId, "%010X", pSQLResult->asUInt("ALBUM_ART_ID"));
+			  sprintf(szArtId, "%010X", pSQLResult->asUInt(ObjectRow::COL_ALBUM_ART_ID));
         url += szArtId;
       }
       else {
@@ -958,8 +927,8 @@ void CContentDirectory::BuildVideoItemDescription(xmlTextWriterPtr pWriter,
   // res
   xmlTextWriterStartElement(pWriter, BAD_CAST "res");    
 
-  string sMimeType = pUPnPBrowse->DeviceSettings()->MimeType(sExt, pSQLResult->asString("AUDIO_CODEC"), pSQLResult->asString("VIDEO_CODEC"));
-  string targetExt = pUPnPBrowse->DeviceSettings()->Extension(sExt, pSQLResult->asString("AUDIO_CODEC"), pSQLResult->asString("VIDEO_CODEC"));
+  string sMimeType = pUPnPBrowse->DeviceSettings()->MimeType(sExt, pSQLResult->asString(ObjectRow::COL_AUDIO_CODEC), pSQLResult->asString(ObjectRow::COL_VIDEO_CODEC));
+  string targetExt = pUPnPBrowse->DeviceSettings()->Extension(sExt, pSQLResult->asString(ObjectRow::COL_AUDIO_CODEC), pSQLResult->asString(ObjectRow::COL_VIDEO_CODEC));
 
   // res@protocolInfo
   string profile;
@@ -973,15 +942,15 @@ void CContentDirectory::BuildVideoItemDescription(xmlTextWriterPtr pWriter,
   
                                                     
   // res@duration
-  if(pUPnPBrowse->IncludeProperty("res@duration") && !pSQLResult->isNull("AV_DURATION")) {
-    string dur = FormatHelper::msToUpnpDuration(pSQLResult->asInt("AV_DURATION"));
+  if(pUPnPBrowse->IncludeProperty("res@duration") && !pSQLResult->isNull(ObjectRow::COL_AV_DURATION)) {
+    string dur = FormatHelper::msToUpnpDuration(pSQLResult->asInt(ObjectRow::COL_AV_DURATION));
     xmlTextWriterWriteAttribute(pWriter, BAD_CAST "duration", BAD_CAST dur.c_str());
   }
       
 	// res@resolution 
-	if(pUPnPBrowse->IncludeProperty("res@resolution") && !pSQLResult->isNull("IV_WIDTH") && !pSQLResult->isNull("IV_HEIGHT")) {	
-		if(!pSQLResult->isNull("IV_WIDTH") && !pSQLResult->isNull("IV_HEIGHT")) {
-			sTmp = pSQLResult->asString("IV_WIDTH") + "x" + pSQLResult->asString("IV_HEIGHT");
+	if(pUPnPBrowse->IncludeProperty("res@resolution") && !pSQLResult->isNull(ObjectRow::COL_IV_WIDTH) && !pSQLResult->isNull(ObjectRow::COL_IV_HEIGHT)) {	
+		if(!pSQLResult->isNull(ObjectRow::COL_IV_WIDTH) && !pSQLResult->isNull(ObjectRow::COL_IV_HEIGHT)) {
+			sTmp = pSQLResult->asString(ObjectRow::COL_IV_WIDTH) + "x" + pSQLResult->asString(ObjectRow::COL_IV_HEIGHT);
 			xmlTextWriterWriteAttribute(pWriter, BAD_CAST "resolution", BAD_CAST sTmp.c_str());
 		}
 		else if(pUPnPBrowse->DeviceSettings()->ShowEmptyResolution()) {
@@ -1001,17 +970,17 @@ void CContentDirectory::BuildVideoItemDescription(xmlTextWriterPtr pWriter,
         xmlTextWriterWriteAttribute(pWriter, BAD_CAST "bitrate", BAD_CAST sBitRate.str().c_str());
       }      
     }
-    else if(!pSQLResult->isNull("V_BITRATE")) {
-      xmlTextWriterWriteAttribute(pWriter, BAD_CAST "bitrate", BAD_CAST pSQLResult->asString("V_BITRATE").c_str());
+    else if(!pSQLResult->isNull(ObjectRow::COL_V_BITRATE)) {
+      xmlTextWriterWriteAttribute(pWriter, BAD_CAST "bitrate", BAD_CAST pSQLResult->asString(ObjectRow::COL_V_BITRATE).c_str());
     }
   }
       
   // res@size
-  if(!bTranscode && pUPnPBrowse->IncludeProperty("res@size") && !pSQLResult->isNull("SIZE")) {
-    xmlTextWriterWriteAttribute(pWriter, BAD_CAST "size", BAD_CAST pSQLResult->asString("SIZE").c_str());
+  if(!bTranscode && pUPnPBrowse->IncludeProperty("res@size") && !pSQLResult->isNull(ObjectRow::COL_SIZE)) {
+    xmlTextWriterWriteAttribute(pWriter, BAD_CAST "size", BAD_CAST pSQLResult->asString(ObjectRow::COL_SIZE).c_str());
   }
 	
-  sExt = pUPnPBrowse->DeviceSettings()->Extension(sExt, pSQLResult->asString("AUDIO_CODEC"), pSQLResult->asString("VIDEO_CODEC"));
+  sExt = pUPnPBrowse->DeviceSettings()->Extension(sExt, pSQLResult->asString(ObjectRow::COL_AUDIO_CODEC), pSQLResult->asString(ObjectRow::COL_VIDEO_CODEC));
                                                     
   sTmp = "http://" + m_sHTTPServerURL + "/VideoItems/" + buildObjectAlias(p_sObjectID, pSQLResult) + "." + sExt;  
   xmlTextWriterWriteString(pWriter, BAD_CAST sTmp.c_str());
@@ -1019,14 +988,14 @@ void CContentDirectory::BuildVideoItemDescription(xmlTextWriterPtr pWriter,
 }
 
 void CContentDirectory::BuildVideoBroadcastItemDescription(xmlTextWriterPtr pWriter,
-                                                  CSQLResult* pSQLResult,
+                                                  ObjectRow* pSQLResult,
                                                   CUPnPBrowseSearchBase*  pUPnPBrowse,
                                                   std::string /*p_sObjectID*/)
 { 
 /* // title
 	xmlTextWriterStartElement(pWriter, BAD_CAST "dc:title");
     // trim filename
-    string sFileName = TrimFileName(pSQLResult->asString("FILE_NAME"), pUPnPBrowse->DeviceSettings()->DisplaySettings()->nMaxFileNameLength, true);    
+    string sFileName = TrimFileName(pSQLResult->asString(ObjectRow::COL_FILE_NAME), pUPnPBrowse->DeviceSettings()->DisplaySettings()->nMaxFileNameLength, true);    
     sFileName = TruncateFileExt(sFileName);
     xmlTextWriterWriteString(pWriter, BAD_CAST sFileName.c_str());    
 	xmlTextWriterEndElement(pWriter);
@@ -1038,14 +1007,14 @@ void CContentDirectory::BuildVideoBroadcastItemDescription(xmlTextWriterPtr pWri
   
   // res
   xmlTextWriterStartElement(pWriter, BAD_CAST "res");  
-  xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString("PATH").c_str());
+  xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString(ObjectRow::COL_PATH).c_str());
   xmlTextWriterEndElement(pWriter);   */
 																											
 																											
 																											// title
 	xmlTextWriterStartElement(pWriter, BAD_CAST "dc:title");
     // trim filename
-    string sFileName = TrimFileName(pSQLResult->asString("FILE_NAME"), pUPnPBrowse->DeviceSettings()->DisplaySettings()->nMaxFileNameLength);
+    string sFileName = TrimFileName(pSQLResult->asString(ObjectRow::COL_FILE_NAME), pUPnPBrowse->DeviceSettings()->DisplaySettings()->nMaxFileNameLength);
     sFileName = TruncateFileExt(sFileName);
     xmlTextWriterWriteString(pWriter, BAD_CAST sFileName.c_str());    
 	xmlTextWriterEndElement(pWriter);
@@ -1057,19 +1026,19 @@ void CContentDirectory::BuildVideoBroadcastItemDescription(xmlTextWriterPtr pWri
   
   // res
   xmlTextWriterStartElement(pWriter, BAD_CAST "res");
-  xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString("PATH").c_str());
+  xmlTextWriterWriteString(pWriter, BAD_CAST pSQLResult->asString(ObjectRow::COL_PATH).c_str());
   xmlTextWriterEndElement(pWriter);  
 }
 
 void CContentDirectory::BuildPlaylistItemDescription(xmlTextWriterPtr pWriter,
-                                                  CSQLResult* pSQLResult,
+                                                  ObjectRow* pSQLResult,
                                                   CUPnPBrowseSearchBase*  pUPnPBrowse,
                                                   std::string p_sObjectID)
 {   
   // title	
   xmlTextWriterStartElement(pWriter, BAD_CAST "dc:title");
 		// trim filename
-		string sFileName = TrimFileName(pSQLResult->asString("TITLE"), pUPnPBrowse->DeviceSettings()->DisplaySettings()->nMaxFileNameLength);
+		string sFileName = TrimFileName(pSQLResult->asString(ObjectRow::COL_TITLE), pUPnPBrowse->DeviceSettings()->DisplaySettings()->nMaxFileNameLength);
 		//sFileName = TruncateFileExt(sFileName);
 		xmlTextWriterWriteString(pWriter, BAD_CAST sFileName.c_str());    
 	xmlTextWriterEndElement(pWriter);  
@@ -1084,7 +1053,7 @@ void CContentDirectory::BuildPlaylistItemDescription(xmlTextWriterPtr pWriter,
   
  
 
-  string ext = ExtractFileExt(pSQLResult->asString("FILE_NAME"));
+  string ext = ExtractFileExt(pSQLResult->asString(ObjectRow::COL_FILE_NAME));
 
   switch(pUPnPBrowse->DeviceSettings()->playlistStyle()) {
     case CDeviceSettings::container:
@@ -1180,112 +1149,33 @@ void CContentDirectory::HandleUPnPSearch(CUPnPSearch* pSearch, std::string* p_ps
 {
   unsigned int	nTotalMatches = 0;
   unsigned int	nNumberReturned = 0;
-  CSQLQuery*		qry = CDatabase::query();
-	CSQLResult*   pRow = NULL;
+  SQLQuery      qry(SQLQuery::ReadOnly);
 	
   // get total matches     
 	//pSearch->prepareSQL();
-	qry->select(pSearch->getQuery(true));
-  if(!qry->eof()) {
-    nTotalMatches = qry->result()->asInt("COUNT");
+	qry.select(pSearch->getQuery(true));
+  if(!qry.eof()) {
+    nTotalMatches = qry.result()->asInt("COUNT");
   }
 
   // get items     	
-	qry->select(pSearch->getQuery());
+	qry.prepare(pSearch->getQuery());
+  qry.execute();
 
   // build result
-  xmlTextWriterPtr writer;
-	xmlBufferPtr buf;	
-	
-	buf    = xmlBufferCreate();   
-	writer = xmlNewTextWriterMemory(buf, 0);    
-	xmlTextWriterStartDocument(writer, NULL, "UTF-8", NULL);
-  
-  // root
-  xmlTextWriterStartElementNS(writer, BAD_CAST "s", BAD_CAST "Envelope", NULL);    
-  xmlTextWriterWriteAttributeNS(writer, BAD_CAST "s", 
-    BAD_CAST "encodingStyle", 
-    BAD_CAST  "http://schemas.xmlsoap.org/soap/envelope/", 
-    BAD_CAST "http://schemas.xmlsoap.org/soap/encoding/");
-   
-    // body
-    xmlTextWriterStartElementNS(writer, BAD_CAST "s", BAD_CAST "Body", NULL);    
+  DIDLResultWriter result("Search", false);
   
-      // search response
-      xmlTextWriterStartElementNS(writer, BAD_CAST "u",        
-        BAD_CAST "SearchResponse", 
-        BAD_CAST "urn:schemas-upnp-org:service:ContentDirectory:1");
-          
-      // result
-      xmlTextWriterStartElement(writer, BAD_CAST "Result");
-          
-      // build result xml
-      xmlTextWriterPtr resWriter;
-      xmlBufferPtr resBuf;
-      resBuf    = xmlBufferCreate();   
-      resWriter = xmlNewTextWriterMemory(resBuf, 0);    
-      xmlTextWriterStartDocument(resWriter, NULL, "UTF-8", NULL);
-  
-      xmlTextWriterStartElementNS(resWriter, NULL, BAD_CAST "DIDL-Lite", BAD_CAST "urn:schemas-upnp-org:metadata-1-0/DIDL-Lite/");
-      xmlTextWriterWriteAttribute(resWriter, BAD_CAST "xmlns:dc", BAD_CAST "http://purl.org/dc/elements/1.1/");
-      xmlTextWriterWriteAttribute(resWriter, BAD_CAST "xmlns:upnp", BAD_CAST "urn:schemas-upnp-org:metadata-1-0/upnp/");          
-  
-      while(!qry->eof()) {        
-        pRow = qry->result();        
-        BuildDescription(resWriter, pRow, pSearch, "0");
-        nNumberReturned++;
-        
-        qry->next();
-      }
-
-      // finalize result xml
-      xmlTextWriterEndElement(resWriter);
-      xmlTextWriterEndDocument(resWriter);
-      xmlFreeTextWriter(resWriter);
-
-      string sResOutput = (const char*)resBuf->content;
+  ObjectRow row;
+  while(!qry.eof()) {        
+    row.set(qry.result());
+    BuildDescription(result.writer(), &row, pSearch, "0");
+    nNumberReturned++;
+    
+    qry.next();
+  }
 
-      xmlBufferFree(resBuf);        
-      sResOutput = sResOutput.substr(strlen("<?xml version=\"1.0\" encoding=\"UTF-8\"?> "));
-      xmlTextWriterWriteString(writer, BAD_CAST sResOutput.c_str());
-      
-      // end result
-      xmlTextWriterEndElement(writer);
-        
-      // number returned      
-      xmlTextWriterStartElement(writer, BAD_CAST "NumberReturned");      
-      xmlTextWriterWriteFormatString(writer, "%u", nNumberReturned);
-      xmlTextWriterEndElement(writer);  
-  
-      // total matches
-      xmlTextWriterStartElement(writer, BAD_CAST "TotalMatches");      
-      xmlTextWriterWriteFormatString(writer, "%u", nTotalMatches);
-      xmlTextWriterEndElement(writer);
-      
-      // update id
-      xmlTextWriterStartElement(writer, BAD_CAST "UpdateID");
-      xmlTextWriterWriteFormatString(writer, "%u", CContentDatabase::systemUpdateId());
-      xmlTextWriterEndElement(writer);
-  
-      // end search response
-      xmlTextWriterEndElement(writer);
-      
-    // end body
-    xmlTextWriterEndElement(writer);
-   
-	// end root
-	xmlTextWriterEndElement(writer);
-  xmlTextWriterEndDocument(writer);
-	xmlFreeTextWriter(writer);
-	
-	string output;
-	output = (const char*)buf->content;	
-  CSharedLog::Log(L_DBG, __FILE__, __LINE__, output);
-  
-	xmlBufferFree(buf);
-	delete qry;
-	
-  *p_psResult = output;
+  p_psResult->swap(result.finish(nNumberReturned, nTotalMatches, CContentDatabase::systemUpdateId()));
+  CSharedLog::Log(L_DBG, __FILE__, __LINE__, *p_psResult);
 }
 
 #warning FIXME
@@ -1519,15 +1409,15 @@ std::string CContentDirectory::BuildProtocolInfo(bool p_bTranscode,
 
 void CContentDirectory::writeAlbumArtUrl(xmlTextWriterPtr pWriter,
                                                 CUPnPAction* pAction,
-                                                CSQLResult* pSQLResult)
+                                                ObjectRow* pSQLResult)
 {
-  OBJECT_TYPE objectType = (OBJECT_TYPE)pSQLResult->asInt("TYPE");
+  OBJECT_TYPE objectType = (OBJECT_TYPE)pSQLResult->asInt(ObjectRow::COL_TYPE);
   bool video = (objectType >= ITEM_VIDEO_ITEM && objectType < ITEM_VIDEO_ITEM_MAX);
   bool audio = (objectType >= ITEM_AUDIO_ITEM && objectType < ITEM_AUDIO_ITEM_MAX);
   bool image = (objectType >= ITEM_IMAGE_ITEM && objectType < ITEM_IMAGE_ITEM_MAX);
   bool container = (objectType >= CONTAINER_STORAGE_FOLDER && objectType < CONTAINER_MAX);
 
-  SQLQuery qry;
+  SQLQuery qry(SQLQuery::ReadOnly);
   object_id_t albumArtId = 0;
   std::string albumArtExt;
   int albumArtWidth = 0;
@@ -1538,18 +1428,18 @@ void CContentDirectory::writeAlbumArtUrl(xmlTextWriterPtr pWriter,
     // audio files with an album art have either the id for an image file
     // or their own object id if the file contains an image.
     // if the id is 0 there is no album art available
-    if(pSQLResult->isNull("ALBUM_ART_ID") || pSQLResult->asUInt("ALBUM_ART_ID") == 0)
+    if(pSQLResult->isNull(ObjectRow::COL_ALBUM_ART_ID) || pSQLResult->asUInt(ObjectRow::COL_ALBUM_ART_ID) == 0)
       return;
 
     // object contains the image
-    if(pSQLResult->asUInt("ALBUM_ART_ID") == pSQLResult->asUInt("OBJECT_ID") || 
-       pSQLResult->asUInt("ALBUM_ART_ID") == pSQLResult->asUInt("REF_ID") ||
-       pSQLResult->asUInt("ALBUM_ART_ID") == pSQLResult->asUInt("VREF_ID")) {
-
-      albumArtId = pSQLResult->asUInt("ALBUM_ART_ID");
-      albumArtExt = pSQLResult->asString("ALBUM_ART_EXT");
-      albumArtWidth = pSQLResult->asInt("ALBUM_ART_WIDTH");
-      albumArtHeight = pSQLResult->asInt("ALBUM_ART_HEIGHT");
+    if(pSQLResult->asUInt(ObjectRow::COL_ALBUM_ART_ID) == pSQLResult->asUInt(ObjectRow::COL_OBJECT_ID) || 
+       pSQLResult->asUInt(ObjectRow::COL_ALBUM_ART_ID) == pSQLResult->asUInt(ObjectRow::COL_REF_ID) ||
+       pSQLResult->asUInt(ObjectRow::COL_ALBUM_ART_ID) == pSQLResult->asUInt(ObjectRow::COL_VREF_ID)) {
+
+      albumArtId = pSQLResult->asUInt(ObjectRow::COL_ALBUM_ART_ID);
+      albumArtExt = pSQLResult->asString(ObjectRow::COL_ALBUM_ART_EXT);
+      albumArtWidth = pSQLResult->asInt(ObjectRow::COL_ALBUM_ART_WIDTH);
+      albumArtHeight = pSQLResult->asInt(ObjectRow::COL_ALBUM_ART_HEIGHT);
       if(albumArtWidth == 0 || albumArtHeight == 0) {
         albumArtWidth = 300;
         albumArtHeight = 300;
@@ -1559,13 +1449,13 @@ void CContentDirectory::writeAlbumArtUrl(xmlTextWriterPtr pWriter,
     // image file
     else {
 
-      if(pSQLResult->isNull("ALBUM_ART_ID") || pSQLResult->asUInt("ALBUM_ART_ID") == 0)
+      if(pSQLResult->isNull(ObjectRow::COL_ALBUM_ART_ID) || pSQLResult->asUInt(ObjectRow::COL_ALBUM_ART_ID) == 0)
         return;
 
-      albumArtId = pSQLResult->asUInt("ALBUM_ART_ID");
-      albumArtExt = pSQLResult->asString("ALBUM_ART_EXT");
-      albumArtWidth = pSQLResult->asInt("ALBUM_ART_WIDTH");
-      albumArtHeight = pSQLResult->asInt("ALBUM_ART_HEIGHT");
+      albumArtId = pSQLResult->asUInt(ObjectRow::COL_ALBUM_ART_ID);
+      albumArtExt = pSQLResult->asString(ObjectRow::COL_ALBUM_ART_EXT);
+      albumArtWidth = pSQLResult->asInt(ObjectRow::COL_ALBUM_ART_WIDTH);
+      albumArtHeight = pSQLResult->asInt(ObjectRow::COL_ALBUM_ART_HEIGHT);
     }
     
   } // audio
@@ -1575,14 +1465,16 @@ void CContentDirectory::writeAlbumArtUrl(xmlTextWriterPtr pWriter,
 
     // if we got an image and no magickWand transcoder there is no album art
     if(!CPluginMgr::hasTranscoderPlugin("magickWand") && 
-       (pSQLResult->isNull("ALBUM_ART_ID") || pSQLResult->asUInt("ALBUM_ART_ID") == 0))
+       (pSQLResult->isNull(ObjectRow::COL_ALBUM_ART_ID) || pSQLResult->asUInt(ObjectRow::COL_ALBUM_ART_ID) == 0))
     return;
 
-    // else we use the object itself
-    albumArtId = pSQLResult->asUInt("OBJECT_ID");
-    albumArtExt = ExtractFileExt(pSQLResult->asString("FILE_NAME"));
-    albumArtWidth = 300;
-    albumArtHeight = 300;
+    // else we use the object itself scaled to JPEG_TN.
+    // the thumbnail is usually pre-rendered by the ThumbnailGenerator
+    albumArtId = pSQLResult->asUInt(ObjectRow::COL_OBJECT_ID);
+    albumArtExt = ExtractFileExt(pSQLResult->asString(ObjectRow::COL_FILE_NAME));
+    albumArtWidth = 160;
+    albumArtHeight = 160;
+    appendSize = CPluginMgr::hasTranscoderPlugin("magickWand");
   } // image
 
 
@@ -1590,12 +1482,12 @@ void CContentDirectory::writeAlbumArtUrl(xmlTextWriterPtr pWriter,
 
     // no album art set and no ffmpegthumbniler means no album art
     if(!CPluginMgr::hasMetadataPlugin("ffmpegthumbnailer") &&
-       (pSQLResult->isNull("ALBUM_ART_ID") || pSQLResult->asUInt("ALBUM_ART_ID") == 0))
+       (pSQLResult->isNull(ObjectRow::COL_ALBUM_ART_ID) || pSQLResult->asUInt(ObjectRow::COL_ALBUM_ART_ID) == 0))
       return;
 
     // create image from the video using ffmpegthumbnailer
-    if((pSQLResult->isNull("ALBUM_ART_ID") || pSQLResult->asUInt("ALBUM_ART_ID") == 0)) {
-      albumArtId = pSQLResult->asUInt("OBJECT_ID");
+    if((pSQLResult->isNull(ObjectRow::COL_ALBUM_ART_ID) || pSQLResult->asUInt(ObjectRow::COL_ALBUM_ART_ID) == 0)) {
+      albumArtId = pSQLResult->asUInt(ObjectRow::COL_OBJECT_ID);
       albumArtExt = "jpg";
       albumArtWidth = 300;
       albumArtHeight = 300;    
@@ -1604,10 +1496,10 @@ void CContentDirectory::writeAlbumArtUrl(xmlTextWriterPtr pWriter,
     // image file
     else {
 
-      albumArtId = pSQLResult->asUInt("ALBUM_ART_ID");
-      albumArtExt = pSQLResult->asString("ALBUM_ART_EXT");
-      albumArtWidth = pSQLResult->asInt("ALBUM_ART_WIDTH");
-      albumArtHeight = pSQLResult->asInt("ALBUM_ART_HEIGHT");
+      albumArtId = pSQLResult->asUInt(ObjectRow::COL_ALBUM_ART_ID);
+      albumArtExt = pSQLResult->asString(ObjectRow::COL_ALBUM_ART_EXT);
+      albumArtWidth = pSQLResult->asInt(ObjectRow::COL_ALBUM_ART_WIDTH);
+      albumArtHeight = pSQLResult->asInt(ObjectRow::COL_ALBUM_ART_HEIGHT);
     }
     
   } // video
@@ -1615,13 +1507,13 @@ void CContentDirectory::writeAlbumArtUrl(xmlTextWriterPtr pWriter,
 
   if(container) {
 
-    if(pSQLResult->isNull("ALBUM_ART_ID") || pSQLResult->asUInt("ALBUM_ART_ID") == 0)
+    if(pSQLResult->isNull(ObjectRow::COL_ALBUM_ART_ID) || pSQLResult->asUInt(ObjectRow::COL_ALBUM_ART_ID) == 0)
       return;
 
-    albumArtId = pSQLResult->asUInt("ALBUM_ART_ID");
-    albumArtExt = pSQLResult->asString("ALBUM_ART_EXT");
-    albumArtWidth = pSQLResult->asInt("ALBUM_ART_WIDTH");
-    albumArtHeight = pSQLResult->asInt("ALBUM_ART_HEIGHT");
+    albumArtId = pSQLResult->asUInt(ObjectRow::COL_ALBUM_ART_ID);
+    albumArtExt = pSQLResult->asString(ObjectRow::COL_ALBUM_ART_EXT);
+    albumArtWidth = pSQLResult->asInt(ObjectRow::COL_ALBUM_ART_WIDTH);
+    albumArtHeight = pSQLResult->asInt(ObjectRow::COL_ALBUM_ART_HEIGHT);
   } // container
   
 
@@ -1670,7 +1562,7 @@ inline bool convertAlias(std::string& alias)
 }
 
 std::string CContentDirectory::buildObjectAlias(std::string objectId, 
-                                                CSQLResult* pSQLResult)
+                                                ObjectRow* pSQLResult)
 {
   /*
   if(!rewriteUrl()) {  
@@ -1679,26 +1571,26 @@ std::string CContentDirectory::buildObjectAlias(std::string objectId,
 */
   
   /*cout << "buildObjectAlias for object id: " << objectId << endl;
-  cout << "title: " << pSQLResult->asString("TITLE") << endl;  */
+  cout << "title: " << pSQLResult->asString(ObjectRow::COL_TITLE) << endl;  */
 
   string alias;
   bool valid = false;
 
 /*
-  switch((OBJECT_TYPE)pSQLResult->asInt("TYPE")) {
+  switch((OBJECT_TYPE)pSQLResult->asInt(ObjectRow::COL_TYPE)) {
 
     case ITEM_AUDIO_ITEM:
     case ITEM_AUDIO_ITEM_MUSIC_TRACK:
       // ARTIST ALBUM TRACK_NO ...
       //valid = convertAlias(alias);
       if(!valid) {
-        alias = pSQLResult->asString("TITLE");
+        alias = pSQLResult->asString(ObjectRow::COL_TITLE);
         valid = convertAlias(alias);
       }
       break;
     
     default:
-      alias = pSQLResult->asString("TITLE");
+      alias = pSQLResult->asString(ObjectRow::COL_TITLE);
       valid = convertAlias(alias);
       break;
   }
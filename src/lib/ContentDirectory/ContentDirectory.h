@@ -39,6 +39,65 @@
 #include <map>
 #include <string>
 
+/**
+ * a row of the browse and search results.
+ * the column indices are resolved on the first row and reused
+ * for all following rows of the same query
+ */
+class ObjectRow
+{
+  public:
+    enum Column {
+      COL_OBJECT_ID,
+      COL_TYPE,
+      COL_REF_ID,
+      COL_VREF_ID,
+      COL_PATH,
+      COL_FILE_NAME,
+      COL_TITLE,
+      COL_DATE,
+      COL_SIZE,
+      COL_AV_ARTIST,
+      COL_AV_ALBUM,
+      COL_AV_GENRE,
+      COL_AV_DURATION,
+      COL_A_TRACK_NUMBER,
+      COL_A_CHANNELS,
+      COL_A_BITRATE,
+      COL_A_SAMPLERATE,
+      COL_A_BITS_PER_SAMPLE,
+      COL_AUDIO_CODEC,
+      COL_VIDEO_CODEC,
+      COL_V_BITRATE,
+      COL_V_HAS_SUBTITLES_FILE,
+      COL_IV_WIDTH,
+      COL_IV_HEIGHT,
+      COL_ALBUM_ART_ID,
+      COL_ALBUM_ART_EXT,
+      COL_ALBUM_ART_WIDTH,
+      COL_ALBUM_ART_HEIGHT,
+      COL_MAX
+    };
+
+    ObjectRow() {
+      m_result = NULL;
+      m_resolved = false;
+    }
+
+    // sets the current row. all rows must come from the same query
+    void set(CSQLResult* result);
+
+    bool isNull(Column col) { return m_result->isNull(m_columns[col]); }
+    std::string asString(Column col) { return m_result->asString(m_columns[col]); }
+    unsigned int asUInt(Column col) { return m_result->asUInt(m_columns[col]); }
+    int asInt(Column col) { return m_result->asInt(m_columns[col]); }
+
+  private:
+    CSQLResult*   m_result;
+    bool          m_resolved;
+    int           m_columns[COL_MAX];
+};
+
 class CContentDirectory: public CUPnPService
 {
 	
@@ -94,42 +153,42 @@ class CContentDirectory: public CUPnPService
                               CUPnPBrowse*  pUPnPBrowse);
 
     void BuildDescription(xmlTextWriterPtr pWriter,
-                          CSQLResult* pSQLResult,
+                          ObjectRow* pSQLResult,
                           CUPnPBrowseSearchBase*  pUPnPBrowse,
                           std::string p_sParentId);
   
     void BuildContainerDescription(xmlTextWriterPtr pWriter,
-                                   CSQLResult* pSQLResult,
+                                   ObjectRow* pSQLResult,
                                    CUPnPBrowseSearchBase*  pUPnPBrowse,
                                    std::string p_sParentId,
                                    OBJECT_TYPE p_nContainerType);
     void BuildItemDescription(xmlTextWriterPtr pWriter,
-                              CSQLResult* pSQLResult,
+                              ObjectRow* pSQLResult,
                               CUPnPBrowseSearchBase*  pUPnPBrowse,
                               OBJECT_TYPE p_nObjectType,
                               std::string p_sParentId);      
     void BuildAudioItemDescription(xmlTextWriterPtr pWriter,
-                                   CSQLResult* pSQLResult,
+                                   ObjectRow* pSQLResult,
                                    CUPnPBrowseSearchBase*  pUPnPBrowse,
                                    std::string p_sObjectID);      
     void BuildAudioBroadcastItemDescription(xmlTextWriterPtr pWriter,
-                                   CSQLResult* pSQLResult,
+                                   ObjectRow* pSQLResult,
                                    CUPnPBrowseSearchBase*  pUPnPBrowse,
                                    std::string p_sObjectID);                                    
     void BuildImageItemDescription(xmlTextWriterPtr pWriter,
-                                   CSQLResult* pSQLResult,
+                                   ObjectRow* pSQLResult,
                                    CUPnPBrowseSearchBase*  pUPnPBrowse,
                                    std::string p_sObjectID);
     void BuildVideoItemDescription(xmlTextWriterPtr pWriter,
-                                   CSQLResult* pSQLResult,
+                                   ObjectRow* pSQLResult,
                                    CUPnPBrowseSearchBase*  pUPnPBrowse,
                                    std::string p_sObjectID); 
     void BuildVideoBroadcastItemDescription(xmlTextWriterPtr pWriter,
-                                   CSQLResult* pSQLResult,
+                                   ObjectRow* pSQLResult,
                                    CUPnPBrowseSearchBase*  pUPnPBrowse,
                                    std::string p_sObjectID);   
     void BuildPlaylistItemDescription(xmlTextWriterPtr pWriter,
-                                   CSQLResult* pSQLResult,
+                                   ObjectRow* pSQLResult,
                                    CUPnPBrowseSearchBase*  pUPnPBrowse,
                                    std::string p_sObjectID);                                    
 
@@ -151,8 +210,8 @@ class CContentDirectory: public CUPnPService
                                   std::string p_sProfileId,
                                   CUPnPBrowseSearchBase*  pUPnPBrowse);
 
-    void writeAlbumArtUrl(xmlTextWriterPtr pWriter, CUPnPAction* pAction, CSQLResult* pSQLResult);
-    std::string buildObjectAlias(std::string objectId, CSQLResult* pSQLResult);
+    void writeAlbumArtUrl(xmlTextWriterPtr pWriter, CUPnPAction* pAction, ObjectRow* pSQLResult);
+    std::string buildObjectAlias(std::string objectId, ObjectRow* pSQLResult);
 
 
     bool  m_hasSubtitles;
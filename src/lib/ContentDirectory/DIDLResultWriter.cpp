@@ -0,0 +1,118 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            DIDLResultWriter.cpp
+ * 
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "DIDLResultWriter.h"
+
+#include <stdio.h>
+
+using namespace std;
+
+DIDLResultWriter::DIDLResultWriter(std::string action, bool secNamespace)
+{
+  m_action = action;
+  m_output.reserve(16384);
+
+  m_output = 
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<s:Envelope xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\" s:encodingStyle=\"http://schemas.xmlsoap.org/soap/encoding/\">"
+    "<s:Body>"
+    "<u:" + m_action + "Response xmlns:u=\"urn:schemas-upnp-org:service:ContentDirectory:1\">"
+    "<Result>";
+
+  xmlOutputBufferPtr out = xmlOutputBufferCreateIO(&DIDLResultWriter::write, &DIDLResultWriter::close, this, NULL);
+  m_writer = xmlNewTextWriter(out);
+
+  xmlTextWriterStartElementNS(m_writer, NULL, BAD_CAST "DIDL-Lite", BAD_CAST "urn:schemas-upnp-org:metadata-1-0/DIDL-Lite/");
+  xmlTextWriterWriteAttribute(m_writer, BAD_CAST "xmlns:dc", BAD_CAST "http://purl.org/dc/elements/1.1/");
+  xmlTextWriterWriteAttribute(m_writer, BAD_CAST "xmlns:upnp", BAD_CAST "urn:schemas-upnp-org:metadata-1-0/upnp/");
+  if(secNamespace)
+    xmlTextWriterWriteAttribute(m_writer, BAD_CAST "xmlns:sec", BAD_CAST "http://www.sec.co.kr/");
+}
+
+DIDLResultWriter::~DIDLResultWriter()
+{
+  if(m_writer)
+    xmlFreeTextWriter(m_writer);
+}
+
+std::string& DIDLResultWriter::finish(unsigned int numberReturned, unsigned int totalMatches, unsigned int updateId)
+{
+  // end DIDL-Lite
+  xmlTextWriterEndElement(m_writer);
+  xmlFreeTextWriter(m_writer);
+  m_writer = NULL;
+
+  char counters[200];
+  snprintf(counters, sizeof(counters), 
+    "</Result>"
+    "<NumberReturned>%u</NumberReturned>"
+    "<TotalMatches>%u</TotalMatches>"
+    "<UpdateID>%u</UpdateID>",
+    numberReturned, totalMatches, updateId);
+
+  m_output += counters;
+  m_output += "</u:" + m_action + "Response></s:Body></s:Envelope>";
+  return m_output;
+}
+
+// the DIDL is the text content of <Result> so it has to be escaped again
+int DIDLResultWriter::write(void* context, const char* buffer, int len) // static
+{
+  std::string* output = &((DIDLResultWriter*)context)->m_output;
+
+  int start = 0;
+  for(int i = 0; i < len; i++) {
+
+    const char* entity;
+    switch(buffer[i]) {
+      case '&':
+        entity = "&amp;";
+        break;
+      case '<':
+        entity = "&lt;";
+        break;
+      case '>':
+        entity = "&gt;";
+        break;
+      case '\r':
+        entity = "&#13;";
+        break;
+      default:
+        continue;
+    }
+
+    output->append(&buffer[start], i - start);
+    output->append(entity);
+    start = i + 1;
+  }
+  output->append(&buffer[start], len - start);
+
+  return len;
+}
+
+int DIDLResultWriter::close(void* /*context*/) // static
+{
+  return 0;
+}
@@ -0,0 +1,69 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            DIDLResultWriter.h
+ * 
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+ 
+#ifndef _DIDLRESULTWRITER_H
+#define _DIDLRESULTWRITER_H
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#include <string>
+#include <libxml/xmlwriter.h>
+
+/**
+ * builds the soap response of a Browse or Search action in a single pass.
+ *
+ * the DIDL-Lite result is created with the usual xmlTextWriter calls on writer()
+ * but the writer's output is escaped and appended directly to the
+ * <Result> element of the envelope. there is no intermediate DIDL document.
+ */
+class DIDLResultWriter
+{
+  public:
+    /** starts the envelope and the DIDL-Lite root element
+     *  @param  action  the action name. e.g. "Browse" creates a "BrowseResponse"
+     *  @param  secNamespace  add the xmlns:sec attribute (samsung)
+     */
+    DIDLResultWriter(std::string action, bool secNamespace = true);
+    ~DIDLResultWriter();
+
+    xmlTextWriterPtr writer() { return m_writer; }
+
+    /** closes the DIDL-Lite root and the envelope
+     *  @return the complete soap response. swap() it to avoid a copy
+     */
+    std::string& finish(unsigned int numberReturned, unsigned int totalMatches, unsigned int updateId);
+
+  private:
+    static int write(void* context, const char* buffer, int len);
+    static int close(void* context);
+
+    std::string       m_action;
+    std::string       m_output;
+    xmlTextWriterPtr  m_writer;
+};
+
+#endif // _DIDLRESULTWRITER_H
@@ -30,56 +30,249 @@
 #include "../SharedLog.h"
 
 #include <iostream>
+#include <vector>
 using namespace std;
 
 using namespace fuppes;
 
+static const char* queryNames[SQL_MAX] = {
+  "other",
+  "count child objects",
+  "get child objects",
+  "get object type",
+  "get object details",
+  "search select fields",
+  "search select count",
+  "search from",
+  "search get children ids",
+  "tables exist",
+  "create table db info",
+  "set db info",
+  "create table objects",
+  "create table object details",
+  "create indices",
+  "get object type count",
+  "full text index exists",
+  "create full text index",
+  "drop full text index",
+  "search full text"
+};
+
+static SQLQueryStats  queryStats[SQL_MAX];
+static fuppes::Mutex  queryStatsMutex;
+
+// the plugin's statements with the object id and device replaced by parameters.
+// [queryNo][0] = DEVICE is NULL, [queryNo][1] = DEVICE = ?2
+static std::string    preparedStatements[SQL_MAX][2];
+
 SQLQuery::SQLQuery(CDatabaseConnection* connection /*= NULL*/)
 {
   if(connection)
     m_query = connection->query();
   else
   	m_query = CDatabase::query();
+
+  m_readConnection = NULL;
+  m_queryNo = SQL_UNKNOWN;
+  m_timing = false;
+  m_time = 0;
+}
+
+SQLQuery::SQLQuery(Access access)
+{
+  m_readConnection = NULL;
+  if(access == ReadOnly)
+    m_readConnection = CDatabase::acquireReadConnection();
+
+  // without a pooled connection we fall back to the shared one
+  if(m_readConnection)
+    m_query = m_readConnection->query();
+  else
+    m_query = CDatabase::query();
+
+  m_queryNo = SQL_UNKNOWN;
+  m_timing = false;
+  m_time = 0;
 }
 
 SQLQuery::~SQLQuery()
 {
+  finish();
 	if(m_query)
 		delete m_query;
+  if(m_readConnection)
+    CDatabase::releaseReadConnection(m_readConnection);
 }
 
 bool SQLQuery::select(const std::string sql)
 {
   if(!m_query)
     return false;
-  return m_query->select(sql);
+
+  finish();
+  unsigned long long start = fuppesMicroTicks();
+  bool result = m_query->select(sql);
+  m_time = fuppesMicroTicks() - start;
+  m_timing = true;
+  finish();
+  m_queryNo = SQL_UNKNOWN;
+  return result;
 }
 
 bool SQLQuery::exec(const std::string sql)
 {
   if(!m_query)
     return false;
-  return m_query->exec(sql);
+
+  finish();
+  unsigned long long start = fuppesMicroTicks();
+  bool result = m_query->exec(sql);
+  m_time = fuppesMicroTicks() - start;
+  m_timing = true;
+  finish();
+  m_queryNo = SQL_UNKNOWN;
+  return result;
 }
 
 fuppes_off_t SQLQuery::insert(const std::string sql)
 {
   if(!m_query)
     return 0;
-  return m_query->insert(sql);
+  
+  finish();
+  unsigned long long start = fuppesMicroTicks();
+  fuppes_off_t result = m_query->insert(sql);
+  m_time = fuppesMicroTicks() - start;
+  m_timing = true;
+  finish();
+  m_queryNo = SQL_UNKNOWN;
+  return result;
+}
+
+bool SQLQuery::prepare(const std::string sql, fuppes_sql_no queryNo /*= SQL_UNKNOWN*/)
+{
+  if(!m_query)
+    return false;
+
+  finish();
+  m_queryNo = queryNo;
+  return m_query->prepare(sql);
+}
+
+void SQLQuery::bind(int index, const std::string value)
+{
+  if(m_query)
+    m_query->bind(index, value);
+}
+
+void SQLQuery::bind(int index, fuppes_off_t value)
+{
+  if(m_query)
+    m_query->bind(index, value);
+}
+
+bool SQLQuery::execute()
+{
+  if(!m_query)
+    return false;
+
+  finish();
+  unsigned long long start = fuppesMicroTicks();
+  bool result = m_query->execute();
+  m_time = fuppesMicroTicks() - start;
+  m_timing = true;
+  return result;
+}
+
+bool SQLQuery::prepare(fuppes_sql_no queryNo, fuppes_off_t objectId, std::string device /*= ""*/, std::string append /*= ""*/)
+{
+  if(!m_query)
+    return false;
+
+  int withDevice = device.empty() ? 0 : 1;
+  std::string sql;
+
+  queryStatsMutex.lock();
+  if(preparedStatements[queryNo][withDevice].empty()) {
+    sql = connection()->getStatement(queryNo);
+    sql = StringReplace(sql, "%OBJECT_ID%", "?1");
+    sql = StringReplace(sql, "%DEVICE%", withDevice ? "DEVICE = ?2" : "DEVICE is NULL");
+    preparedStatements[queryNo][withDevice] = sql;
+  }
+  sql = preparedStatements[queryNo][withDevice];
+  queryStatsMutex.unlock();
+
+  if(!append.empty())
+    sql += append;
+
+  if(!prepare(sql, queryNo))
+    return false;
+
+  bind(1, objectId);
+  if(withDevice)
+    bind(2, device);
+  return true;
+}
+
+bool SQLQuery::execute(fuppes_sql_no queryNo, fuppes_off_t objectId, std::string device /*= ""*/, std::string append /*= ""*/)
+{
+  if(!prepare(queryNo, objectId, device, append))
+    return false;
+  return execute();
+}
+
+void SQLQuery::finish()
+{
+  if(!m_timing)
+    return;
+  m_timing = false;
+
+  unsigned int time = (unsigned int)m_time;
+
+  queryStatsMutex.lock();
+  queryStats[m_queryNo].count++;
+  queryStats[m_queryNo].time += time;
+  if(time > queryStats[m_queryNo].maxTime)
+    queryStats[m_queryNo].maxTime = time;
+  queryStatsMutex.unlock();
+
+  m_time = 0;
+}
+
+SQLQueryStats SQLQuery::stats(fuppes_sql_no queryNo) // static
+{
+  MutexLocker locker(&queryStatsMutex);
+  return queryStats[queryNo];
+}
+
+const char* SQLQuery::queryName(fuppes_sql_no queryNo) // static
+{
+  return queryNames[queryNo];
 }
 
 bool SQLQuery::eof()
 {
   if(!m_query)
     return false;
-  return m_query->eof();
+  bool result = m_query->eof();
+  if(result)
+    finish();
+  return result;
 }
 
 void SQLQuery::next()
 {
-  if(m_query)
+  if(!m_query)
+    return;
+
+  if(!m_timing) {
     m_query->next();
+    return;
+  }
+
+  unsigned long long start = fuppesMicroTicks();
+  m_query->next();
+  m_time += fuppesMicroTicks() - start;
 }
 
 CSQLResult* SQLQuery::result()
@@ -98,6 +291,7 @@ fuppes_off_t SQLQuery::lastInsertId()
 
 void SQLQuery::clear()
 {
+  finish();
   if(m_query)
     m_query->clear();
 }
@@ -137,7 +331,9 @@ std::string SQLQuery::build(fuppes_sql_no queryNo, std::string objectId, std::st
   sql = StringReplace (sql, "%DEVICE%", device);
   
   //cout << "SQL: " << sql << endl;
-  
+
+  // the next select()/exec() is accounted for this query type
+  m_queryNo = queryNo;
   return sql;
 }
 
@@ -162,8 +358,40 @@ static CConnectionParams m_connectionParams;
 //static fuppesThreadMutex mutex;
 static fuppes::Mutex mutex;
 
-bool CDatabase::connect(const CConnectionParams params) // static
+// how long a read query waits for a pooled connection
+// before it falls back to the shared connection
+#define READ_CONNECTION_TIMEOUT 100  // ms
+
+#ifdef WIN32
+typedef DWORD ThreadId;
+#define currentThread() GetCurrentThreadId()
+#define sameThread(a, b) ((a) == (b))
+#else
+typedef pthread_t ThreadId;
+#define currentThread() pthread_self()
+#define sameThread(a, b) pthread_equal(a, b)
+#endif
+
+struct ReadConnection
+{
+  CDatabaseConnection*  connection;
+  ThreadId              owner;
+  // number of queries of the owner using the connection. 0 = idle
+  unsigned int          refs;
+};
+
+static std::vector<ReadConnection>  readConnections;
+static unsigned int                 readConnectionLimit = 0;
+static fuppes::Mutex                readMutex;
+static fuppes::Condition            readCondition(&readMutex);
+
+bool CDatabase::connect(const CConnectionParams params, unsigned int readConnections /*= 0*/) // static
 {
+  // every connection to an in-memory database would see a different database
+  readConnectionLimit = readConnections;
+  if(params.type == "sqlite3" && (params.filename.empty() || params.filename == ":memory:"))
+    readConnectionLimit = 0;
+
 	if(!m_connection) {
 	  CDatabasePlugin* plugin = CPluginMgr::databasePlugin(params.type);
 	  if(!plugin) {
@@ -198,6 +426,14 @@ bool CDatabase::setup() // static
 
 void CDatabase::close() // static
 {
+  readMutex.lock();
+  for(size_t i = 0; i < readConnections.size(); i++) {
+    delete readConnections[i].connection;
+  }
+  readConnections.clear();
+  readConnectionLimit = 0;
+  readMutex.unlock();
+
 	if(!m_connection) {
 		return;
 	}
@@ -241,3 +477,76 @@ CDatabaseConnection* CDatabase::connection(bool create /*= false*/) // static
 	
 	return result;
 }
+
+CDatabaseConnection* CDatabase::acquireReadConnection() // static
+{
+  MutexLocker locker(&readMutex);
+
+  if(readConnectionLimit == 0 || !m_connection)
+    return NULL;
+
+  ThreadId self = currentThread();
+  unsigned int deadline = fuppesTicks() + READ_CONNECTION_TIMEOUT;
+
+  while(true) {
+
+    // the calling thread already holds a connection
+    for(size_t i = 0; i < readConnections.size(); i++) {
+      if(readConnections[i].refs > 0 && sameThread(readConnections[i].owner, self)) {
+        readConnections[i].refs++;
+        return readConnections[i].connection;
+      }
+    }
+
+    // an idle connection
+    for(size_t i = 0; i < readConnections.size(); i++) {
+      if(readConnections[i].refs == 0) {
+        readConnections[i].owner = self;
+        readConnections[i].refs = 1;
+        return readConnections[i].connection;
+      }
+    }
+
+    // open a new one
+    if(readConnections.size() < readConnectionLimit) {
+      CDatabasePlugin* plugin = CPluginMgr::databasePlugin(m_connectionParams.type);
+      if(!plugin)
+        return NULL;
+
+      CConnectionParams params = m_connectionParams;
+      params.readonly = true;
+      ReadConnection read;
+      read.connection = plugin->createConnection();
+      if(!read.connection->connect(params)) {
+        delete read.connection;
+        // don't try again for every query
+        readConnectionLimit = readConnections.size();
+        Log::error(Log::contentdb, Log::normal, __FILE__, __LINE__, "failed to open a read only database connection. using %d", readConnectionLimit);
+        return NULL;
+      }
+      read.owner = self;
+      read.refs = 1;
+      readConnections.push_back(read);
+      return read.connection;
+    }
+
+    // all connections are busy
+    unsigned int now = fuppesTicks();
+    if(now >= deadline)
+      return NULL;
+    readCondition.wait(deadline - now);
+  }
+}
+
+void CDatabase::releaseReadConnection(CDatabaseConnection* connection) // static
+{
+  MutexLocker locker(&readMutex);
+
+  for(size_t i = 0; i < readConnections.size(); i++) {
+    if(readConnections[i].connection != connection)
+      continue;
+    if(readConnections[i].refs > 0 && --readConnections[i].refs == 0)
+      readCondition.signal();
+    return;
+  }
+}
@@ -35,10 +35,28 @@
 
 typedef ISQLQuery CSQLQuery;
 
+/**
+ * execution statistics of a query type
+ */
+struct SQLQueryStats
+{
+  unsigned int        count;
+  unsigned long long  time;     // total time in microseconds
+  unsigned int        maxTime;  // microseconds
+};
+
 class SQLQuery
 {
 	public:
+    enum Access {
+      ReadWrite,
+      // uses a connection from the read pool (see CDatabase).
+      // the query must not modify the database
+      ReadOnly
+    };
+
 		SQLQuery(CDatabaseConnection* connection = NULL);
+    explicit SQLQuery(Access access);
 		~SQLQuery();
 
     std::string build(fuppes_sql_no queryNo, std::string objectId, std::string device = "");
@@ -48,10 +66,27 @@ class SQLQuery
     bool exec(const std::string sql = "");
 		fuppes_off_t insert(const std::string sql = "");
 
-    void prepare(const std::string sql);
-    void bind(const std::string field, const std::string value);
+    // prepared statements. see ISQLQuery
+    bool prepare(const std::string sql, fuppes_sql_no queryNo = SQL_UNKNOWN);
+    void bind(int index, const std::string value);
+    void bind(int index, fuppes_off_t value);
+    bool execute();
+
+    /**
+     * prepares one of the plugin's statements.
+     * the object id is bound as ?1 and the device as ?2.
+     * "append" is added to the statement (e.g. order and limit clauses)
+     * and may use parameters starting with ?3.
+     */
+    bool prepare(fuppes_sql_no queryNo, fuppes_off_t objectId, std::string device = "", std::string append = "");
+    // prepare() and execute(). the rows are fetched step by step
+    bool execute(fuppes_sql_no queryNo, fuppes_off_t objectId, std::string device = "", std::string append = "");
 
     static std::string escape(std::string value);
+
+    // per query type statistics
+    static SQLQueryStats  stats(fuppes_sql_no queryNo);
+    static const char*    queryName(fuppes_sql_no queryNo);
     
     bool eof();
 		void next();
@@ -64,16 +99,38 @@ class SQLQuery
    unsigned int size();
     
 	private:
-		ISQLQuery*	m_query;
+    // accounts the time spent in the current query
+    void finish();
+
+		ISQLQuery*	        m_query;
+    // the pooled connection of a read only query
+    CDatabaseConnection* m_readConnection;
+    fuppes_sql_no       m_queryNo;
+    bool                m_timing;
+    unsigned long long  m_time;
 };
 
+/**
+ * the database connections.
+ *
+ * all writes and most of the reads go through a single connection.
+ * read only queries from the browse and search requests use a pool of
+ * additional read only connections so they do not queue up behind the
+ * scanner's transactions. sqlite databases are switched to WAL mode
+ * which lets readers proceed while a write transaction is open.
+ *
+ * write transactions (startTransaction()) take the write lock when they
+ * start. so a transaction that reads before it writes can't fail because
+ * another connection committed in between.
+ */
 class CDatabase
 {
 	public:
     /**
      * establish database connection
+     * @param readConnections  max. size of the read pool. 0 = no pool
      */
-		static bool connect(const CConnectionParams params);
+		static bool connect(const CConnectionParams params, unsigned int readConnections = 0);
     /**
      * 
      */
@@ -87,6 +144,14 @@ class CDatabase
 		static CDatabaseConnection* connection(bool create = false);
 
     static CConnectionParams connectionParams();
+
+    /**
+     * takes a connection from the read pool. a thread that already holds
+     * a read connection gets the same one again so nested queries never
+     * wait for the pool. returns NULL if there is no pool or it is exhausted
+     */
+    static CDatabaseConnection* acquireReadConnection();
+    static void releaseReadConnection(CDatabaseConnection* connection);
     
 	private:
 		static CDatabaseConnection* m_connection;
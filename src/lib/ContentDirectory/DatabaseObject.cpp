@@ -32,6 +32,13 @@ using namespace fuppes;
 #include <iostream>
 using namespace std;
 
+// one entry of a TREE_PATH
+static std::string treePathEntry(object_id_t objectId)
+{
+  std::stringstream result;
+  result << objectId << "/";
+  return result.str();
+}
 
 DbObject* DbObject::createFromObjectId(object_id_t objectId, SQLQuery* qry /*= NULL*/, std::string layout /*= ""*/) // static
 {
@@ -131,9 +138,13 @@ DbObject::DbObject(DbObject* object)
 
   m_lastModified = object->m_lastModified;
   m_lastUpdated = object->m_lastUpdated;
+  m_fileSize  = object->m_fileSize;
+  m_fileModified = object->m_fileModified;
+  m_fileInode = object->m_fileInode;
   
   m_details   = object->m_details;
   m_changed   = false;
+  m_parentChanged = false;
   m_pathChanged = false;
   m_lastModifiedChanged = false;
 }
@@ -160,8 +171,13 @@ DbObject::DbObject(CSQLResult* result)
 
   m_lastModified = result->asInt("MODIFIED_AT");
   m_lastUpdated = result->asInt("UPDATED_AT");
+  m_treePath  = result->asString("TREE_PATH");
+  m_fileSize  = strToOffT(result->asString("FILE_SIZE"));
+  m_fileModified = result->asInt("FILE_MTIME");
+  m_fileInode = strToOffT(result->asString("FILE_INODE"));
   
   m_changed   = false;
+  m_parentChanged = false;
   m_pathChanged = false;
   m_lastModifiedChanged = false;
 
@@ -182,8 +198,13 @@ void DbObject::reset()
   m_vrefId    = 0;
   m_lastModified = 0;
   m_lastUpdated = 0;
+  m_treePath  = "";
+  m_fileSize  = 0;
+  m_fileModified = 0;
+  m_fileInode = 0;
   
   m_changed   = false;
+  m_parentChanged = false;
   m_pathChanged = false;
   m_lastModifiedChanged = false;
   
@@ -233,7 +254,19 @@ bool DbObject::save(SQLQuery* qry /*= NULL*/, bool createReference /*= false*/)
       "DEVICE = " << (m_device.empty() ? "NULL" : "'" + SQLEscape(m_device) + "'") << ", " <<
       "VCONTAINER_TYPE = " << m_vcType << ", " <<
       "VCONTAINER_PATH = " << (m_vcPath.empty() ? "NULL" : "'" + SQLEscape(m_vcPath) + "'") << ", " <<
-      "VREF_ID = " << m_vrefId << ", ";
+      "VREF_ID = " << m_vrefId << ", " <<
+      "FILE_SIZE = " << m_fileSize << ", " <<
+      "FILE_MTIME = " << m_fileModified << ", " <<
+      "FILE_INODE = " << m_fileInode << ", ";
+
+      // the object got a new parent. we have to rebuild the tree path
+      std::string oldPrefix;
+      if(m_parentChanged) {
+        if(!m_treePath.empty())
+          oldPrefix = m_treePath + treePathEntry(m_objectId);
+        m_treePath = subtreePrefix(m_parentId, m_device, qry);
+      }
+      sql << "TREE_PATH = " << (m_treePath.empty() ? "NULL" : "'" + SQLEscape(m_treePath) + "'") << ", ";
 
       // we either update the last updated timestamp ...
       if(!m_lastModifiedChanged) {
@@ -265,6 +298,21 @@ bool DbObject::save(SQLQuery* qry /*= NULL*/, bool createReference /*= false*/)
       
       m_pathChanged = false;
     }
+
+    // ... and the tree path of all descendants
+    if(m_parentChanged && (m_type > OBJECT_TYPE_UNKNOWN && m_type < CONTAINER_MAX) && !oldPrefix.empty() && !m_treePath.empty()) {
+      std::string newPrefix = m_treePath + treePathEntry(m_objectId);
+      sql.str("");
+
+      sql << "update OBJECTS set "
+        "TREE_PATH = replace(TREE_PATH, '" << oldPrefix << "', '" << newPrefix << "') "
+        "where "
+        "TREE_PATH >= '" << oldPrefix << "' and TREE_PATH < '" << subtreeEnd(oldPrefix) << "' and "
+        "DEVICE " << (m_device.empty() ? "is NULL" : ("= '" + SQLEscape(m_device) + "'"));
+
+      ret = qry->exec(sql.str());
+    }
+    m_parentChanged = false;
     
   }
   else { // INSERT
@@ -286,6 +334,9 @@ bool DbObject::save(SQLQuery* qry /*= NULL*/, bool createReference /*= false*/)
       }
       sql.str("");
     }
+
+    m_treePath = subtreePrefix(m_parentId, m_device, qry);
+    m_parentChanged = false;
     
     sql << "insert into OBJECTS ( " <<
       "OBJECT_ID, "
@@ -302,7 +353,11 @@ bool DbObject::save(SQLQuery* qry /*= NULL*/, bool createReference /*= false*/)
       "VCONTAINER_PATH, "
       "VREF_ID, "
       "VISIBLE, "
-      "MODIFIED_AT"
+      "MODIFIED_AT, "
+      "TREE_PATH, "
+      "FILE_SIZE, "
+      "FILE_MTIME, "
+      "FILE_INODE"
       ") values ( " <<
       m_objectId << ", " << 
       m_parentId << ", " << 
@@ -317,7 +372,11 @@ bool DbObject::save(SQLQuery* qry /*= NULL*/, bool createReference /*= false*/)
       m_vcType << ", " << 
       (m_vcPath.empty() ? "NULL" : "'" + SQLEscape(m_vcPath) + "'") << ", " <<
       m_vrefId << ", " << (m_visible ? 1 : 0) << ", " <<
-      DateTime::now().toInt() <<
+      DateTime::now().toInt() << ", " <<
+      (m_treePath.empty() ? "NULL" : "'" + SQLEscape(m_treePath) + "'") << ", " <<
+      m_fileSize << ", " <<
+      m_fileModified << ", " <<
+      m_fileInode <<
     ")";
 
 
@@ -335,11 +394,15 @@ bool DbObject::save(SQLQuery* qry /*= NULL*/, bool createReference /*= false*/)
 }
 
 
-bool DbObject::remove()
+bool DbObject::remove(SQLQuery* qry /*= NULL*/)
 {
-  SQLQuery qry;
   std::stringstream sql;
 
+  bool tmpQry = (qry == NULL);
+  if(tmpQry) {
+    qry = new SQLQuery();
+  }
+
 
   // container
   if(m_type > OBJECT_TYPE_UNKNOWN && m_type < CONTAINER_MAX) {
@@ -351,12 +414,12 @@ bool DbObject::remove()
       sql.str("");
       sql << "delete from OBJECT_DETAILS where ID in (" <<
         "select DETAIL_ID from OBJECTS where PATH like '" << SQLEscape(m_path) << "%')";
-      qry.exec(sql.str());
+      qry->exec(sql.str());
 
       // delete objects
       sql.str("");
       sql << "delete from OBJECTS where PATH like '" << SQLEscape(m_path) << "%'";
-      qry.exec(sql.str());
+      qry->exec(sql.str());
       
     }
     else {
@@ -372,19 +435,58 @@ bool DbObject::remove()
  
       sql.str("");
       sql << "delete from OBJECT_DETAILS where ID = " << m_detailId;
-      qry.exec(sql.str());
+      qry->exec(sql.str());
     }
       
     // delete object
     sql.str("");
     sql << "delete from OBJECTS where ID = " << m_id;
-    qry.exec(sql.str());   
+    qry->exec(sql.str());   
   }
     
+  if(tmpQry)
+    delete qry;
+
   return true;
 }
 
 
+std::string DbObject::subtreePrefix(object_id_t objectId, std::string device /*= ""*/, SQLQuery* qry /*= NULL*/) // static
+{
+  if(objectId == 0)
+    return "/";
+
+  // use a separate query on the same connection so we don't
+  // touch a result the caller may still be reading
+  SQLQuery lookup(qry ? qry->connection() : NULL);
+  if(device.empty()) {
+    lookup.prepare("select TREE_PATH from OBJECTS where OBJECT_ID = ?1 and DEVICE is NULL");
+  }
+  else {
+    lookup.prepare("select TREE_PATH from OBJECTS where OBJECT_ID = ?1 and DEVICE = ?2");
+    lookup.bind(2, device);
+  }
+  lookup.bind(1, (fuppes_off_t)objectId);
+  lookup.execute();
+
+  std::string result;
+  if(!lookup.eof() && !lookup.result()->isNull("TREE_PATH")) {
+    result = lookup.result()->asString("TREE_PATH") + treePathEntry(objectId);
+  }
+  lookup.clear();
+  return result;
+}
+
+std::string DbObject::subtreeEnd(std::string prefix) // static
+{
+  // tree paths only contain digits and slashes and '0' follows '/'
+  if(prefix.empty())
+    return prefix;
+  prefix[prefix.length() - 1] = '0';
+  return prefix;
+}
+
+
 std::string DbObject::toString(DbObject* object, bool details /*= false*/) // static
 {
   stringstream result;
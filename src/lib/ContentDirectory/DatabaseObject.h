@@ -421,6 +421,12 @@ DEVICE          :: the name of the virtual folder layout
 VCONTAINER_TYPE :: the type of the virtual container (e.g. genre, album, artist)
 VCONTAINER_PATH :: the full virtual path this object is part of ( e.g. folder | genre | artist)
 VREF_ID         :: id of the referenced "original" object (the file with DEVICE == NULL and REF_ID == NULL)
+UPDATE_ID       :: the container update id
+TREE_PATH       :: the object ids of all ancestors (e.g. /12/345/). 
+                   all descendants of a container have TREE_PATH + OBJECT_ID + "/" as prefix
+FILE_SIZE       :: the file size at the last scan
+FILE_MTIME      :: the file's (or directory's) modification time at the last scan
+FILE_INODE      :: the file's inode at the last scan
  
 */
 
@@ -461,8 +467,13 @@ class DbObject
       m_vrefId                  = object.m_vrefId;
       m_lastModified            = object.m_lastModified;
       m_lastUpdated             = object.m_lastUpdated;
+      m_treePath                = object.m_treePath;
+      m_fileSize                = object.m_fileSize;
+      m_fileModified            = object.m_fileModified;
+      m_fileInode               = object.m_fileInode;
           
       m_changed                 = object.m_changed;
+      m_parentChanged           = object.m_parentChanged;
       m_pathChanged             = object.m_pathChanged;
       m_oldPath                 = object.m_oldPath;
       m_lastModifiedChanged     = object.m_lastModifiedChanged;
@@ -484,9 +495,13 @@ class DbObject
     std::string             device() { return m_device; }
     VirtualContainerType    vcType() { return m_vcType; }
     std::string             vcPath() { return m_vcPath; }
+    std::string             treePath() { return m_treePath; }
     bool                    visible() { return m_visible; }
     time_t                  lastModified() { return m_lastModified; }
     time_t                  lastUpdated() { return m_lastUpdated; }
+    fuppes_off_t            fileSize() { return m_fileSize; }
+    time_t                  fileModified() { return m_fileModified; }
+    fuppes_off_t            fileInode() { return m_fileInode; }
 
     // set the object id. if not set an object id will be set when saving
     void  setObjectId(object_id_t objectId) { 
@@ -499,6 +514,7 @@ class DbObject
       if(m_parentId != parentId) {
         m_parentId = parentId; 
         m_changed = true; 
+        m_parentChanged = true;
       }
     }
     void  setDetailId(object_id_t detailId) { 
@@ -588,6 +604,16 @@ class DbObject
       m_changed = true;
     }
 
+    // the file's state at the last scan. containers only use the modification time
+    void setFingerprint(fuppes_off_t size, time_t modified, fuppes_off_t inode) {
+      if(m_fileSize != size || m_fileModified != modified || m_fileInode != inode) {
+        m_fileSize = size;
+        m_fileModified = modified;
+        m_fileInode = inode;
+        m_changed = true;
+      }
+    }
+
 
     ObjectDetails*  details() {
 
@@ -613,9 +639,18 @@ class DbObject
      */
     bool save(SQLQuery* qry = NULL, bool createReference = false);
 
-    bool remove();
+    // if qry is NULL remove will use it's own query instance
+    bool remove(SQLQuery* qry = NULL);
 
     static std::string toString(DbObject* object, bool details = false);
+
+    /**
+     * the TREE_PATH prefix of all descendants of a container.
+     * returns "/" for the root and an empty string if the container does not exist
+     */
+    static std::string subtreePrefix(object_id_t objectId, std::string device = "", SQLQuery* qry = NULL);
+    // the first TREE_PATH that is no longer part of the subtree
+    static std::string subtreeEnd(std::string prefix);
     
   private:
     unsigned int            m_id;
@@ -635,8 +670,13 @@ class DbObject
     object_id_t             m_vrefId;
     time_t                  m_lastModified;
     time_t                  m_lastUpdated;
+    std::string             m_treePath;
+    fuppes_off_t            m_fileSize;
+    time_t                  m_fileModified;
+    fuppes_off_t            m_fileInode;
     
     bool                    m_changed;
+    bool                    m_parentChanged;
     bool                    m_pathChanged;
     std::string             m_oldPath;
     bool                    m_lastModifiedChanged;
@@ -0,0 +1,378 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            DirectoryWalker.cpp
+ *
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "DirectoryWalker.h"
+#include "FileDetails.h"
+#include "../SharedConfig.h"
+#include "../SharedLog.h"
+#include "../Common/Common.h"
+#include "../Common/Directory.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#endif
+
+using namespace fuppes;
+
+// max. number of read directories waiting for the consumer
+#define MAX_SCANNED_DIRECTORIES 256
+
+DirectoryReader::DirectoryReader(DirectoryWalker* walker, unsigned int index) :
+  Thread("DirectoryReader")
+{
+  m_walker = walker;
+  m_index = index;
+}
+
+DirectoryReader::~DirectoryReader()
+{
+  close();
+
+  std::deque<ScannedDirectory*>::iterator iter;
+  for(iter = m_queue.begin(); iter != m_queue.end(); iter++) {
+    delete *iter;
+  }
+}
+
+void DirectoryReader::run()
+{
+  ScannedDirectory* dir;
+  ScannedDirectory* child;
+  std::vector<ScannedDirectory*> children;
+
+  while(!stopRequested()) {
+
+    dir = m_walker->take(m_index);
+    if(dir == NULL)
+      break;
+
+    read(dir);
+
+    // the children are created before the directory is passed
+    // to the consumer which may delete it
+    children.clear();
+    for(size_t i = 0; i < dir->directories.size(); i++) {
+      child = new ScannedDirectory();
+      child->path = dir->path + dir->directories[i] + upnpPathDelim;
+      child->parent = dir->path;
+      child->name = dir->directories[i];
+      children.push_back(child);
+    }
+
+    // the directory must reach the consumer before its children are read
+    m_walker->finish(dir, children.size());
+
+    // pushed in reverse order so they are read in readdir order
+    for(size_t i = children.size(); i > 0; i--) {
+      m_walker->push(m_index, children[i - 1]);
+    }
+  }
+}
+
+void DirectoryReader::read(ScannedDirectory* dir)
+{
+  std::string name;
+  bool isDir;
+  bool isFile;
+  bool stated;
+  struct stat info;
+
+  // unchanged directories have the same entries as in the last scan
+  if(stat(dir->path.c_str(), &info) == 0)
+    dir->modified = info.st_mtime;
+  if(m_walker->m_known && dir->modified != 0) {
+    KnownDirectoryMap::const_iterator known = m_walker->m_known->find(dir->path);
+    if(known != m_walker->m_known->end() && known->second.modified == dir->modified) {
+      dir->unchanged = true;
+      dir->directories = known->second.directories;
+      return;
+    }
+  }
+
+#ifndef WIN32
+  DIR* handle = opendir(dir->path.c_str());
+  if(handle == NULL) {
+    CSharedLog::Log(L_EXT, __FILE__, __LINE__, "unable to read directory: %s", dir->path.c_str());
+    return;
+  }
+
+  CSharedLog::Log(L_EXT, __FILE__, __LINE__, "read directory: %s", dir->path.c_str());
+
+  int fd = dirfd(handle);
+  dirent* entry;
+  while((entry = readdir(handle)) != NULL) {
+
+    name = entry->d_name;
+    if(name.compare(".") == 0 || name.compare("..") == 0)
+      continue;
+
+    // the type is provided by most filesystems. symlinks and
+    // unknown types need a stat call relative to the directory
+    isDir = false;
+    isFile = false;
+    stated = false;
+    #ifdef _DIRENT_HAVE_D_TYPE
+    if(entry->d_type == DT_DIR)
+      isDir = true;
+    else if(entry->d_type == DT_REG)
+      isFile = true;
+    else if(entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN)
+    #endif
+    {
+      if(fstatat(fd, entry->d_name, &info, 0) == 0) {
+        isDir = S_ISDIR(info.st_mode);
+        isFile = S_ISREG(info.st_mode);
+        stated = true;
+      }
+    }
+#else
+  Directory directory(dir->path);
+  if(!directory.open())
+    return;
+  DirEntryList entries = directory.dirEntryList(DirEntry::Directory | DirEntry::File);
+  directory.close();
+
+  for(size_t i = 0; i < entries.size(); i++) {
+    name = entries[i].name();
+    isDir = (entries[i].type() == DirEntry::Directory);
+    isFile = (entries[i].type() == DirEntry::File);
+    stated = false;
+#endif
+
+    if(isDir) {
+      if(name[0] != '.')
+        dir->directories.push_back(name);
+      continue;
+    }
+    if(!isFile)
+      continue;
+
+    if(dir->albumArt.empty() && CSharedConfig::isAlbumArtFile(name))
+      dir->albumArt = name;
+    if(!CFileDetails::Shared()->IsSupportedFileExtension(ExtractFileExt(name)))
+      continue;
+
+    // the fingerprint is only needed for supported files
+#ifndef WIN32
+    if(!stated && fstatat(fd, name.c_str(), &info, 0) != 0)
+      continue;
+#else
+    if(stat((dir->path + name).c_str(), &info) != 0)
+      continue;
+#endif
+
+    ScannedFile file;
+    file.name = name;
+    file.size = info.st_size;
+    file.modified = info.st_mtime;
+    file.inode = info.st_ino;
+    dir->files.push_back(file);
+  }
+
+#ifndef WIN32
+  closedir(handle);
+#endif
+}
+
+
+
+DirectoryWalker::DirectoryWalker(unsigned int readers)
+{
+  if(readers == 0)
+    readers = 1;
+
+  m_workCondition = new Condition(&m_mutex);
+  m_resultCondition = new Condition(&m_mutex);
+  m_spaceCondition = new Condition(&m_mutex);
+  m_known = NULL;
+  m_pending = 0;
+  m_stop = false;
+  m_directoryCount = 0;
+  m_fileCount = 0;
+
+  for(unsigned int i = 0; i < readers; i++) {
+    m_readers.push_back(new DirectoryReader(this, i));
+  }
+}
+
+DirectoryWalker::~DirectoryWalker()
+{
+  stop();
+
+  for(size_t i = 0; i < m_readers.size(); i++) {
+    delete m_readers[i];
+  }
+
+  std::list<ScannedDirectory*>::iterator iter;
+  for(iter = m_roots.begin(); iter != m_roots.end(); iter++) {
+    delete *iter;
+  }
+  for(iter = m_results.begin(); iter != m_results.end(); iter++) {
+    delete *iter;
+  }
+
+  delete m_workCondition;
+  delete m_resultCondition;
+  delete m_spaceCondition;
+}
+
+void DirectoryWalker::add(std::string path)
+{
+  ScannedDirectory* dir = new ScannedDirectory();
+  dir->path = Directory::appendTrailingSlash(path);
+  dir->root = true;
+  m_roots.push_back(dir);
+}
+
+void DirectoryWalker::start()
+{
+  // the roots are distributed over the readers
+  m_pending = m_roots.size();
+  unsigned int reader = 0;
+  while(!m_roots.empty()) {
+    push(reader, m_roots.front());
+    m_roots.pop_front();
+    reader = (reader + 1) % m_readers.size();
+  }
+
+  for(size_t i = 0; i < m_readers.size(); i++) {
+    m_readers[i]->start();
+  }
+}
+
+void DirectoryWalker::stop()
+{
+  m_mutex.lock();
+  m_stop = true;
+  m_workCondition->broadcast();
+  m_spaceCondition->broadcast();
+  m_resultCondition->broadcast();
+  m_mutex.unlock();
+
+  for(size_t i = 0; i < m_readers.size(); i++) {
+    m_readers[i]->stop();
+  }
+  for(size_t i = 0; i < m_readers.size(); i++) {
+    m_readers[i]->close();
+  }
+}
+
+ScannedDirectory* DirectoryWalker::next()
+{
+  MutexLocker locker(&m_mutex);
+
+  while(m_results.empty()) {
+    if(m_stop || m_pending == 0)
+      return NULL;
+    m_resultCondition->wait(100);
+  }
+
+  ScannedDirectory* result = m_results.front();
+  m_results.pop_front();
+  m_spaceCondition->signal();
+  return result;
+}
+
+void DirectoryWalker::push(unsigned int reader, ScannedDirectory* dir)
+{
+  m_readers[reader]->m_mutex.lock();
+  m_readers[reader]->m_queue.push_back(dir);
+  m_readers[reader]->m_mutex.unlock();
+
+  MutexLocker locker(&m_mutex);
+  m_workCondition->signal();
+}
+
+ScannedDirectory* DirectoryWalker::take(unsigned int reader)
+{
+  ScannedDirectory* result;
+  DirectoryReader* victim;
+
+  while(true) {
+
+    // our own queue
+    victim = m_readers[reader];
+    victim->m_mutex.lock();
+    if(!victim->m_queue.empty()) {
+      result = victim->m_queue.back();
+      victim->m_queue.pop_back();
+      victim->m_mutex.unlock();
+      return result;
+    }
+    victim->m_mutex.unlock();
+
+    // steal from the others
+    for(size_t i = 1; i < m_readers.size(); i++) {
+      victim = m_readers[(reader + i) % m_readers.size()];
+      victim->m_mutex.lock();
+      if(!victim->m_queue.empty()) {
+        result = victim->m_queue.front();
+        victim->m_queue.pop_front();
+        victim->m_mutex.unlock();
+        return result;
+      }
+      victim->m_mutex.unlock();
+    }
+
+    // nothing to do. wait until another reader pushes new directories
+    // or the walk is complete
+    MutexLocker locker(&m_mutex);
+    if(m_stop || m_pending == 0)
+      return NULL;
+    m_workCondition->wait(10);
+  }
+}
+
+void DirectoryWalker::finish(ScannedDirectory* result, unsigned int subdirectories)
+{
+  MutexLocker locker(&m_mutex);
+
+  while(!m_stop && m_results.size() >= MAX_SCANNED_DIRECTORIES) {
+    m_spaceCondition->wait(100);
+  }
+  if(m_stop) {
+    delete result;
+    return;
+  }
+
+  m_directoryCount++;
+  m_fileCount += result->files.size();
+  m_results.push_back(result);
+
+  // the subdirectories are counted before they are pushed
+  // so m_pending never drops to zero while there is work left
+  m_pending += subdirectories;
+  m_pending--;
+  if(m_pending == 0) {
+    m_workCondition->broadcast();
+    m_resultCondition->broadcast();
+  }
+  else {
+    m_resultCondition->signal();
+  }
+}
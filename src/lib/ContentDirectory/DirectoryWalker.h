@@ -0,0 +1,195 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            DirectoryWalker.h
+ *
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _DIRECTORYWALKER_H
+#define _DIRECTORYWALKER_H
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#include "../Common/Thread.h"
+#include "../../../include/fuppes_types.h"
+
+#include <string>
+#include <deque>
+#include <list>
+#include <map>
+#include <vector>
+#include <time.h>
+
+namespace fuppes {
+
+class DirectoryWalker;
+
+/**
+ * a file's state. used to detect changes between two scans
+ */
+struct ScannedFile
+{
+  ScannedFile() {
+    size = 0;
+    modified = 0;
+    inode = 0;
+  }
+
+  std::string   name;
+  fuppes_off_t  size;
+  time_t        modified;
+  fuppes_off_t  inode;
+};
+
+/**
+ * a directory from a previous scan
+ */
+struct KnownDirectory
+{
+  KnownDirectory() {
+    modified = 0;
+  }
+
+  // the modification time at the last scan. 0 = unknown
+  time_t                    modified;
+  // the names of the subdirectories
+  std::vector<std::string>  directories;
+};
+
+// path (with trailing slash) -> directory
+typedef std::map<std::string, KnownDirectory> KnownDirectoryMap;
+
+/**
+ * the content of a directory as read by a DirectoryReader
+ */
+struct ScannedDirectory
+{
+  ScannedDirectory() {
+    root = false;
+    modified = 0;
+    unchanged = false;
+  }
+
+  // with trailing slash
+  std::string               path;
+  // the parent's path. empty for a root directory
+  std::string               parent;
+  // the directory's name
+  std::string               name;
+  bool                      root;
+
+  // the directory's modification time
+  time_t                    modified;
+  // the directory has not been modified since the last scan.
+  // the subdirectories are taken from the KnownDirectory, files are not read
+  bool                      unchanged;
+
+  // the names of the (non hidden) subdirectories
+  std::vector<std::string>  directories;
+  // the files with a supported extension
+  std::vector<ScannedFile>  files;
+  // the name of the first album art file. empty if there is none
+  std::string               albumArt;
+};
+
+/**
+ * reads directories from its own queue and steals from the
+ * other readers' queues if its own queue is empty
+ */
+class DirectoryReader: public Thread
+{
+  friend class DirectoryWalker;
+
+  public:
+    DirectoryReader(DirectoryWalker* walker, unsigned int index);
+    ~DirectoryReader();
+
+  private:
+    void run();
+    void read(ScannedDirectory* dir);
+
+    DirectoryWalker*        m_walker;
+    unsigned int            m_index;
+
+    // the directories waiting to be read. the owner works on the back,
+    // thieves take from the front (the directories closer to the root)
+    Mutex                   m_mutex;
+    std::deque<ScannedDirectory*> m_queue;
+};
+
+/**
+ * walks a set of directory trees with a number of DirectoryReader
+ * threads and passes the directories to a single consumer.
+ *
+ * a directory is always passed to the consumer after its parent
+ */
+class DirectoryWalker
+{
+  friend class DirectoryReader;
+
+  public:
+    DirectoryWalker(unsigned int readers);
+    ~DirectoryWalker();
+
+    // adds a root directory. must be called before start()
+    void add(std::string path);
+    // directories whose modification time matches are not read again.
+    // the map must not change until the walk is complete
+    void setKnownDirectories(const KnownDirectoryMap* known) { m_known = known; }
+    void start();
+    // stops the readers. next() returns NULL afterwards
+    void stop();
+
+    // waits for the next directory. the caller has to delete it.
+    // returns NULL if all directories have been read
+    ScannedDirectory* next();
+
+    unsigned int directoryCount() { return m_directoryCount; }
+    unsigned int fileCount() { return m_fileCount; }
+
+  private:
+    // reader side. the caller of push() has to count the directory in m_pending
+    void push(unsigned int reader, ScannedDirectory* dir);
+    ScannedDirectory* take(unsigned int reader);
+    void finish(ScannedDirectory* result, unsigned int subdirectories);
+
+    std::vector<DirectoryReader*>   m_readers;
+    std::list<ScannedDirectory*>    m_roots;
+    const KnownDirectoryMap*        m_known;
+
+    Mutex                           m_mutex;
+    Condition*                      m_workCondition;
+    Condition*                      m_resultCondition;
+    Condition*                      m_spaceCondition;
+    std::list<ScannedDirectory*>    m_results;
+    // directories queued or currently read
+    unsigned int                    m_pending;
+    bool                            m_stop;
+
+    unsigned int                    m_directoryCount;
+    unsigned int                    m_fileCount;
+};
+
+}
+
+#endif // _DIRECTORYWALKER_H
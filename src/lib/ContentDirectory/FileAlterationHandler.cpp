@@ -30,6 +30,7 @@
 #include "ContentDatabase.h"
 #include "FileDetails.h"
 #include "VirtualContainerMgr.h"
+#include "DatabaseConnection.h"
 using namespace fuppes;
 
 #include <iostream>
@@ -39,6 +40,16 @@ FileAlterationHandler::FileAlterationHandler()
 {
   m_fileAlterationMonitor = NULL;
   m_lastEventTime = DateTime::now();
+  m_connection = NULL;
+  m_batchQuery = NULL;
+  m_query = NULL;
+  m_transaction = false;
+}
+
+FileAlterationHandler::~FileAlterationHandler()
+{
+  delete m_batchQuery;
+  delete m_connection;
 }
 
 void FileAlterationHandler::setMonitor(CFileAlterationMonitor* fileAlterationMonitor)
@@ -47,13 +58,123 @@ void FileAlterationHandler::setMonitor(CFileAlterationMonitor* fileAlterationMon
 }
 
 void FileAlterationHandler::famEvent(CFileAlterationEvent* event)
+{
+  std::list<CFileAlterationEvent*> events;
+  events.push_back(event);
+  famEvents(&events);
+}
+
+void FileAlterationHandler::famEvents(std::list<CFileAlterationEvent*>* events)
 {
   fuppes::MutexLocker locker(&m_mutex);
 
-  if(event->type() != FAM_MODIFY) {  
-    m_lastEventTime = DateTime::now();
+  m_changedContainers.clear();
+  m_scanDirectories.clear();
+  m_parentIds.clear();
+
+  m_query = NULL;
+  m_transaction = false;
+  if(events->size() > 1) {
+    if(!m_connection) {
+      m_connection = CDatabase::connection(true);
+      if(m_connection)
+        m_batchQuery = new SQLQuery(m_connection);
+    }
+    if(m_connection) {
+      m_query = m_batchQuery;
+      m_transaction = m_connection->startTransaction();
+    }
+  }
+
+  std::list<CFileAlterationEvent*>::iterator iter;
+  for(iter = events->begin(); iter != events->end(); iter++) {
+    if((*iter)->type() != FAM_MODIFY) {  
+      m_lastEventTime = DateTime::now();
+    }
+    handleEvent(*iter);
+    m_uncommitted.push_back(*iter);
   }
-  
+
+  commitBatch();
+  m_transaction = false;
+  if(m_query)
+    m_query->clear();
+  m_query = NULL;
+
+  // a failed commit has rolled back its events. they are applied
+  // again one by one on the shared connection
+  if(!m_failed.empty()) {
+    Log::log(Log::fam, Log::normal, __FILE__, __LINE__, "batch commit failed. applying %d events again", (int)m_failed.size());
+    for(iter = m_failed.begin(); iter != m_failed.end(); iter++) {
+      handleEvent(*iter);
+    }
+    m_failed.clear();
+    m_scanDirectories.sort();
+    m_scanDirectories.unique();
+  }
+
+  // increment the changed containers' and the system update id.
+  // this uses the shared connection so the batch has to be committed first
+  std::set<object_id_t>::iterator container;
+  for(container = m_changedContainers.begin(); container != m_changedContainers.end(); container++) {
+    CContentDatabase::incContainerUpdateId(*container, false);
+  }
+  if(!m_changedContainers.empty())
+    CContentDatabase::incSystemUpdateId();
+
+  // the new directories are scanned after their objects are committed
+  std::list<std::string>::iterator path;
+  for(path = m_scanDirectories.begin(); path != m_scanDirectories.end(); path++) {
+    CContentDatabase::scanDirectory(*path);
+  }
+}
+
+void FileAlterationHandler::commitBatch()
+{
+  if(m_transaction && !m_connection->commit()) {
+    m_failed.splice(m_failed.end(), m_uncommitted);
+    // the cache may hold directories that have been rolled back
+    m_parentIds.clear();
+  }
+  m_uncommitted.clear();
+}
+
+void FileAlterationHandler::suspendBatch()
+{
+  // the event that is currently handled is part of the next batch
+  commitBatch();
+}
+
+void FileAlterationHandler::resumeBatch()
+{
+  if(m_transaction)
+    m_transaction = m_connection->startTransaction();
+}
+
+bool FileAlterationHandler::getParentId(std::string path, object_id_t* parentId)
+{
+  std::map<std::string, object_id_t>::iterator iter = m_parentIds.find(path);
+  if(iter != m_parentIds.end()) {
+    *parentId = iter->second;
+    return true;
+  }
+
+  DbObject* parent = DbObject::createFromFileName(path, m_query);
+  if(!parent)
+    return false;
+  *parentId = parent->objectId();
+  delete parent;
+
+  m_parentIds[path] = *parentId;
+  return true;
+}
+
+void FileAlterationHandler::handleEvent(CFileAlterationEvent* event)
+{
+  // directory events may change the paths of the cached parents
+  if(event->isDir())
+    m_parentIds.clear();
+
   //cout << CFileAlterationEvent::toString(event) << endl;
 
   // create
@@ -112,88 +233,99 @@ void FileAlterationHandler::famEvent(CFileAlterationEvent* event)
 void FileAlterationHandler::createDirectory(CFileAlterationEvent* event)
 {
   // get the parent
-  DbObject* parent = DbObject::createFromFileName(event->path());
-  if(!parent) {
+  object_id_t parentId;
+  if(!getParentId(event->path(), &parentId)) {
     cout << "fam error: directory: " << event->path() << " not found" << endl;
     return;
   }
 
   // insert the directory
   string path = Directory::appendTrailingSlash(event->path() + event->dir());
-  CContentDatabase::insertDirectory(path, event->dir(), parent->objectId(), NULL, true);
-  delete parent;
+  CContentDatabase::insertDirectory(path, event->dir(), parentId, m_query, true);
 
-  // scan the directory
-  CContentDatabase::scanDirectory(path);
+  // scan the directory after the batch
+  m_scanDirectories.push_back(path);
 
-  // increment systemUpdateId
-  CContentDatabase::incSystemUpdateId();
+  m_changedContainers.insert(parentId);
 }
 
 void FileAlterationHandler::deleteDirectory(CFileAlterationEvent* event)
 {  
   // get the object
   string path = Directory::appendTrailingSlash(event->path() + event->dir());
-  DbObject* dir = DbObject::createFromFileName(path);
+  DbObject* dir = DbObject::createFromFileName(path, m_query);
   if(!dir) {
     cout << "fam error: directory: " << path << " not found" << endl;
     return;
   }
 
   // remove all virtual files that are build from the directories content
+  suspendBatch();
   VirtualContainerMgr::deleteDirectory(dir);
+  resumeBatch();
 
   // remove the dir
-  dir->remove();
+  object_id_t parentId = dir->parentId();
+  dir->remove(m_query);
   delete dir;
 
-  // increment systemUpdateId
-  CContentDatabase::incSystemUpdateId();
+  m_changedContainers.insert(parentId);
 }
 
 void FileAlterationHandler::moveDirectory(CFileAlterationEvent* event)
 {
   // get the object from the old path
   string oldPath = Directory::appendTrailingSlash(event->oldPath() + event->oldDir()); 
-  DbObject* obj = DbObject::createFromFileName(oldPath);
+  DbObject* obj = DbObject::createFromFileName(oldPath, m_query);
   if(!obj) {
     cout << "fam error: directory: " << oldPath << " not found" << endl;
     return;
   }
 
   // get the new parent
-  DbObject* parent = DbObject::createFromFileName(event->path());
+  DbObject* parent = DbObject::createFromFileName(event->path(), m_query);
   if(!parent) {
     cout << "fam error: directory: " << event->path() << " not found" << endl;
     delete obj;
     return;
   }
   
+  object_id_t oldParentId = obj->parentId();
+  object_id_t newParentId = parent->objectId();
+
   string newPath = Directory::appendTrailingSlash(event->path() + event->dir());
   obj->setPath(newPath);
   obj->setTitle(event->dir());
   obj->setParentId(parent->objectId());
-  obj->save();
+  obj->save(m_query);
   
   delete obj;
   delete parent;
                                                
-  // increment systemUpdateId
-  CContentDatabase::incSystemUpdateId();
+  m_changedContainers.insert(oldParentId);
+  m_changedContainers.insert(newParentId);
 }
 
 
 
 void FileAlterationHandler::createFile(CFileAlterationEvent* event)
 {
-  CContentDatabase::insertFile(event->path() + event->file(), 0, NULL, true);
+  object_id_t parentId;
+  if(!getParentId(event->path(), &parentId)) {
+    cout << "fam error: dir: " << event->path() << " not found" << endl;
+    return;
+  }
+
+  if(CContentDatabase::insertFile(event->path() + event->file(), parentId, m_query, true) > 0) {
+    m_changedContainers.insert(parentId);
+  }
 
   // virtual folder structure is updated by UpdateThread after reading the files metadata
 }
 
 void FileAlterationHandler::deleteFile(CFileAlterationEvent* event)
 {
-  DbObject* file = DbObject::createFromFileName(event->path() + event->file());
+  DbObject* file = DbObject::createFromFileName(event->path() + event->file(), m_query);
   if(!file) {
     cout << "fam error: file: " << (event->path() + event->file()) << " not found" << endl;
     return;
@@ -207,10 +339,15 @@ void FileAlterationHandler::deleteFile(CFileAlterationEvent* event)
   
 
   // delete the file from the virtual folder structure
+  suspendBatch();
   VirtualContainerMgr::deleteFile(file);
+  resumeBatch();
   
-  file->remove();
+  object_id_t parentId = file->parentId();
+  file->remove(m_query);
   delete file;
+
+  m_changedContainers.insert(parentId);
 }
 
 void FileAlterationHandler::moveFile(CFileAlterationEvent* event)
@@ -226,14 +363,14 @@ void FileAlterationHandler::moveFile(CFileAlterationEvent* event)
   
   // get the object from the old path
   string oldPath = event->oldPath() + event->oldFile();
-  DbObject* file = DbObject::createFromFileName(oldPath);
+  DbObject* file = DbObject::createFromFileName(oldPath, m_query);
   if(!file) {
     cout << "fam error: file: " << oldPath << " not found" << endl;
     return;
   }
 
   // get the new parent
-  DbObject* parent = DbObject::createFromFileName(event->path());
+  DbObject* parent = DbObject::createFromFileName(event->path(), m_query);
   if(!parent) {
     cout << "fam error: dir: " << event->path() << " not found" << endl;
     delete file;
@@ -246,6 +383,8 @@ cout << "old parent id: " << file->parentId() << " new pid: " << parent->objectI
 
 // check for album art
   
+  object_id_t oldParentId = file->parentId();
+  object_id_t newParentId = parent->objectId();
   file->setParentId(parent->objectId());
   file->setPath(event->path());
   file->setFileName(event->file());
@@ -254,12 +393,12 @@ cout << "old parent id: " << file->parentId() << " new pid: " << parent->objectI
   if(file->title() == title) {
     file->setTitle(TruncateFileExt(event->file()));
   }
-  file->save();  
+  file->save(m_query);  
   delete file;
   delete parent;
 
-  // increment systemUpdateId
-  CContentDatabase::incSystemUpdateId();
+  m_changedContainers.insert(oldParentId);
+  m_changedContainers.insert(newParentId);
 }
 
 
@@ -267,7 +406,7 @@ cout << "old parent id: " << file->parentId() << " new pid: " << parent->objectI
 void FileAlterationHandler::modifyFile(CFileAlterationEvent* event)
 {
   // get the object
-  DbObject* file = DbObject::createFromFileName(event->path() + event->file());
+  DbObject* file = DbObject::createFromFileName(event->path() + event->file(), m_query);
   if(!file) {
     cout << "fam error: file: " << event->path() + event->file() << " not found" << endl;
     return;
@@ -285,7 +424,7 @@ void FileAlterationHandler::modifyFile(CFileAlterationEvent* event)
 
   if(modified > file->lastUpdated()) {
     file->setLastModified(modified);
-    file->save();
+    file->save(m_query);
   }
   delete file;
 
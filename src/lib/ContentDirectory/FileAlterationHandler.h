@@ -34,13 +34,24 @@
 #include "../Common/Thread.h"
 #include "FileAlterationMonitor.h"
 
+#include <list>
+#include <map>
+#include <set>
+
+class SQLQuery;
+class CDatabaseConnection;
+
 class FileAlterationHandler: public IFileAlterationMonitor
 {
   public:
     FileAlterationHandler();
+    ~FileAlterationHandler();
     void setMonitor(CFileAlterationMonitor* fileAlterationMonitor);
     
     void famEvent(CFileAlterationEvent* event);
+    // applies the events in one transaction. the update ids of the
+    // changed containers and the system update id are incremented once
+    void famEvents(std::list<CFileAlterationEvent*>* events);
 
     fuppes::DateTime    lastEventTime() { return m_lastEventTime; }
     
@@ -49,6 +60,34 @@ class FileAlterationHandler: public IFileAlterationMonitor
     CFileAlterationMonitor*   m_fileAlterationMonitor;
     fuppes::DateTime          m_lastEventTime;
 
+    // the current batch
+    std::set<object_id_t>               m_changedContainers;
+    std::list<std::string>              m_scanDirectories;
+    // directory path -> object id
+    std::map<std::string, object_id_t>  m_parentIds;
+
+    // a batch runs on its own connection so statements of other threads
+    // on the shared connection don't end up in its transaction.
+    // m_query is NULL for a single event (shared connection)
+    CDatabaseConnection*  m_connection;
+    SQLQuery*             m_batchQuery;
+    SQLQuery*             m_query;
+    bool                  m_transaction;
+    // the events since the last commit and the ones whose commit failed
+    std::list<CFileAlterationEvent*>  m_uncommitted;
+    std::list<CFileAlterationEvent*>  m_failed;
+
+    // the virtual folders are updated on the shared connection.
+    // so the batch is committed before and continued afterwards
+    // commits the batch. the events of a failed commit are moved to m_failed
+    void    commitBatch();
+    void    suspendBatch();
+    void    resumeBatch();
+
+    void    handleEvent(CFileAlterationEvent* event);
+    // looks up a directory's object id. cached until the next directory event
+    bool    getParentId(std::string path, object_id_t* parentId);
+
     void    createDirectory(CFileAlterationEvent* event);
     void    deleteDirectory(CFileAlterationEvent* event);
     void    moveDirectory(CFileAlterationEvent* event);
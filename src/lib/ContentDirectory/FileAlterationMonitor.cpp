@@ -31,8 +31,12 @@
 #endif
 
 #include "../SharedLog.h"
+#include "../SharedConfig.h"
 using namespace fuppes;
 
+// max. ms a file system event is held back during a burst of events
+#define FAM_MAX_DELAY 5000
+
 //#ifdef WIN32
 #include <iostream>
 using namespace std;
@@ -44,12 +48,315 @@ void CFileAlterationMonitor::famEvent(CFileAlterationEvent* event)
   if(m_pEventHandler == NULL)
     return;
   
-	Log::log(Log::fam, Log::debug, __FILE__, __LINE__, CFileAlterationEvent::toString(event));  
+	FUPPES_LOG(Log::fam, Log::debug, CFileAlterationEvent::toString(event));  
   //fuppesThreadLockMutex(&mutex);
 	m_pEventHandler->famEvent(event);
 	//fuppesThreadUnlockMutex(&mutex);
 }
 
+void CFileAlterationMonitor::famEvents(std::list<CFileAlterationEvent*>* events)
+{
+  if(m_pEventHandler == NULL)
+    return;
+
+  std::list<CFileAlterationEvent*>::iterator iter;
+  for(iter = events->begin(); iter != events->end(); iter++) {
+    FUPPES_LOG(Log::fam, Log::debug, CFileAlterationEvent::toString(*iter));
+  }
+  m_pEventHandler->famEvents(events);
+}
+
+
+static std::string famKey(bool isDir, std::string path, std::string file)
+{
+  std::string key = Directory::appendTrailingSlash(path) + file;
+  if(isDir)
+    key = Directory::appendTrailingSlash(key);
+  return key;
+}
+
+static bool isInside(std::string key, std::string dirKey)
+{
+  return (key.length() > dirKey.length() && key.compare(0, dirKey.length(), dirKey) == 0);
+}
+
+CFileAlterationQueue::~CFileAlterationQueue()
+{
+  std::list<Entry*>::iterator iter;
+  for(iter = m_events.begin(); iter != m_events.end(); iter++) {
+    delete *iter;
+  }
+}
+
+void CFileAlterationQueue::create(bool isDir, std::string path, std::string file, bool complete /*= true*/)
+{
+  std::string key = famKey(isDir, path, file);
+  if(isNew(key))
+    return;
+
+  // the file is still in the db. we just have to read it again
+  Entry* entry = find(key);
+  if(entry && entry->event.m_type == FAM_DELETE && !isDir) {
+    entry->event.m_type = FAM_MODIFY;
+    entry->complete = complete;
+    return;
+  }
+
+  append(FAM_CREATE, isDir, path, file, "", "", complete);
+}
+
+bool CFileAlterationQueue::written(std::string path, std::string file)
+{
+  std::string key = famKey(false, path, file);
+  if(isNew(key))
+    return true;
+
+  Entry* entry = find(key);
+  if(entry && (entry->event.m_type == FAM_CREATE || entry->event.m_type == FAM_MODIFY)) {
+    entry->complete = true;
+    return true;
+  }
+  return false;
+}
+
+void CFileAlterationQueue::modify(std::string path, std::string file)
+{
+  std::string key = famKey(false, path, file);
+  if(isNew(key))
+    return;
+
+  Entry* entry = find(key);
+  if(entry && (entry->event.m_type == FAM_CREATE || entry->event.m_type == FAM_MODIFY))
+    return;
+
+  append(FAM_MODIFY, false, path, file);
+}
+
+void CFileAlterationQueue::remove(bool isDir, std::string path, std::string file)
+{
+  std::string key = famKey(isDir, path, file);
+  if(isNew(key))
+    return;
+
+  std::list<Entry*>::iterator iter;
+  
+  // the pending creates and modifies inside a deleted directory are obsolete
+  if(isDir) {
+    std::list<Entry*> obsolete;
+    for(iter = m_events.begin(); iter != m_events.end(); iter++) {
+      if(((*iter)->event.m_type == FAM_CREATE || (*iter)->event.m_type == FAM_MODIFY) &&
+         isInside((*iter)->key, key)) {
+        obsolete.push_back(*iter);
+      }
+    }
+    for(iter = obsolete.begin(); iter != obsolete.end(); iter++) {
+      erase(*iter);
+    }
+  }
+
+  Entry* entry = find(key);
+  if(entry && entry->event.m_type == FAM_MODIFY) {
+    erase(entry);
+    entry = find(key);
+  }
+
+  if(entry && entry->event.m_type == FAM_DELETE)
+    return;
+
+  // the object never made it into the db
+  if(entry && entry->event.m_type == FAM_CREATE) {
+    erase(entry);
+    return;
+  }
+
+  // the object is deleted from where it was before the move
+  if(entry && entry->event.m_type == FAM_MOVE) {
+    unmap(entry);
+    entry->event.m_type = FAM_DELETE;
+    entry->event.m_path = entry->event.m_oldPath;
+    entry->event.m_file = entry->event.m_oldFile;
+    entry->event.m_oldPath = "";
+    entry->event.m_oldFile = "";
+    entry->key = famKey(isDir, entry->event.m_path, entry->event.m_file);
+    if(find(entry->key) == NULL)
+      m_keys[entry->key] = entry;
+    return;
+  }
+
+  append(FAM_DELETE, isDir, path, file);
+}
+
+void CFileAlterationQueue::move(bool isDir, std::string path, std::string file, std::string oldPath, std::string oldFile)
+{
+  std::string key = famKey(isDir, path, file);
+  std::string oldKey = famKey(isDir, oldPath, oldFile);
+
+  // the object is not in the db yet
+  if(isNew(oldKey)) {
+    create(isDir, path, file);
+    return;
+  }
+
+  // moved into a new directory which is scanned as a whole
+  if(isNew(key)) {
+    remove(isDir, oldPath, oldFile);
+    return;
+  }
+
+  Entry* entry = find(oldKey);
+  if(entry && entry->event.m_type == FAM_CREATE) {
+    bool complete = entry->complete;
+    erase(entry);
+    create(isDir, path, file, complete);
+    return;
+  }
+
+  if(entry && entry->event.m_type == FAM_MODIFY) {
+    erase(entry);
+    append(FAM_MOVE, isDir, path, file, oldPath, oldFile);
+    append(FAM_MODIFY, false, path, file);
+    return;
+  }
+
+  // a chain of moves. if there are other events for the
+  // new path the moves are applied one by one
+  if(entry && entry->event.m_type == FAM_MOVE && find(key) == NULL) {
+    if(famKey(isDir, entry->event.m_oldPath, entry->event.m_oldFile) == key) {
+      erase(entry);
+    }
+    else {
+      unmap(entry);
+      entry->event.m_path = path;
+      entry->event.m_file = file;
+      entry->key = key;
+      m_keys[key] = entry;
+    }
+  }
+  else {
+    append(FAM_MOVE, isDir, path, file, oldPath, oldFile);
+  }
+
+  if(isDir)
+    moveContent(oldKey, key);
+}
+
+void CFileAlterationQueue::take(std::list<CFileAlterationEvent*>* events)
+{
+  std::list<Entry*> incomplete;
+  std::list<Entry*>::iterator iter;
+  for(iter = m_events.begin(); iter != m_events.end(); iter++) {
+    if((*iter)->complete) {
+      events->push_back(new CFileAlterationEvent((*iter)->event));
+      delete *iter;
+    }
+    else {
+      incomplete.push_back(*iter);
+    }
+  }
+
+  // only file creates are held back
+  m_events = incomplete;
+  m_keys.clear();
+  m_newDirectories.clear();
+  for(iter = m_events.begin(); iter != m_events.end(); iter++) {
+    m_keys[(*iter)->key] = *iter;
+  }
+}
+
+CFileAlterationQueue::Entry* CFileAlterationQueue::find(std::string key)
+{
+  std::map<std::string, Entry*>::iterator iter = m_keys.find(key);
+  if(iter == m_keys.end())
+    return NULL;
+  return iter->second;
+}
+
+CFileAlterationQueue::Entry* CFileAlterationQueue::append(FAM_EVENT_TYPE type, bool isDir, std::string path, std::string file, 
+                                                          std::string oldPath /*= ""*/, std::string oldFile /*= ""*/, bool complete /*= true*/)
+{
+  Entry* entry = new Entry();
+  entry->event.m_type = type;
+  entry->event.m_isDir = isDir;
+  entry->event.m_path = path;
+  entry->event.m_file = file;
+  entry->event.m_oldPath = oldPath;
+  entry->event.m_oldFile = oldFile;
+  entry->complete = complete;
+  entry->key = famKey(isDir, path, file);
+
+  m_events.push_back(entry);
+  m_keys[entry->key] = entry;
+  if(type == FAM_CREATE && isDir)
+    m_newDirectories.insert(entry->key);
+  return entry;
+}
+
+void CFileAlterationQueue::erase(Entry* entry)
+{
+  m_events.remove(entry);
+  unmap(entry);
+  if(entry->event.m_type == FAM_CREATE && entry->event.m_isDir)
+    m_newDirectories.erase(entry->key);
+  delete entry;
+}
+
+void CFileAlterationQueue::unmap(Entry* entry)
+{
+  std::map<std::string, Entry*>::iterator iter = m_keys.find(entry->key);
+  if(iter == m_keys.end() || iter->second != entry)
+    return;
+  m_keys.erase(iter);
+
+  // an older event for the same path becomes the latest one
+  std::list<Entry*>::reverse_iterator older;
+  for(older = m_events.rbegin(); older != m_events.rend(); older++) {
+    if(*older != entry && (*older)->key == entry->key) {
+      m_keys[entry->key] = *older;
+      break;
+    }
+  }
+}
+
+bool CFileAlterationQueue::isNew(std::string key)
+{
+  std::set<std::string>::iterator iter;
+  for(iter = m_newDirectories.begin(); iter != m_newDirectories.end(); iter++) {
+    if(isInside(key, *iter))
+      return true;
+  }
+  return false;
+}
+
+void CFileAlterationQueue::moveContent(std::string oldKey, std::string newKey)
+{
+  std::list<Entry*> moved;
+  std::list<Entry*>::iterator iter;
+  for(iter = m_events.begin(); iter != m_events.end(); iter++) {
+    if(((*iter)->event.m_type == FAM_CREATE || (*iter)->event.m_type == FAM_MODIFY) &&
+       isInside((*iter)->key, oldKey)) {
+      moved.push_back(*iter);
+    }
+  }
+
+  // the objects are inserted/read after the directory has been moved in the db
+  Entry* entry;
+  for(iter = moved.begin(); iter != moved.end(); iter++) {
+    entry = *iter;
+    m_events.remove(entry);
+    unmap(entry);
+    if(entry->event.m_type == FAM_CREATE && entry->event.m_isDir)
+      m_newDirectories.erase(entry->key);
+
+    entry->event.m_path = newKey + entry->event.m_path.substr(oldKey.length());
+    entry->key = newKey + entry->key.substr(oldKey.length());
+
+    m_events.push_back(entry);
+    m_keys[entry->key] = entry;
+    if(entry->event.m_type == FAM_CREATE && entry->event.m_isDir)
+      m_newDirectories.insert(entry->key);
+  }
+}
+
 
 
 /*CFileAlterationMgr* CFileAlterationMgr::m_Instance = 0;
@@ -99,6 +406,7 @@ CInotifyMonitor::CInotifyMonitor(IFileAlterationMonitor* pEventHandler):
 {
   m_pInotify = new Inotify();
   m_active = true;
+  m_quietPeriod = CSharedConfig::Shared()->contentDirectory->FamQuietPeriod();
 }
 
 CInotifyMonitor::~CInotifyMonitor()
@@ -124,7 +432,7 @@ bool CInotifyMonitor::addWatch(std::string path)
     return false;
   }
 
-	Log::log(Log::fam, Log::extended, __FILE__, __LINE__, "add watch \"%s\"", path.c_str());
+	FUPPES_LOG(Log::fam, Log::extended, "add watch \"%s\"", path.c_str());
 
   InotifyWatch* pWatch = NULL;
   try { // IN_UNMOUNT
@@ -150,7 +458,7 @@ void CInotifyMonitor::removeWatch(std::string path)
 {
   appendTrailingSlash(&path);
   //cout << "remove watch: " << path << endl;
-	Log::log(Log::fam, Log::extended, __FILE__, __LINE__, "remove watch \"%s\"", path.c_str());
+	FUPPES_LOG(Log::fam, Log::extended, "remove watch \"%s\"", path.c_str());
 	
   std::map<std::string, InotifyWatch*>::iterator iter;
   if((iter = m_watches.find(path)) == m_watches.end()) {
@@ -272,11 +580,13 @@ void CInotifyMonitor::run()
   std::string   movedFromPath;
   std::string   movedFromFile;
   bool          movedFromIsDir = false;
-  
-  CFileAlterationEvent   famEvent;
-  // path, event
-  std::map<std::string, CFileAlterationEvent*>            events;
-  std::map<std::string, CFileAlterationEvent*>::iterator  eventsIter;  
+
+  // the events are collected and merged until there are no new
+  // events for m_quietPeriod ms (or for at most FAM_MAX_DELAY ms)
+  CFileAlterationQueue  queue;
+  unsigned int          firstEventTicks = 0;
+  unsigned int          lastEventTicks = 0;
+  unsigned int          now;
 
   size_t numEvents;
 
@@ -298,10 +608,20 @@ void CInotifyMonitor::run()
     numEvents = pInotify->m_pInotify->GetEventCount();
 
     if(numEvents == 0) {
+      now = fuppesTicks();
+      if(!queue.empty() &&
+         ((now - lastEventTicks) >= m_quietPeriod || (now - firstEventTicks) >= FAM_MAX_DELAY)) {
+        flush(&queue);
+        firstEventTicks = now;
+      }
       msleep(100);
       continue;
     }    
-    Log::log(Log::fam, Log::debug, __FILE__, __LINE__, "got %d events", numEvents);
+    FUPPES_LOG(Log::fam, Log::debug, "got %d events", numEvents);
+
+    lastEventTicks = fuppesTicks();
+    if(queue.empty())
+      firstEventTicks = lastEventTicks;
 
     // process events
     while(pInotify->m_pInotify->GetEvent(&event)) {
@@ -310,7 +630,7 @@ void CInotifyMonitor::run()
       std::string types;
       event.DumpTypes(types);
       //cout << "event: " << "cookie: " << event.GetCookie() << " types: " << types << endl;
-      Log::log(Log::fam, Log::debug, __FILE__, __LINE__, 
+      FUPPES_LOG(Log::fam, Log::debug, 
         "event :: cookie: %d types: %s", event.GetCookie(), types.c_str());
 
 
@@ -336,27 +656,16 @@ void CInotifyMonitor::run()
 
         cout << "CREATE EVENT: " << absEventPath << endl;
         
-        // directories just send a CREATE event so we can
-        // throw the event right now
+        // directories just send a CREATE event. the watch is added
+        // right now so we don't miss events inside the new dir
         if(event.IsType(IN_ISDIR)) {
           pInotify->addWatch(absEventPath);
-          
-          famEvent.m_type  = FAM_CREATE;
-          famEvent.m_isDir = true;
-          famEvent.m_path  = event.GetWatch()->GetPath();
-          famEvent.m_file  = event.GetName();
-          
-          pInotify->famEvent(&famEvent);
+          queue.create(true, event.GetWatch()->GetPath(), event.GetName());
         }
         // the file's CREATE event is always followed by a
-        // CLOSE event. therefore we queue it and wait for CLOSE
+        // CLOSE event. therefore it is held back until CLOSE
         else {
-    
-          events[absEventPath] = new CFileAlterationEvent();
-          events[absEventPath]->m_type  = FAM_CREATE;
-          events[absEventPath]->m_isDir = false;
-          events[absEventPath]->m_path  = event.GetWatch()->GetPath();
-          events[absEventPath]->m_file  = event.GetName();
+          queue.create(false, event.GetWatch()->GetPath(), event.GetName(), false);
         }        
         
 			} // IN_CREATE
@@ -371,11 +680,7 @@ void CInotifyMonitor::run()
           pInotify->removeWatch(absEventPath);
         }
         
-        famEvent.m_type = FAM_DELETE;
-        famEvent.m_path = event.GetWatch()->GetPath();
-        famEvent.m_file = event.GetName();        
-        famEvent.m_isDir = event.IsType(IN_ISDIR);
-        pInotify->famEvent(&famEvent);
+        queue.remove(event.IsType(IN_ISDIR), event.GetWatch()->GetPath(), event.GetName());
 
       } // IN_DELETE        
 
@@ -386,22 +691,10 @@ void CInotifyMonitor::run()
 
         cout << "CLOSE_WRITE EVENT: " << absEventPath << endl;
         
-        // check if there is a create event and throw it ...
-        eventsIter = events.find(absEventPath);
-        if(eventsIter != events.end()) {
-          
-          CFileAlterationEvent* evt = eventsIter->second;
-          pInotify->famEvent(evt);
-          delete evt;
-          events.erase(eventsIter); 
-        }
+        // check if there is a create event and release it ...
         // ... else we have a (file) modify event
-        else {
-          famEvent.m_type  = FAM_MODIFY;
-          famEvent.m_isDir = false;
-          famEvent.m_path  = event.GetWatch()->GetPath();
-          famEvent.m_file  = event.GetName();
-          pInotify->famEvent(&famEvent);
+        if(!queue.written(event.GetWatch()->GetPath(), event.GetName())) {
+          queue.modify(event.GetWatch()->GetPath(), event.GetName());
         }
         
       } // IN_CLOSE_WRITE
@@ -428,24 +721,20 @@ void CInotifyMonitor::run()
         if(pInotify->m_pInotify->PeekEvent(&peek) &&
            peek.IsType(IN_MOVED_TO) && 
            peek.GetCookie() == event.GetCookie()) {
-           // the event is thrown in the next round of this loop
+           // the event is handled in the next round of this loop
            continue;
         }
         // else the dir is moved outside the shared dirs
-        // which means we throw a delete event and remove the watch
+        // which means we queue a delete event and remove the watch
         else {
 
-          famEvent.m_type  = FAM_DELETE;
-          famEvent.m_path  = movedFromPath;
-          famEvent.m_file  = movedFromFile;        
-          famEvent.m_isDir = movedFromIsDir;
           movedFromCookie = 0;
 
           if(movedFromIsDir) {
             pInotify->removeWatch(Directory::appendTrailingSlash(movedFromPath + movedFromFile));
           }
 
-          pInotify->famEvent(&famEvent);          
+          queue.remove(movedFromIsDir, movedFromPath, movedFromFile);
         }
         
       } // IN_MOVED_FROM
@@ -458,45 +747,61 @@ void CInotifyMonitor::run()
         if(event.GetCookie() == movedFromCookie) {
           //cout << "moved already watched object from : " << movedFromPath + movedFromFile << " to: " << eventPath << " [MOVE]" << endl;            
 
-          famEvent.m_type  = FAM_MOVE;
-          famEvent.m_isDir = event.IsType(IN_ISDIR);
-          famEvent.m_path  = event.GetWatch()->GetPath();
-          famEvent.m_file  = event.GetName();
-          famEvent.m_oldPath  = movedFromPath;
-          famEvent.m_oldFile  = movedFromFile;
-
           if(event.IsType(IN_ISDIR)) {
-            pInotify->moveWatch(famEvent.m_oldPath + famEvent.m_oldFile, 
-                                famEvent.m_path + famEvent.m_file);
+            pInotify->moveWatch(movedFromPath + movedFromFile, 
+                                event.GetWatch()->GetPath() + event.GetName());
           }
           
-          pInotify->famEvent(&famEvent);          
+          queue.move(event.IsType(IN_ISDIR), event.GetWatch()->GetPath(), event.GetName(),
+                     movedFromPath, movedFromFile);
 
           movedFromCookie = 0;
         }
         else {
           //cout << "new object moved in to: " << eventPath << " [NEW]" << endl;
           
-          famEvent.m_type  = FAM_CREATE;
-          famEvent.m_isDir = event.IsType(IN_ISDIR);
-          famEvent.m_path  = event.GetWatch()->GetPath();
-          famEvent.m_file  = event.GetName();                 
-                     
           if(event.IsType(IN_ISDIR)) {
             pInotify->addWatch(absEventPath); 
           }
-          pInotify->famEvent(&famEvent); 
+          queue.create(event.IsType(IN_ISDIR), event.GetWatch()->GetPath(), event.GetName());
         }
 
       }  // IN_MOVED_TO   
       
 
     } // while getEvents
+
+    // during a continuous burst (e.g. a long copy) every poll returns
+    // events and the quiet period never starts
+    now = fuppesTicks();
+    if(!queue.empty() && (now - firstEventTicks) >= FAM_MAX_DELAY) {
+      flush(&queue);
+      firstEventTicks = now;
+    }
     
   }
+
+  // apply what we have got so far
+  flush(&queue);
   
   //fuppesThreadExit();
 }
+
+void CInotifyMonitor::flush(CFileAlterationQueue* queue)
+{
+  std::list<CFileAlterationEvent*> events;
+  queue->take(&events);
+  if(events.empty())
+    return;
+
+  FUPPES_LOG(Log::fam, Log::debug, "applying %d events", events.size());
+  famEvents(&events);
+
+  std::list<CFileAlterationEvent*>::iterator iter;
+  for(iter = events.begin(); iter != events.end(); iter++) {
+    delete *iter;
+  }
+}
   
 #endif // HAVE_INOTIFY
 
@@ -40,6 +40,8 @@
 #include <string>
 #include <sstream>
 #include <map>
+#include <set>
+#include <list>
 
 typedef enum {
 
@@ -84,6 +86,7 @@ class KqueueMonitor;
 class CFileAlterationEvent
 {
   friend class CFileAlterationMonitor;
+  friend class CFileAlterationQueue;
 	#ifdef HAVE_INOTIFY
 	friend class CInotifyMonitor;
 	#endif
@@ -169,6 +172,74 @@ class IFileAlterationMonitor
   public:
     //virtual void FamEvent(FAM_EVENT_TYPE eventType, std::string path, std::string name, std::string oldPath = "", std::string oldName = "") = 0;
      virtual void famEvent(CFileAlterationEvent* event) = 0;
+
+     // a batch of merged events in the order they occured
+     virtual void famEvents(std::list<CFileAlterationEvent*>* events) {
+       std::list<CFileAlterationEvent*>::iterator iter;
+       for(iter = events->begin(); iter != events->end(); iter++) {
+         famEvent(*iter);
+       }
+     }
+};
+
+/**
+ * collects file system events and merges the events for the same object
+ * so a burst of events results in as few database updates as possible.
+ *
+ *  create + (close) + modify = create
+ *  create + delete           = nothing
+ *  delete + create           = modify (e.g. a file replaced by an editor)
+ *  move a > b + move b > c   = move a > c
+ *  move a > b + delete b     = delete a
+ *
+ * events inside a new directory are dropped as the directory is scanned
+ * as a whole when the create event is applied.
+ */
+class CFileAlterationQueue
+{
+  public:
+    CFileAlterationQueue() { }
+    ~CFileAlterationQueue();
+
+    // incomplete creates are held back until written() is called
+    void  create(bool isDir, std::string path, std::string file, bool complete = true);
+    // a file has been closed after writing. returns false if there
+    // is no pending event for the file
+    bool  written(std::string path, std::string file);
+    void  modify(std::string path, std::string file);
+    void  remove(bool isDir, std::string path, std::string file);
+    void  move(bool isDir, std::string path, std::string file, std::string oldPath, std::string oldFile);
+
+    bool  empty() { return m_events.empty(); }
+    // moves the complete events to events. the caller has to delete them
+    void  take(std::list<CFileAlterationEvent*>* events);
+
+  private:
+    struct Entry {
+      CFileAlterationEvent  event;
+      bool                  complete;
+      // path + file. with trailing slash for directories
+      std::string           key;
+    };
+
+    Entry*  find(std::string key);
+    Entry*  append(FAM_EVENT_TYPE type, bool isDir, std::string path, std::string file,
+                   std::string oldPath = "", std::string oldFile = "", bool complete = true);
+    void    erase(Entry* entry);
+    // removes the entry from m_keys. an older entry for the same key takes its place
+    void    unmap(Entry* entry);
+    // the path is inside a directory created in this batch
+    bool    isNew(std::string key);
+    // moves the pending creates and modifies inside a moved
+    // directory behind the move and sets their new path
+    void    moveContent(std::string oldKey, std::string newKey);
+
+    // in the order they occured
+    std::list<Entry*>               m_events;
+    // key -> latest event for the object
+    std::map<std::string, Entry*>   m_keys;
+    // keys of the directories created in this batch
+    std::set<std::string>           m_newDirectories;
 };
 
 class CFileAlterationMonitor: protected fuppes::Thread
@@ -185,6 +256,7 @@ class CFileAlterationMonitor: protected fuppes::Thread
     bool isActive() { return m_active; }
     
     void famEvent(CFileAlterationEvent* event);
+    void famEvents(std::list<CFileAlterationEvent*>* events);
 			
   protected:
     CFileAlterationMonitor(IFileAlterationMonitor* pEventHandler): fuppes::Thread("FileAlterationMonitor") { 
@@ -239,6 +311,9 @@ class CInotifyMonitor: public CFileAlterationMonitor
   private:
     Inotify*                                m_pInotify;
 		void run();
+    // passes the complete events to the handler
+    void  flush(CFileAlterationQueue* queue);
+    unsigned int                            m_quietPeriod;
     // path, watch
     std::map<std::string, InotifyWatch*>    m_watches;
 };
@@ -31,6 +31,7 @@
 #include "../DeviceSettings/DeviceIdentificationMgr.h"
 
 #include "../Plugins/Plugin.h"
+#include "../Common/Thread.h"
 
 #include <sstream>
 #include <iostream>
@@ -226,6 +227,8 @@ bool CFileDetails::getImageDetails(std::string p_sFileName, ImageItem* imageItem
 	return false;
 }
 
+static fuppes::Mutex videoMutex;
+
 bool CFileDetails::getVideoDetails(std::string p_sFileName, VideoItem* videoItem) // static
 {
 	string sExt = ExtractFileExt(p_sFileName);  
@@ -237,11 +240,15 @@ bool CFileDetails::getVideoDetails(std::string p_sFileName, VideoItem* videoItem
 		return false;
 	}
 
+	// libavformat's open/find_stream_info are not thread safe
+	// so we have to serialize the metadata workers here
 	bool result = false;
+	videoMutex.lock();
 	if(video->openFile(p_sFileName)) {
 		result = video->readData(videoItem->metadata());
 		video->closeFile();
 	}
+	videoMutex.unlock();
 	delete video;	
 
 	return result;
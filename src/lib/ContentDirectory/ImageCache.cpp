@@ -0,0 +1,475 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            ImageCache.cpp
+ * 
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ImageCache.h"
+#include "../SharedConfig.h"
+#include "../SharedLog.h"
+#include "../Configuration/PathFinder.h"
+#include "../Common/Directory.h"
+#include "../Common/File.h"
+#include "../Plugins/Plugin.h"
+#include "../DeviceSettings/DeviceSettings.h"
+#include "DatabaseObject.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <utime.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+using namespace fuppes;
+
+ImageCache* ImageCache::m_instance = NULL;
+
+ImageCache* ImageCache::Shared() // static
+{
+  if(m_instance == NULL)
+    m_instance = new ImageCache();
+  return m_instance;
+}
+
+ImageCache::ImageCache()
+{
+  m_condition   = new Condition(&m_mutex);
+  m_size        = 0;
+  m_maxSize     = CSharedConfig::Shared()->contentDirectory->ImageCacheSize() * 1024 * 1024;
+  m_diskSize    = 0;
+  m_maxDiskSize = (fuppes_off_t)CSharedConfig::Shared()->contentDirectory->ImageDiskCacheSize() * 1024 * 1024;
+  m_hits        = 0;
+  m_diskHits    = 0;
+  m_misses      = 0;
+
+  if(m_maxDiskSize > 0 && !PathFinder::findThumbnailsDir().empty()) {
+    m_directory = PathFinder::findThumbnailsDir() + "cache/";
+    if(!Directory::exists(m_directory) && !Directory::create(m_directory)) {
+      CSharedLog::Log(L_NORM, __FILE__, __LINE__, "unable to create image cache dir %s", m_directory.c_str());
+      m_directory = "";
+    }
+  }
+  if(m_directory.empty()) {
+    m_maxDiskSize = 0;
+    return;
+  }
+
+  // get the current size of the disk cache
+  Directory dir(m_directory);
+  dir.open();
+  DirEntryList entries = dir.dirEntryList(DirEntry::File);
+  dir.close();
+  struct stat info;
+  for(size_t i = 0; i < entries.size(); i++) {
+    if(stat(entries[i].absolutePath().c_str(), &info) == 0)
+      m_diskSize += info.st_size;
+  }
+  if(m_diskSize > m_maxDiskSize)
+    trimFiles();
+}
+
+std::string ImageCache::key(object_id_t objectId, time_t modified, int width, int height, std::string format) // static
+{
+  stringstream result;
+  result << objectId << "\n" <<
+    modified << "\n" <<
+    width << "x" << height << "\n" <<
+    format;
+  return result.str();
+}
+
+std::string ImageCache::format(CDeviceSettings* device, Source source, std::string ext) // static
+{
+  // video thumbnails are never transcoded
+  if(source == VideoFile)
+    return "video";
+
+  stringstream result;
+  result << ext;
+  CFileSettings* settings = device->FileSettings(ext);
+  if(settings && settings->pImageSettings) {
+    CImageSettings* image = settings->pImageSettings;
+    result << ">" << image->Extension() << "," << image->bDcraw << "," << 
+      image->sDcrawParams << "," << image->nResizeMethod;
+  }
+  return result.str();
+}
+
+bool ImageCache::create(Source source, std::string fileName, std::string ext, CDeviceSettings* device,
+                        int width, int height, ObjectDetails* details, Image* result) // static
+{
+  size_t inSize = 0;
+  size_t outSize = 0;
+  unsigned char* inBuffer = NULL;
+  unsigned char* outBuffer = (unsigned char*)malloc(1);
+  std::string mimeType = device->MimeType(ext);
+
+  // embedded image from audio or video file
+  bool transcode = true;
+  if(source == AudioFile || source == VideoFile) {
+
+    string plugin = "taglib";
+    if(source == VideoFile) {
+      plugin = "ffmpegthumbnailer";
+      transcode = false;
+    }
+
+    CMetadataPlugin* metadata = CPluginMgr::metadataPlugin(plugin);
+    if(!metadata) {
+      CSharedLog::Log(L_EXT, __FILE__, __LINE__, "metadata plugin %s not found", plugin.c_str());
+      free(outBuffer);
+      return false;
+    }
+
+    char tmpMime[100];
+    inBuffer = (unsigned char*)malloc(1);
+    metadata->openFile(fileName);
+    bool found = metadata->readImage(&tmpMime[0], &inBuffer, &inSize);
+    metadata->closeFile();
+    delete metadata;
+    if(!found) {
+      CSharedLog::Log(L_EXT, __FILE__, __LINE__, "metadata plugin %s failed to read embedded image", plugin.c_str());
+      free(inBuffer);
+      free(outBuffer);
+      return false;
+    }
+
+    // get the mime type and the extension of the extracted file
+    mimeType = tmpMime;
+    ext = device->extensionByMimeType(mimeType);
+  } // embedded image
+
+  // an actual image file
+  else {
+
+    std::fstream fsImg;
+    fsImg.open(fileName.c_str(), ios::binary|ios::in);
+    if(fsImg.fail() == 1) {
+      CSharedLog::Log(L_EXT, __FILE__, __LINE__, "failed to load image file %s", fileName.c_str());
+      free(outBuffer);
+      return false;
+    }
+    fsImg.seekg(0, ios::end); 
+    inSize = streamoff(fsImg.tellg()); 
+    fsImg.seekg(0, ios::beg);
+    inBuffer = (unsigned char*)malloc(inSize > 0 ? inSize : 1);
+    fsImg.read((char*)inBuffer, inSize);
+    fsImg.close();
+  } // image file
+
+  if(transcode) {
+    CTranscoderBase* transcoder = CPluginMgr::transcoderPlugin("magickWand");
+    if(transcoder == NULL) {
+      CSharedLog::Log(L_EXT, __FILE__, __LINE__, "image magick transcoder not available");
+      free(inBuffer);
+      free(outBuffer);
+      return false;
+    }
+
+    CFileSettings* settings = new CFileSettings(device->FileSettings(ext));
+    if(!settings->pImageSettings) {
+      settings->pImageSettings = new CImageSettings();
+    }
+    settings->pImageSettings->nHeight = height;
+    settings->pImageSettings->nWidth = width;
+    settings->pImageSettings->bGreater = true;
+    settings->pImageSettings->bLess = true;
+
+    transcoder->TranscodeMem(settings, (const unsigned char**)&inBuffer, inSize, &outBuffer, &outSize);
+    delete settings;
+    delete transcoder;
+
+    result->data.assign((char*)outBuffer, outSize);
+    mimeType = device->MimeType(ext);
+
+    // todo: get the actual image dimensions
+  }
+  else {
+    result->data.assign((char*)inBuffer, inSize);
+    width = details->width();
+    height = details->height();
+  }
+
+  free(inBuffer);
+  free(outBuffer);
+
+  result->mimeType = mimeType;
+  result->ext = ext;
+  result->width = width;
+  result->height = height;
+  return !result->data.empty();
+}
+
+bool ImageCache::get(const std::string& key, Image* result)
+{
+  if(m_maxSize == 0 && m_maxDiskSize == 0)
+    return false;
+
+  MutexLocker locker(&m_mutex);
+
+  // the image is currently created by another request.
+  // we don't wait forever in case the other request hangs
+  unsigned int timeouts = 0;
+  while(m_pending.find(key) != m_pending.end() && timeouts < 30) {
+    if(!m_condition->wait(1000))
+      timeouts++;
+  }
+
+  if(getMemory(key, result)) {
+    m_hits++;
+    return true;
+  }
+
+  // the file is read without holding the lock. we are the
+  // producer until we know whether the file exists
+  m_pending.insert(key);
+  m_mutex.unlock();
+  bool found = readFile(key, result);
+  m_mutex.lock();
+
+  if(found) {
+    m_pending.erase(key);
+    m_condition->broadcast();
+    putMemory(key, *result);
+    m_diskHits++;
+    return true;
+  }
+
+  m_misses++;
+  return false;
+}
+
+void ImageCache::put(const std::string& key, const Image& image, bool memory)
+{
+  if(m_maxSize == 0 && m_maxDiskSize == 0)
+    return;
+
+  writeFile(key, image);
+
+  MutexLocker locker(&m_mutex);
+  if(memory || m_maxDiskSize == 0)
+    putMemory(key, image);
+  m_pending.erase(key);
+  m_condition->broadcast();
+}
+
+void ImageCache::abort(const std::string& key)
+{
+  MutexLocker locker(&m_mutex);
+  m_pending.erase(key);
+  m_condition->broadcast();
+}
+
+bool ImageCache::reserve(const std::string& key)
+{
+  if(m_maxSize == 0 && m_maxDiskSize == 0)
+    return false;
+
+  MutexLocker locker(&m_mutex);
+  if(m_pending.find(key) != m_pending.end() || m_index.find(key) != m_index.end())
+    return false;
+  if(m_maxDiskSize > 0 && File::exists(fileName(key)))
+    return false;
+
+  m_pending.insert(key);
+  return true;
+}
+
+unsigned int ImageCache::count()
+{
+  MutexLocker locker(&m_mutex);
+  return m_index.size();
+}
+
+bool ImageCache::getMemory(const std::string& key, Image* result)
+{
+  std::map<std::string, std::list<Entry>::iterator>::iterator iter = m_index.find(key);
+  if(iter == m_index.end())
+    return false;
+
+  // move to the front
+  m_entries.splice(m_entries.begin(), m_entries, iter->second);
+  *result = iter->second->image;
+  return true;
+}
+
+void ImageCache::putMemory(const std::string& key, const Image& image)
+{
+  unsigned int entrySize = (key.length() * 2) + image.data.length();
+  if(m_maxSize == 0 || entrySize > m_maxSize)
+    return;
+
+  if(m_index.find(key) != m_index.end())
+    return;
+
+  while(!m_entries.empty() && (m_size + entrySize) > m_maxSize) {
+    removeOldest();
+  }
+
+  Entry entry;
+  entry.key = key;
+  m_entries.push_front(entry);
+  m_entries.front().image = image;
+  m_index[key] = m_entries.begin();
+  m_size += entrySize;
+}
+
+void ImageCache::removeOldest()
+{
+  Entry& oldest = m_entries.back();
+  m_size -= (oldest.key.length() * 2) + oldest.image.data.length();
+  m_index.erase(oldest.key);
+  m_entries.pop_back();
+}
+
+std::string ImageCache::fileName(const std::string& key)
+{
+  // 64 bit FNV-1a
+  unsigned long long hash = 14695981039346656037ULL;
+  for(size_t i = 0; i < key.length(); i++) {
+    hash ^= (unsigned char)key[i];
+    hash *= 1099511628211ULL;
+  }
+
+  char name[17];
+  snprintf(name, sizeof(name), "%016llx", hash);
+  return m_directory + name;
+}
+
+/*
+ * the cache files start with a header line:
+ *   key length, mime type, extension, width, height (tab separated)
+ * followed by the key and the image data
+ */
+bool ImageCache::readFile(const std::string& key, Image* result)
+{
+  if(m_maxDiskSize == 0)
+    return false;
+
+  std::string name = fileName(key);
+  std::ifstream file(name.c_str(), ios::binary | ios::in);
+  if(file.fail())
+    return false;
+
+  std::string header;
+  if(!std::getline(file, header))
+    return false;
+
+  size_t keyLength;
+  std::vector<std::string> fields;
+  std::stringstream tmp(header);
+  std::string field;
+  while(std::getline(tmp, field, '\t')) {
+    fields.push_back(field);
+  }
+  if(fields.size() != 5)
+    return false;
+  keyLength = atoi(fields[0].c_str());
+
+  // a hash collision
+  std::string fileKey(keyLength, '\0');
+  file.read(&fileKey[0], keyLength);
+  if(fileKey != key)
+    return false;
+
+  std::stringstream data;
+  data << file.rdbuf();
+  file.close();
+
+  result->data = data.str();
+  result->mimeType = fields[1];
+  result->ext = fields[2];
+  result->width = atoi(fields[3].c_str());
+  result->height = atoi(fields[4].c_str());
+
+  // the modification time is used for the lru order
+  utime(name.c_str(), NULL);
+  return true;
+}
+
+void ImageCache::writeFile(const std::string& key, const Image& image)
+{
+  if(m_maxDiskSize == 0)
+    return;
+
+  // write to a temporary file first so readers never see a partial image
+  std::string name = fileName(key);
+  std::string tmpName = name + ".tmp";
+  std::ofstream file(tmpName.c_str(), ios::binary | ios::out | ios::trunc);
+  if(file.fail()) {
+    CSharedLog::Log(L_EXT, __FILE__, __LINE__, "unable to write image cache file %s", tmpName.c_str());
+    return;
+  }
+
+  file << key.length() << "\t" << image.mimeType << "\t" << image.ext << "\t" <<
+    image.width << "\t" << image.height << "\n";
+  file.write(key.c_str(), key.length());
+  file.write(image.data.c_str(), image.data.length());
+  fuppes_off_t written = file.tellp();
+  file.close();
+
+  if(file.fail() || rename(tmpName.c_str(), name.c_str()) != 0) {
+    File::remove(tmpName);
+    return;
+  }
+
+  MutexLocker locker(&m_mutex);
+  m_diskSize += written;
+  if(m_diskSize > m_maxDiskSize)
+    trimFiles();
+}
+
+static bool olderFile(const std::pair<time_t, std::string>& a, const std::pair<time_t, std::string>& b)
+{
+  return a.first < b.first;
+}
+
+void ImageCache::trimFiles()
+{
+  Directory dir(m_directory);
+  dir.open();
+  DirEntryList entries = dir.dirEntryList(DirEntry::File);
+  dir.close();
+
+  std::vector<std::pair<time_t, std::string> > files;
+  struct stat info;
+  m_diskSize = 0;
+  for(size_t i = 0; i < entries.size(); i++) {
+    if(stat(entries[i].absolutePath().c_str(), &info) != 0)
+      continue;
+    m_diskSize += info.st_size;
+    files.push_back(std::make_pair(info.st_mtime, entries[i].absolutePath()));
+  }
+
+  std::sort(files.begin(), files.end(), olderFile);
+
+  fuppes_off_t limit = (m_maxDiskSize / 10) * 9;
+  for(size_t i = 0; i < files.size() && m_diskSize > limit; i++) {
+    if(stat(files[i].second.c_str(), &info) == 0 && File::remove(files[i].second))
+      m_diskSize -= info.st_size;
+  }
+}
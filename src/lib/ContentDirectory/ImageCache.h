@@ -0,0 +1,155 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            ImageCache.h
+ * 
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _IMAGECACHE_H
+#define _IMAGECACHE_H
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#include "../Common/Thread.h"
+#include "../../../include/fuppes_types.h"
+
+#include <string>
+#include <list>
+#include <map>
+#include <set>
+#include <time.h>
+
+class CDeviceSettings;
+namespace fuppes {
+  class ObjectDetails;
+}
+
+/**
+ * cache of scaled images, embedded album art and video thumbnails.
+ *
+ * the images are keyed by everything that changes the output (object,
+ * modification time of the source, requested size and the device's
+ * settings for the image type) so the entries never have to be
+ * invalidated. a cache file name is the hash of its key.
+ *
+ * the most recently used images are kept in memory, all images are kept
+ * on disk up to a size limit. concurrent requests for the same image wait
+ * for the first one instead of scaling the image again.
+ */
+class ImageCache
+{
+  public:
+    static ImageCache* Shared();
+
+    struct Image {
+      Image() {
+        width = 0;
+        height = 0;
+      }
+
+      std::string   data;
+      std::string   mimeType;
+      std::string   ext;
+      int           width;
+      int           height;
+    };
+
+    enum Source {
+      ImageFile,
+      // the embedded image
+      AudioFile,
+      // a frame extracted by ffmpegthumbnailer
+      VideoFile
+    };
+
+    static std::string key(object_id_t objectId, time_t modified, int width, int height, std::string format);
+    // the part of the key that depends on the device.
+    // ext is the image's extension (the album art's for audio files)
+    static std::string format(CDeviceSettings* device, Source source, std::string ext);
+    // scales an image file or extracts and scales an embedded image.
+    // details is used for the size of unscaled video thumbnails
+    static bool create(Source source, std::string fileName, std::string ext, CDeviceSettings* device,
+                       int width, int height, fuppes::ObjectDetails* details, Image* result);
+
+    // copies the cached image to result. on a miss the caller has to create
+    // the image and pass it to put() or call abort() if that failed.
+    // waits if another thread is creating the same image
+    bool get(const std::string& key, Image* result);
+    // memory = false keeps the image out of the memory cache if it is stored on disk
+    void put(const std::string& key, const Image& image, bool memory = true);
+    void abort(const std::string& key);
+    // used for pre-rendering. returns false if the image is already cached or
+    // currently created. otherwise the caller has to create it like on a miss
+    bool reserve(const std::string& key);
+
+    unsigned int  hits() { return m_hits; }
+    unsigned int  diskHits() { return m_diskHits; }
+    unsigned int  misses() { return m_misses; }
+    unsigned int  count();
+    unsigned int  size() { return m_size; }
+    // max. memory in bytes. 0 = disabled
+    unsigned int  maxSize() { return m_maxSize; }
+    fuppes_off_t  diskSize() { return m_diskSize; }
+    // max. disk space in bytes. 0 = disabled
+    fuppes_off_t  maxDiskSize() { return m_maxDiskSize; }
+
+  private:
+    ImageCache();
+    static ImageCache* m_instance;
+
+    struct Entry {
+      std::string key;
+      Image       image;
+    };
+
+    // memory. m_mutex must be locked
+    bool    getMemory(const std::string& key, Image* result);
+    void    putMemory(const std::string& key, const Image& image);
+    void    removeOldest();
+
+    // disk
+    std::string fileName(const std::string& key);
+    bool    readFile(const std::string& key, Image* result);
+    void    writeFile(const std::string& key, const Image& image);
+    // removes the least recently used files until the cache is below 90% of the limit
+    void    trimFiles();
+
+    fuppes::Mutex                     m_mutex;
+    fuppes::Condition*                m_condition;
+    // most recently used first
+    std::list<Entry>                  m_entries;
+    std::map<std::string, std::list<Entry>::iterator> m_index;
+    // the images currently created
+    std::set<std::string>             m_pending;
+
+    std::string                       m_directory;
+    unsigned int                      m_size;
+    unsigned int                      m_maxSize;
+    fuppes_off_t                      m_diskSize;
+    fuppes_off_t                      m_maxDiskSize;
+    unsigned int                      m_hits;
+    unsigned int                      m_diskHits;
+    unsigned int                      m_misses;
+};
+
+#endif // _IMAGECACHE_H
@@ -0,0 +1,244 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            ThumbnailGenerator.cpp
+ * 
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ThumbnailGenerator.h"
+#include "UPnPObjectTypes.h"
+#include "../SharedConfig.h"
+#include "../Log.h"
+#include "../Common/Common.h"
+#include "../Common/File.h"
+#include "../DeviceSettings/DeviceIdentificationMgr.h"
+#include "../HTTP/HTTPServer.h"
+
+#ifdef __linux__
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+using namespace fuppes;
+
+// max. number of queued items. the thumbnails of
+// the remaining items are created on request
+#define MAX_THUMBNAIL_JOBS 10000
+
+ThumbnailWorker::ThumbnailWorker(ThumbnailGenerator* owner)
+:Thread("ThumbnailWorker")
+{
+  m_owner = owner;
+}
+
+ThumbnailWorker::~ThumbnailWorker()
+{
+  close();
+}
+
+void ThumbnailWorker::run()
+{
+  ThumbnailJob* job;
+  unsigned int wait;
+
+#ifdef __linux__
+  // linux applies the nice value to the calling thread only
+  setpriority(PRIO_PROCESS, 0, 19);
+#endif
+
+  while(!stopRequested()) {
+
+    // streaming always has priority
+    if(HTTPSessionStore::activeStreams() > 0) {
+      msleep(500);
+      continue;
+    }
+
+    job = m_owner->takeJob(500);
+    if(job == NULL)
+      continue;
+
+    wait = m_owner->reserveSlot();
+    if(wait > 0)
+      msleep(wait);
+
+    m_owner->render(job);
+    delete job;
+  }
+}
+
+
+
+ThumbnailGenerator::ThumbnailGenerator()
+{
+  m_jobCondition = new Condition(&m_mutex);
+  m_jobCount = 0;
+  m_interval = 0;
+  m_nextSlot = 0;
+}
+
+ThumbnailGenerator::~ThumbnailGenerator()
+{
+  stop();
+  delete m_jobCondition;
+}
+
+void ThumbnailGenerator::start()
+{
+  unsigned int count = CSharedConfig::Shared()->contentDirectory->ThumbnailWorkers();
+  if(count == 0 ||
+     (CSharedConfig::Shared()->contentDirectory->ImageCacheSize() == 0 &&
+      CSharedConfig::Shared()->contentDirectory->ImageDiskCacheSize() == 0))
+    return;
+
+  unsigned int perSecond = CSharedConfig::Shared()->contentDirectory->ThumbnailsPerSecond();
+  m_interval = (perSecond > 0) ? (1000 / perSecond) : 0;
+  m_nextSlot = fuppesTicks();
+
+  ThumbnailWorker* worker;
+  for(unsigned int i = 0; i < count; i++) {
+    worker = new ThumbnailWorker(this);
+    worker->start();
+    m_workers.push_back(worker);
+  }
+}
+
+void ThumbnailGenerator::stop()
+{
+  std::vector<ThumbnailWorker*>::iterator iter;
+  for(iter = m_workers.begin(); iter != m_workers.end(); iter++) {
+    (*iter)->stop();
+  }
+  m_mutex.lock();
+  m_jobCondition->broadcast();
+  m_mutex.unlock();
+  for(iter = m_workers.begin(); iter != m_workers.end(); iter++) {
+    delete *iter;
+  }
+  m_workers.clear();
+
+  std::list<ThumbnailJob*>::iterator job;
+  for(job = m_jobs.begin(); job != m_jobs.end(); job++) {
+    delete *job;
+  }
+  m_jobs.clear();
+  m_jobCount = 0;
+}
+
+void ThumbnailGenerator::add(DbObject* obj, ObjectDetails* details)
+{
+  if(m_workers.empty())
+    return;
+
+  ThumbnailJob* job;
+
+  // DLNA JPEG_TN and JPEG_SM
+  if(obj->type() >= ITEM_IMAGE_ITEM && obj->type() < ITEM_IMAGE_ITEM_MAX) {
+    job = new ThumbnailJob();
+    job->source = ImageCache::ImageFile;
+    job->ext = ExtractFileExt(obj->fileName());
+    job->imageExt = job->ext;
+    job->sizes.push_back(std::make_pair(160, 160));
+    job->sizes.push_back(std::make_pair(640, 480));
+  }
+  // the embedded image in the size written to the DIDL
+  else if(obj->type() >= ITEM_AUDIO_ITEM && obj->type() < ITEM_AUDIO_ITEM_MAX &&
+          details->albumArtId() == obj->objectId()) {
+    job = new ThumbnailJob();
+    job->source = ImageCache::AudioFile;
+    job->ext = ExtractFileExt(obj->fileName());
+    job->imageExt = details->albumArtExt();
+    if(details->albumArtWidth() > 0 && details->albumArtHeight() > 0)
+      job->sizes.push_back(std::make_pair(details->albumArtWidth(), details->albumArtHeight()));
+    else
+      job->sizes.push_back(std::make_pair(300, 300));
+  }
+  else {
+    return;
+  }
+
+  job->objectId = obj->objectId();
+  job->fileName = obj->path() + obj->fileName();
+
+  MutexLocker locker(&m_mutex);
+  if(m_jobCount >= MAX_THUMBNAIL_JOBS) {
+    delete job;
+    return;
+  }
+  m_jobs.push_back(job);
+  m_jobCount++;
+  m_jobCondition->signal();
+}
+
+ThumbnailJob* ThumbnailGenerator::takeJob(unsigned int timeoutMs)
+{
+  MutexLocker locker(&m_mutex);
+  if(m_jobs.empty())
+    m_jobCondition->wait(timeoutMs);
+  if(m_jobs.empty())
+    return NULL;
+
+  ThumbnailJob* job = m_jobs.front();
+  m_jobs.pop_front();
+  m_jobCount--;
+  return job;
+}
+
+unsigned int ThumbnailGenerator::reserveSlot()
+{
+  if(m_interval == 0)
+    return 0;
+
+  MutexLocker locker(&m_mutex);
+  unsigned int now = fuppesTicks();
+  if(m_nextSlot < now)
+    m_nextSlot = now;
+  unsigned int wait = m_nextSlot - now;
+  m_nextSlot += m_interval;
+  return wait;
+}
+
+void ThumbnailGenerator::render(ThumbnailJob* job)
+{
+  CDeviceSettings* device = CDeviceIdentificationMgr::Shared()->DefaultDevice();
+  std::string format = ImageCache::format(device, job->source, job->imageExt);
+  time_t modified = File::lastModified(job->fileName);
+
+  std::string key;
+  ImageCache::Image image;
+  std::list<std::pair<int, int> >::iterator iter;
+  for(iter = job->sizes.begin(); iter != job->sizes.end(); iter++) {
+
+    key = ImageCache::key(job->objectId, modified, iter->first, iter->second, format);
+    if(!ImageCache::Shared()->reserve(key))
+      continue;
+
+    FUPPES_LOG(Log::contentdb, Log::debug, "render thumbnail %dx%d :: %s", iter->first, iter->second, job->fileName.c_str());
+
+    image = ImageCache::Image();
+    if(!ImageCache::create(job->source, job->fileName, job->ext, device, iter->first, iter->second, NULL, &image)) {
+      ImageCache::Shared()->abort(key);
+      // all sizes will fail
+      return;
+    }
+    ImageCache::Shared()->put(key, image, false);
+  }
+}
@@ -0,0 +1,124 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            ThumbnailGenerator.h
+ * 
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _THUMBNAILGENERATOR_H
+#define _THUMBNAILGENERATOR_H
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#include "../Common/Thread.h"
+#include "DatabaseObject.h"
+#include "ImageCache.h"
+
+#include <string>
+#include <list>
+#include <vector>
+
+namespace fuppes {
+
+class ThumbnailGenerator;
+
+/**
+ * an item whose thumbnails are rendered in the background.
+ * the job holds everything needed so the workers never touch the database
+ */
+struct ThumbnailJob
+{
+  object_id_t         objectId;
+  ImageCache::Source  source;
+  std::string         fileName;
+  // the extension of the file
+  std::string         ext;
+  // the extension of the image (the album art's for audio files)
+  std::string         imageExt;
+  // the sizes (width, height) to render
+  std::list<std::pair<int, int> > sizes;
+};
+
+/**
+ * takes jobs from the ThumbnailGenerator and renders the thumbnails
+ */
+class ThumbnailWorker: public Thread
+{
+  public:
+    ThumbnailWorker(ThumbnailGenerator* owner);
+    ~ThumbnailWorker();
+
+  private:
+    void run();
+
+    ThumbnailGenerator* m_owner;
+};
+
+/**
+ * renders the thumbnails of new and changed items into the ImageCache
+ * before they are requested for the first time.
+ *
+ * images get the DLNA JPEG_TN and JPEG_SM sizes, audio files with an
+ * embedded image the album art size written to the DIDL.
+ * the images are rendered for the default device. devices with the same
+ * image settings use the same cache entries.
+ *
+ * the work is done by a small pool of low priority threads that are
+ * rate limited and pause while files are streamed
+ */
+class ThumbnailGenerator
+{
+  friend class ThumbnailWorker;
+
+  public:
+    ThumbnailGenerator();
+    ~ThumbnailGenerator();
+
+    void start();
+    void stop();
+
+    // queues the thumbnails of an item after its metadata has been written.
+    // items without thumbnails are ignored
+    void add(DbObject* obj, ObjectDetails* details);
+
+  private:
+    // worker side
+    ThumbnailJob* takeJob(unsigned int timeoutMs);
+    // returns the number of ms the worker has to wait before rendering the next image
+    unsigned int reserveSlot();
+    void render(ThumbnailJob* job);
+
+    Mutex                       m_mutex;
+    Condition*                  m_jobCondition;
+    std::list<ThumbnailJob*>    m_jobs;
+    unsigned int                m_jobCount;
+    std::vector<ThumbnailWorker*> m_workers;
+
+    // cpu and i/o throttling
+    unsigned int                m_interval;
+    unsigned int                m_nextSlot;
+};
+
+}
+
+#endif // _THUMBNAILGENERATOR_H
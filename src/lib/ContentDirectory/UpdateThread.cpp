@@ -37,17 +37,84 @@ using namespace fuppes;
 #include <iostream>
 using namespace std;
 
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+static unsigned int cpuCount()
+{
+#ifdef WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors;
+#else
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return (count > 0) ? count : 1;
+#endif
+}
+
+
+MetadataWorker::MetadataWorker(UpdateThread* owner)
+:Thread("MetadataWorker")
+{
+  m_owner = owner;
+}
+
+MetadataWorker::~MetadataWorker()
+{
+  close();
+}
+
+void MetadataWorker::run()
+{
+  MetadataJob* job;
+  unsigned int wait;
+  
+  while(!stopRequested()) {
+
+    job = m_owner->takeJob(500);
+    if(job == NULL)
+      continue;
+
+    wait = m_owner->reserveSlot();
+    if(wait > 0)
+      msleep(wait);
+
+    switch(job->kind) {
+      case MetadataJob::Audio:
+        UpdateThread::extractAudioFile(job);
+        break;
+      case MetadataJob::Image:
+        UpdateThread::extractImageFile(job);
+        break;
+      case MetadataJob::Video:
+        UpdateThread::extractVideoFile(job);
+        break;
+    }
+
+    m_owner->finishJob(job);
+  }
+}
+
 
 
 UpdateThread::UpdateThread(FileAlterationHandler* famHandler)
 :Thread("UpdateThread")
 {
   m_famHandler = famHandler;
+  m_layoutsChecked = false;
+  m_jobCondition = new Condition(&m_mutex);
+  m_resultCondition = new Condition(&m_mutex);
+  m_pending = 0;
+  m_interval = 0;
+  m_nextSlot = 0;
 }
 
 UpdateThread::~UpdateThread()
 {
   close();
+  delete m_jobCondition;
+  delete m_resultCondition;
 }
 
 
@@ -74,6 +141,8 @@ void UpdateThread::run()
   msleep(1000);
 
   CDatabaseConnection* connection = CDatabase::connection(true);
+  startWorkers();
+  m_thumbnails.start();
   
   SQLQuery qry(connection);
   SQLQuery ins(connection);
@@ -84,6 +153,13 @@ void UpdateThread::run()
 
     m_count = 0;
 
+    // rebuild the layouts whose .cfg has changed since the last start.
+    // this is done here so the start-up does not have to wait for it
+    if(!m_layoutsChecked && !CContentDatabase::Shared()->IsRebuilding()) {
+      CVirtualContainerMgr::Shared()->RebuildContainerList(false, true, true);
+      m_layoutsChecked = true;
+    }
+
     // check if a fam event occured recently
     int diff = DateTime::now().toInt() - m_famHandler->lastEventTime().toInt();
     if(diff < 5) {
@@ -327,7 +403,8 @@ void UpdateThread::run()
     
   } // !stopRequested
 
-
+  m_thumbnails.stop();
+  stopWorkers();
   delete connection;
   
   //cout << "exit update thread" << endl;
@@ -336,94 +413,277 @@ void UpdateThread::run()
 
 
 
+void UpdateThread::startWorkers()
+{
+  unsigned int count = CSharedConfig::Shared()->contentDirectory->MetadataWorkers();
+  if(count == 0)
+    count = cpuCount();
+
+  unsigned int filesPerSecond = CSharedConfig::Shared()->contentDirectory->MetadataFilesPerSecond();
+  m_interval = (filesPerSecond > 0) ? (1000 / filesPerSecond) : 0;
+  m_nextSlot = fuppesTicks();
+
+  MetadataWorker* worker;
+  for(unsigned int i = 0; i < count; i++) {
+    worker = new MetadataWorker(this);
+    worker->start();
+    m_workers.push_back(worker);
+  }
+}
+
+void UpdateThread::stopWorkers()
+{
+  std::vector<MetadataWorker*>::iterator iter;
+  for(iter = m_workers.begin(); iter != m_workers.end(); iter++) {
+    (*iter)->stop();
+  }
+  m_mutex.lock();
+  m_jobCondition->broadcast();
+  m_mutex.unlock();
+  for(iter = m_workers.begin(); iter != m_workers.end(); iter++) {
+    delete *iter;
+  }
+  m_workers.clear();
+
+  // jobs left over if we got stopped while updating
+  std::list<MetadataJob*>::iterator job;
+  for(job = m_jobs.begin(); job != m_jobs.end(); job++) {
+    delete (*job)->object;
+    delete *job;
+  }
+  m_jobs.clear();
+  for(job = m_results.begin(); job != m_results.end(); job++) {
+    delete (*job)->object;
+    delete *job;
+  }
+  m_results.clear();
+  m_pending = 0;
+}
+
+MetadataJob* UpdateThread::takeJob(unsigned int timeoutMs)
+{
+  MutexLocker locker(&m_mutex);
+  if(m_jobs.empty())
+    m_jobCondition->wait(timeoutMs);
+  if(m_jobs.empty())
+    return NULL;
+
+  MetadataJob* job = m_jobs.front();
+  m_jobs.pop_front();
+  return job;
+}
+
+void UpdateThread::finishJob(MetadataJob* job)
+{
+  MutexLocker locker(&m_mutex);
+  m_results.push_back(job);
+  m_resultCondition->signal();
+}
+
+unsigned int UpdateThread::reserveSlot()
+{
+  if(m_interval == 0)
+    return 0;
+
+  MutexLocker locker(&m_mutex);
+  unsigned int now = fuppesTicks();
+  if(m_nextSlot < now)
+    m_nextSlot = now;
+  unsigned int wait = m_nextSlot - now;
+  m_nextSlot += m_interval;
+  return wait;
+}
+
+void UpdateThread::takeResults(std::list<MetadataJob*>* results, unsigned int timeoutMs)
+{
+  MutexLocker locker(&m_mutex);
+  if(m_results.empty())
+    m_resultCondition->wait(timeoutMs);
+  results->splice(results->end(), m_results);
+}
+
+
+bool UpdateThread::queueJob(DbObject* obj)
+{
+  MetadataJob::Kind kind;
+  switch(obj->type()) {
+    case ITEM_IMAGE_ITEM:
+    case ITEM_IMAGE_ITEM_PHOTO:
+      kind = MetadataJob::Image;
+      break;
+    case ITEM_AUDIO_ITEM:
+    case ITEM_AUDIO_ITEM_MUSIC_TRACK:
+      kind = MetadataJob::Audio;
+      break;
+    case ITEM_VIDEO_ITEM:
+    case ITEM_VIDEO_ITEM_MOVIE:
+    case ITEM_VIDEO_ITEM_MUSIC_VIDEO_CLIP:
+      kind = MetadataJob::Video;
+      break;
+    default:
+      return false;
+  }
+
+  MetadataJob* job = new MetadataJob();
+  job->kind = kind;
+  job->object = obj;
+  job->update = (obj->detailId() > 0);
+  if(job->update)
+    job->oldDetails = *obj->details();
+
+  m_pending++;
+  MutexLocker locker(&m_mutex);
+  m_jobs.push_back(job);
+  m_jobCondition->signal();
+  return true;
+}
+
+
 bool UpdateThread::updateItems(CDatabaseConnection* connection, SQLQuery* get, SQLQuery* set)
 {
   stringstream sql;
   DbObject* obj;
+  std::list<MetadataJob*> results;
+  std::list<MetadataJob*> written;
+  std::list<MetadataJob*>::iterator iter;
+
+  unsigned int capacity = m_workers.size() * 4;
+  unsigned int batchSize = CSharedConfig::Shared()->databaseSettings->scanBatchSize();
+  unsigned int batchCount = 0;
+  unsigned int lastCommit = fuppesTicks();
+  unsigned int rows;
+  unsigned int found = 0;
+  object_id_t lastId = 0;
+  bool more = true;
+  bool famEvent = false;
 
   m_count = 0;
-  
-  // update metadata
-  sql << "select * from OBJECTS where TYPE > " << ITEM << " and (UPDATED_AT is NULL or UPDATED_AT < MODIFIED_AT) and DEVICE is NULL and REF_ID = 0";
-  get->select(sql.str());
-  if(get->eof()) {
+    
+  while(!stopRequested()) {
+
+    // check if a fam event occured recently.
+    // stop reading new items and let the workers finish their jobs
+    int diff = DateTime::now().toInt() - m_famHandler->lastEventTime().toInt();
+    if(diff < 5) {
+      famEvent = true;
+    }
+
+    // read the next items. we use a short select on the object id instead of a cursor
+    // so the query is not open while we write. the select runs outside of the
+    // write transaction
+    if(more && !famEvent && m_pending < capacity) {
+      sql.str("");
+      sql << "select * from OBJECTS where TYPE > " << ITEM << " and (UPDATED_AT is NULL or UPDATED_AT < MODIFIED_AT) and DEVICE is NULL and REF_ID = 0 and " <<
+        "OBJECT_ID > " << lastId << " order by OBJECT_ID limit " << (capacity - m_pending);
+      get->select(sql.str());
+
+      rows = 0;
+      while(!get->eof()) {
+        rows++;
+        obj = new DbObject(get->result());
+        lastId = obj->objectId();
+        if(!queueJob(obj))
+          delete obj;
+        get->next();
+      }
+      get->clear();
+
+      found += rows;
+      if(rows < (capacity - m_pending))
+        more = false;
+    }
+
+    if(m_pending == 0) {
+      if(!more || famEvent)
+        break;
+      continue;
+    }
+
+    // collect the results and write them batchwise
+    takeResults(&results, 500);
+    for(iter = results.begin(); iter != results.end(); iter++) {
+      m_pending--;
+      m_count++;
+      written.push_back(*iter);
+      batchCount++;
+    }
+    results.clear();
+
+    if(batchCount > 0 && (batchCount >= batchSize || m_pending == 0 || (fuppesTicks() - lastCommit) > 5000)) {
+      flush(connection, set, &written, (batchSize > 0));
+      batchCount = 0;
+      lastCommit = fuppesTicks();
+    }
+  }
+
+  flush(connection, set, &written, (batchSize > 0));
+
+  if(found == 0) {
     if(m_sleep < 4000)
       m_sleep += 500;
     return false;
   }
   m_sleep = 500;
   
-    
-  while(!get->eof() && !stopRequested()) {
+  return (m_count > 0);
+}
 
-    // check if a fam event occured recently
-    int diff = DateTime::now().toInt() - m_famHandler->lastEventTime().toInt();
-    if(diff < 5) {
-      return (m_count > 0);
+void UpdateThread::writeJob(MetadataJob* job, SQLQuery* qry)
+{
+  DbObject* obj = job->object;
+
+  FUPPES_LOG(Log::contentdb, Log::extended, "update object %d :: %s", m_count, obj->fileName().c_str());
+
+  if(job->saveDetails) {
+    job->details.save(qry);
+    obj->setDetailId(job->details.id());
+  }
+  if(!job->title.empty())
+    obj->setTitle(job->title);
+  obj->setUpdated();
+  obj->save(qry);
+}
+
+void UpdateThread::flush(CDatabaseConnection* connection, SQLQuery* qry, std::list<MetadataJob*>* written, bool transaction)
+{
+  if(written->empty())
+    return;
+
+  // the transaction takes the write lock when it starts. so it is only
+  // open while we write and not while the workers extract the metadata
+  std::list<MetadataJob*>::iterator iter;
+  if(transaction)
+    connection->startTransaction();
+  for(iter = written->begin(); iter != written->end(); iter++) {
+    writeJob(*iter, qry);
+  }
+  // a failed batch has been rolled back. the objects are still
+  // outdated so the next run extracts and writes them again
+  if(transaction && !connection->commit()) {
+    Log::log(Log::contentdb, Log::normal, __FILE__, __LINE__, "writing %d objects failed. retrying on the next update", (int)written->size());
+    for(iter = written->begin(); iter != written->end(); iter++) {
+      delete (*iter)->object;
+      delete *iter;
     }
-      
-    m_count++;
-    obj = new DbObject(get->result());
+    written->clear();
+    return;
+  }
 
-    cout << "update object " << m_count << " of " << get->size() << " :: " << obj->fileName() << endl;
-      
-    // container
-    if(obj->type() < CONTAINER_MAX) {
-
-    } // container
-    else if(obj->type() >= ITEM) {
-
-      ObjectDetails oldDetails;
-      bool update = (obj->detailId() > 0);
-      if(update)
-        oldDetails = *obj->details();
-
-      switch(obj->type()) {
-
-        case ITEM_IMAGE_ITEM:
-        case ITEM_IMAGE_ITEM_PHOTO:
-          updateImageFile(obj, set);
-          if(!update)
-            VirtualContainerMgr::insertFile(obj);
-          else
-            VirtualContainerMgr::updateFile(obj, &oldDetails);
-          break;
-
-        case ITEM_AUDIO_ITEM:
-        case ITEM_AUDIO_ITEM_MUSIC_TRACK:
-          updateAudioFile(obj, set);
-          if(!update)
-            VirtualContainerMgr::insertFile(obj);
-          else
-            VirtualContainerMgr::updateFile(obj, &oldDetails);
-          break;
-        case ITEM_AUDIO_ITEM_AUDIO_BROADCAST:
-          break;
-
-        case ITEM_VIDEO_ITEM:
-        case ITEM_VIDEO_ITEM_MOVIE:
-        case ITEM_VIDEO_ITEM_MUSIC_VIDEO_CLIP:
-          updateVideoFile(obj, set);
-          if(!update)
-            VirtualContainerMgr::insertFile(obj);
-          else
-            VirtualContainerMgr::updateFile(obj, &oldDetails);
-          break;
-        case ITEM_VIDEO_ITEM_VIDEO_BROADCAST:
-          break;
-
-        default:
-          break;          
-      }
+  // the virtual container manager uses the shared connection.
+  // so we have to wait until our transaction is committed
+  for(iter = written->begin(); iter != written->end(); iter++) {
+    if(!(*iter)->update)
+      VirtualContainerMgr::insertFile((*iter)->object);
+    else
+      VirtualContainerMgr::updateFile((*iter)->object, &(*iter)->oldDetails);
 
-    } // item
-      
-    delete obj;
-    get->next();
-    msleep(1);
-  } // while !eof
+    if((*iter)->saveDetails)
+      m_thumbnails.add((*iter)->object, &(*iter)->details);
 
-  return (m_count > 0);
+    delete (*iter)->object;
+    delete *iter;
+  }
+  written->clear();
 }
 
 
@@ -431,31 +691,20 @@ bool UpdateThread::updateItems(CDatabaseConnection* connection, SQLQuery* get, S
 
 
 
-void UpdateThread::updateAudioFile(DbObject* obj, SQLQuery* qry)
+void UpdateThread::extractAudioFile(MetadataJob* job)
 {
+  DbObject* obj = job->object;
   string fileName = obj->path() + obj->fileName();
   AudioItem audioItem;
-  //cout << "UPDATE AUDIO FILE: " << fileName << endl;
 
-  bool gotMetadata = true;
-	gotMetadata = CFileDetails::getMusicTrackDetails(fileName, &audioItem);
+  bool gotMetadata = CFileDetails::getMusicTrackDetails(fileName, &audioItem);
 
-  unsigned int objectId = obj->objectId(); // CContentDatabase::GetObjId();
-	unsigned int imgId = 0;
-  
-	string imgMimeType;
-	if(audioItem.hasImage()) {
-		imgId = objectId;
-		imgMimeType = audioItem.imageMimeType();
-	}
-
-  ObjectDetails details;
+  ObjectDetails& details = job->details;
   details.setSize(getFileSize(fileName));
   if(gotMetadata) {
     details = audioItem;
   }
 
-  
   if(audioItem.hasImage()) {
     details.setAlbumArtId(obj->objectId());
 
@@ -466,70 +715,38 @@ void UpdateThread::updateAudioFile(DbObject* obj, SQLQuery* qry)
     details.setAlbumArtHeight(audioItem.imageHeight());
   }
 
-  details.save(qry);
-
-  if(!audioItem.title().empty())
-    obj->setTitle(audioItem.title());
-  obj->setDetailId(details.id());
-  obj->save(qry);  
+  job->saveDetails = true;
+  job->title = audioItem.title();
 }
 
-void UpdateThread::updateImageFile(DbObject* obj, SQLQuery* qry)
+void UpdateThread::extractImageFile(MetadataJob* job)
 {
+  DbObject* obj = job->object;
   string fileName = obj->path() + obj->fileName();
-  cout << "UPDATE IMAGE FILE: " << fileName << endl;
 
   ImageItem imageItem;
   bool gotMetadata = CFileDetails::getImageDetails(fileName, &imageItem);
 
+  // just mark the object as updated
   if(!gotMetadata) {
-    obj->setUpdated();
-    obj->save();
     return;
   }
-  
-  /*string dlna;
-	string mimeType;
-	string ext = ExtractFileExt(fileName);
-	if(CPluginMgr::dlnaPlugin()) {
-		CPluginMgr::dlnaPlugin()->getImageProfile(ext, imageItem.width(), imageItem.height(), &dlna, &mimeType);
-	}*/
-
-  ObjectDetails details;
-  details = imageItem;
-  details.setSize(getFileSize(fileName));
-  details.save(qry);
-  
-  obj->setDetailId(details.id());
-  obj->save(qry);
-  
-	/*stringstream sSql;
-	sSql << 
-	  "insert into OBJECT_DETAILS " <<
-		"(SIZE, IV_WIDTH, IV_HEIGHT, DATE, " <<
-		"DLNA_PROFILE, DLNA_MIME_TYPE) " <<
-		"values (" <<
-		getFileSize(fileName) << ", " <<
-		ImageItem.nWidth << ", " <<
-		ImageItem.nHeight << ", " <<
-   (ImageItem.sDate.empty() ? "NULL" : "'" + ImageItem.sDate + "'") << ", " <<
-    "'" << dlna << "', " <<
-		"'" << mimeType << "')";
-	
-  return qry->insert(sSql.str()); */ 
-  
+
+  job->details = imageItem;
+  job->details.setSize(getFileSize(fileName));
+  job->saveDetails = true;
 }
 
 
-void UpdateThread::updateVideoFile(DbObject* obj, SQLQuery* qry)
+void UpdateThread::extractVideoFile(MetadataJob* job)
 {
+  DbObject* obj = job->object;
   string fileName = obj->path() + obj->fileName();
-  cout << "UPDATE VIDEO FILE: " << fileName << endl;
   
   VideoItem videoItem;
 	bool gotMetadata = CFileDetails::getVideoDetails(fileName, &videoItem);
 
-  ObjectDetails details;
+  ObjectDetails& details = job->details;
   details.setSize(getFileSize(fileName));
 
   // check for subtitles
@@ -540,12 +757,6 @@ void UpdateThread::updateVideoFile(DbObject* obj, SQLQuery* qry)
   if(gotMetadata) {
     details = videoItem;
   }
-  details.save(qry);
-  
-  obj->setDetailId(details.id());
-  //if(!videoItem.title().empty())
-  //  obj->setTitle(videoItem.title());
-  obj->setUpdated();
-  obj->save(qry);
-}
 
+  job->saveDetails = true;
+}
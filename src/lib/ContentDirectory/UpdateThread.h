@@ -34,11 +34,72 @@
 #include "DatabaseConnection.h"
 #include "DatabaseObject.h"
 #include "FileAlterationHandler.h"
+#include "ThumbnailGenerator.h"
+
+#include <list>
+#include <vector>
 
 namespace fuppes {
+
+class UpdateThread;
+
+/**
+ * an item whose metadata is extracted by a MetadataWorker.
+ * the reader creates the job, a worker fills in the details and
+ * the writer saves them
+ */
+struct MetadataJob
+{
+  enum Kind {
+    Audio,
+    Image,
+    Video
+  };
+
+  MetadataJob() {
+    object = NULL;
+    update = false;
+    saveDetails = false;
+  }
+
+  Kind          kind;
+  DbObject*     object;
+  // the details before the update. only valid if update is true
+  ObjectDetails oldDetails;
+  bool          update;
+
+  // set by the worker
+  ObjectDetails details;
+  bool          saveDetails;
+  std::string   title;
+};
+
+/**
+ * takes jobs from the UpdateThread, reads the file's metadata
+ * and passes the job back. workers never touch the database
+ */
+class MetadataWorker: public Thread
+{
+  public:
+    MetadataWorker(UpdateThread* owner);
+    ~MetadataWorker();
+
+  private:
+    void run();
+
+    UpdateThread* m_owner;
+};
+
   
+/**
+ * the update thread reads the objects that need an update from the database,
+ * passes them to a pool of MetadataWorker threads and saves the results
+ * in batched transactions on its own connection
+ */
 class UpdateThread: public Thread
 {
+  friend class MetadataWorker;
+
   public:
     UpdateThread(FileAlterationHandler* famHandler);
     ~UpdateThread();
@@ -47,15 +108,52 @@ class UpdateThread: public Thread
 		void run();
 
     bool updateItems(CDatabaseConnection* connection, SQLQuery* get, SQLQuery* set);
-    
-    void updateAudioFile(DbObject* obj, SQLQuery* qry);
-    void updateVideoFile(DbObject* obj, SQLQuery* qry);
-    void updateImageFile(DbObject* obj, SQLQuery* qry);
+
+    // reader. returns false if the object needs no metadata update
+    bool queueJob(DbObject* obj);
+    // writer
+    void writeJob(MetadataJob* job, SQLQuery* qry);
+    // writes the results in one transaction and updates the virtual folders of the written objects
+    void flush(CDatabaseConnection* connection, SQLQuery* qry, std::list<MetadataJob*>* written, bool transaction);
+
+    // worker side
+    MetadataJob* takeJob(unsigned int timeoutMs);
+    void finishJob(MetadataJob* job);
+    // returns the number of ms the worker has to wait before reading the next file
+    unsigned int reserveSlot();
+
+    // waits for finished jobs and moves them to results
+    void takeResults(std::list<MetadataJob*>* results, unsigned int timeoutMs);
+
+    void startWorkers();
+    void stopWorkers();
+
+    static void extractAudioFile(MetadataJob* job);
+    static void extractVideoFile(MetadataJob* job);
+    static void extractImageFile(MetadataJob* job);
 
 
     FileAlterationHandler* m_famHandler;
+    // the virtual folder layouts have been checked against their .cfg files
+    bool m_layoutsChecked;
     int m_count;
     int m_sleep;
+
+    Mutex                       m_mutex;
+    Condition*                  m_jobCondition;
+    Condition*                  m_resultCondition;
+    std::list<MetadataJob*>     m_jobs;
+    std::list<MetadataJob*>     m_results;
+    // jobs queued or in process. only used by the update thread
+    unsigned int                m_pending;
+    std::vector<MetadataWorker*> m_workers;
+
+    // pre-renders the thumbnails of the written items
+    ThumbnailGenerator          m_thumbnails;
+
+    // i/o throttling
+    unsigned int                m_interval;
+    unsigned int                m_nextSlot;
 };
 
 
@@ -32,6 +32,7 @@
 #include "../SharedConfig.h"
 #include "../SharedLog.h"
 #include <iostream>
+#include <algorithm>
 #include <time.h>
 
 
@@ -71,7 +72,9 @@ bool CVirtualContainerMgr::IsRebuilding()
 }    
 
 
-bool CVirtualContainerMgr::HandleFile(std::string device, std::string file, SQLQuery* qry)
+static void layoutEntries(CXMLNode* node, std::string parentKey, std::vector<std::string>* entries);
+
+bool CVirtualContainerMgr::HandleFile(std::string device, std::string file, SQLQuery* qry, bool insertFiles, bool changedOnly)
 {
   assert(!file.empty());
 
@@ -79,29 +82,67 @@ bool CVirtualContainerMgr::HandleFile(std::string device, std::string file, SQLQ
   CSharedLog::Print("[VirtualContainer] load '%s'", file.c_str());
   
   CXMLDocument doc;
-  if(doc.LoadFromFile(file)) {
-    CXMLNode* root = doc.RootNode();
-    if(root->Attribute("version").compare(VFOLDER_CFG_VERSION) == 0 &&
-       root->Name().compare("vfolder_layout") == 0) {
-      //CreateChildItems(root, qry, device, 0, NULL);
-      createLayout(root, 0, qry, device);
-    } else {
-      CSharedLog::Print("[VirtualContainer] '%s' has an invalid version number %s when it should be %s. Please get a more recent config file, or (if you know what you are doing) you can update it yourself.", file.c_str(), root->Attribute("version").c_str(), VFOLDER_CFG_VERSION.c_str());
-      return false;
-    }
-  } else {
+  if(!doc.LoadFromFile(file)) {
     CSharedLog::Print("[VirtualContainer] failed to load '%s' virtual configuration file: Invalid XML.", file.c_str());
     return false;
   }
 
+  CXMLNode* root = doc.RootNode();
+  if(root->Attribute("version").compare(VFOLDER_CFG_VERSION) != 0 ||
+     root->Name().compare("vfolder_layout") != 0) {
+    CSharedLog::Print("[VirtualContainer] '%s' has an invalid version number %s when it should be %s. Please get a more recent config file, or (if you know what you are doing) you can update it yourself.", file.c_str(), root->Attribute("version").c_str(), VFOLDER_CFG_VERSION.c_str());
+    return false;
+  }
 
+  // the files are kept up to date incrementally. so on start-up the
+  // layout only has to be rebuilt if its structure has changed.
+  // a rebuild requested by the user always recreates the layout
+  VirtualLayout* layout = VirtualContainerMgr::layout(device);
+  std::vector<std::string> entries;
+  if(changedOnly) {
+    layoutEntries(root, "", &entries);
+    std::sort(entries.begin(), entries.end());
+  }
+  if(changedOnly && entries == layout->entries()) {
+    CSharedLog::Print("[VirtualContainer] layout '%s' is unchanged", device.c_str());
+    return false;
+  }
+
+  unsigned int start = fuppesTicks();
+
+  // drop the layout's folders and files
+  stringstream sql;
+  sql << "delete from OBJECT_DETAILS where ID in (select DETAIL_ID from OBJECTS where " <<
+    "DEVICE = '" << SQLEscape(device) << "' and TYPE < " << ITEM << ")";
+  qry->exec(sql.str());
+  qry->exec("delete from OBJECTS where DEVICE = '" + SQLEscape(device) + "'");
+
+  createLayout(root, 0, qry, device);
+  layout->load(qry);
+
+  unsigned int count = 0;
+  if(insertFiles) {
+    sql.str("");
+    sql << "select * from OBJECTS where DEVICE is NULL and REF_ID = 0 and TYPE > " << ITEM;
+    DbObject* obj;
+    qry->select(sql.str());
+    while(!qry->eof()) {
+      obj = new DbObject(qry->result());
+      VirtualContainerMgr::insertFileForLayout(obj, layout);
+      delete obj;
+      count++;
+      qry->next();
+    }
+  }
+
+  CSharedLog::Print("[VirtualContainer] layout '%s' rebuilt in %u ms (%u files)", device.c_str(), fuppesTicks() - start, count);
   return true;
 }
 
 
 
 
-void CVirtualContainerMgr::RebuildContainerList(bool force /*= false*/, bool insertFiles /*= true*/)
+void CVirtualContainerMgr::RebuildContainerList(bool force /*= false*/, bool insertFiles /*= true*/, bool changedOnly /*= false*/)
 {
   if(!force && CContentDatabase::Shared()->IsRebuilding()) {
     CSharedLog::Log(L_NORM, __FILE__, __LINE__, "database rebuild in progress");
@@ -111,49 +152,43 @@ void CVirtualContainerMgr::RebuildContainerList(bool force /*= false*/, bool ins
   fuppes::DateTime start = DateTime::now();
   CSharedLog::Print("[VirtualContainer] create virtual container layout started at %s", start.toString().c_str());
 
-  // drop all virtual folders and files
-	SQLQuery qry;
-  qry.exec("delete from OBJECTS where DEVICE is NOT NULL;");
-  qry.connection()->vacuum();
+  MutexLocker locker(&VirtualContainerMgr::m_mutex);
 
+  // the database may have been cleared since the indexes were loaded
+  VirtualContainerMgr::resetLayouts();
 
+  // drop the layouts that are no longer enabled
+	SQLQuery qry;
   StringList vfolders = CSharedConfig::Shared()->virtualFolders()->getEnabledFolders();
+  stringstream where;
+  where << "DEVICE is NOT NULL";
+  for(unsigned int i = 0; i < vfolders.size(); i++) {
+    where << " and DEVICE <> '" << SQLEscape(vfolders.at(i)) << "'";
+  }
+  stringstream sql;
+  sql << "delete from OBJECT_DETAILS where ID in (select DETAIL_ID from OBJECTS where " <<
+    where.str() << " and TYPE < " << ITEM << ")";
+  qry.exec(sql.str());
+  qry.exec("delete from OBJECTS where " + where.str());
+
+  bool rebuilt = false;
   for(unsigned int i = 0; i < vfolders.size(); i++) {
     
     string file = CSharedConfig::Shared()->pathFinder->findVFolderInPath(vfolders.at(i));
     if(!file.empty()) {
       CSharedLog::Print("[VirtualContainer] read vfolder layout from '%s'.", (vfolders.at(i) + VFOLDER_EXT).c_str());
-      HandleFile(vfolders.at(i), file, &qry);
+      if(HandleFile(vfolders.at(i), file, &qry, insertFiles, changedOnly))
+        rebuilt = true;
     } else {
       CSharedLog::Print("[VirtualContainer] '%s' could not be found in the path.", (vfolders.at(i) + VFOLDER_EXT).c_str());
     }
   }
 
-
-  if(!insertFiles) {
-    fuppes::DateTime end = DateTime::now();
-    CSharedLog::Print("[VirtualContainer] virtual container layout created at %s", end.toString().c_str());
-    return;
-  }
-  
-
-  // insert files
-  stringstream sql;
-  sql << "select * from OBJECTS where DEVICE is NULL and REF_ID = 0 and TYPE > " << ITEM;
-  DbObject* obj;
-  qry.select(sql.str());
-  while(!qry.eof()) {
-
-    obj = new DbObject(qry.result());
-    VirtualContainerMgr::insertFile(obj);
-    delete obj;        
-    qry.next();
-  }
-
+  if(rebuilt)
+    qry.connection()->vacuum();
 
   fuppes::DateTime end = DateTime::now();
   CSharedLog::Print("[VirtualContainer] virtual container layout created at %s", end.toString().c_str());
-
 }
 
 
@@ -267,6 +302,47 @@ std::string createVFolderPath(CXMLNode* node)
   
 }
 
+// the split folders. the list is terminated by an empty string
+static std::string splitFolders[] = {
+  "0-9", "ABC", "DEF", "GHI", "JKL",
+  "MNO" , "PQR", "STU", "VWX", "YZ",
+  "!?#",
+  ""};
+
+// identifies a vfolder or split folder by its position in the layout
+static std::string layoutKey(std::string parentKey, std::string title, DbObject::VirtualContainerType type, std::string path)
+{
+  stringstream key;
+  key << parentKey << "/" << title << "|" << type << "|" << path;
+  return key.str();
+}
+
+// collects the folders createLayout() would create
+static void layoutEntries(CXMLNode* node, std::string parentKey, std::vector<std::string>* entries)
+{
+  if(node->type() != CXMLNode::ElementNode)
+    return;
+
+  if(node->name().compare("vfolder_layout") == 0) {
+    for(int i = 0; i < node->ChildCount(); i++) {
+      layoutEntries(node->ChildNode(i), parentKey, entries);
+    }
+  }
+  else if(node->name().compare("vfolder") == 0) {
+    std::string key = layoutKey(parentKey, node->attribute("name"), DbObject::Folder, createVFolderPath(node));
+    entries->push_back(key);
+    for(int i = 0; i < node->ChildCount(); i++) {
+      layoutEntries(node->ChildNode(i), key, entries);
+    }
+  }
+  else if(node->name().compare("split") == 0) {
+    std::string path = createVFolderPath(node->parent());
+    for(int i = 0; splitFolders[i].length() > 0; i++) {
+      entries->push_back(layoutKey(parentKey, splitFolders[i], DbObject::Split, path));
+    }
+  }
+}
+
 void CVirtualContainerMgr::createLayout(CXMLNode* node, object_id_t pid, SQLQuery* qry, std::string layout)
 {
   if(node->type() != CXMLNode::ElementNode)
@@ -314,18 +390,12 @@ void CVirtualContainerMgr::createLayout(CXMLNode* node, object_id_t pid, SQLQuer
   else if(node->name().compare("split") == 0) {
     
     std::string path = createVFolderPath(node->parent());
-    string folders[] = {
-    "0-9", "ABC", "DEF", "GHI", "JKL",
-    "MNO" , "PQR", "STU", "VWX", "YZ",
-    "!?#",
-    ""};      
-
-    for(int i = 0; folders[i].length() > 0; i++) {
+    for(int i = 0; splitFolders[i].length() > 0; i++) {
       folder.reset();
       folder.setObjectId(GetId());
       folder.setParentId(pid);
       folder.setType(CONTAINER_STORAGE_FOLDER);
-      folder.setTitle(folders[i]);
+      folder.setTitle(splitFolders[i]);
       folder.setDevice(layout);
       folder.setVirtualContainerType(DbObject::Split);
       folder.setVirtualContainerPath(path);
@@ -474,11 +544,188 @@ void CVirtualContainerMgr::MapSharedDirsTo(CXMLNode* pNode,
 
 
 
+VirtualLayout::VirtualLayout(std::string name)
+{
+  m_name = name;
+}
+
+void VirtualLayout::load(SQLQuery* qry)
+{
+  m_containers.clear();
+  m_folders.clear();
+  m_splits.clear();
+  m_children.clear();
+
+  stringstream sql;
+  sql << "select OBJECT_ID, PARENT_ID, VCONTAINER_TYPE, VCONTAINER_PATH, TITLE from OBJECTS where " <<
+    "DEVICE = '" << SQLEscape(m_name) << "' and " <<
+    "TYPE < " << ITEM << " and " <<
+    "VCONTAINER_TYPE > " << DbObject::None;
+
+  Container container;
+  qry->select(sql.str());
+  while(!qry->eof()) {
+    container.parentId = qry->result()->asUInt("PARENT_ID");
+    container.type = (DbObject::VirtualContainerType)qry->result()->asInt("VCONTAINER_TYPE");
+    container.path = qry->result()->asString("VCONTAINER_PATH");
+    container.title = qry->result()->asString("TITLE");
+    add(qry->result()->asUInt("OBJECT_ID"), container);
+    qry->next();
+  }
+}
+
+std::vector<std::string> VirtualLayout::paths(std::string itemType)
+{
+  std::vector<std::string> result;
+  std::map<std::string, object_id_t>::iterator iter;
+  for(iter = m_folders.begin(); iter != m_folders.end(); iter++) {
+    if(iter->first.find(itemType) != std::string::npos)
+      result.push_back(iter->first);
+  }
+  return result;
+}
+
+object_id_t VirtualLayout::folder(std::string path)
+{
+  std::map<std::string, object_id_t>::iterator iter = m_folders.find(path);
+  return (iter != m_folders.end() ? iter->second : 0);
+}
+
+object_id_t VirtualLayout::split(object_id_t pid, std::string character)
+{
+  std::map<object_id_t, std::vector<object_id_t> >::iterator iter = m_splits.find(pid);
+  if(iter == m_splits.end())
+    return 0;
+
+  // umlauts and other special characters go into the '!?#' folder
+  object_id_t other = 0;
+  std::string title;
+  for(size_t i = 0; i < iter->second.size(); i++) {
+    title = m_containers[iter->second[i]].title;
+    if(title.find(character) != std::string::npos)
+      return iter->second[i];
+    if(title.find("#") != std::string::npos)
+      other = iter->second[i];
+  }
+  return other;
+}
+
+object_id_t VirtualLayout::child(object_id_t pid, DbObject::VirtualContainerType type, std::string path, std::string title)
+{
+  std::map<std::string, object_id_t>::iterator iter = m_children.find(childKey(pid, type, path, title));
+  return (iter != m_children.end() ? iter->second : 0);
+}
+
+void VirtualLayout::add(DbObject* container)
+{
+  Container entry;
+  entry.parentId = container->parentId();
+  entry.type = container->vcType();
+  entry.path = container->vcPath();
+  entry.title = container->title();
+  add(container->objectId(), entry);
+}
+
+void VirtualLayout::add(object_id_t objectId, Container container)
+{
+  m_containers[objectId] = container;
+
+  if(container.type == DbObject::Folder) {
+    if(m_folders.find(container.path) == m_folders.end())
+      m_folders[container.path] = objectId;
+  }
+  else if(container.type == DbObject::Split) {
+    m_splits[container.parentId].push_back(objectId);
+  }
+  else if(container.type >= DbObject::Genre) {
+    m_children[childKey(container.parentId, container.type, container.path, container.title)] = objectId;
+  }
+}
+
+void VirtualLayout::remove(object_id_t objectId)
+{
+  std::map<object_id_t, Container>::iterator iter = m_containers.find(objectId);
+  if(iter == m_containers.end())
+    return;
+
+  Container* container = &iter->second;
+  if(container->type == DbObject::Folder) {
+    if(folder(container->path) == objectId)
+      m_folders.erase(container->path);
+  }
+  else if(container->type == DbObject::Split) {
+    std::vector<object_id_t>* splits = &m_splits[container->parentId];
+    splits->erase(std::remove(splits->begin(), splits->end(), objectId), splits->end());
+  }
+  else if(container->type >= DbObject::Genre) {
+    m_children.erase(childKey(container->parentId, container->type, container->path, container->title));
+  }
+
+  m_containers.erase(iter);
+}
+
+std::vector<std::string> VirtualLayout::entries()
+{
+  std::vector<std::string> result;
+  std::map<object_id_t, Container>::iterator iter;
+  for(iter = m_containers.begin(); iter != m_containers.end(); iter++) {
+    if(iter->second.type == DbObject::Folder || iter->second.type == DbObject::Split)
+      result.push_back(entryKey(iter->first));
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+std::string VirtualLayout::childKey(object_id_t pid, DbObject::VirtualContainerType type, std::string path, std::string title)
+{
+  // the TITLE column is case insensitive
+  stringstream key;
+  key << pid << "|" << type << "|" << path << "|" << ToLower(title);
+  return key.str();
+}
+
+std::string VirtualLayout::entryKey(object_id_t objectId)
+{
+  std::map<object_id_t, Container>::iterator iter = m_containers.find(objectId);
+  if(iter == m_containers.end())
+    return "";
+  return layoutKey(entryKey(iter->second.parentId), iter->second.title, iter->second.type, iter->second.path);
+}
+
+
+
+fuppes::Mutex                           VirtualContainerMgr::m_mutex;
+std::map<std::string, VirtualLayout*>  VirtualContainerMgr::m_layouts;
+
+VirtualLayout* VirtualContainerMgr::layout(std::string name) // static
+{
+  std::map<std::string, VirtualLayout*>::iterator iter = m_layouts.find(name);
+  if(iter != m_layouts.end())
+    return iter->second;
+
+  SQLQuery qry;
+  VirtualLayout* result = new VirtualLayout(name);
+  result->load(&qry);
+  m_layouts[name] = result;
+  return result;
+}
+
+void VirtualContainerMgr::resetLayouts() // static
+{
+  std::map<std::string, VirtualLayout*>::iterator iter;
+  for(iter = m_layouts.begin(); iter != m_layouts.end(); iter++) {
+    delete iter->second;
+  }
+  m_layouts.clear();
+}
+
 void VirtualContainerMgr::insertFile(fuppes::DbObject* object) // static
 {
+  MutexLocker locker(&m_mutex);
+
   StringList vfolders = CSharedConfig::Shared()->virtualFolders()->getEnabledFolders();
   for(unsigned int i = 0; i < vfolders.size(); i++) {  
-    insertFileForLayout(object, vfolders.at(i));
+    insertFileForLayout(object, layout(vfolders.at(i)));
   }
 }
 
@@ -489,7 +736,7 @@ void VirtualContainerMgr::insertFile(fuppes::DbObject* object) // static
  childType    property type of the split children
  layout       the virtual layout
 */
-object_id_t getSplitParent(object_id_t pid, DbObject* object, std::string childType, std::string layout)
+object_id_t getSplitParent(object_id_t pid, DbObject* object, std::string childType, VirtualLayout* layout)
 {
   string title;
   if(childType.compare("genre") == 0) {    
@@ -517,40 +764,14 @@ object_id_t getSplitParent(object_id_t pid, DbObject* object, std::string childT
     title = "0-9";
   
 #warning todo: handle umlauts and other special characters
-  
-  SQLQuery qry;
-  stringstream sql;
-  sql << "select OBJECT_ID from OBJECTS where " <<
-    "PARENT_ID = " << pid << " and " <<
-    "TITLE like '%" << title << "%' and " <<
-    "DEVICE = '" << layout << "'";
-
-  //cout << sql.str() << endl;
-  qry.select(sql.str());
-
-
-  // this is a quick fix to handle umlauts and other special characters
-  // it's not a clean solution because umlauts will go into the '!?#' folder
-  // instead of e.g A-C for the a-umlaut.
-  if(qry.size() == 0) {
-
-    sql.str("");
-    sql << "select OBJECT_ID from OBJECTS where " <<
-      "PARENT_ID = " << pid << " and " <<
-      "TITLE like '%" << "#" << "%' and " <<
-      "DEVICE = '" << layout << "'";
 
-    qry.select(sql.str());
-  }
-  
-
-  ASSERT(qry.size() == 1);
-
-  return qry.result()->asUInt("OBJECT_ID");
+  object_id_t result = layout->split(pid, title);
+  ASSERT(result != 0);
+  return result;
 }
 
 
-void VirtualContainerMgr::insertFileForLayout(fuppes::DbObject* object, std::string layout) // static
+void VirtualContainerMgr::insertFileForLayout(fuppes::DbObject* object, VirtualLayout* layout) // static
 {
   string path;
   switch(object->type()) {
@@ -571,17 +792,8 @@ void VirtualContainerMgr::insertFileForLayout(fuppes::DbObject* object, std::str
       break;
   }
 
-
-  SQLQuery qry;
-  stringstream sql;
-  
   // get all paths containing the item type
-  StringList paths;
-  qry.select("select distinct(VCONTAINER_PATH) from OBJECTS where VCONTAINER_PATH like '%" + path + "%' and DEVICE = '" + layout + "'");
-  while(!qry.eof()) {
-    paths.push_back(qry.result()->asString("VCONTAINER_PATH"));
-    qry.next();
-  }
+  std::vector<std::string> paths = layout->paths(path);
   
   StringList parts;
   object_id_t pid;
@@ -591,15 +803,8 @@ void VirtualContainerMgr::insertFileForLayout(fuppes::DbObject* object, std::str
     ASSERT(parts.at(0) == "folder");
     
     // get folder id
-    sql << "select OBJECT_ID from OBJECTS where " <<
-      "VCONTAINER_TYPE = " << DbObject::Folder << " and " <<
-      "VCONTAINER_PATH = '" << paths.at(i) << "' and " <<
-      "DEVICE = '" + layout + "'";
-    qry.select(sql.str());
-    sql.str("");
-    ASSERT(qry.size() == 1);
-    
-    pid = qry.result()->asUInt("OBJECT_ID");
+    pid = layout->folder(paths.at(i));
+    ASSERT(pid != 0);
     
     // loop through the parts of the path
     // except for the first item (folder) and the last (audioItem)
@@ -644,7 +849,7 @@ void VirtualContainerMgr::insertFileForLayout(fuppes::DbObject* object, std::str
     DbObject file(object);
     file.setObjectId(CVirtualContainerMgr::Shared()->GetId());
     file.setParentId(pid);
-    file.setDevice(layout);
+    file.setDevice(layout->name());
     file.setVirtualContainerPath(paths.at(i));
     file.setVirtualRefId(object->objectId());
     file.setRefId(refId);
@@ -666,7 +871,7 @@ object_id_t VirtualContainerMgr::createFolderIfNotExists(DbObject* object,
                                                          object_id_t pid, 
                                                          DbObject::VirtualContainerType type, 
                                                          std::string path, 
-                                                         std::string layout) // static
+                                                         VirtualLayout* layout) // static
 {
   string title;
   OBJECT_TYPE objType = CONTAINER_STORAGE_FOLDER;
@@ -695,21 +900,9 @@ object_id_t VirtualContainerMgr::createFolderIfNotExists(DbObject* object,
   if(title.length() == 0)
     title = "unknown";
   
-  SQLQuery qry;
-  stringstream sql;
-  sql << "select OBJECT_ID from OBJECTS where "
-    "PARENT_ID = " << pid << " and " <<
-    "VCONTAINER_TYPE = " << type << " and " <<
-    "VCONTAINER_PATH = '" << path << "' and " <<
-    "TITLE = '" << SQLEscape(title) << "' and " <<
-    "DEVICE = '" << layout << "'";
-  qry.select(sql.str());
-
-  ASSERT(qry.size() == 0 || qry.size() == 1);
-
-  if(qry.size() == 1) {
-    //cout << "FOLDER *" << title << "* exists : id: " << qry.result()->asUInt("OBJECT_ID") << endl;
-    return qry.result()->asUInt("OBJECT_ID");
+  object_id_t objectId = layout->child(pid, type, path, title);
+  if(objectId > 0) {
+    return objectId;
   }
   
 
@@ -721,7 +914,7 @@ object_id_t VirtualContainerMgr::createFolderIfNotExists(DbObject* object,
   folder.setTitle(title);
   folder.setVirtualContainerType(type);
   folder.setVirtualContainerPath(path);
-  folder.setDevice(layout);
+  folder.setDevice(layout->name());
 
   /* todo set metadata for artist, composer or album folders
   switch(type) {
@@ -740,6 +933,7 @@ object_id_t VirtualContainerMgr::createFolderIfNotExists(DbObject* object,
   
   folder.setDetailId(details.id());
   folder.save();
+  layout->add(&folder);
 
   //cout << "createFolderIfNotExists" << endl << DbObject::toString(&folder) << endl;
   
@@ -751,7 +945,7 @@ object_id_t VirtualContainerMgr::createFolderIfNotExists(DbObject* object,
 object_id_t VirtualContainerMgr::createSharedDirFoldersIfNotExist(DbObject* object, 
                                                                   object_id_t pid,
                                                                   std::string path, 
-                                                                  std::string layout)
+                                                                  VirtualLayout* layout)
 {
   // get the object parents up to the first level (pid == 0) in reverse order
   SQLQuery qry;
@@ -764,25 +958,15 @@ object_id_t VirtualContainerMgr::createSharedDirFoldersIfNotExist(DbObject* obje
   }
 
   // loop through the parents and create a virtual copy if none exists
-  stringstream sql;
+  object_id_t objectId;
   std::list<DbObject*>::iterator it;
   for(it = parents.begin(); it != parents.end(); it++) {
     DbObject* parent = *it;
 
-    sql.str("");
-    sql << "select OBJECT_ID from OBJECTS where "
-      "PARENT_ID = " << pid << " and " <<
-      "VCONTAINER_TYPE = " << DbObject::SharedDir << " and " <<
-      "VCONTAINER_PATH = '" << path << "' and " <<
-      "TITLE = '" << SQLEscape(parent->title()) << "' and " <<
-      "DEVICE = '" << layout << "'";
-    qry.select(sql.str());
-    
-    ASSERT(qry.size() == 0 || qry.size() == 1);
-
     // folder exists
-    if(qry.size() == 1) {
-      pid = qry.result()->asUInt("OBJECT_ID");
+    objectId = layout->child(pid, DbObject::SharedDir, path, parent->title());
+    if(objectId > 0) {
+      pid = objectId;
       delete parent;
       continue;
     }
@@ -795,8 +979,9 @@ object_id_t VirtualContainerMgr::createSharedDirFoldersIfNotExist(DbObject* obje
     folder.setTitle(parent->title());
     folder.setVirtualContainerType(DbObject::SharedDir);
     folder.setVirtualContainerPath(path);
-    folder.setDevice(layout);
+    folder.setDevice(layout->name());
     folder.save();
+    layout->add(&folder);
 
     pid = folder.objectId();
 
@@ -808,13 +993,15 @@ object_id_t VirtualContainerMgr::createSharedDirFoldersIfNotExist(DbObject* obje
 
 void VirtualContainerMgr::updateFile(fuppes::DbObject* object, fuppes::ObjectDetails* oldDetails) // static
 {
+  MutexLocker locker(&m_mutex);
+
   StringList vfolders = CSharedConfig::Shared()->virtualFolders()->getEnabledFolders();
   for(unsigned int i = 0; i < vfolders.size(); i++) {  
-    updateFileForLayout(object, oldDetails, vfolders.at(i));
+    updateFileForLayout(object, oldDetails, layout(vfolders.at(i)));
   }
 }
 
-void VirtualContainerMgr::updateFileForLayout(fuppes::DbObject* object, fuppes::ObjectDetails* oldDetails, std::string layout) // static
+void VirtualContainerMgr::updateFileForLayout(fuppes::DbObject* object, fuppes::ObjectDetails* oldDetails, VirtualLayout* layout) // static
 {
   deleteFileForLayout(object, layout);
   insertFileForLayout(object, layout);
@@ -823,9 +1010,11 @@ void VirtualContainerMgr::updateFileForLayout(fuppes::DbObject* object, fuppes::
 
 void VirtualContainerMgr::deleteFile(fuppes::DbObject* object) // static
 {
+  MutexLocker locker(&m_mutex);
+
   StringList vfolders = CSharedConfig::Shared()->virtualFolders()->getEnabledFolders();
   for(unsigned int i = 0; i < vfolders.size(); i++) {  
-    deleteFileForLayout(object, vfolders.at(i));
+    deleteFileForLayout(object, layout(vfolders.at(i)));
   }
 }
 
@@ -834,6 +1023,8 @@ void VirtualContainerMgr::deleteDirectory(fuppes::DbObject* directory) // static
   stringstream sql;
   SQLQuery qry;
   DbObject* object;
+
+  MutexLocker locker(&m_mutex);
                
   StringList vfolders = CSharedConfig::Shared()->virtualFolders()->getEnabledFolders();
   for(unsigned int i = 0; i < vfolders.size(); i++) {  
@@ -849,21 +1040,21 @@ void VirtualContainerMgr::deleteDirectory(fuppes::DbObject* directory) // static
     // ... and remove them from each virtual layout
     while(!qry.eof()) {
       object = new DbObject(qry.result());
-      deleteFileForLayout(object, vfolders.at(i));
+      deleteFileForLayout(object, layout(vfolders.at(i)));
       delete object;
       qry.next();
     }
   }  
 }
 
-void VirtualContainerMgr::deleteFileForLayout(fuppes::DbObject* object, std::string layout) // static
+void VirtualContainerMgr::deleteFileForLayout(fuppes::DbObject* object, VirtualLayout* layout) // static
 {
   stringstream sql;
   SQLQuery qry;
 
   sql << "select * from OBJECTS where "
     "VREF_ID = " << object->objectId() << " and " <<
-    "DEVICE = '" << layout << "'";
+    "DEVICE = '" << layout->name() << "'";
   
   DbObject* obj;
   DbObject* parent;
@@ -878,10 +1069,10 @@ void VirtualContainerMgr::deleteFileForLayout(fuppes::DbObject* object, std::str
     // delete empty parent folders
     DbObject::VirtualContainerType type;
     do {
-      parent = DbObject::createFromObjectId(pid, NULL, layout);
+      parent = DbObject::createFromObjectId(pid, NULL, layout->name());
       type = parent->vcType();
       if(type >= DbObject::Genre) {
-        deleteFolderIfEmpty(parent);
+        deleteFolderIfEmpty(parent, layout);
       }
       pid = parent->parentId();
       delete parent;
@@ -892,7 +1083,7 @@ void VirtualContainerMgr::deleteFileForLayout(fuppes::DbObject* object, std::str
   
 }
 
-void VirtualContainerMgr::deleteFolderIfEmpty(DbObject* vfolder) // static
+void VirtualContainerMgr::deleteFolderIfEmpty(DbObject* vfolder, VirtualLayout* layout) // static
 {
   stringstream sql;
   SQLQuery qry;
@@ -915,4 +1106,6 @@ void VirtualContainerMgr::deleteFolderIfEmpty(DbObject* vfolder) // static
     "OBJECT_ID = " << vfolder->objectId() << " and " <<
     "DEVICE = '" << vfolder->device() << "'";
   qry.exec(sql.str());
+
+  layout->remove(vfolder->objectId());
 }
@@ -36,6 +36,9 @@
 #include "DatabaseConnection.h"
 #include "DatabaseObject.h"
 
+#include <map>
+#include <vector>
+
 /*
 class CObjectDetails {
   public:
@@ -50,6 +53,63 @@ class CObjectDetails {
 
 class VirtualContainerMgr;
 
+/**
+ * the containers of a single vfolder layout.
+ *
+ * the index is loaded once from the database and updated by
+ * VirtualContainerMgr whenever it creates or deletes a container
+ * so inserting a file does not need to look up its folders.
+ * all access is serialized by VirtualContainerMgr
+ */
+class VirtualLayout
+{
+  public:
+    VirtualLayout(std::string name);
+
+    std::string name() { return m_name; }
+
+    // (re)reads the layout's containers
+    void load(SQLQuery* qry);
+
+    // the vfolder paths containing the item type (audioItem, imageItem or videoItem)
+    std::vector<std::string> paths(std::string itemType);
+    // the vfolder with the path. 0 if there is none
+    object_id_t folder(std::string path);
+    // the split folder ("0-9", "ABC", ...) below pid the character belongs to
+    object_id_t split(object_id_t pid, std::string character);
+    // a genre, artist, composer, album or shared dir folder. 0 if there is none
+    object_id_t child(object_id_t pid, fuppes::DbObject::VirtualContainerType type, std::string path, std::string title);
+
+    void add(fuppes::DbObject* container);
+    void remove(object_id_t objectId);
+
+    // the vfolders and split folders as sorted keys. two layouts with
+    // the same entries were created from the same .cfg structure
+    std::vector<std::string> entries();
+
+  private:
+    struct Container {
+      object_id_t                             parentId;
+      fuppes::DbObject::VirtualContainerType  type;
+      std::string                             path;
+      std::string                             title;
+    };
+
+    void add(object_id_t objectId, Container container);
+    std::string childKey(object_id_t pid, fuppes::DbObject::VirtualContainerType type, std::string path, std::string title);
+    std::string entryKey(object_id_t objectId);
+
+    std::string                               m_name;
+    // all containers by object id
+    std::map<object_id_t, Container>          m_containers;
+    // vcontainer path -> vfolder
+    std::map<std::string, object_id_t>        m_folders;
+    // parent id -> split folders
+    std::map<object_id_t, std::vector<object_id_t> >  m_splits;
+    // parent, type, path and title -> genre, artist, composer, album and shared dir folders
+    std::map<std::string, object_id_t>        m_children;
+};
+
 
 class CVirtualContainerMgr
 {
@@ -59,13 +119,17 @@ class CVirtualContainerMgr
 	  static CVirtualContainerMgr* Shared();
     ~CVirtualContainerMgr();
   
-    void RebuildContainerList(bool force = false, bool insertFiles = true);
+    // drops and recreates the layouts. with changedOnly set a layout is
+    // kept if its structure matches the .cfg file (used on start-up)
+    void RebuildContainerList(bool force = false, bool insertFiles = true, bool changedOnly = false);
     bool IsRebuilding();
   
 	private:
 	  CVirtualContainerMgr();
     
-    bool HandleFile(std::string device, std::string file, SQLQuery* qry);
+    // rebuilds a layout. with changedOnly set only if its structure differs
+    // from the .cfg file. returns true if the layout has been rebuilt
+    bool HandleFile(std::string device, std::string file, SQLQuery* qry, bool insertFiles, bool changedOnly);
 	  static CVirtualContainerMgr* m_pInstance;  
 
 		
@@ -82,6 +146,8 @@ class CVirtualContainerMgr
 
 class VirtualContainerMgr
 {
+  friend class CVirtualContainerMgr;
+
   public:
     /**
      * object the original file object (REF_ID NULL and DEVICE = NULL)
@@ -106,14 +172,22 @@ class VirtualContainerMgr
     static void deleteDirectory(fuppes::DbObject* directory);
     
   private:
-    static void insertFileForLayout(fuppes::DbObject* object, std::string layout);
-    static object_id_t createFolderIfNotExists(fuppes::DbObject* object, object_id_t pid, fuppes::DbObject::VirtualContainerType type, std::string path, std::string layout);
-    static object_id_t createSharedDirFoldersIfNotExist(fuppes::DbObject* object, object_id_t pid, std::string path, std::string layout);
+    // the index of a layout. loaded on first use
+    static VirtualLayout* layout(std::string name);
+    // drops all indexes. the next call to layout() reloads them
+    static void resetLayouts();
+
+    static void insertFileForLayout(fuppes::DbObject* object, VirtualLayout* layout);
+    static object_id_t createFolderIfNotExists(fuppes::DbObject* object, object_id_t pid, fuppes::DbObject::VirtualContainerType type, std::string path, VirtualLayout* layout);
+    static object_id_t createSharedDirFoldersIfNotExist(fuppes::DbObject* object, object_id_t pid, std::string path, VirtualLayout* layout);
+
+    static void updateFileForLayout(fuppes::DbObject* object, fuppes::ObjectDetails* oldDetails, VirtualLayout* layout);
 
-    static void updateFileForLayout(fuppes::DbObject* object, fuppes::ObjectDetails* oldDetails, std::string layout);
+    static void deleteFileForLayout(fuppes::DbObject* object, VirtualLayout* layout);
+    static void deleteFolderIfEmpty(fuppes::DbObject* vfolder, VirtualLayout* layout);
 
-    static void deleteFileForLayout(fuppes::DbObject* object, std::string layout);
-    static void deleteFolderIfEmpty(fuppes::DbObject* vfolder);
+    static fuppes::Mutex                           m_mutex;
+    static std::map<std::string, VirtualLayout*>  m_layouts;
 };
 
 #endif // _VIRTUALCONTAINERMGR_H
@@ -27,7 +27,6 @@
 #include "../Log.h"
 #include "../SharedConfig.h"
 #include "../Configuration/DeviceMapping.h"
-#include "../Common/RegEx.h"
 #include "MacAddressTable.h"
 #include <iostream>
 
@@ -156,9 +155,8 @@ void CDeviceIdentificationMgr::IdentifyDevice(CHTTPMessage* pDeviceMessage)
   // this is nothing that any real upnp rendere should have but
   // the fuppes webinterface uses it and maybe some future config gui
   // could also use this
-  RegEx rxVirtualLayout("VIRTUAL-LAYOUT: *(\\w+)", PCRE_CASELESS);
-  if(rxVirtualLayout.search(pDeviceMessage->GetHeader())) {
-    string layout = rxVirtualLayout.match(1);
+  string layout = pDeviceMessage->requestedVirtualFolderLayout();
+  if(!layout.empty()) {
 
     if(layout.compare("none") == 0) {
         pDeviceMessage->setVirtualFolderLayout("");
@@ -32,10 +32,12 @@
 #include "Common/Common.h"
 #include "Common/Exception.h"
 #include "SharedLog.h"
+#include "SharedConfig.h"
 #include "HTTP/HTTPMessage.h"
 #include "MediaServer.h"
 #include "UPnPDevice.h"
 #include "GENA/SubscriptionMgr.h"
+#include "GENA/EventDispatcher.h"
 #include "ControlInterface/ControlInterface.h"
 
 #include "ContentDirectory/ContentDatabase.h"
@@ -75,6 +77,9 @@ CFuppes::CFuppes(std::string p_sIPAddress, std::string p_sUUID)
   if(bIsNewDB) {
     CContentDatabase::Shared()->RebuildDB();
   }
+  else if(CSharedConfig::Shared()->databaseSettings->updateOnStart()) {
+    CContentDatabase::Shared()->UpdateDB();
+  }
 
   // init file details
   try {
@@ -159,8 +164,7 @@ CFuppes::CFuppes(std::string p_sIPAddress, std::string p_sUUID)
 	
   CSharedLog::Log(L_EXT, __FILE__, __LINE__, "UPnP subsystem started");
 
-  // init virtual containers
-	CVirtualContainerMgr::Shared();
+  // the virtual container layouts are checked by the update thread
 
   // init control interface
   ControlInterface::init();
@@ -250,6 +254,7 @@ CFuppes::~CFuppes()
 
   //cout << "delete CSubscriptionMgr" << endl;
   CSubscriptionMgr::deleteInstance();
+  EventDispatcher::deleteInstance();
 
   //cout << "delete CSubscriptionCache" << endl;
   CSubscriptionCache::deleteInstance();
@@ -0,0 +1,521 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            EventDispatcher.cpp
+ *
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "EventDispatcher.h"
+#include "EventNotification.h"
+#include "../Common/Common.h"
+#include "../Common/Exception.h"
+#include "../HTTP/HTTPParser.h"
+#include "../SharedConfig.h"
+#include "../SharedLog.h"
+
+#include <sstream>
+
+using namespace std;
+using namespace fuppes;
+
+// max. notifications per second and subscriber
+#define GENA_MAX_EVENT_RATE       5
+// kept alive connections are closed after this time (ms)
+#define GENA_KEEP_ALIVE_TIMEOUT   30000
+// max. time to wait for the response to a notification (ms)
+#define GENA_RESPONSE_TIMEOUT     5000
+// a subscriber is skipped for failures * GENA_RETRY_DELAY ms after a failed notification
+#define GENA_RETRY_DELAY          5000
+#define GENA_MAX_RETRY_DELAY      60000
+// the queue of a subscriber that failed this often is dropped
+#define GENA_MAX_FAILURES         3
+
+EventDispatcher* EventDispatcher::m_instance = NULL;
+
+EventDispatcher* EventDispatcher::Shared() // static
+{
+  if(m_instance == NULL)
+    m_instance = new EventDispatcher();
+  return m_instance;
+}
+
+void EventDispatcher::deleteInstance() // static
+{
+  if(m_instance == NULL)
+    return;
+  delete m_instance;
+  m_instance = NULL;
+}
+
+EventDispatcher::EventDispatcher()
+:Thread("EventDispatcher")
+{
+  m_condition = new Condition(&m_mutex);
+  m_queueDepth = 0;
+  m_maxQueueDepth = 0;
+  m_sent = 0;
+  m_coalesced = 0;
+  m_failed = 0;
+  m_connections = 0;
+  start();
+}
+
+EventDispatcher::~EventDispatcher()
+{
+  stop();
+  m_mutex.lock();
+  m_condition->broadcast();
+  m_mutex.unlock();
+  close();
+
+  m_mutex.lock();
+  std::map<std::string, GenaSubscriber*> subscribers;
+  subscribers.swap(m_subscribers);
+  std::map<std::string, GenaSubscriber*>::iterator iter;
+  for(iter = subscribers.begin(); iter != subscribers.end(); iter++) {
+    deleteSubscriber(iter->second);
+  }
+  m_mutex.unlock();
+
+  delete m_condition;
+}
+
+GenaWorker::GenaWorker(EventDispatcher* dispatcher, GenaSubscriber* subscriber)
+:Thread("GenaWorker")
+{
+  m_dispatcher = dispatcher;
+  m_subscriber = subscriber;
+}
+
+void GenaWorker::run()
+{
+  m_dispatcher->work(m_subscriber);
+}
+
+void EventDispatcher::notify(std::string sid, std::string callback, GenaProperties properties)
+{
+  string address;
+  unsigned int port = 0;
+  if(!SplitURL(callback, &address, &port)) {
+    SHARED_LOG(L_EXT, "invalid event callback \"%s\"", callback.c_str());
+    return;
+  }
+
+  GenaEvent* event = new GenaEvent();
+  event->sid = sid;
+  event->callback = callback;
+  event->properties = properties;
+
+  stringstream key;
+  key << address << ":" << port;
+
+  MutexLocker locker(&m_mutex);
+
+  GenaSubscriber* subscriber;
+  std::map<std::string, GenaSubscriber*>::iterator iter = m_subscribers.find(key.str());
+  if(iter == m_subscribers.end()) {
+    subscriber = new GenaSubscriber();
+    subscriber->address = address;
+    subscriber->port = port;
+    subscriber->lastUsed = fuppesTicks();
+    subscriber->nextSend = subscriber->lastUsed;
+    subscriber->condition = new Condition(&m_mutex);
+    subscriber->worker = new GenaWorker(this, subscriber);
+    m_subscribers[key.str()] = subscriber;
+    subscriber->worker->start();
+  }
+  else {
+    subscriber = iter->second;
+  }
+
+  // merge into a queued event of the same subscription
+  std::list<GenaEvent*>::iterator queued;
+  for(queued = subscriber->events.begin(); queued != subscriber->events.end(); queued++) {
+    if((*queued)->sid == sid) {
+      merge(*queued, event);
+      delete event;
+      m_coalesced++;
+      return;
+    }
+  }
+
+  subscriber->events.push_back(event);
+  m_queueDepth++;
+  if(m_queueDepth > m_maxQueueDepth)
+    m_maxQueueDepth = m_queueDepth;
+  subscriber->condition->signal();
+}
+
+void EventDispatcher::remove(std::string sid)
+{
+  MutexLocker locker(&m_mutex);
+
+  m_sequences.erase(sid);
+
+  std::map<std::string, GenaSubscriber*>::iterator iter;
+  std::list<GenaEvent*>::iterator event;
+  for(iter = m_subscribers.begin(); iter != m_subscribers.end(); iter++) {
+    event = iter->second->events.begin();
+    while(event != iter->second->events.end()) {
+      if((*event)->sid == sid) {
+        delete *event;
+        event = iter->second->events.erase(event);
+        m_queueDepth--;
+      }
+      else {
+        event++;
+      }
+    }
+  }
+}
+
+void EventDispatcher::run()
+{
+  m_mutex.lock();
+  while(!stopRequested()) {
+    closeIdle(fuppesTicks());
+    m_condition->wait(1000);
+  }
+  m_mutex.unlock();
+}
+
+void EventDispatcher::work(GenaSubscriber* subscriber)
+{
+  GenaEvent* event;
+  unsigned int sequence;
+  unsigned int now;
+  unsigned int wait;
+  bool success;
+
+  m_mutex.lock();
+  while(!subscriber->worker->stopping()) {
+
+    now = fuppesTicks();
+    if(subscriber->events.empty()) {
+      subscriber->condition->wait(1000);
+      continue;
+    }
+    if((int)(subscriber->nextSend - now) > 0) {
+      subscriber->condition->wait(subscriber->nextSend - now);
+      continue;
+    }
+
+    event = subscriber->events.front();
+    subscriber->events.pop_front();
+    m_queueDepth--;
+    sequence = nextSequence(event->sid);
+    // a subscriber that is sending is not idle
+    subscriber->lastUsed = now;
+
+    // the subscriber is only deleted after its worker has
+    // finished so it stays valid while we send without the lock
+    m_mutex.unlock();
+    success = send(subscriber, event, sequence);
+    delete event;
+    m_mutex.lock();
+
+    now = fuppesTicks();
+    subscriber->lastUsed = now;
+    if(success) {
+      m_sent++;
+      subscriber->failures = 0;
+      subscriber->nextSend = now + (1000 / GENA_MAX_EVENT_RATE);
+      continue;
+    }
+
+    m_failed++;
+    subscriber->failures++;
+    wait = subscriber->failures * GENA_RETRY_DELAY;
+    subscriber->nextSend = now + (wait < GENA_MAX_RETRY_DELAY ? wait : GENA_MAX_RETRY_DELAY);
+
+    // the control point is most likely gone. its subscriptions will time out
+    if(subscriber->failures >= GENA_MAX_FAILURES) {
+      SHARED_LOG(L_EXT, "dropping %d events for %s:%d", 
+                      (int)subscriber->events.size(), subscriber->address.c_str(), subscriber->port);
+      m_failed += subscriber->events.size();
+      m_queueDepth -= subscriber->events.size();
+      std::list<GenaEvent*>::iterator iter;
+      for(iter = subscriber->events.begin(); iter != subscriber->events.end(); iter++) {
+        delete *iter;
+      }
+      subscriber->events.clear();
+    }
+  }
+  m_mutex.unlock();
+}
+
+void EventDispatcher::closeIdle(unsigned int now)
+{
+  // remove them from the map first. notify() may add a new
+  // subscriber while the workers are joined without the lock
+  std::list<GenaSubscriber*> idle;
+  std::map<std::string, GenaSubscriber*>::iterator iter = m_subscribers.begin();
+  while(iter != m_subscribers.end()) {
+    if(!iter->second->events.empty() || now - iter->second->lastUsed < GENA_KEEP_ALIVE_TIMEOUT) {
+      iter++;
+      continue;
+    }
+
+    idle.push_back(iter->second);
+    m_subscribers.erase(iter++);
+  }
+
+  std::list<GenaSubscriber*>::iterator subscriber;
+  for(subscriber = idle.begin(); subscriber != idle.end(); subscriber++) {
+    deleteSubscriber(*subscriber);
+  }
+}
+
+void EventDispatcher::deleteSubscriber(GenaSubscriber* subscriber)
+{
+  subscriber->worker->stop();
+  subscriber->condition->signal();
+  m_mutex.unlock();
+  subscriber->worker->close();
+  m_mutex.lock();
+
+  disconnect(subscriber);
+  m_queueDepth -= subscriber->events.size();
+  std::list<GenaEvent*>::iterator event;
+  for(event = subscriber->events.begin(); event != subscriber->events.end(); event++) {
+    delete *event;
+  }
+  delete subscriber->worker;
+  delete subscriber->condition;
+  delete subscriber;
+}
+
+unsigned int EventDispatcher::nextSequence(std::string sid)
+{
+  // the initial event has sequence number 0.
+  // after an overflow we continue with 1
+  unsigned int& sequence = m_sequences[sid];
+  unsigned int result = sequence;
+  if(sequence == 0xFFFFFFFF)
+    sequence = 1;
+  else
+    sequence++;
+  return result;
+}
+
+bool EventDispatcher::send(GenaSubscriber* subscriber, GenaEvent* event, unsigned int sequence)
+{
+  CEventNotification notification;
+  notification.SetCallback(event->callback);
+  notification.SetSID(event->sid);
+  notification.SetSequence(sequence);
+  notification.SetContent(buildContent(event));
+
+  stringstream host;
+  host << subscriber->address << ":" << subscriber->port;
+  notification.SetHost(host.str());
+
+  std::string message = notification.BuildHeader() + notification.GetContent();
+  bool keepAlive;
+
+  // a kept alive connection may have been closed by the
+  // subscriber in the meantime. so we retry once on a new one
+  bool reused = (subscriber->socket != NULL);
+  while(true) {
+
+    if(subscriber->socket == NULL && !connect(subscriber))
+      return false;
+
+    keepAlive = false;
+    if(subscriber->socket->send(message) == (fuppes_off_t)message.length() &&
+       readResponse(subscriber, &keepAlive)) {
+      if(!keepAlive)
+        disconnect(subscriber);
+      return true;
+    }
+
+    disconnect(subscriber);
+    if(!reused || subscriber->worker->stopping())
+      return false;
+    reused = false;
+  }
+}
+
+bool EventDispatcher::connect(GenaSubscriber* subscriber)
+{
+  try {
+    subscriber->socket = new TCPSocket(CSharedConfig::Shared()->networkSettings->GetIPv4Address());
+    subscriber->socket->remoteAddress(subscriber->address);
+    subscriber->socket->remotePort(subscriber->port);
+    if(subscriber->socket->connect()) {
+      MutexLocker locker(&m_mutex);
+      m_connections++;
+      return true;
+    }
+  }
+  catch(fuppes::Exception &ex) {
+    CSharedLog::Log(L_DBG, ex);
+  }
+
+  SHARED_LOG(L_EXT, "failed to connect to %s:%d", subscriber->address.c_str(), subscriber->port);
+  disconnect(subscriber);
+  return false;
+}
+
+void EventDispatcher::disconnect(GenaSubscriber* subscriber)
+{
+  if(subscriber->socket == NULL)
+    return;
+
+  try {
+    subscriber->socket->close();
+  }
+  catch(fuppes::Exception &ex) {
+  }
+  delete subscriber->socket;
+  subscriber->socket = NULL;
+}
+
+bool EventDispatcher::readResponse(GenaSubscriber* subscriber, bool* keepAlive)
+{
+  TCPSocket* socket = subscriber->socket;
+  std::string response;
+  std::string header;
+  char buffer[1024];
+  fd_set fds;
+  timeval tv;
+  size_t end = std::string::npos;
+  fuppes_off_t contentLength = 0;
+  int received;
+
+  unsigned int start = fuppesTicks();
+  while(fuppesTicks() - start < GENA_RESPONSE_TIMEOUT && !subscriber->worker->stopping()) {
+
+    FD_ZERO(&fds);
+    FD_SET(socket->socket(), &fds);
+    tv.tv_sec = 0;
+    tv.tv_usec = 200000;
+    received = select(socket->socket() + 1, &fds, NULL, NULL, &tv);
+    if(received < 0)
+      return false;
+    if(received == 0)
+      continue;
+
+    // 0 = the connection has been closed
+    received = ::recv(socket->socket(), buffer, sizeof(buffer), 0);
+    if(received <= 0)
+      return false;
+    response.append(buffer, received);
+
+    if(end == std::string::npos) {
+      end = response.find("\r\n\r\n");
+      if(end == std::string::npos)
+        continue;
+      header = response.substr(0, end + 4);
+      if(CHTTPParser::hasContentLength((char*)header.c_str()))
+        contentLength = CHTTPParser::getContentLength((char*)header.c_str());
+    }
+
+    if((fuppes_off_t)response.length() < (fuppes_off_t)(end + 4) + contentLength)
+      continue;
+
+    header = ToLower(header);
+    *keepAlive = (header.compare(0, 8, "http/1.1") == 0) && 
+                 (header.find("connection: close") == std::string::npos);
+    return true;
+  }
+
+  return false;
+}
+
+void EventDispatcher::merge(GenaEvent* queued, GenaEvent* event) // static
+{
+  GenaProperties::iterator newValue;
+  GenaProperties::iterator oldValue;
+  for(newValue = event->properties.begin(); newValue != event->properties.end(); newValue++) {
+
+    for(oldValue = queued->properties.begin(); oldValue != queued->properties.end(); oldValue++) {
+      if(oldValue->first == newValue->first)
+        break;
+    }
+    if(oldValue == queued->properties.end()) {
+      queued->properties.push_back(*newValue);
+      continue;
+    }
+
+    if(newValue->first.compare("ContainerUpdateIDs") == 0)
+      oldValue->second = mergeContainerUpdateIds(oldValue->second, newValue->second);
+    else
+      oldValue->second = newValue->second;
+  }
+  queued->callback = event->callback;
+}
+
+std::string EventDispatcher::mergeContainerUpdateIds(std::string queued, std::string ids) // static
+{
+  // "id,updateId,id,updateId,..." the newer update id of a container wins
+  std::vector<std::string> values;
+  std::string value;
+  std::string all = queued;
+  if(!all.empty() && !ids.empty())
+    all += ",";
+  all += ids;
+
+  std::stringstream input(all);
+  while(std::getline(input, value, ',')) {
+    values.push_back(value);
+  }
+
+  std::map<std::string, size_t> positions;
+  std::map<std::string, size_t>::iterator pos;
+  std::vector<std::pair<std::string, std::string> > containers;
+  for(size_t i = 0; i + 1 < values.size(); i += 2) {
+    pos = positions.find(values[i]);
+    if(pos == positions.end()) {
+      positions[values[i]] = containers.size();
+      containers.push_back(std::make_pair(values[i], values[i + 1]));
+    }
+    else {
+      containers[pos->second].second = values[i + 1];
+    }
+  }
+
+  std::stringstream result;
+  for(size_t i = 0; i < containers.size(); i++) {
+    if(i > 0)
+      result << ",";
+    result << containers[i].first << "," << containers[i].second;
+  }
+  return result.str();
+}
+
+std::string EventDispatcher::buildContent(GenaEvent* event) // static
+{
+  if(event->properties.empty())
+    return "";
+
+  stringstream content;
+  content << "<e:propertyset xmlns:e=\"urn:schemas-upnp-org:event-1-0\">";
+  GenaProperties::iterator iter;
+  for(iter = event->properties.begin(); iter != event->properties.end(); iter++) {
+    content << 
+      "<e:property>"
+      "<" << iter->first << ">" << iter->second << "</" << iter->first << ">"
+      "</e:property>";
+  }
+  content << "</e:propertyset>";
+  return content.str();
+}
@@ -0,0 +1,178 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            EventDispatcher.h
+ *
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _EVENTDISPATCHER_H
+#define _EVENTDISPATCHER_H
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#include "../Common/Thread.h"
+#include "../Common/Socket.h"
+
+#include <string>
+#include <list>
+#include <map>
+#include <vector>
+
+// evented variable name -> value
+typedef std::vector<std::pair<std::string, std::string> > GenaProperties;
+
+/**
+ * an event waiting to be sent to a subscription
+ */
+struct GenaEvent
+{
+  std::string     sid;
+  std::string     callback;
+  GenaProperties  properties;
+};
+
+class EventDispatcher;
+struct GenaSubscriber;
+
+/**
+ * sends the events of one subscriber. a subscriber that does not
+ * respond only delays its own events
+ */
+class GenaWorker: public fuppes::Thread
+{
+  public:
+    GenaWorker(EventDispatcher* dispatcher, GenaSubscriber* subscriber);
+    bool stopping() { return stopRequested(); }
+
+  private:
+    void run();
+
+    EventDispatcher*  m_dispatcher;
+    GenaSubscriber*   m_subscriber;
+};
+
+/**
+ * a control point's event url (address and port). the events of all its
+ * subscriptions are sent in order over one kept alive connection
+ */
+struct GenaSubscriber
+{
+  GenaSubscriber() {
+    port = 0;
+    socket = NULL;
+    lastUsed = 0;
+    nextSend = 0;
+    failures = 0;
+    worker = NULL;
+    condition = NULL;
+  }
+
+  std::string             address;
+  unsigned int            port;
+  fuppes::TCPSocket*      socket;
+  // ticks of the last notification. idle connections are closed
+  unsigned int            lastUsed;
+  // moderation. no event is sent before this time
+  unsigned int            nextSend;
+  // failed notifications in a row
+  unsigned int            failures;
+  std::list<GenaEvent*>   events;
+  GenaWorker*             worker;
+  // signaled when an event is queued. bound to the dispatcher's mutex
+  fuppes::Condition*      condition;
+};
+
+/**
+ * sends the GENA event notifications.
+ *
+ * every subscriber has its own worker thread so a control point that is
+ * gone (connect and response timeouts) does not hold up the others.
+ * the dispatcher thread closes the idle subscribers.
+ *
+ * every subscriber gets at most GENA_MAX_EVENT_RATE notifications per second.
+ * an event for a subscription that still has one queued is merged into
+ * the queued one. the newest values win and the ContainerUpdateIDs are
+ * combined. so a subscriber never has more than one event per subscription
+ * in its queue no matter how fast the database changes.
+ */
+class EventDispatcher: private fuppes::Thread
+{
+  friend class GenaWorker;
+
+  public:
+    static EventDispatcher* Shared();
+    static void deleteInstance();
+
+    // queues an event. never blocks on the network
+    void notify(std::string sid, std::string callback, GenaProperties properties);
+    // drops the queued events and the sequence number of a subscription
+    void remove(std::string sid);
+
+    unsigned int  queueDepth() { return m_queueDepth; }
+    unsigned int  maxQueueDepth() { return m_maxQueueDepth; }
+    unsigned int  sent() { return m_sent; }
+    unsigned int  coalesced() { return m_coalesced; }
+    unsigned int  failed() { return m_failed; }
+    unsigned int  connections() { return m_connections; }
+
+  private:
+    EventDispatcher();
+    ~EventDispatcher();
+    static EventDispatcher* m_instance;
+
+    void run();
+    // the loop of a subscriber's worker
+    void work(GenaSubscriber* subscriber);
+
+    // m_mutex must be locked
+    void closeIdle(unsigned int now);
+    unsigned int nextSequence(std::string sid);
+    // m_mutex must be locked. it is unlocked while the worker is joined
+    void deleteSubscriber(GenaSubscriber* subscriber);
+
+    // called without the lock. only the subscriber's worker uses its socket
+    bool send(GenaSubscriber* subscriber, GenaEvent* event, unsigned int sequence);
+    bool connect(GenaSubscriber* subscriber);
+    void disconnect(GenaSubscriber* subscriber);
+    bool readResponse(GenaSubscriber* subscriber, bool* keepAlive);
+
+    static void merge(GenaEvent* queued, GenaEvent* event);
+    static std::string mergeContainerUpdateIds(std::string queued, std::string ids);
+    static std::string buildContent(GenaEvent* event);
+
+    fuppes::Mutex                           m_mutex;
+    fuppes::Condition*                      m_condition;
+    // "address:port" -> subscriber
+    std::map<std::string, GenaSubscriber*>  m_subscribers;
+    // sid -> sequence number of the next event
+    std::map<std::string, unsigned int>     m_sequences;
+
+    unsigned int  m_queueDepth;
+    unsigned int  m_maxQueueDepth;
+    unsigned int  m_sent;
+    unsigned int  m_coalesced;
+    unsigned int  m_failed;
+    unsigned int  m_connections;
+};
+
+#endif // _EVENTDISPATCHER_H
@@ -41,7 +41,7 @@ std::string CEventNotification::BuildHeader()
     "NT: upnp:event\r\n" <<
     "NTS: upnp:propchange\r\n" <<
     "SID: uuid:" << m_sSID << "\r\n" <<
-    "SEQ: 0\r\n" <<
+    "SEQ: " << m_nSequence << "\r\n" <<
     "User-Agent: SSDP CD Events\r\n" << 
     "Cache-Control: no-cache\r\n\r\n";
   
@@ -33,6 +33,8 @@
 class CEventNotification
 {
   public:
+    CEventNotification() { m_nSequence = 0; m_nSubscriberPort = 0; }
+
     std::string BuildHeader();
     void SetHost(std::string p_sHost) { m_sHost = p_sHost; }
   
@@ -42,6 +44,7 @@ class CEventNotification
     void SetCallback(std::string p_sCallback);
     
     void SetSID(std::string p_sSID) { m_sSID = p_sSID; }    
+    void SetSequence(unsigned int p_nSequence) { m_nSequence = p_nSequence; }
     
     std::string  GetSubscriberIP() { return m_sSubscriberIP; }
     unsigned int GetSubscriberPort() { return m_nSubscriberPort; }
@@ -50,6 +53,7 @@ class CEventNotification
     std::string m_sContent;
     std::string m_sHost;
     std::string m_sSID;
+    unsigned int m_nSequence;
   
     std::string  m_sSubscriberIP;
     unsigned int m_nSubscriberPort;
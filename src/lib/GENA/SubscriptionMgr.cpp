@@ -24,6 +24,7 @@
  */
  
 #include "SubscriptionMgr.h"
+#include "EventDispatcher.h"
 #include "../Common/RegEx.h"
 #include "../Common/UUID.h"
 #include "../Common/Exception.h"
@@ -32,16 +33,16 @@
 
 using namespace fuppes;
 
+// min. time between two moderated ContentDirectory events (ms)
+#define GENA_MODERATION_INTERVAL 2000
+
 CSubscription::CSubscription()
 { 
   m_bHandled   = false;
-  m_pHTTPClient = NULL;
 }
 
 CSubscription::~CSubscription()
 {
-  if(m_pHTTPClient)
-    delete m_pHTTPClient;
 }
 
 
@@ -56,40 +57,19 @@ void CSubscription::DecTimeLeft()
     m_nTimeLeft--;
 }
 
-CHTTPClient* CSubscription::GetHTTPClient()
-{
-  if(!m_pHTTPClient)
-    m_pHTTPClient = new CHTTPClient(NULL, "CSubscription");
-  return m_pHTTPClient;
-}
-
-
-
-void CSubscription::AsyncReply()
+void CSubscription::AsyncReply(std::string containerUpdateIds /*= ""*/)
 {
-  CEventNotification* pNotification = new CEventNotification();
+  GenaProperties properties;
   
   switch(m_nSubscriptionTarget)
   {
     case UPNP_SERVICE_CONTENT_DIRECTORY : {
 
-      stringstream content;
-      content <<
-        "<e:propertyset xmlns:e=\"urn:schemas-upnp-org:event-1-0\">"
-        "<e:property>"
-        "<SystemUpdateID>" << CContentDatabase::systemUpdateId() << "</SystemUpdateID>"
-        "</e:property>"
-			  "<e:property>"
-        "<ContainerUpdateIDs></ContainerUpdateIDs>"
-        "</e:property>"
-        "<e:property>"
-        "<TransferIDs></TransferIDs>"
-        "</e:property>"
-        "</e:propertyset>";  
-     pNotification->SetContent(content.str());
-      
-     pNotification->SetCallback(m_sCallback);
-     pNotification->SetSID(m_sSID);
+      stringstream systemUpdateId;
+      systemUpdateId << CContentDatabase::systemUpdateId();
+      properties.push_back(make_pair("SystemUpdateID", systemUpdateId.str()));
+      properties.push_back(make_pair("ContainerUpdateIDs", containerUpdateIds));
+      properties.push_back(make_pair("TransferIDs", ""));
 /*
 NOTIFY / HTTP/1.1
 HOST: 192.168.0.3:49152
@@ -122,21 +102,9 @@ CONTENT-TYPE: text/html
       } break;
     case UPNP_SERVICE_CONNECTION_MANAGER :
       
-      pNotification->SetContent(
-        "<e:propertyset xmlns:e=\"urn:schemas-upnp-org:event-1-0\">"
-        "<e:property>"
-        "<SourceProtocolInfo>http-get:*:audio/mpeg:*,http-get:*:audio/mpegurl:*,http-get:*:image/jpeg:*</SourceProtocolInfo>"
-        "</e:property>"
-        "<e:property>"
-        "<SinkProtocolInfo></SinkProtocolInfo>"
-        "</e:property>"
-        "<e:property>"
-        "<CurrentConnectionIDs>0</CurrentConnectionIDs>"
-        "</e:property>"
-        "</e:propertyset>");
-    
-     pNotification->SetCallback(m_sCallback);
-     pNotification->SetSID(m_sSID);      
+      properties.push_back(make_pair("SourceProtocolInfo", "http-get:*:audio/mpeg:*,http-get:*:audio/mpegurl:*,http-get:*:image/jpeg:*"));
+      properties.push_back(make_pair("SinkProtocolInfo", ""));
+      properties.push_back(make_pair("CurrentConnectionIDs", "0"));
       
 /*
 NOTIFY / HTTP/1.1
@@ -174,9 +142,7 @@ CONTENT-TYPE: text/html
       break;
 
 		case UPNP_SERVICE_X_MS_MEDIA_RECEIVER_REGISTRAR :      
-  		pNotification->SetContent("");    
-   		pNotification->SetCallback(m_sCallback);
-   		pNotification->SetSID(m_sSID);    
+      // no properties. sent with an empty body
 
 /*
 			 <e:propertyset xmlns:e="urn:schemas-upnp-org:event-1-0" xmlns:s="urn:microsoft.com:service:X_MS_MediaReceiverRegistrar:1">
@@ -201,8 +167,8 @@ CONTENT-TYPE: text/html
       break;
   }
   
-  this->GetHTTPClient()->AsyncNotify(pNotification);
-  delete pNotification;
+  // the dispatcher numbers the events when they are sent
+  EventDispatcher::Shared()->notify(m_sSID, m_sCallback, properties);
 }
 
 
@@ -264,19 +230,19 @@ void CSubscriptionCache::AddSubscription(CSubscription* pSubscription)
 
 bool CSubscriptionCache::RenewSubscription(std::string pSID)
 {
-  CSharedLog::Log(L_EXT, __FILE__, __LINE__, "renew subscription \"%s\"", pSID.c_str());
+  SHARED_LOG(L_EXT, "renew subscription \"%s\"", pSID.c_str());
   
   bool bResult = false;
   
   m_Mutex.lock();
   m_SubscriptionsIterator = m_Subscriptions.find(pSID);
   if(m_SubscriptionsIterator != m_Subscriptions.end()) {    
-    CSharedLog::Log(L_EXT, __FILE__, __LINE__, "renew subscription \"%s\" done", pSID.c_str());
+    SHARED_LOG(L_EXT, "renew subscription \"%s\" done", pSID.c_str());
     m_Subscriptions[pSID]->Renew();
     bResult = true;
   }
   else {
-    CSharedLog::Log(L_EXT, __FILE__, __LINE__, "renew subscription \"%s\" failed", pSID.c_str());
+    SHARED_LOG(L_EXT, "renew subscription \"%s\" failed", pSID.c_str());
     bResult = false;
   }
   
@@ -286,7 +252,7 @@ bool CSubscriptionCache::RenewSubscription(std::string pSID)
 
 bool CSubscriptionCache::DeleteSubscription(std::string pSID)
 {
-  CSharedLog::Log(L_EXT, __FILE__, __LINE__, "delete subscription \"%s\"", pSID.c_str());
+  SHARED_LOG(L_EXT, "delete subscription \"%s\"", pSID.c_str());
     
   bool bResult = false;
   CSubscription* pSubscription;
@@ -294,14 +260,15 @@ bool CSubscriptionCache::DeleteSubscription(std::string pSID)
   m_Mutex.lock();  
   m_SubscriptionsIterator = m_Subscriptions.find(pSID);  
   if(m_SubscriptionsIterator != m_Subscriptions.end()) { 
-    CSharedLog::Log(L_EXT, __FILE__, __LINE__, "delete subscription \"%s\" done", pSID.c_str());
+    SHARED_LOG(L_EXT, "delete subscription \"%s\" done", pSID.c_str());
     pSubscription = (*m_SubscriptionsIterator).second;
     m_Subscriptions.erase(pSID);
     delete pSubscription;
+    EventDispatcher::Shared()->remove(pSID);
     bResult = true;
   }
   else {
-    CSharedLog::Log(L_EXT, __FILE__, __LINE__, "delete subscription \"%s\" failed", pSID.c_str());
+    SHARED_LOG(L_EXT, "delete subscription \"%s\" failed", pSID.c_str());
     bResult = false;
   }
   
@@ -344,14 +311,14 @@ CSubscriptionMgr::~CSubscriptionMgr()
 
 bool CSubscriptionMgr::HandleSubscription(CHTTPMessage* pRequest, CHTTPMessage* pResponse)
 {
-	Log::log(Log::gena, Log::debug, __FILE__, __LINE__, "REQUEST:\n" + pRequest->GetHeader());
+	FUPPES_LOG(Log::gena, Log::debug, "REQUEST:\n" + pRequest->GetHeader());
   
   CSubscription* pSubscription = new CSubscription();
   try {    
     CSubscriptionMgr::ParseSubscription(pRequest, pSubscription);
   } 
   catch (fuppes::Exception ex) {
-    CSharedLog::Log(L_EXT, __FILE__, __LINE__, ex.what());
+    SHARED_LOG(L_EXT, ex.what());
     
     delete pSubscription;
     return false;
@@ -449,9 +416,22 @@ void CSubscriptionMgr::run()
 {
   CSubscription* pSubscr = NULL;
   std::map<std::string, CSubscription*>::iterator tmpIt;    
+  std::string containerUpdateIds;
+  unsigned int lastEvent = fuppesTicks();
+  unsigned int now;
   
   while(!this->stopRequested()) {
     //cout << "CSubscriptionMgr::MainLoop" << endl;
+
+    // SystemUpdateID and ContainerUpdateIDs are moderated.
+    // changed containers are collected and sent at most every 2 seconds
+    containerUpdateIds = "";
+    now = fuppesTicks();
+    if(now - lastEvent >= GENA_MODERATION_INTERVAL) {
+      containerUpdateIds = CContentDatabase::takeContainerUpdateIds();
+      if(!containerUpdateIds.empty())
+        lastEvent = now;
+    }
     
     CSubscriptionCache::Shared()->Lock();
     
@@ -471,16 +451,20 @@ void CSubscriptionMgr::run()
       pSubscr->DecTimeLeft();      
       
       if(!pSubscr->m_bHandled) {        
-        #warning todo: max send freq 5Hz for "SystemUpdateID" and "ContainerUpdateIDs"        
         pSubscr->m_bHandled = true;        
         pSubscr->AsyncReply();
       }
+      else if(!containerUpdateIds.empty() && 
+              pSubscr->GetSubscriptionTarget() == UPNP_SERVICE_CONTENT_DIRECTORY) {
+        pSubscr->AsyncReply(containerUpdateIds);
+      }
       
       if(pSubscr->GetTimeLeft() == 0) {        
         tmpIt = CSubscriptionCache::Shared()->m_SubscriptionsIterator;
         ++tmpIt;
         CSubscriptionCache::Shared()->m_Subscriptions.erase(pSubscr->GetSID());        
         CSubscriptionCache::Shared()->m_SubscriptionsIterator = tmpIt;
+        EventDispatcher::Shared()->remove(pSubscr->GetSID());
         delete pSubscr;
       }
       else {
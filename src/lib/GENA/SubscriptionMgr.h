@@ -74,7 +74,9 @@ class CSubscription
     bool m_bHandled;
     
     
-    void AsyncReply();
+    // queues an event at the EventDispatcher.
+    // containerUpdateIds is only used for ContentDirectory events
+    void AsyncReply(std::string containerUpdateIds = "");
     
         
   private:
@@ -84,9 +86,6 @@ class CSubscription
     std::string        m_sCallback;
     SUBSCRIPTION_TYPE  m_nSubscriptionType;  
     UPNP_DEVICE_TYPE   m_nSubscriptionTarget;
-  
-    CHTTPClient* GetHTTPClient();
-    CHTTPClient* m_pHTTPClient;
 };
 
 class CSubscriptionCache
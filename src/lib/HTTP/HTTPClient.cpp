@@ -244,7 +244,7 @@ bool CHTTPClient::AsyncGet(std::string p_sGetURL)
   
   // build GET header
   std::string sMsg = BuildGetHeader(sGet, sIPAddress, nPort);  
-  CSharedLog::Log(L_DBG, __FILE__, __LINE__, "send GET Header \n%s", sMsg.c_str());
+  SHARED_LOG(L_DBG, "send GET Header \n%s", sMsg.c_str());
 	
   // start async send
   m_sMessage   = sMsg;
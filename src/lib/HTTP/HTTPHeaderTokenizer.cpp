@@ -0,0 +1,229 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            HTTPHeaderTokenizer.cpp
+ *
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "HTTPHeaderTokenizer.h"
+
+#include <string.h>
+
+struct KnownField {
+  const char*                       name;
+  size_t                            length;
+  HTTPHeaderTokenizer::HeaderField  field;
+};
+
+static const KnownField knownFields[] = {
+  { "callback",                     8, HTTPHeaderTokenizer::Callback },
+  { "connection",                  10, HTTPHeaderTokenizer::Connection },
+  { "contentfeatures.dlna.org",    24, HTTPHeaderTokenizer::ContentFeatures },
+  { "content-length",              14, HTTPHeaderTokenizer::ContentLength },
+  { "getcaptioninfo.sec",          18, HTTPHeaderTokenizer::GetCaptionInfo },
+  { "getcontentfeatures.dlna.org", 27, HTTPHeaderTokenizer::GetContentFeatures },
+  { "nt",                           2, HTTPHeaderTokenizer::Nt },
+  { "range",                        5, HTTPHeaderTokenizer::Range },
+  { "soapaction",                  10, HTTPHeaderTokenizer::SoapAction },
+  { "transfer-encoding",           17, HTTPHeaderTokenizer::TransferEncoding },
+  { "transfermode.dlna.org",       21, HTTPHeaderTokenizer::TransferMode },
+  { "user-agent",                  10, HTTPHeaderTokenizer::UserAgent },
+  { "virtual-layout",              14, HTTPHeaderTokenizer::VirtualLayout },
+  { NULL,                           0, HTTPHeaderTokenizer::Other }
+};
+
+static inline char lowerCase(char c)
+{
+  return (c >= 'A' && c <= 'Z') ? (c + ('a' - 'A')) : c;
+}
+
+static inline bool isSpace(char c)
+{
+  return (c == ' ' || c == '\t');
+}
+
+void HTTPHeaderTokenizer::reset()
+{
+  m_lineStart     = 0;
+  m_scanned       = 0;
+  m_startLine     = false;
+  m_done          = false;
+  m_headerLength  = 0;
+
+  m_field         = Other;
+  m_first         = NULL;
+  m_firstLength   = 0;
+  m_second        = NULL;
+  m_secondLength  = 0;
+  m_third         = NULL;
+  m_thirdLength   = 0;
+}
+
+HTTPHeaderTokenizer::Token HTTPHeaderTokenizer::next(const char* buffer, size_t length)
+{
+  if(m_done)
+    return End;
+
+  const char* eol;
+  const char* line;
+  size_t lineLength;
+
+  while(m_scanned < length) {
+
+    eol = (const char*)memchr(buffer + m_scanned, '\n', length - m_scanned);
+    if(eol == NULL) {
+      m_scanned = length;
+      return Incomplete;
+    }
+
+    line = buffer + m_lineStart;
+    lineLength = eol - line;
+    if(lineLength > 0 && line[lineLength - 1] == '\r')
+      lineLength--;
+    m_lineStart = m_scanned = (eol - buffer) + 1;
+
+    // the empty line ends the header. empty lines before the start line are ignored
+    if(lineLength == 0) {
+      if(!m_startLine)
+        continue;
+      m_done = true;
+      m_headerLength = m_lineStart;
+      return End;
+    }
+
+    if(!m_startLine) {
+      m_startLine = true;
+      return (startLine(line, lineLength) ? StartLine : Invalid);
+    }
+
+    // lines without a colon are skipped
+    if(headerField(line, lineLength))
+      return Field;
+  }
+
+  return Incomplete;
+}
+
+bool HTTPHeaderTokenizer::startLine(const char* line, size_t length)
+{
+  const char* end = line + length;
+  const char* pos = (const char*)memchr(line, ' ', length);
+  if(pos == NULL)
+    return false;
+
+  m_first = line;
+  m_firstLength = pos - line;
+  while(pos < end && *pos == ' ')
+    pos++;
+
+  // status line: version, status code and reason
+  if(startsWith(line, length, "http/")) {
+    const char* space = (const char*)memchr(pos, ' ', end - pos);
+    if(space == NULL)
+      space = end;
+    m_second = pos;
+    m_secondLength = space - pos;
+    while(space < end && *space == ' ')
+      space++;
+    m_third = space;
+    m_thirdLength = end - space;
+    return (m_secondLength > 0);
+  }
+
+  // request line: method, uri and version. the uri may contain spaces
+  const char* version = end;
+  while(version > pos && version[-1] != ' ')
+    version--;
+  if(version == pos)
+    return false;
+  m_third = version;
+  m_thirdLength = end - version;
+
+  const char* uriEnd = version;
+  while(uriEnd > pos && uriEnd[-1] == ' ')
+    uriEnd--;
+  m_second = pos;
+  m_secondLength = uriEnd - pos;
+  return (m_secondLength > 0);
+}
+
+bool HTTPHeaderTokenizer::headerField(const char* line, size_t length)
+{
+  const char* colon = (const char*)memchr(line, ':', length);
+  if(colon == NULL)
+    return false;
+
+  m_first = line;
+  m_firstLength = colon - line;
+  while(m_firstLength > 0 && isSpace(line[m_firstLength - 1]))
+    m_firstLength--;
+
+  const char* value = colon + 1;
+  const char* end = line + length;
+  while(value < end && isSpace(*value))
+    value++;
+  while(end > value && isSpace(end[-1]))
+    end--;
+  m_second = value;
+  m_secondLength = end - value;
+
+  m_field = Other;
+  for(int i = 0; knownFields[i].name != NULL; i++) {
+    if(knownFields[i].length == m_firstLength &&
+       equals(m_first, m_firstLength, knownFields[i].name)) {
+      m_field = knownFields[i].field;
+      break;
+    }
+  }
+  return true;
+}
+
+bool HTTPHeaderTokenizer::equals(const char* data, size_t length, const char* lower) // static
+{
+  size_t i;
+  for(i = 0; i < length; i++) {
+    if(lower[i] == '\0' || lowerCase(data[i]) != lower[i])
+      return false;
+  }
+  return (lower[i] == '\0');
+}
+
+bool HTTPHeaderTokenizer::startsWith(const char* data, size_t length, const char* lower) // static
+{
+  size_t i;
+  for(i = 0; lower[i] != '\0'; i++) {
+    if(i == length || lowerCase(data[i]) != lower[i])
+      return false;
+  }
+  return true;
+}
+
+fuppes_off_t HTTPHeaderTokenizer::toNumber(const char* data, size_t length) // static
+{
+  if(length == 0 || data[0] < '0' || data[0] > '9')
+    return -1;
+
+  fuppes_off_t result = 0;
+  for(size_t i = 0; i < length && data[i] >= '0' && data[i] <= '9'; i++) {
+    result = (result * 10) + (data[i] - '0');
+  }
+  return result;
+}
@@ -0,0 +1,134 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            HTTPHeaderTokenizer.h
+ *
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _HTTPHEADERTOKENIZER_H
+#define _HTTPHEADERTOKENIZER_H
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#include "../../../include/fuppes_types.h"
+#include <stddef.h>
+
+/**
+ * splits an http header into the start line and the header fields.
+ *
+ * the tokenizer does not copy or allocate anything. it works on the
+ * caller's buffer and returns pointers into it. it remembers how far it
+ * got so the buffer can grow between two calls (e.g. after each recv())
+ * and every byte is scanned only once.
+ */
+class HTTPHeaderTokenizer
+{
+  public:
+    enum Token {
+      // the buffer ends before the next line is complete
+      Incomplete,
+      // the request or status line. see first(), second() and third()
+      StartLine,
+      // a header field. see field(), name() and value()
+      Field,
+      // the empty line. see headerLength()
+      End,
+      // the start line is malformed
+      Invalid
+    };
+
+    // the header fields we are interested in
+    enum HeaderField {
+      Other,
+      Callback,
+      Connection,
+      ContentFeatures,
+      ContentLength,
+      GetCaptionInfo,
+      GetContentFeatures,
+      Nt,
+      Range,
+      SoapAction,
+      TransferEncoding,
+      TransferMode,
+      UserAgent,
+      VirtualLayout
+    };
+
+    HTTPHeaderTokenizer() { reset(); }
+    void reset();
+
+    /**
+     * returns the next token.
+     * buffer must contain the data of all previous calls (it may have
+     * been reallocated in the meantime). the pointers returned by
+     * the accessors are valid until the buffer changes
+     */
+    Token next(const char* buffer, size_t length);
+
+    // start line: method, uri and version or version, status code and reason
+    const char*   first() { return m_first; }
+    size_t        firstLength() { return m_firstLength; }
+    const char*   second() { return m_second; }
+    size_t        secondLength() { return m_secondLength; }
+    const char*   third() { return m_third; }
+    size_t        thirdLength() { return m_thirdLength; }
+
+    // the current header field. the value is trimmed
+    HeaderField   field() { return m_field; }
+    const char*   name() { return m_first; }
+    size_t        nameLength() { return m_firstLength; }
+    const char*   value() { return m_second; }
+    size_t        valueLength() { return m_secondLength; }
+
+    // the size of the header including the empty line. valid after End
+    size_t        headerLength() { return m_headerLength; }
+
+    // case insensitive comparison. lower must be lower case
+    static bool   equals(const char* data, size_t length, const char* lower);
+    // true if data starts with lower (case insensitive)
+    static bool   startsWith(const char* data, size_t length, const char* lower);
+    // the decimal number at the beginning of data. -1 if there is none
+    static fuppes_off_t toNumber(const char* data, size_t length);
+
+  private:
+    bool          startLine(const char* line, size_t length);
+    bool          headerField(const char* line, size_t length);
+
+    // the offset of the current line and the offset we continue scanning for its end
+    size_t        m_lineStart;
+    size_t        m_scanned;
+    bool          m_startLine;
+    bool          m_done;
+    size_t        m_headerLength;
+
+    HeaderField   m_field;
+    const char*   m_first;
+    size_t        m_firstLength;
+    const char*   m_second;
+    size_t        m_secondLength;
+    const char*   m_third;
+    size_t        m_thirdLength;
+};
+
+#endif // _HTTPHEADERTOKENIZER_H
@@ -55,11 +55,14 @@ CHTTPMessage::CHTTPMessage()
   m_nRangeEnd           = 0;
 	m_hasRange						= false;
   m_nHTTPConnection     = HTTP_CONNECTION_UNKNOWN;
+  m_keepAlive           = false;
   m_pUPnPAction         = NULL;
 	m_pDeviceSettings			= NULL;
   #ifndef DISABLE_TRANSCODING
   m_pTranscodingSessionInfo = NULL;  
   m_pTranscodingCacheObj = NULL;
+  m_nTranscodingStart    = 0;
+  m_bFirstByteSent       = false;
   #endif
   m_nTransferEncoding    = HTTP_TRANSFER_ENCODING_NONE;
 
@@ -184,6 +187,9 @@ std::string CHTTPMessage::GetHeaderAsString()
       break;
 	  case HTTP_MESSAGE_TYPE_404_NOT_FOUND:
       sResult << sVersion << " 404 Not Found\r\n";
+      break;
+    case HTTP_MESSAGE_TYPE_413_REQUEST_ENTITY_TOO_LARGE:
+      sResult << sVersion << " 413 Request Entity Too Large\r\n";
       break;
 	  case HTTP_MESSAGE_TYPE_500_INTERNAL_SERVER_ERROR:
       sResult << sVersion << " " << "500 Internal Server Error\r\n";
@@ -195,7 +201,7 @@ std::string CHTTPMessage::GetHeaderAsString()
       break;    
       
     default:
-      CSharedLog::Log(L_DBG, __FILE__, __LINE__, "GetHeaderAsString() :: unhandled message type");
+      SHARED_LOG(L_DBG, "GetHeaderAsString() :: unhandled message type");
       assert(0);
       break;
 	}		  
@@ -211,7 +217,7 @@ std::string CHTTPMessage::GetHeaderAsString()
     
     // if it's a non binary file give the length of m_sContent
     if(!m_bIsBinary) {
-      sResult << "Content-Length: " << (int)strlen(m_sContent.c_str()) << "\r\n";
+      sResult << "Content-Length: " << m_sContent.length() << "\r\n";
     }
     // otherwise calc length
     else
@@ -301,7 +307,10 @@ std::string CHTTPMessage::GetHeaderAsString()
     sResult << "Cache-control: no-cache\r\n";
 		
     // connection
-    sResult << "Connection: close\r\n";
+    if(m_keepAlive)
+      sResult << "Connection: keep-alive\r\n";
+    else
+      sResult << "Connection: close\r\n";
 	
     // date
     char   szTime[30];
@@ -345,10 +354,12 @@ std::string CHTTPMessage::GetHeaderAsString()
 
 std::string CHTTPMessage::GetMessageAsString()
 {
-  stringstream sResult;
-  sResult << GetHeaderAsString();
-  sResult << m_sContent;
-  return sResult.str();
+  std::string sHeader = GetHeaderAsString();
+  std::string sResult;
+  sResult.reserve(sHeader.length() + m_sContent.length());
+  sResult  = sHeader;
+  sResult += m_sContent;
+  return sResult;
 }
 
 fuppes_off_t CHTTPMessage::GetBinContentLength()
@@ -415,7 +426,6 @@ unsigned int CHTTPMessage::GetBinContentChunk(char* p_sContentChunk, unsigned in
     #endif
     
     unsigned int nRest = 0;
-    unsigned int nDelayCount = 0;
     
     #ifndef DISABLE_TRANSCODING
     if(bTranscode) {
@@ -454,45 +464,33 @@ unsigned int CHTTPMessage::GetBinContentChunk(char* p_sContentChunk, unsigned in
     
     
     #ifndef DISABLE_TRANSCODING
-    while(bTranscode && 
-          !m_pTranscodingCacheObj->m_bIsComplete && 
-          (nRest < p_nSize) && 
-          !m_pTranscodingSessionInfo->m_bBreakTranscoding)
+    // we are sending faster than we can transcode.
+    // the transcoding thread wakes us up as soon as new data is available.
+    // the first chunk is sent as soon as there is any data
+    if(bTranscode && 
+       !m_pTranscodingCacheObj->m_bIsComplete && 
+       (nRest < p_nSize) && 
+       !m_pTranscodingSessionInfo->m_bBreakTranscoding)
     { 
-      if(m_pTranscodingCacheObj->GetValidBytes() > m_nBinContentPosition) {
-        nRest = m_pTranscodingCacheObj->GetValidBytes() - m_nBinContentPosition; 
-      }
-      else {
-        nRest = 0;
-      }
+      unsigned int nWanted = m_bFirstByteSent ? p_nSize : 1;
+      unsigned int nDeadline = CSharedConfig::Shared()->globalSettings->TranscodingDeadline() * 1000;
       
-      stringstream sLog;
-      sLog << "we are sending faster then we can transcode!" << endl;
-      sLog << "  try     : " << (nDelayCount + 1) << "/20" << endl;
-      sLog << "  length  : " << m_pTranscodingCacheObj->GetValidBytes() << endl;
-      sLog << "  position: " << m_nBinContentPosition << endl;
-      sLog << "  size    : " << p_nSize << endl;
-      sLog << "  rest    : " << nRest << endl;
-      sLog << "delaying send-process!";
-      
-      CSharedLog::Shared()->Log(L_DBG, __FILE__, __LINE__,  sLog.str().c_str());
-                                   
-      fuppesSleep(500);
-                              
-      nDelayCount++;
-      
-      // if bufer is still empty after 10 seconds
-      //   the machine seems to be too slow. so
-      //   we give up
-      if (nDelayCount == 20) { // 20 * 500ms = 10sec
-        BreakTranscoding();                                  
+      if(!m_pTranscodingCacheObj->WaitForData(m_nBinContentPosition + nWanted, nDeadline) &&
+         m_pTranscodingCacheObj->GetValidBytes() <= m_nBinContentPosition) {
+        
+        // the machine seems to be too slow. so we give up
+        SHARED_LOG(L_DBG, "no data from transcoder after %d seconds. giving up", nDeadline / 1000);
+        BreakTranscoding();
         return 0;
       }
     }
 
     
     if(bTranscode) {
-      nRest = m_pTranscodingCacheObj->GetValidBytes() - m_nBinContentPosition;
+      if(m_pTranscodingCacheObj->GetValidBytes() > m_nBinContentPosition)
+        nRest = m_pTranscodingCacheObj->GetValidBytes() - m_nBinContentPosition;
+      else
+        nRest = 0;
     }
     else {
       nRest = m_nBinContentLength - m_nBinContentPosition;         
@@ -529,9 +527,14 @@ unsigned int CHTTPMessage::GetBinContentChunk(char* p_sContentChunk, unsigned in
       
       #ifndef DISABLE_TRANSCODING
       if(bTranscode) {        
-        m_pTranscodingCacheObj->Lock();        
-        memcpy(p_sContentChunk, &m_pTranscodingCacheObj->m_sBuffer[m_nBinContentPosition], nRest);
-        m_pTranscodingCacheObj->Unlock();
+        nRest = m_pTranscodingCacheObj->Read(p_sContentChunk, m_nBinContentPosition, nRest);
+        
+        if(!m_bFirstByteSent && nRest > 0) {
+          m_bFirstByteSent = true;
+          unsigned int nTime = fuppesTicks() - m_nTranscodingStart;
+          CTranscodingCache::Shared()->AddTimeToFirstByte(nTime);
+          SHARED_LOG(L_EXT, "time to first byte: %u ms :: %s", nTime, m_pTranscodingSessionInfo->m_sInFileName.c_str());
+        }
       }
       else
       #endif
@@ -628,112 +631,20 @@ bool CHTTPMessage::BuildFromString(std::string p_sMessage)
 {
   m_nBinContentLength = 0;
   m_sMessage = p_sMessage;  
-  
-  bool bResult = false;
 
-  /* Message GET */
-  RegEx rxGET("GET +(.+) +HTTP/1\\.([1|0])", PCRE_CASELESS);
-  if(rxGET.Search(p_sMessage.c_str()))
-  {
-    m_nHTTPMessageType = HTTP_MESSAGE_TYPE_GET;
-
-    string sVersion = rxGET.Match(2);
-    if(sVersion.compare("0") == 0)		
-      m_nHTTPVersion = HTTP_VERSION_1_0;		
-    else if(sVersion.compare("1") == 0)		
-      m_nHTTPVersion = HTTP_VERSION_1_1;
-
-    m_sRequest = rxGET.Match(1);
-    bResult = true;		
-  }
-
-  /* Message HEAD */
-  RegEx rxHEAD("HEAD +(.+) +HTTP/1\\.([1|0])", PCRE_CASELESS);
-  if(rxHEAD.Search(p_sMessage.c_str()))
-  {
-    m_nHTTPMessageType = HTTP_MESSAGE_TYPE_HEAD;
-
-    string sVersion = rxHEAD.Match(2);
-    if(sVersion.compare("0") == 0)		
-      m_nHTTPVersion = HTTP_VERSION_1_0;		
-    else if(sVersion.compare("1") == 0)		
-      m_nHTTPVersion = HTTP_VERSION_1_1;
-
-    m_sRequest = rxHEAD.Match(1);			   
-    bResult = true;  
-  }
-   
-  
-  /* Message POST */
-  RegEx rxPOST("POST +(.+) +HTTP/1\\.([1|0])", PCRE_CASELESS);
-  if(rxPOST.Search(p_sMessage.c_str()))
-  {
-    string sVersion = rxPOST.Match(2);
-    if(sVersion.compare("0") == 0)		
-      m_nHTTPVersion = HTTP_VERSION_1_0;		
-    else if(sVersion.compare("1") == 0)
-      m_nHTTPVersion = HTTP_VERSION_1_1;
-
-    m_sRequest = rxPOST.Match(1);			
-
-    bResult = ParsePOSTMessage(p_sMessage);
-  }
-  
-  /* Message SUBSCRIBE */
-  RegEx rxSUBSCRIBE("[SUBSCRIBE|UNSUBSCRIBE]+ +(.+) +HTTP/1\\.([1|0])", PCRE_CASELESS);
-  if(rxSUBSCRIBE.Search(p_sMessage.c_str()))
-  {
-    m_nHTTPMessageType = HTTP_MESSAGE_TYPE_SUBSCRIBE;     
-    
-    string sVersion = rxSUBSCRIBE.Match(2);
-    if(sVersion.compare("0") == 0)		
-      m_nHTTPVersion = HTTP_VERSION_1_0;		
-    else if(sVersion.compare("1") == 0)
-      m_nHTTPVersion = HTTP_VERSION_1_1;
-
-    m_sRequest = rxSUBSCRIBE.Match(1);
-                                 
-    bResult = ParseSUBSCRIBEMessage(p_sMessage);       
-  }
-  
-  /* Range */
-  RegEx rxRANGE("RANGE: +BYTES=(\\d*)(-\\d*)", PCRE_CASELESS);
-  if(rxRANGE.Search(p_sMessage.c_str()))
-  {
-		m_hasRange = true;
-    string sMatch1 = rxRANGE.Match(1);    
-    string sMatch2;
-    if(rxRANGE.SubStrings() > 2)
-     sMatch2 = rxRANGE.Match(2);
-
-    if(sMatch1.substr(0,1) != "-")
-      m_nRangeStart = strToOffT(rxRANGE.Match(1));
-    else
-      m_nRangeStart = 0;
-    
-    m_nRangeEnd = 0;
-    
-    string sSub;
-    if(sMatch1.substr(0, 1) == "-") {
-      sSub = sMatch1.substr(1, sMatch1.length());
-      m_nRangeEnd   = strToOffT(sSub.c_str());
-    }
-    else if(rxRANGE.SubStrings() > 2)
-    {
-      sSub = sMatch2.substr(1, sMatch2.length());
-      m_nRangeEnd   = strToOffT(sSub.c_str());
-    }
-  }
-  
-  /* CONNECTION */
-  RegEx rxCONNECTION("CONNECTION: +(close|keep-alive)", PCRE_CASELESS);
-  if(rxCONNECTION.Search(p_sMessage.c_str())) {   
-    std::string sConnection = ToLower(rxCONNECTION.Match(1));
-    if(sConnection.compare("close") == 0)
-      m_nHTTPConnection = HTTP_CONNECTION_CLOSE;
+  // the request line and the header fields have been
+  // set by CHTTPParser::parseHeader()
+  switch(m_nHTTPMessageType) {
+    case HTTP_MESSAGE_TYPE_GET:
+    case HTTP_MESSAGE_TYPE_HEAD:
+    case HTTP_MESSAGE_TYPE_SUBSCRIBE:
+      return true;
+    case HTTP_MESSAGE_TYPE_POST:
+    case HTTP_MESSAGE_TYPE_POST_SOAP_ACTION:
+      return (m_nContentLength < (fuppes_off_t)p_sMessage.length());
+    default:
+      return false;
   }
-  
-  return bResult;
 }
 
 bool CHTTPMessage::LoadContentFromFile(std::string p_sFileName)
@@ -768,11 +679,11 @@ bool CHTTPMessage::LoadContentFromFile(std::string p_sFileName)
 bool CHTTPMessage::TranscodeContentFromFile(std::string p_sFileName, fuppes::DbObject* object)
 { 
   #ifdef DISABLE_TRANSCODING
-  CSharedLog::Log(L_EXT, __FILE__, __LINE__, "TranscodeContentFromFile :: %s - %s", p_sFileName.c_str(), "ERROR: transcoding disabled");
+  SHARED_LOG(L_EXT, "TranscodeContentFromFile :: %s - %s", p_sFileName.c_str(), "ERROR: transcoding disabled");
   return false;
   #else
   
-  CSharedLog::Log(L_EXT, __FILE__, __LINE__, "TranscodeContentFromFile :: %s", p_sFileName.c_str());
+  SHARED_LOG(L_EXT, "TranscodeContentFromFile :: %s", p_sFileName.c_str());
     
   if(m_pTranscodingSessionInfo) {
     delete m_pTranscodingSessionInfo;
@@ -782,6 +693,8 @@ bool CHTTPMessage::TranscodeContentFromFile(std::string p_sFileName, fuppes::DbO
   }  
 	
   m_bIsBinary  = true;  
+  m_nTranscodingStart = fuppesTicks();
+  m_bFirstByteSent    = false;
   m_pTranscodingSessionInfo = new CTranscodeSessionInfo();
   m_pTranscodingSessionInfo->m_bBreakTranscoding   = false;
   m_pTranscodingSessionInfo->m_bIsTranscoding      = true;
@@ -796,9 +709,9 @@ bool CHTTPMessage::TranscodeContentFromFile(std::string p_sFileName, fuppes::DbO
   m_pTranscodingSessionInfo->sACodec    = object->details()->audioCodec(); //.sACodec;
   m_pTranscodingSessionInfo->sVCodec    = object->details()->videoCodec(); //.sVCodec;
 
-  m_pTranscodingCacheObj = CTranscodingCache::Shared()->GetCacheObject(m_pTranscodingSessionInfo->m_sInFileName);
+  m_pTranscodingCacheObj = CTranscodingCache::Shared()->GetCacheObject(m_pTranscodingSessionInfo, DeviceSettings());
   if(!m_pTranscodingCacheObj->Init(m_pTranscodingSessionInfo, DeviceSettings())) {
-		CSharedLog::Log(L_EXT, __FILE__, __LINE__, "init transcoding failed :: %s", p_sFileName.c_str());
+		SHARED_LOG(L_EXT, "init transcoding failed :: %s", p_sFileName.c_str());
 		return false;
 	}
 	
@@ -829,95 +742,34 @@ bool CHTTPMessage::IsTranscoding()
     return false;
 }
 
-void CHTTPMessage::BreakTranscoding()
+bool CHTTPMessage::isLocalFile()
 {
   #ifndef DISABLE_TRANSCODING
-  if(m_pTranscodingSessionInfo) {                            
-    m_pTranscodingSessionInfo->m_bBreakTranscoding = true;   
-  }
+  if(m_pTranscodingSessionInfo)
+    return false;
   #endif
+  return m_file.isOpen();
 }
 
-
-
-bool CHTTPMessage::ParsePOSTMessage(std::string p_sMessage)
+bool CHTTPMessage::isInMemory()
 {
-  /*POST /UPnPServices/ContentDirectory/control HTTP/1.1
-    Host: 192.168.0.3:32771
-    SOAPACTION: "urn:schemas-upnp-org:service:ContentDirectory:1#Browse"
-    CONTENT-TYPE: text/xml ; charset="utf-8"
-    Content-Length: 467*/
-	
-  RegEx rxSOAP("SOAPACTION: *\"(.*)#(.+)\"", PCRE_CASELESS);
-	if(rxSOAP.Search(p_sMessage.c_str()))	{
-		
-		m_soapTarget = rxSOAP.Match(1);
-		m_soapAction = rxSOAP.Match(2);
-
-    m_nHTTPMessageType = HTTP_MESSAGE_TYPE_POST_SOAP_ACTION;
-	}
-  else
-  {
-    m_nHTTPMessageType = HTTP_MESSAGE_TYPE_POST;
-  }
-      
-  /* Content length */
-  RegEx rxContentLength("CONTENT-LENGTH: *(\\d+)", PCRE_CASELESS);
-  if(rxContentLength.Search(p_sMessage.c_str()))
-  {
-    string sContentLength = rxContentLength.Match(1);    
-    m_nContentLength = atoll(sContentLength.c_str());
-  }
-  
-  if((unsigned int)m_nContentLength >= p_sMessage.length())                      
+  #ifndef DISABLE_TRANSCODING
+  if(m_pTranscodingSessionInfo || m_pTranscodingCacheObj)
     return false;
-  
-  //m_sContent = p_sMessage.substr(p_sMessage.length() - m_nContentLength, m_nContentLength);
-  
-  return true;
+  #endif
+  return m_bIsBinary && !m_file.isOpen();
 }
 
-bool CHTTPMessage::ParseSUBSCRIBEMessage(std::string p_sMessage)
+void CHTTPMessage::BreakTranscoding()
 {
-/*
-SUBSCRIBE /UPnPServices/ConnectionManager/event/ HTTP/1.1
-HOST: 192.168.0.3:58444
-CALLBACK: <http://192.168.0.3:49152/>
-NT: upnp:event
-TIMEOUT: Second-1801
-
-
-SUBSCRIBE /UPnPServices/ConnectionManager/event/ HTTP/1.1
-TIMEOUT: Second-15
-HOST: 192.168.0.3:1050
-CALLBACK: <http://192.168.0.3:42577>
-NT: upnp:event
-Content-Length: 0
-
-*/     
-
-  //cout << "PARSE SUBSCRIBE" << endl;
-
-  RegEx rxCallBack("CALLBACK: *(.+)", PCRE_CASELESS);
-  if(rxCallBack.Search(p_sMessage.c_str()))
-  {
-    m_sGENACallBack = rxCallBack.Match(1);
+  #ifndef DISABLE_TRANSCODING
+  if(m_pTranscodingSessionInfo) {                            
+    m_pTranscodingSessionInfo->m_bBreakTranscoding = true;   
   }
+  #endif
+}
 
-  RegEx rxNT("NT: *(.+)", PCRE_CASELESS);
-  if(rxNT.Search(p_sMessage.c_str()))
-  {
-    m_sGENANT = rxNT.Match(1);
-  }
 
-  // Header information: Timeout (GENA - Request)
-  //std::string        m_sGENATimeout;  
-  // Header information: Subscription-ID (GENA - Request & Response)
-  //std::string        m_sGENASubscriptionID;    
-  
-  
-  return true;     
-}
 
 void CHTTPMessage::SetLocalEndPoint(sockaddr_in p_EndPoint)
 {	
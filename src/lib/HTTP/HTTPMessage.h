@@ -80,7 +80,9 @@ typedef enum tagHTTP_MESSAGE_TYPE
   HTTP_MESSAGE_TYPE_SUBSCRIBE        = 11,
   HTTP_MESSAGE_TYPE_UNSUBSCRIBE      = 12,
   HTTP_MESSAGE_TYPE_GENA_OK          = 13,
-  HTTP_MESSAGE_TYPE_NOTIFY           = 14
+  HTTP_MESSAGE_TYPE_NOTIFY           = 14,
+
+  HTTP_MESSAGE_TYPE_413_REQUEST_ENTITY_TOO_LARGE = 15
   
 }HTTP_MESSAGE_TYPE;
 
@@ -209,6 +211,7 @@ class CHTTPMessage
     std::string       GetContentType()      { return m_sHTTPContentType;  }
     HTTP_MESSAGE_TYPE GetMessageType()      { return m_nHTTPMessageType;  }
     HTTP_VERSION      GetVersion()          { return m_nHTTPVersion;      }
+    fuppes_off_t      GetContentLength()    { return m_nContentLength;    }
     //std::string       GetContent()          { return m_sContent;          }
     fuppes_off_t      GetBinContentLength();
     char*             GetBinContent()       { return m_sBuffer;     }
@@ -232,6 +235,9 @@ class CHTTPMessage
     void              SetRangeStart(fuppes_off_t p_nRangeStart) { m_nRangeStart = p_nRangeStart; }
     void              SetRangeEnd(fuppes_off_t p_nRangeEnd) { m_nRangeEnd = p_nRangeEnd; }
     HTTP_CONNECTION   GetHTTPConnection() { return m_nHTTPConnection; }
+    // keep the connection open after the response has been sent
+    void              keepAlive(bool keepAlive) { m_keepAlive = keepAlive; }
+    bool              keepAlive() { return m_keepAlive; }
   
     bool              PostVarExists(std::string p_sPostVarName);
     std::string       GetPostVar(std::string p_sPostVarName);
@@ -245,7 +251,9 @@ class CHTTPMessage
     void             SetMessageType(HTTP_MESSAGE_TYPE p_nHTTPMessageType) { m_nHTTPMessageType = p_nHTTPMessageType; }
     void             SetVersion(HTTP_VERSION p_nHTTPVersion)              { m_nHTTPVersion     = p_nHTTPVersion;     }
     void             SetContentType(std::string p_sContentType)           { m_sHTTPContentType = p_sContentType;     }
-  	void						 SetContent(std::string p_sContent)                   { m_sContent         = p_sContent;         }
+  	void						 SetContent(const std::string& p_sContent)            { m_sContent         = p_sContent;         }
+    // takes over the content without copying it. p_sContent is left with the previous content
+    void             SwapContent(std::string& p_sContent)                 { m_sContent.swap(p_sContent);            }
     void             SetBinContent(char* p_szBinContent, fuppes_off_t p_nBinContenLength);  
     
     std::string				GetGENASubscriptionID() { return m_sGENASubscriptionID; }
@@ -287,11 +295,19 @@ class CHTTPMessage
     bool             TranscodeContentFromFile(std::string p_sFileName, fuppes::DbObject* object);
     void             BreakTranscoding();  
     bool             IsTranscoding();
+
+    // the content is served untranscoded from a local file
+    bool             isLocalFile();
+    // the binary content has been set with SetBinContent() (images, thumbnails)
+    bool             isInMemory();
+    fuppes::File*    localFile() { return &m_file; }
   
 	  CDeviceSettings*  DeviceSettings() { return m_pDeviceSettings; }
 	  void              DeviceSettings(CDeviceSettings* pSettings) { m_pDeviceSettings = pSettings; }
 		std::string       virtualFolderLayout() { return m_virtualFolderLayout; }
 		void							setVirtualFolderLayout(std::string layout) { m_virtualFolderLayout = layout; }
+    // VIRTUAL-LAYOUT: name
+    std::string       requestedVirtualFolderLayout() { return m_requestedVirtualFolderLayout; }
 		
 		std::string GetRemoteIPAddress();
 		void        SetLocalEndPoint(sockaddr_in);
@@ -315,6 +331,9 @@ class CHTTPMessage
     #ifndef DISABLE_TRANSCODING
     CTranscodeSessionInfo* m_pTranscodingSessionInfo;    
     CTranscodingCacheObject* m_pTranscodingCacheObj;
+    // fuppesTicks() when the transcoding was requested
+    unsigned int  m_nTranscodingStart;
+    bool          m_bFirstByteSent;
     #endif
     //fuppesThreadMutex TranscodeMutex;    
   
@@ -330,9 +349,10 @@ private:
     // Header information: HTTP request line
     std::string	       m_sRequest;
     // Header information: content length
-    int                m_nContentLength;
+    fuppes_off_t       m_nContentLength;
     // Header information: Connection [close|keep alive]
     HTTP_CONNECTION    m_nHTTPConnection;
+    bool               m_keepAlive;
    
     // Header information: Call-Back (GENA - Request)
     std::string        m_sGENACallBack;
@@ -367,15 +387,13 @@ private:
   
 	  CDeviceSettings* 		m_pDeviceSettings;   
 		std::string					m_virtualFolderLayout;
+		std::string					m_requestedVirtualFolderLayout;
 
 		std::string m_sContent;
     std::string m_sHeader;
     std::string m_sMessage;
 		sockaddr_in m_LocalEp;
 		sockaddr_in m_RemoteEp;
-	
-		bool ParsePOSTMessage(std::string p_sMessage);
-    bool ParseSUBSCRIBEMessage(std::string p_sMessage);
 
 };
 
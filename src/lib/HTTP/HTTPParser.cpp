@@ -28,6 +28,19 @@
 #include "../Common/RegEx.h"
 #include "../DeviceSettings/DeviceIdentificationMgr.h"
 
+#include <ctype.h>
+#include <string.h>
+
+// the length of the leading word (\w+) of value
+static size_t wordLength(const char* value, size_t length)
+{
+  size_t result = 0;
+  while(result < length &&
+        (isalnum((unsigned char)value[result]) || value[result] == '_'))
+    result++;
+  return result;
+}
+
 bool CHTTPParser::parseHeader(std::string header, CHTTPMessage* message)
 {
 	// header is already parsed
@@ -35,114 +48,67 @@ bool CHTTPParser::parseHeader(std::string header, CHTTPMessage* message)
 		return true;
 	}
 
-  // detect message type and HTTP version
-  std::string sType;
-  int nVersion;
-  
-  RegEx rxRequest("([GET|HEAD|POST|SUBSCRIBE|UNSUBSCRIBE|NOTIFY]+) +(.+) +HTTP/1\\.([1|0])", PCRE_CASELESS);
-  RegEx rxResponse("HTTP/1\\.([1|0]) +(\\d+) +(.+)", PCRE_CASELESS);
- 	
-	// it's a request
-  if(rxRequest.Search(header)) { 
-    sType    = rxRequest.Match(1);
-    nVersion = atoi(rxRequest.Match(3).c_str());
-		message->m_sRequest = rxRequest.Match(2);
-  }
-	// it's a response
-  else if(rxResponse.Search(header)) {
-		sType    = rxResponse.Match(2);
-		nVersion = atoi(rxResponse.Match(1).c_str());
-		message->m_sRequest = rxRequest.Match(3);
-	}
-	else {    
-		return false;
-	}
-  
-	// set version
-	if(nVersion == 0)
-	  message->SetVersion(HTTP_VERSION_1_0);
-	else if(nVersion == 1)
-	  message->SetVersion(HTTP_VERSION_1_1);
-	else {    
-	  return false;
-  }
-    
-  // set message type
-  sType = ToUpper(sType);
-	
-  // GET
-  if(sType.compare("GET") == 0) {
-	  message->SetMessageType(HTTP_MESSAGE_TYPE_GET);
-	}
-  
-	// HEAD
-  else if(sType.compare("HEAD") == 0) {
-	  message->SetMessageType(HTTP_MESSAGE_TYPE_HEAD);
+  // the header may end without the empty line
+  HTTPHeaderTokenizer tokenizer;
+  if(tokenize(&tokenizer, header.c_str(), header.length(), message) == HTTPHeaderTokenizer::Invalid ||
+     message->m_nHTTPVersion == HTTP_VERSION_UNKNOWN) {
+    return false;
   }
-	
-  // POST
-	else if(sType.compare("POST") == 0) {
-	  message->SetMessageType(HTTP_MESSAGE_TYPE_POST);
+
+	CDeviceIdentificationMgr::Shared()->IdentifyDevice(message); 
+  return true;
+}
+
+HTTPHeaderTokenizer::Token CHTTPParser::parseHeader(HTTPHeaderTokenizer* tokenizer, const char* buffer, size_t length, CHTTPMessage* message) // static
+{
+  HTTPHeaderTokenizer::Token token = tokenize(tokenizer, buffer, length, message);
+  if(token == HTTPHeaderTokenizer::End) {
+    message->m_sHeader.assign(buffer, tokenizer->headerLength());
+    CDeviceIdentificationMgr::Shared()->IdentifyDevice(message);
   }
+  return token;
+}
 
-  /* SUBSCRIBE|UNSUBSCRIBE */
-  
-  /* NOTIFY */
-  
-  // 200 OK
-	else if(sType.compare("200") == 0) {
-	  message->SetMessageType(HTTP_MESSAGE_TYPE_200_OK);
-	}
-	
-	// 403 FORBIDDEN
-	else if(sType.compare("403") == 0) {
-	  message->SetMessageType(HTTP_MESSAGE_TYPE_403_FORBIDDEN);
-	}
-	
-	// 404 NOT FOUND
-	else if(sType.compare("404") == 0) {
-	  message->SetMessageType(HTTP_MESSAGE_TYPE_404_NOT_FOUND);
-	}
+HTTPHeaderTokenizer::Token CHTTPParser::tokenize(HTTPHeaderTokenizer* tokenizer, const char* buffer, size_t length, CHTTPMessage* message) // static
+{
+  HTTPHeaderTokenizer::Token token;
+  while(true) {
+    token = tokenizer->next(buffer, length);
+    if(token == HTTPHeaderTokenizer::StartLine) {
+      if(!parseStartLine(tokenizer, message))
+        return HTTPHeaderTokenizer::Invalid;
+    }
+    else if(token == HTTPHeaderTokenizer::Field) {
+      parseField(tokenizer, message);
+    }
+    else {
+      return token;
+    }
+  }
+}
 
-	
-	/*RegEx rxContentLength("CONTENT-LENGTH: *(\\d+)", PCRE_CASELESS);
-  if(rxContentLength.Search(header.c_str())) {
-    string sContentLength = rxContentLength.Match(1);    
-    int nContentLength = ::atoi(sContentLength.c_str());
+static fuppes_off_t contentLength(const char* buffer)
+{
+  HTTPHeaderTokenizer tokenizer;
+  HTTPHeaderTokenizer::Token token;
+  size_t length = strlen(buffer);
+  while((token = tokenizer.next(buffer, length)) == HTTPHeaderTokenizer::StartLine ||
+        token == HTTPHeaderTokenizer::Field) {
+    if(token == HTTPHeaderTokenizer::Field && tokenizer.field() == HTTPHeaderTokenizer::ContentLength)
+      return HTTPHeaderTokenizer::toNumber(tokenizer.value(), tokenizer.valueLength());
   }
-	else {
-		return false;
-	}*/
-	
-	parseCommonValues(header, message);
-	parseGetVars(header, message);
-  parseDlnaHeader(header, message);
-  
-	CDeviceIdentificationMgr::Shared()->IdentifyDevice(message); 
-  return true;
+  return -1;
 }
 
 bool CHTTPParser::hasContentLength(char* buffer) 
 {
-	RegEx rxContentLength("CONTENT-LENGTH: *(\\d+)", PCRE_CASELESS);
-  if(rxContentLength.Search(buffer)) {
-    return true;
-  }
-	else {
-		return false;
-	}
+  return (contentLength(buffer) >= 0);
 }
 
 fuppes_off_t CHTTPParser::getContentLength(char* buffer)
 {
-	RegEx rxContentLength("CONTENT-LENGTH: *(\\d+)", PCRE_CASELESS);
-  if(rxContentLength.Search(buffer)) {
-    fuppes_off_t contentLength = strToOffT(rxContentLength.Match(1));
-		return contentLength;
-  }
-	else {
-		return 0;
-	}
+  fuppes_off_t result = contentLength(buffer);
+  return (result >= 0 ? result : 0);
 }
 
 void CHTTPParser::ConvertURLEncodeContentToPlain(CHTTPMessage* message)
@@ -191,20 +157,171 @@ void CHTTPParser::ConvertURLEncodeContentToPlain(CHTTPMessage* message)
   message->SetContent(sVars.str());
 }
 
-void CHTTPParser::parseCommonValues(std::string header, CHTTPMessage* message)
+bool CHTTPParser::parseStartLine(HTTPHeaderTokenizer* tokenizer, CHTTPMessage* message) // static
 {
-  RegEx rxUserAgent("USER-AGENT: *(.*)\r\n", PCRE_CASELESS);
-	if(rxUserAgent.Search(header.c_str())) {
-		message->m_sUserAgent = rxUserAgent.Match(1);
-	}
+  const char* type;
+  size_t      typeLength;
+  const char* version;
+  size_t      versionLength;
+  bool        request;
 
-  RegEx rxTransferEncoding("Transfer-Encoding: *(\\w+)\r\n", PCRE_CASELESS);
-	if(rxTransferEncoding.Search(header)) {
-    string encoding = ToLower(rxTransferEncoding.Match(1));
-    if(encoding == "chunked")
-      message->m_nTransferEncoding = HTTP_TRANSFER_ENCODING_CHUNKED;
-	}
-  
+  // it's a response
+  if(HTTPHeaderTokenizer::startsWith(tokenizer->first(), tokenizer->firstLength(), "http/")) {
+    version       = tokenizer->first();
+    versionLength = tokenizer->firstLength();
+    type          = tokenizer->second();
+    typeLength    = tokenizer->secondLength();
+    request       = false;
+    message->m_sRequest.assign(tokenizer->third(), tokenizer->thirdLength());
+  }
+  // it's a request
+  else {
+    type          = tokenizer->first();
+    typeLength    = tokenizer->firstLength();
+    version       = tokenizer->third();
+    versionLength = tokenizer->thirdLength();
+    request       = true;
+    message->m_sRequest.assign(tokenizer->second(), tokenizer->secondLength());
+  }
+
+	// set version
+  if(HTTPHeaderTokenizer::equals(version, versionLength, "http/1.0"))
+	  message->SetVersion(HTTP_VERSION_1_0);
+  else if(HTTPHeaderTokenizer::equals(version, versionLength, "http/1.1"))
+	  message->SetVersion(HTTP_VERSION_1_1);
+	else {    
+	  return false;
+  }
+    
+  // set message type
+  if(HTTPHeaderTokenizer::equals(type, typeLength, "get"))
+	  message->SetMessageType(HTTP_MESSAGE_TYPE_GET);
+  else if(HTTPHeaderTokenizer::equals(type, typeLength, "head"))
+	  message->SetMessageType(HTTP_MESSAGE_TYPE_HEAD);
+	else if(HTTPHeaderTokenizer::equals(type, typeLength, "post"))
+	  message->SetMessageType(HTTP_MESSAGE_TYPE_POST);
+  else if(HTTPHeaderTokenizer::equals(type, typeLength, "subscribe") ||
+          HTTPHeaderTokenizer::equals(type, typeLength, "unsubscribe"))
+	  message->SetMessageType(HTTP_MESSAGE_TYPE_SUBSCRIBE);
+  /* NOTIFY */
+	else if(HTTPHeaderTokenizer::equals(type, typeLength, "200"))
+	  message->SetMessageType(HTTP_MESSAGE_TYPE_200_OK);
+	else if(HTTPHeaderTokenizer::equals(type, typeLength, "403"))
+	  message->SetMessageType(HTTP_MESSAGE_TYPE_403_FORBIDDEN);
+	else if(HTTPHeaderTokenizer::equals(type, typeLength, "404"))
+	  message->SetMessageType(HTTP_MESSAGE_TYPE_404_NOT_FOUND);
+
+  if(request)
+    parseGetVars("", message);
+  return true;
+}
+
+void CHTTPParser::parseField(HTTPHeaderTokenizer* tokenizer, CHTTPMessage* message) // static
+{
+  const char* value = tokenizer->value();
+  size_t length = tokenizer->valueLength();
+  const char* hash;
+
+  switch(tokenizer->field()) {
+
+    case HTTPHeaderTokenizer::ContentLength:
+      message->m_nContentLength = HTTPHeaderTokenizer::toNumber(value, length);
+      if(message->m_nContentLength < 0)
+        message->m_nContentLength = 0;
+      break;
+
+    case HTTPHeaderTokenizer::UserAgent:
+      message->m_sUserAgent.assign(value, length);
+      break;
+
+    case HTTPHeaderTokenizer::TransferEncoding:
+      if(HTTPHeaderTokenizer::equals(value, wordLength(value, length), "chunked"))
+        message->m_nTransferEncoding = HTTP_TRANSFER_ENCODING_CHUNKED;
+      break;
+
+    case HTTPHeaderTokenizer::Connection:
+      if(HTTPHeaderTokenizer::equals(value, length, "close"))
+        message->m_nHTTPConnection = HTTP_CONNECTION_CLOSE;
+      break;
+
+    case HTTPHeaderTokenizer::Range:
+      parseRange(value, length, message);
+      break;
+
+    // SOAPACTION: "urn:schemas-upnp-org:service:ContentDirectory:1#Browse"
+    case HTTPHeaderTokenizer::SoapAction:
+      if(message->m_nHTTPMessageType != HTTP_MESSAGE_TYPE_POST)
+        break;
+      if(length > 0 && value[0] == '"') {
+        value++;
+        length--;
+      }
+      if(length > 0 && value[length - 1] == '"')
+        length--;
+      hash = value + length;
+      while(hash > value && hash[-1] != '#')
+        hash--;
+      if(hash == value || hash == value + length)
+        break;
+      message->m_soapTarget.assign(value, hash - value - 1);
+      message->m_soapAction.assign(hash, value + length - hash);
+      message->m_nHTTPMessageType = HTTP_MESSAGE_TYPE_POST_SOAP_ACTION;
+      break;
+
+    case HTTPHeaderTokenizer::Callback:
+      message->m_sGENACallBack.assign(value, length);
+      break;
+
+    case HTTPHeaderTokenizer::Nt:
+      message->m_sGENANT.assign(value, length);
+      break;
+
+    case HTTPHeaderTokenizer::GetContentFeatures:
+      if(HTTPHeaderTokenizer::equals(value, length, "1"))
+        message->dlnaGetContentFeatures(true);
+      break;
+
+    case HTTPHeaderTokenizer::TransferMode:
+      message->m_dlnaTransferMode.assign(value, wordLength(value, length));
+      break;
+
+    case HTTPHeaderTokenizer::ContentFeatures:
+      message->m_dlnaContentFeatures.assign(value, length);
+      break;
+
+    case HTTPHeaderTokenizer::GetCaptionInfo:
+      if(HTTPHeaderTokenizer::equals(value, length, "1"))
+        message->m_secGetCaptionInfo = true;
+      break;
+
+    case HTTPHeaderTokenizer::VirtualLayout:
+      message->m_requestedVirtualFolderLayout.assign(value, wordLength(value, length));
+      break;
+
+    default:
+      break;
+  }
+}
+
+// RANGE: bytes=start-[end]
+void CHTTPParser::parseRange(const char* value, size_t length, CHTTPMessage* message) // static
+{
+  if(!HTTPHeaderTokenizer::startsWith(value, length, "bytes="))
+    return;
+  value += 6;
+  length -= 6;
+
+  size_t dash = 0;
+  while(dash < length && value[dash] >= '0' && value[dash] <= '9')
+    dash++;
+  if(dash == length || value[dash] != '-')
+    return;
+
+  message->m_hasRange = true;
+  message->m_nRangeStart = (dash > 0 ? HTTPHeaderTokenizer::toNumber(value, dash) : 0);
+  message->m_nRangeEnd = HTTPHeaderTokenizer::toNumber(value + dash + 1, length - dash - 1);
+  if(message->m_nRangeEnd < 0)
+    message->m_nRangeEnd = 0;
 }
 
 void CHTTPParser::parseGetVars(std::string /*header*/, CHTTPMessage* message)
@@ -239,33 +356,3 @@ void CHTTPParser::parseGetVars(std::string /*header*/, CHTTPMessage* message)
 		get = get.substr(amp + 1, get.length());
 	}
 }
-
-void CHTTPParser::parseDlnaHeader(std::string header, CHTTPMessage* message) // static
-{
-
-  RegEx rxGetCF("getcontentFeatures\\.dlna\\.org: *(\\d+) *\r\n", PCRE_CASELESS);
-	if(rxGetCF.Search(header.c_str())) {
-    if(rxGetCF.match(1).compare("1") == 0)
-  		message->dlnaGetContentFeatures(true);
-	}
-  
-  RegEx rxTM("transferMode\\.dlna\\.org: *(\\w+) *\r\n", PCRE_CASELESS);
-	if(rxTM.Search(header.c_str())) {
-    message->dlnaTransferMode(rxTM.match(1));
-	}
-  
-  RegEx rxCF("contentFeatures\\.dlna\\.org: *(\\w+) *\r\n", PCRE_CASELESS);
-	if(rxCF.Search(header.c_str())) {
-    message->dlnaContentFeatures(rxCF.match(1));
-  }
-
-}
-
-void CHTTPParser::parseSecHeader(std::string header, CHTTPMessage* message) // static
-{
-  RegEx rxGetCI("getCaptionInfo\\.sec: *(\\d+) *\r\n", PCRE_CASELESS);
-	if(rxGetCI.Search(header.c_str())) {
-    if(rxGetCI.match(1).compare("1") == 0)
-  		message->m_secGetCaptionInfo = true;
-	}
-}
@@ -32,6 +32,7 @@
 
 #include <string>
 #include "../Common/Common.h"
+#include "HTTPHeaderTokenizer.h"
 
 class CHTTPMessage;
 
@@ -39,16 +40,20 @@ class CHTTPParser
 { 
   public:
   	static bool parseHeader(std::string header, CHTTPMessage* message);
+    // parses the data received so far. the message's fields are set as soon
+    // as their lines are complete. on End the header is set and the device identified
+    static HTTPHeaderTokenizer::Token parseHeader(HTTPHeaderTokenizer* tokenizer, const char* buffer, size_t length, CHTTPMessage* message);
 		static void ConvertURLEncodeContentToPlain(CHTTPMessage* message);
 
 		static bool					hasContentLength(char* buffer);
 		static fuppes_off_t getContentLength(char* buffer);
 		
   private:
-		static void parseCommonValues(std::string header, CHTTPMessage* message);
+    static HTTPHeaderTokenizer::Token tokenize(HTTPHeaderTokenizer* tokenizer, const char* buffer, size_t length, CHTTPMessage* message);
+		static bool parseStartLine(HTTPHeaderTokenizer* tokenizer, CHTTPMessage* message);
+		static void parseField(HTTPHeaderTokenizer* tokenizer, CHTTPMessage* message);
+		static void parseRange(const char* value, size_t length, CHTTPMessage* message);
 		static void parseGetVars(std::string header, CHTTPMessage* message);
-		static void parseDlnaHeader(std::string header, CHTTPMessage* message);
-		static void parseSecHeader(std::string header, CHTTPMessage* message);
 };
 
 #endif // _HTTPPARSER_H
@@ -0,0 +1,521 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            HTTPReactor.cpp
+ *
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "HTTPReactor.h"
+
+#ifdef HAVE_EPOLL
+
+#include "HTTPServer.h"
+#include "HTTPMessage.h"
+#include "HTTPParser.h"
+#include "HTTPRequestHandler.h"
+#include "../SharedLog.h"
+#include "../SharedConfig.h"
+#include "../Log.h"
+#include "../Common/Exception.h"
+
+#include <sys/epoll.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace fuppes;
+
+// max. number of events fetched by a single epoll_wait()
+#define HTTP_REACTOR_MAX_EVENTS 64
+
+// idle keep-alive connections are closed after this many seconds
+#define HTTP_KEEPALIVE_TIMEOUT 30
+
+// connections sending more than this without a complete header are dropped
+#define HTTP_MAX_REQUEST_SIZE 1048576 // 1 mb
+
+// requests with a larger content are answered with "413 Request Entity Too Large"
+#define HTTP_MAX_CONTENT_SIZE 4194304 // 4 mb
+
+
+HTTPConnection::HTTPConnection(fuppes::TCPRemoteSocket* socket)
+{
+  m_socket        = socket;
+  m_request       = new CHTTPMessage();
+  m_headerEnd     = 0;
+  m_contentLength = 0;
+  m_peerClosed    = false;
+  m_tooLarge      = false;
+  m_lastActivity  = time(NULL);
+}
+
+HTTPConnection::~HTTPConnection()
+{
+  if(m_request)
+    delete m_request;
+  if(m_socket)
+    delete m_socket;
+}
+
+bool HTTPConnection::receive()
+{
+  char buffer[4096];
+  int  received;
+
+  m_lastActivity = time(NULL);
+
+  // stop reading when the buffer exceeds the limits. complete() checks them
+  do {
+    received = ::recv(m_socket->socket(), buffer, sizeof(buffer), 0);
+    if(received > 0)
+      m_buffer.append(buffer, received);
+  } while((received > 0 || (received < 0 && errno == EINTR)) &&
+          m_buffer.length() <= HTTP_MAX_REQUEST_SIZE + HTTP_MAX_CONTENT_SIZE);
+
+  // connection closed by peer
+  if(received == 0) {
+    m_peerClosed = true;
+    return complete();
+  }
+
+  if(received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    return false;
+
+  // the header has to fit into HTTP_MAX_REQUEST_SIZE
+  complete();
+  return (m_headerEnd > 0 || m_buffer.length() < HTTP_MAX_REQUEST_SIZE);
+}
+
+bool HTTPConnection::complete()
+{
+  // header
+  if(m_headerEnd == 0) {
+    HTTPHeaderTokenizer::Token token = CHTTPParser::parseHeader(&m_tokenizer, m_buffer.data(), m_buffer.length(), m_request);
+
+    // a malformed request line. the request is answered with "400 Bad Request"
+    if(token == HTTPHeaderTokenizer::Invalid) {
+      m_headerEnd = m_buffer.length();
+      m_contentLength = 0;
+      return true;
+    }
+    if(token != HTTPHeaderTokenizer::End)
+      return false;
+
+    m_headerEnd = m_tokenizer.headerLength();
+    m_contentLength = m_request->GetContentLength();
+  }
+
+  // the request is answered without reading the rest of the content
+  if(m_tooLarge)
+    return true;
+  if(m_contentLength > HTTP_MAX_CONTENT_SIZE ||
+     m_buffer.length() - m_headerEnd > HTTP_MAX_CONTENT_SIZE) {
+    m_tooLarge = true;
+    return true;
+  }
+
+  // chunked content is complete when the last (empty) chunk arrived
+  if(m_request->GetTransferEncoding() == HTTP_TRANSFER_ENCODING_CHUNKED) {
+    size_t length = m_buffer.length();
+    if(length < m_headerEnd + 5)
+      return false;
+    return (m_buffer.compare(length - 5, 5, "0\r\n\r\n") == 0);
+  }
+
+  if((fuppes_off_t)(m_buffer.length() - m_headerEnd) >= m_contentLength)
+    return true;
+
+  // xbox 360: sends a content length of 3 but only 2 bytes of data
+  if(m_contentLength == 3 && m_request->DeviceSettings() &&
+     m_request->DeviceSettings()->Xbox360Support())
+    return true;
+
+  return false;
+}
+
+std::string HTTPConnection::message()
+{
+  if(m_request->GetTransferEncoding() != HTTP_TRANSFER_ENCODING_CHUNKED) {
+    return m_buffer.substr(0, m_headerEnd + m_contentLength);
+  }
+
+  // size (hex) CRLF
+  // data CRLF
+  // 0 (possible whitespace) CRLF
+  // CRLF
+  string result = m_buffer.substr(0, m_headerEnd);
+  size_t pos = m_headerEnd;
+  size_t eol;
+  unsigned int size;
+  while((eol = m_buffer.find("\r\n", pos)) != string::npos) {
+    size = HexToInt(m_buffer.substr(pos, eol - pos));
+    if(size == 0)
+      break;
+    result.append(m_buffer, eol + 2, size);
+    pos = eol + 2 + size + 2;
+  }
+  return result;
+}
+
+CHTTPMessage* HTTPConnection::takeRequest()
+{
+  CHTTPMessage* request = m_request;
+  m_request = NULL;
+  return request;
+}
+
+fuppes::TCPRemoteSocket* HTTPConnection::takeSocket()
+{
+  fuppes::TCPRemoteSocket* socket = m_socket;
+  m_socket = NULL;
+  return socket;
+}
+
+void HTTPConnection::reset()
+{
+  // keep pipelined data
+  if(m_request->GetTransferEncoding() == HTTP_TRANSFER_ENCODING_CHUNKED ||
+     (size_t)(m_headerEnd + m_contentLength) >= m_buffer.length())
+    m_buffer.clear();
+  else
+    m_buffer.erase(0, m_headerEnd + m_contentLength);
+
+  delete m_request;
+  m_request       = new CHTTPMessage();
+  m_tokenizer.reset();
+  m_headerEnd     = 0;
+  m_contentLength = 0;
+  m_tooLarge      = false;
+  m_lastActivity  = time(NULL);
+}
+
+
+
+HTTPWorker::HTTPWorker(HTTPReactor* reactor, std::string serverUrl)
+:Thread("httpworker")
+{
+  m_reactor = reactor;
+  m_handler = new CHTTPRequestHandler(serverUrl);
+}
+
+HTTPWorker::~HTTPWorker()
+{
+  close();
+  delete m_handler;
+}
+
+void HTTPWorker::run()
+{
+  HTTPConnection* connection;
+  while(!stopRequested()) {
+    connection = m_reactor->dequeue(500);
+    if(connection != NULL)
+      handle(connection);
+  }
+}
+
+void HTTPWorker::handle(HTTPConnection* connection)
+{
+  CHTTPMessage* request  = connection->request();
+  CHTTPMessage* response = new CHTTPMessage();
+
+  // the rest of the content is not read. so the connection is closed
+  if(connection->tooLarge()) {
+    response->SetVersion(HTTP_VERSION_1_0);
+    response->SetMessageType(HTTP_MESSAGE_TYPE_413_REQUEST_ENTITY_TOO_LARGE);
+    response->SetMessage("413 Request Entity Too Large");
+    response->keepAlive(false);
+
+    connection->socket()->setBlocking();
+    SendResponse(connection->socket(), response, request);
+    delete response;
+    delete connection;
+    return;
+  }
+
+  request->SetMessage(connection->message());
+  request->SetRemoteEndPoint(connection->socket()->remoteEndpoint());
+  std::string ip = inet_ntoa(connection->socket()->remoteEndpoint().sin_addr);
+
+  FUPPES_LOG(Log::http, Log::debug, "REQUEST:\n" + request->GetMessage());
+
+  // check if requesting IP is allowed to access
+  if(CSharedConfig::Shared()->networkSettings->IsAllowedIP(ip)) {
+    bool result = m_handler->HandleRequest(request, response);
+    if(!result)
+      result = m_reactor->server()->CallOnReceive(request, response);
+
+    if(!result) {
+      response->SetVersion(HTTP_VERSION_1_0);
+      response->SetMessageType(HTTP_MESSAGE_TYPE_400_BAD_REQUEST);
+      response->SetMessage("400 Bad Request");
+    }
+  }
+  // otherwise create a "403 (forbidden)" response
+  else {
+    response->SetVersion(HTTP_VERSION_1_0);
+    response->SetMessageType(HTTP_MESSAGE_TYPE_403_FORBIDDEN);
+    response->SetMessage("403 Forbidden");
+  }
+
+  connection->socket()->setBlocking();
+
+  // files and transcoded content are streamed in their own thread.
+  // in-memory content (images, thumbnails) is sent right away
+  if(response->IsBinary() && !response->isInMemory() &&
+     (request->GetMessageType() != HTTP_MESSAGE_TYPE_HEAD)) {
+    HTTPStreamSession* session = new HTTPStreamSession(connection->takeSocket(), connection->takeRequest(), response);
+    delete connection;
+    session->start();
+    return;
+  }
+
+  bool keepAlive = (request->GetVersion() == HTTP_VERSION_1_1) &&
+                   (request->GetHTTPConnection() != HTTP_CONNECTION_CLOSE) &&
+                   !connection->peerClosed();
+  // the client needs a content length to find the end of binary content
+  if(response->IsBinary() &&
+     (response->GetBinContentLength() == 0 || response->GetTransferEncoding() == HTTP_TRANSFER_ENCODING_CHUNKED))
+    keepAlive = false;
+  response->keepAlive(keepAlive);
+
+  bool sent = SendResponse(connection->socket(), response, request);
+  delete response;
+
+  if(!sent) {
+    SHARED_LOG(L_DBG, " error sending HTTP message");
+  }
+
+  if(!sent || !keepAlive) {
+    delete connection;
+    return;
+  }
+
+  connection->reset();
+  connection->socket()->setNonBlocking();
+  m_reactor->rearm(connection);
+}
+
+
+
+HTTPStreamSession::HTTPStreamSession(fuppes::TCPRemoteSocket* socket, CHTTPMessage* request, CHTTPMessage* response)
+:Thread("httpstream")
+{
+  m_socket   = socket;
+  m_request  = request;
+  m_response = response;
+}
+
+HTTPStreamSession::~HTTPStreamSession()
+{
+  // stop and close thread
+  close();
+
+  delete m_response;
+  delete m_request;
+  delete m_socket;
+}
+
+void HTTPStreamSession::run()
+{
+  HTTPSessionStore::append(this);
+
+  if(!SendResponse(m_socket, m_response, m_request)) {
+    SHARED_LOG(L_DBG, " error sending HTTP message");
+  }
+
+  HTTPSessionStore::finished(this);
+}
+
+
+
+HTTPReactor::HTTPReactor(CHTTPServer* server, unsigned int workers)
+:Thread("httpreactor")
+{
+  m_server = server;
+  m_lastIdleCheck = time(NULL);
+  m_queueCondition = new Condition(&m_mutex);
+
+  m_epoll = epoll_create(HTTP_REACTOR_MAX_EVENTS);
+  if(m_epoll == -1)
+    throw fuppes::Exception(__FILE__, __LINE__, "epoll_create failed %d - %s", errno, strerror(errno));
+
+  for(unsigned int i = 0; i < workers; i++) {
+    m_workers.push_back(new HTTPWorker(this, server->GetURL()));
+  }
+}
+
+HTTPReactor::~HTTPReactor()
+{
+  close();
+
+  for(size_t i = 0; i < m_workers.size(); i++) {
+    delete m_workers[i];
+  }
+  m_workers.clear();
+
+  std::list<HTTPConnection*>::iterator iter;
+  for(iter = m_queue.begin(); iter != m_queue.end(); ++iter) {
+    delete *iter;
+  }
+  m_queue.clear();
+  for(iter = m_connections.begin(); iter != m_connections.end(); ++iter) {
+    delete *iter;
+  }
+  m_connections.clear();
+
+  ::close(m_epoll);
+  delete m_queueCondition;
+}
+
+void HTTPReactor::append(fuppes::TCPRemoteSocket* socket)
+{
+  socket->setNonBlocking();
+  HTTPConnection* connection = new HTTPConnection(socket);
+
+  m_mutex.lock();
+  m_connections.push_back(connection);
+  m_mutex.unlock();
+
+  epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events   = EPOLLIN | EPOLLONESHOT;
+  event.data.ptr = connection;
+  if(epoll_ctl(m_epoll, EPOLL_CTL_ADD, socket->socket(), &event) != 0) {
+    SHARED_LOG(L_EXT, "epoll_ctl failed %d - %s", errno, strerror(errno));
+    remove(connection);
+  }
+}
+
+HTTPConnection* HTTPReactor::dequeue(unsigned int timeoutMs)
+{
+  MutexLocker locker(&m_mutex);
+
+  if(m_queue.empty())
+    m_queueCondition->wait(timeoutMs);
+  if(m_queue.empty())
+    return NULL;
+
+  HTTPConnection* connection = m_queue.front();
+  m_queue.pop_front();
+  return connection;
+}
+
+void HTTPReactor::rearm(HTTPConnection* connection)
+{
+  MutexLocker locker(&m_mutex);
+
+  // a pipelined request may already be complete
+  if(connection->complete()) {
+    m_queue.push_back(connection);
+    m_queueCondition->signal();
+    return;
+  }
+
+  m_connections.push_back(connection);
+
+  epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events   = EPOLLIN | EPOLLONESHOT;
+  event.data.ptr = connection;
+  if(epoll_ctl(m_epoll, EPOLL_CTL_MOD, connection->socket()->socket(), &event) != 0) {
+    m_connections.remove(connection);
+    delete connection;
+  }
+}
+
+void HTTPReactor::remove(HTTPConnection* connection)
+{
+  m_mutex.lock();
+  m_connections.remove(connection);
+  m_mutex.unlock();
+
+  delete connection;
+}
+
+void HTTPReactor::closeIdle()
+{
+  time_t now = time(NULL);
+  if(now - m_lastIdleCheck < 1)
+    return;
+  m_lastIdleCheck = now;
+
+  MutexLocker locker(&m_mutex);
+
+  std::list<HTTPConnection*>::iterator iter = m_connections.begin();
+  while(iter != m_connections.end()) {
+    if(now - (*iter)->lastActivity() > HTTP_KEEPALIVE_TIMEOUT) {
+      delete *iter;
+      iter = m_connections.erase(iter);
+      continue;
+    }
+    ++iter;
+  }
+}
+
+void HTTPReactor::run()
+{
+  for(size_t i = 0; i < m_workers.size(); i++) {
+    m_workers[i]->start();
+  }
+  SHARED_LOG(L_EXT, "HTTP reactor started with %d workers", (int)m_workers.size());
+
+  epoll_event     events[HTTP_REACTOR_MAX_EVENTS];
+  HTTPConnection* connection;
+  int             count;
+
+  while(!stopRequested()) {
+
+    count = epoll_wait(m_epoll, events, HTTP_REACTOR_MAX_EVENTS, 500);
+
+    for(int i = 0; i < count; i++) {
+      connection = (HTTPConnection*)events[i].data.ptr;
+
+      if(!connection->receive()) {
+        remove(connection);
+        continue;
+      }
+
+      // request complete. pass it to the workers
+      if(connection->complete()) {
+        m_mutex.lock();
+        m_connections.remove(connection);
+        m_queue.push_back(connection);
+        m_queueCondition->signal();
+        m_mutex.unlock();
+        continue;
+      }
+
+      // wait for more data
+      events[i].events = EPOLLIN | EPOLLONESHOT;
+      epoll_ctl(m_epoll, EPOLL_CTL_MOD, connection->socket()->socket(), &events[i]);
+    }
+
+    closeIdle();
+  }
+
+  for(size_t i = 0; i < m_workers.size(); i++) {
+    m_workers[i]->close();
+  }
+}
+
+#endif // HAVE_EPOLL
@@ -0,0 +1,174 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            HTTPReactor.h
+ *
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _HTTPREACTOR_H
+#define _HTTPREACTOR_H
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#ifdef HAVE_EPOLL
+
+#include "../Common/Thread.h"
+#include "../Common/Socket.h"
+#include "HTTPHeaderTokenizer.h"
+
+#include <string>
+#include <list>
+#include <vector>
+#include <time.h>
+
+class CHTTPServer;
+class CHTTPMessage;
+class CHTTPRequestHandler;
+class HTTPReactor;
+
+/**
+ * a client connection owned by the reactor.
+ * collects the request until it is complete
+ */
+class HTTPConnection
+{
+  public:
+    HTTPConnection(fuppes::TCPRemoteSocket* socket);
+    ~HTTPConnection();
+
+    // appends received data. returns false if the connection is closed or broken
+    bool receive();
+    // the buffer contains a complete request
+    bool complete();
+    // prepares the connection for the next request on a keep-alive connection
+    void reset();
+
+    fuppes::TCPRemoteSocket*  socket() { return m_socket; }
+    CHTTPMessage*             request() { return m_request; }
+    // releases the request/socket. the caller has to free it
+    CHTTPMessage*             takeRequest();
+    fuppes::TCPRemoteSocket*  takeSocket();
+    // header + (dechunked) content of the complete request
+    std::string               message();
+    time_t                    lastActivity() { return m_lastActivity; }
+    bool                      peerClosed() { return m_peerClosed; }
+    // the content exceeds HTTP_MAX_CONTENT_SIZE
+    bool                      tooLarge() { return m_tooLarge; }
+
+  private:
+    fuppes::TCPRemoteSocket*  m_socket;
+    CHTTPMessage*             m_request;
+    std::string               m_buffer;
+    // resumes parsing the header where the last receive() stopped
+    HTTPHeaderTokenizer       m_tokenizer;
+    size_t                    m_headerEnd;
+    fuppes_off_t              m_contentLength;
+    bool                      m_peerClosed;
+    bool                      m_tooLarge;
+    time_t                    m_lastActivity;
+};
+
+
+/**
+ * handles a complete request taken from the reactor's queue.
+ * text responses (SOAP, description, GENA) and in-memory images are sent
+ * directly, file and transcoding streams are passed to a HTTPStreamSession
+ */
+class HTTPWorker: public fuppes::Thread
+{
+  public:
+    HTTPWorker(HTTPReactor* reactor, std::string serverUrl);
+    ~HTTPWorker();
+
+  private:
+    void run();
+    void handle(HTTPConnection* connection);
+
+    HTTPReactor*          m_reactor;
+    CHTTPRequestHandler*  m_handler;
+};
+
+
+/**
+ * streams a binary response in its own thread so long running
+ * transfers don't block the workers
+ */
+class HTTPStreamSession: public fuppes::Thread
+{
+  public:
+    HTTPStreamSession(fuppes::TCPRemoteSocket* socket, CHTTPMessage* request, CHTTPMessage* response);
+    ~HTTPStreamSession();
+
+  private:
+    void run();
+
+    fuppes::TCPRemoteSocket*  m_socket;
+    CHTTPMessage*             m_request;
+    CHTTPMessage*             m_response;
+};
+
+
+/**
+ * epoll based connection handling.
+ * the reactor thread waits for incoming data on all idle connections
+ * and queues complete requests for a fixed number of HTTPWorker threads.
+ */
+class HTTPReactor: public fuppes::Thread
+{
+  friend class HTTPWorker;
+
+  public:
+    HTTPReactor(CHTTPServer* server, unsigned int workers);
+    ~HTTPReactor();
+
+    // takes ownership of the socket
+    void append(fuppes::TCPRemoteSocket* socket);
+
+    CHTTPServer* server() { return m_server; }
+
+  private:
+    void run();
+
+    // waits for a complete request. returns NULL on timeout
+    HTTPConnection* dequeue(unsigned int timeoutMs);
+    // rearms a keep-alive connection after the response has been sent
+    void rearm(HTTPConnection* connection);
+    // closes and deletes a connection
+    void remove(HTTPConnection* connection);
+    // closes connections that have been idle for too long
+    void closeIdle();
+
+    CHTTPServer*                          m_server;
+    int                                   m_epoll;
+
+    fuppes::Mutex                         m_mutex;
+    fuppes::Condition*                    m_queueCondition;
+    std::list<HTTPConnection*>            m_queue;
+    std::list<HTTPConnection*>            m_connections;
+    std::vector<HTTPWorker*>              m_workers;
+    time_t                                m_lastIdleCheck;
+};
+
+#endif // HAVE_EPOLL
+
+#endif // _HTTPREACTOR_H
@@ -34,6 +34,7 @@
 #include "../SharedConfig.h"
 #include "../ContentDirectory/FileDetails.h"
 #include "../ContentDirectory/DatabaseConnection.h"
+#include "../ContentDirectory/ImageCache.h"
 #include "../Transcoding/TranscodingMgr.h"
 #include "../ControlInterface/SoapControl.h"
 #include "../DLNA/DLNA.h"
@@ -64,21 +65,21 @@ bool CHTTPRequestHandler::HandleRequest(CHTTPMessage* pRequest, CHTTPMessage* pR
     case HTTP_MESSAGE_TYPE_POST:
       bResult = this->HandleHTTPRequest(pRequest, pResponse);
       if(bResult)
-       	Log::log(Log::http, Log::debug, __FILE__, __LINE__, "RESPONSE:\n" + pResponse->GetHeaderAsString());
+       	FUPPES_LOG(Log::http, Log::debug, "RESPONSE:\n" + pResponse->GetHeaderAsString());
       break;
       
     // SOAP
     case HTTP_MESSAGE_TYPE_POST_SOAP_ACTION:
       bResult = this->HandleSOAPAction(pRequest, pResponse);
       if(bResult)
-  			Log::log(Log::soap, Log::debug, __FILE__, __LINE__, "RESPONSE:\n" + pResponse->GetMessageAsString());
+  			FUPPES_LOG(Log::soap, Log::debug, "RESPONSE:\n" + pResponse->GetMessageAsString());
       break;
       
     // GENA
     case HTTP_MESSAGE_TYPE_SUBSCRIBE:
       bResult = this->HandleGENAMessage(pRequest, pResponse);
       if(bResult)
-  			Log::log(Log::gena, Log::debug, __FILE__, __LINE__, "RESPONSE:\n" + pResponse->GetMessageAsString());
+  			FUPPES_LOG(Log::gena, Log::debug, "RESPONSE:\n" + pResponse->GetMessageAsString());
 			break;
     
     default :
@@ -91,7 +92,7 @@ bool CHTTPRequestHandler::HandleRequest(CHTTPMessage* pRequest, CHTTPMessage* pR
 
 bool CHTTPRequestHandler::HandleHTTPRequest(CHTTPMessage* pRequest, CHTTPMessage* pResponse)
 {
-	Log::log(Log::http, Log::debug, __FILE__, __LINE__, "REQUEST:\n" + pRequest->GetMessage());
+	FUPPES_LOG(Log::http, Log::debug, "REQUEST:\n" + pRequest->GetMessage());
 	
   string sRequest = pRequest->GetRequest();  
   bool   bResult  = false;  
@@ -239,7 +240,7 @@ bool CHTTPRequestHandler::HandleHTTPRequest(CHTTPMessage* pRequest, CHTTPMessage
     
 bool CHTTPRequestHandler::HandleSOAPAction(CHTTPMessage* pRequest, CHTTPMessage* pResponse)
 {  
-	Log::log(Log::soap, Log::debug, __FILE__, __LINE__, "REQUEST:\n" + pRequest->GetMessage());
+	FUPPES_LOG(Log::soap, Log::debug, "REQUEST:\n" + pRequest->GetMessage());
 	
   // get UPnP action
   CUPnPAction* pAction = pRequest->GetAction();
@@ -291,7 +292,7 @@ bool CHTTPRequestHandler::HandleSOAPAction(CHTTPMessage* pRequest, CHTTPMessage*
 
 bool CHTTPRequestHandler::HandleGENAMessage(CHTTPMessage* pRequest, CHTTPMessage* pResponse)
 {
-	Log::log(Log::gena, Log::debug, __FILE__, __LINE__, "REQUEST:\n" + pRequest->GetMessage());
+	FUPPES_LOG(Log::gena, Log::debug, "REQUEST:\n" + pRequest->GetMessage());
   
   CSubscriptionMgr::HandleSubscription(pRequest, pResponse);
   pResponse->SetVersion(pRequest->GetVersion());
@@ -307,7 +308,7 @@ bool CHTTPRequestHandler::handleAVItemRequest(std::string p_sObjectId, CHTTPMess
   std::string       sPath;
   std::string       sMimeType;
   string            targetExt;
-  SQLQuery				  qry;
+  SQLQuery          qry(SQLQuery::ReadOnly);
   bool              bResult = true;  
   bool              transcode = false;
   
@@ -317,7 +318,7 @@ bool CHTTPRequestHandler::handleAVItemRequest(std::string p_sObjectId, CHTTPMess
   string sql = qry.build(SQL_GET_OBJECT_DETAILS, objectId, sDevice);
   qry.select(sql);
   if(qry.eof()) {
-    CSharedLog::Log(L_EXT, __FILE__, __LINE__, "unknown object id: %s", p_sObjectId.c_str());
+    SHARED_LOG(L_EXT, "unknown object id: %s", p_sObjectId.c_str());
     return false;
   }
   
@@ -329,7 +330,7 @@ bool CHTTPRequestHandler::handleAVItemRequest(std::string p_sObjectId, CHTTPMess
   sExt  = ExtractFileExt(sPath);
   
   if(!fuppes::File::exists(sPath)) {
-    CSharedLog::Log(L_EXT, __FILE__, __LINE__, "file: %s not found", sPath.c_str());
+    SHARED_LOG(L_EXT, "file: %s not found", sPath.c_str());
     return false;
   }
 
@@ -356,7 +357,7 @@ bool CHTTPRequestHandler::handleAVItemRequest(std::string p_sObjectId, CHTTPMess
     pResponse->LoadContentFromFile(sPath);
   }  
   else {
-    CSharedLog::Log(L_EXT, __FILE__, __LINE__, "transcode %s",  sPath.c_str());
+    SHARED_LOG(L_EXT, "transcode %s",  sPath.c_str());
  
     if(pRequest->GetMessageType() == HTTP_MESSAGE_TYPE_GET) {  
       DbObject object(qry.result());
@@ -437,7 +438,7 @@ bool CHTTPRequestHandler::handleImageRequest(std::string p_sObjectId, CHTTPMessa
   std::string       sExt;
   std::string       sPath;
   std::string       sMimeType;
-  SQLQuery  				qry;
+  SQLQuery          qry(SQLQuery::ReadOnly);
 
   
   string sDevice = pRequest->virtualFolderLayout();
@@ -450,7 +451,7 @@ bool CHTTPRequestHandler::handleImageRequest(std::string p_sObjectId, CHTTPMessa
   object_id_t objectId = HexToInt(p_sObjectId);  
   DbObject* tmp = DbObject::createFromObjectId(objectId, &qry, sDevice);
   if(tmp == NULL) {
-		CSharedLog::Log(L_EXT, __FILE__, __LINE__, "unknown object id: %s", p_sObjectId.c_str());
+		SHARED_LOG(L_EXT, "unknown object id: %s", p_sObjectId.c_str());
     return false;
   }
 
@@ -473,7 +474,7 @@ bool CHTTPRequestHandler::handleImageRequest(std::string p_sObjectId, CHTTPMessa
     result = handleVideoImageRequest(obj, pRequest, pResponse);
   }
   else {
-		CSharedLog::Log(L_EXT, __FILE__, __LINE__, "unsupported image request on object type %d", obj->type());
+		SHARED_LOG(L_EXT, "unsupported image request on object type %d", obj->type());
 	}
 
   delete obj;
@@ -487,7 +488,7 @@ bool CHTTPRequestHandler::handleImageRequest(std::string p_sObjectId, CHTTPMessa
   qry.select(sql);
     
   if(qry.eof()) {
-		CSharedLog::Log(L_EXT, __FILE__, __LINE__, "unknown object id: %s", p_sObjectId.c_str());
+		SHARED_LOG(L_EXT, "unknown object id: %s", p_sObjectId.c_str());
 		return false;
 	}
 
@@ -519,12 +520,12 @@ bool CHTTPRequestHandler::handleImageRequest(std::string p_sObjectId, CHTTPMessa
     }
 	}
 	else {
-		CSharedLog::Log(L_EXT, __FILE__, __LINE__, "unsupported image request on object type %d", obj.type());
+		SHARED_LOG(L_EXT, "unsupported image request on object type %d", obj.type());
 		return false;
 	}
     
   if(!fuppes::File::exists(sPath)) {
-    CSharedLog::Log(L_EXT, __FILE__, __LINE__, "file: %s not found", sPath.c_str());
+    SHARED_LOG(L_EXT, "file: %s not found", sPath.c_str());
     return false;
   }
 	//cout << "image request: " << sPath << endl;
@@ -535,137 +536,46 @@ bool CHTTPRequestHandler::handleImageRequest(std::string p_sObjectId, CHTTPMessa
 	/*int less = pRequest->getVarAsInt("less");
 	int greater = pRequest->getVarAsInt("greater");*/
 	
-	// transcode | scale request via GET
-	// and/or embedded image from audio file
-	if((width > 0 || height > 0 || audioFile || videoFile) && !hasCached) {
-		CSharedLog::Log(L_EXT, __FILE__, __LINE__, "GET transcode %s - %dx%d",  sPath.c_str(), width, height);
-		
-		size_t inSize = 0;
-		size_t outSize = 0;
-		unsigned char* inBuffer = (unsigned char*)malloc(1);
-		unsigned char* outBuffer = (unsigned char*)malloc(1);
-		char tmpMime[100];
-		//memset(tmpMime, 0, 1);
-		
-		// embedded image from audio or video file
-		bool transcode = true;
-		if(audioFile || videoFile) {
-
-      string plugin;
-			if(audioFile) {
-        plugin = "taglib";
-			}
-      else if(videoFile) {
-        plugin = "ffmpegthumbnailer";
-				transcode = false;
-			}
-
-			CMetadataPlugin* metadata = CPluginMgr::metadataPlugin(plugin);
-			if(!metadata) {
-				CSharedLog::Log(L_EXT, __FILE__, __LINE__, "metadata plugin %s not found", plugin.c_str());
-				free(inBuffer);
-				free(outBuffer);
-				//free(tmpMime);
-			  return false;
-      }
-      
-      
-			metadata->openFile(sPath);
-			inSize = 0;
-			if(!metadata->readImage(&tmpMime[0], &inBuffer, &inSize)) {
-				metadata->closeFile();
-				CSharedLog::Log(L_EXT, __FILE__, __LINE__, "metadata plugin %s failed to read embedded image", "taglib");
-				free(inBuffer);
-				free(outBuffer);
-				//free(tmpMime);
-		    return false;
-			}
-			metadata->closeFile();
-
-      // get the mime type and the extension of the extracted file      
-      sMimeType = tmpMime;
-      sExt = pRequest->DeviceSettings()->extensionByMimeType(sMimeType);        
-			delete metadata;
-		} // embedded image
-
-
-
-    // an actual image file or a cached image is requested
-		else {
-
-      if(hasCached) {
-				transcode = false;        
-      }
-      
-			std::fstream fsImg;
-			fsImg.open(sPath.c_str(), ios::binary|ios::in);
-		  if(fsImg.fail() == 1) {
-				CSharedLog::Log(L_EXT, __FILE__, __LINE__, "failed to load image file %s", sPath.c_str());
-				free(inBuffer);
-				free(outBuffer);
-				//free(tmpMime);
-			  return false;
-			}
-			fsImg.seekg(0, ios::end); 
-  		inSize = streamoff(fsImg.tellg()); 
-  		fsImg.seekg(0, ios::beg);
-			inBuffer = (unsigned char*)realloc(inBuffer, inSize);
-			fsImg.read((char*)inBuffer, inSize);
-			fsImg.close();
-		} // image file
-
-		if(transcode) {
-			CTranscoderBase* transcoder = CPluginMgr::transcoderPlugin("magickWand");
-			if(transcoder == NULL) {
-				CSharedLog::Log(L_EXT, __FILE__, __LINE__, "image magick transcoder not available");
-				free(inBuffer);
-				free(outBuffer);
-				//free(tmpMime);
-			  return false;
-			}
-		
-			CFileSettings* settings = new CFileSettings(pRequest->DeviceSettings()->FileSettings(sExt));
-		
-			// TODO fixme. Robert: What are we supposed to be fixing?
-			if(!settings->pImageSettings) {
-				settings->pImageSettings = new CImageSettings();
-			}
-			settings->pImageSettings->nHeight = height;
-			settings->pImageSettings->nWidth = width;
-			settings->pImageSettings->bGreater = true;
-			settings->pImageSettings->bLess = true;
-		
-			transcoder->TranscodeMem(settings,
-															 (const unsigned char**)&inBuffer, inSize, &outBuffer, &outSize);
-			delete settings;
-			delete transcoder;
-
-			pResponse->SetBinContent((char*)outBuffer, outSize);
-
-      // todo: get the actual image dimensions
-      //width = width;
-      //height = height:
-      sMimeType = pRequest->DeviceSettings()->MimeType(sExt);
+	// scaled and embedded images are cached
+	bool scale = ((width > 0 || height > 0 || audioFile || videoFile) && !hasCached);
+	ImageCache::Source source = ImageCache::ImageFile;
+	std::string format = sExt;
+	if(audioFile) {
+		source = ImageCache::AudioFile;
+		format = obj.details()->albumArtExt();
+	}
+	else if(videoFile) {
+		source = ImageCache::VideoFile;
+	}
+	std::string cacheKey;
+	ImageCache::Image image;
+	if(scale) {
+		format = ImageCache::format(pRequest->DeviceSettings(), source, format);
+		cacheKey = ImageCache::key(objectId, fuppes::File::lastModified(sPath), width, height, format);
+	}
 
+	if(scale && ImageCache::Shared()->get(cacheKey, &image)) {
+		SHARED_LOG(L_EXT, "GET cached %s - %dx%d",  sPath.c_str(), width, height);
+	}
 
-		} else { // transcode
-			pResponse->SetBinContent((char*)inBuffer, inSize);
+	// transcode | scale request via GET
+	// and/or embedded image from audio file
+	else if(scale) {
+		SHARED_LOG(L_EXT, "GET transcode %s - %dx%d",  sPath.c_str(), width, height);
 
-      width = obj.details()->width();
-      height = obj.details()->height();
+		if(!ImageCache::create(source, sPath, sExt, pRequest->DeviceSettings(), width, height, obj.details(), &image)) {
+			ImageCache::Shared()->abort(cacheKey);
+			return false;
 		}
+		ImageCache::Shared()->put(cacheKey, image);
+	}
 
-    
-/*
-		pResponse->SetMessageType(HTTP_MESSAGE_TYPE_200_OK);
-#warning todo: set correct mime type 
-    // the current mimeType variable only holds a dummy mime type set above
-		pResponse->SetContentType(sMimeType);
-*/
-		free(inBuffer);
-		free(outBuffer);
-		//free(tmpMime);
-		//return true;
+	if(scale) {
+		pResponse->SetBinContent((char*)image.data.c_str(), image.data.length());
+		sMimeType = image.mimeType;
+		sExt = image.ext;
+		width = image.width;
+		height = image.height;
 	} // embedded audio or width|height via GET
 	
 
@@ -676,7 +586,7 @@ bool CHTTPRequestHandler::handleImageRequest(std::string p_sObjectId, CHTTPMessa
     height = obj.details()->height();
     
 	  if(pRequest->DeviceSettings()->DoTranscode(sExt, qry.result()->asString("AUDIO_CODEC"), qry.result()->asString("VIDEO_CODEC"))) {
-		  CSharedLog::Log(L_EXT, __FILE__, __LINE__, "transcode %s",  sPath.c_str());
+		  SHARED_LOG(L_EXT, "transcode %s",  sPath.c_str());
    
 		  sMimeType = pRequest->DeviceSettings()->MimeType(sExt, qry.result()->asString("AUDIO_CODEC"), qry.result()->asString("VIDEO_CODEC"));
 		  if(pRequest->GetMessageType() == HTTP_MESSAGE_TYPE_GET) {          
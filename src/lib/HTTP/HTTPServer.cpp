@@ -26,10 +26,10 @@
 #include "HTTPServer.h"
 #include "HTTPMessage.h"
 #include "HTTPRequestHandler.h"
+#include "HTTPReactor.h"
 //#include "CommonFunctions.h"
 #include "../SharedLog.h"
 #include "../SharedConfig.h"
-#include "../Common/RegEx.h"
 #include "../Common/Exception.h"
 #include "../DeviceSettings/DeviceIdentificationMgr.h"
 #include "../DeviceSettings/MacAddressTable.h"
@@ -57,7 +57,9 @@ using namespace fuppes;
 
 
 bool ReceiveRequest(HTTPSession* p_Session, CHTTPMessage* p_Request);
-bool SendResponse(HTTPSession* p_Session, CHTTPMessage* p_Response, CHTTPMessage* p_Request);
+#ifndef WIN32
+bool SendFileResponse(TCPRemoteSocket* p_Socket, CHTTPMessage* p_Response, CHTTPMessage* p_Request);
+#endif
 
 /** Constructor */
 CHTTPServer::CHTTPServer(std::string p_sIPAddress)
@@ -66,6 +68,7 @@ CHTTPServer::CHTTPServer(std::string p_sIPAddress)
   // init member vars
   m_bIsRunning  = false;
 	m_isStarted   = false;
+  m_reactor     = NULL;
 	//accept_thread = (fuppesThread)NULL;
 	//fuppesThreadInitMutex(&m_ReceiveMutex);  	
 
@@ -93,12 +96,20 @@ void CHTTPServer::Start()
     throw fuppes::Exception(__FILE__, __LINE__, "failed to listen on socket");
 
   HTTPSessionStore::init();
+
+#ifdef HAVE_EPOLL
+  unsigned int workers = CSharedConfig::Shared()->networkSettings->GetHTTPWorkers();
+  if(workers > 0) {
+    m_reactor = new HTTPReactor(this, workers);
+    m_reactor->start();
+  }
+#endif
   
   // start accept thread
 	start();
   m_bIsRunning = true;
   
-  CSharedLog::Log(L_EXT, __FILE__, __LINE__, "HTTPServer started");
+  SHARED_LOG(L_EXT, "HTTPServer started");
 } // Start()
 
 
@@ -128,9 +139,15 @@ void CHTTPServer::Stop()
   m_listenSocket.close();
   m_bIsRunning = false;
 
+  if(m_reactor) {
+    m_reactor->close();
+    delete m_reactor;
+    m_reactor = NULL;
+  }
+
   HTTPSessionStore::uninit();
   
-  CSharedLog::Log(L_EXT, __FILE__, __LINE__, "HTTPServer stopped");
+  SHARED_LOG(L_EXT, "HTTPServer stopped");
 } // Stop()
 
 std::string CHTTPServer::GetURL()
@@ -215,7 +232,7 @@ bool CHTTPServer::CallOnReceive(CHTTPMessage* pMessageIn, CHTTPMessage* pMessage
 //fuppesThreadCallback AcceptLoop(void *arg)
 void CHTTPServer::run()
 {                     
-	CSharedLog::Log(L_EXT, __FILE__, __LINE__,  "listening on %s", this->GetURL().c_str());
+	SHARED_LOG(L_EXT,  "listening on %s", this->GetURL().c_str());
 	this->m_isStarted = true;
 
   TCPRemoteSocket* sock;
@@ -227,6 +244,11 @@ void CHTTPServer::run()
     if(sock == NULL)
       continue;
 
+    if(m_reactor) {
+      m_reactor->append(sock);
+      continue;
+    }
+
     HTTPSession* session = new HTTPSession(this, sock, this->GetURL());
 		session->start();
 
@@ -240,12 +262,23 @@ void CHTTPServer::run()
 
 	this->m_isStarted = false;
 	
-  CSharedLog::Log(L_DBG, __FILE__, __LINE__, "exiting accept loop");
+  SHARED_LOG(L_DBG, "exiting accept loop");
 	
 } // run()
 
 
 HTTPSessionStore* HTTPSessionStore::m_instance = NULL;
+volatile int HTTPSessionStore::m_activeStreams = 0;
+
+void HTTPSessionStore::streamStarted() // static
+{
+  __sync_fetch_and_add(&m_activeStreams, 1);
+}
+
+void HTTPSessionStore::streamFinished() // static
+{
+  __sync_fetch_and_sub(&m_activeStreams, 1);
+}
 
 void HTTPSessionStore::init() // static
 {
@@ -273,7 +306,7 @@ void HTTPSessionStore::uninit() // static
   m_instance = NULL;
 }
 
-void HTTPSessionStore::append(HTTPSession* session) // static
+void HTTPSessionStore::append(fuppes::Thread* session) // static
 {
   if(m_instance == NULL)
     return;
@@ -282,7 +315,7 @@ void HTTPSessionStore::append(HTTPSession* session) // static
   m_instance->m_sessions.push_back(session);
 }
 
-void HTTPSessionStore::finished(HTTPSession* session) // static
+void HTTPSessionStore::finished(fuppes::Thread* session) // static
 {
   if(m_instance == NULL)
     return;
@@ -331,7 +364,7 @@ void HTTPSession::run()
 	int flag = 1;
   int nOpt = setsockopt(m_Connection, SOL_SOCKET, SO_NOSIGPIPE, &flag, sizeof(flag));
   if(nOpt < 0) {
-    CSharedLog::Log(L_EXT, __FILE__, __LINE__, "setsockopt(SO_NOSIGPIPE)");
+    SHARED_LOG(L_EXT, "setsockopt(SO_NOSIGPIPE)");
     HTTPSessionStore::finished(this);
     return;
   }
@@ -365,7 +398,7 @@ void HTTPSession::run()
       break;
     }
 
-    Log::log(Log::http, Log::debug, __FILE__, __LINE__, "REQUEST:\n" + pRequest->GetMessage());
+    FUPPES_LOG(Log::http, Log::debug, "REQUEST:\n" + pRequest->GetMessage());
     // end receive
     
     // check if requesting IP is allowed to access
@@ -389,9 +422,9 @@ void HTTPSession::run()
     }
     
     // send response
-    bResult = SendResponse(pSession, pResponse, pRequest);
+    bResult = SendResponse(pSession->socket(), pResponse, pRequest);
     if(!bResult) {
-      CSharedLog::Log(L_DBG, __FILE__, __LINE__, " error sending HTTP message");
+      SHARED_LOG(L_DBG, " error sending HTTP message");
       break;
     }
     // end send response
@@ -466,7 +499,7 @@ bool ReceiveRequest(HTTPSession* p_Session, CHTTPMessage* p_Request)
       #else
       sLog << "error no. " << errno << " " << strerror(errno) << endl;            
       #endif
-      CSharedLog::Log(L_DBG, __FILE__, __LINE__, sLog.str().c_str());
+      SHARED_LOG(L_DBG, sLog.str().c_str());
       
       // WIN32 :: WSAEWOULDBLOCK handling
       #ifdef WIN32
@@ -555,11 +588,8 @@ bool ReceiveRequest(HTTPSession* p_Session, CHTTPMessage* p_Request)
     // check content length
     if(p_Request->GetTransferEncoding() == HTTP_TRANSFER_ENCODING_NONE) {
       
-      RegEx rxContentLength("CONTENT-LENGTH: *(\\d+)", PCRE_CASELESS);
-      if(rxContentLength.Search(p_Request->GetHeader().c_str())) {
-        string sContentLength = rxContentLength.Match(1);    
-        nContentLength = ::atoi(sContentLength.c_str());
-      }
+      // set by the header parser
+      nContentLength = p_Request->GetContentLength();
 		
       // check if we received the full content
       if((nBytesReceived - nHeaderPos) < nContentLength) {
@@ -642,9 +672,27 @@ bool ReceiveRequest(HTTPSession* p_Session, CHTTPMessage* p_Request)
 } // ReceiveRequest
 
 
-/** sends p_Response via the socket in p_Session */
+/** counts a stream as active as long as it is in scope */
+class ActiveStream
+{
+  public:
+    ActiveStream(bool stream) {
+      m_stream = stream;
+      if(m_stream)
+        HTTPSessionStore::streamStarted();
+    }
+    ~ActiveStream() {
+      if(m_stream)
+        HTTPSessionStore::streamFinished();
+    }
+
+  private:
+    bool m_stream;
+};
+
+/** sends p_Response via p_Socket */
 //bool SendResponse(CHTTPSessionInfo* p_Session, CHTTPMessage* p_Response, CHTTPMessage* p_Request)
-bool SendResponse(HTTPSession* p_Session, CHTTPMessage* p_Response, CHTTPMessage* p_Request)
+bool SendResponse(TCPRemoteSocket* p_Socket, CHTTPMessage* p_Response, CHTTPMessage* p_Request)
 {
   // local vars
 	int nRet = 0;       
@@ -659,18 +707,19 @@ bool SendResponse(HTTPSession* p_Session, CHTTPMessage* p_Response, CHTTPMessage
         
     // send
     //nRet = fuppesSocketSend(p_Session->GetConnection(), p_Response->GetMessageAsString().c_str(), (int)strlen(p_Response->GetMessageAsString().c_str()));
-    nRet = p_Session->socket()->send(p_Response->GetMessageAsString().c_str(), (int)strlen(p_Response->GetMessageAsString().c_str()));
+    std::string sMessage = p_Response->GetMessageAsString();
+    nRet = p_Socket->send(sMessage.c_str(), sMessage.length());
     #ifdef WIN32 
     if(nRet == -1) {
       stringstream sLog;            
       sLog << "send error :: error no. " << WSAGetLastError() << " " << strerror(WSAGetLastError()) << endl;              
-      CSharedLog::Log(L_DBG, __FILE__, __LINE__, sLog.str().c_str());
+      SHARED_LOG(L_DBG, sLog.str().c_str());
     }
     #else
     if(nRet == -1) {
       stringstream sLog;       
       sLog << "send error :: error no. " << errno << " " << strerror(errno) << endl;
-      CSharedLog::Log(L_DBG, __FILE__, __LINE__, sLog.str().c_str());
+      SHARED_LOG(L_DBG, sLog.str().c_str());
     }          
     #endif
     
@@ -748,14 +797,24 @@ bool SendResponse(HTTPSession* p_Session, CHTTPMessage* p_Response, CHTTPMessage
       ))) 
   {
 	  // log
-		CSharedLog::Log(L_DBG, __FILE__, __LINE__, "send header: %s\n", p_Response->GetHeaderAsString().c_str());
+		SHARED_LOG(L_DBG, "send header: %s\n", p_Response->GetHeaderAsString().c_str());
     // send
     //nErr = fuppesSocketSend(p_Session->GetConnection(), p_Response->GetHeaderAsString().c_str(), (int)strlen(p_Response->GetHeaderAsString().c_str()));
-    nErr = p_Session->socket()->send(p_Response->GetHeaderAsString().c_str(), (int)strlen(p_Response->GetHeaderAsString().c_str()));
+    nErr = p_Socket->send(p_Response->GetHeaderAsString().c_str(), (int)strlen(p_Response->GetHeaderAsString().c_str()));
            
     return (nErr > 0);
   }   
-       
+
+  ActiveStream stream(p_Response->isLocalFile() || p_Response->IsTranscoding());
+
+#ifndef WIN32
+  // untranscoded local files are passed to the kernel
+  // without going through the chunk buffer
+  if(p_Response->isLocalFile() &&
+     (p_Response->GetTransferEncoding() == HTTP_TRANSFER_ENCODING_NONE)) {
+    return SendFileResponse(p_Socket, p_Response, p_Request);
+  }
+#endif
     
   int          nCnt          = 0;
   int          nSend         = 0;    
@@ -791,29 +850,29 @@ bool SendResponse(HTTPSession* p_Session, CHTTPMessage* p_Response, CHTTPMessage
     if(nCnt == 0) {      
       // send
       //nErr = fuppesSocketSend(p_Session->GetConnection(), p_Response->GetHeaderAsString().c_str(), p_Response->GetHeaderAsString().length());
-      nErr = p_Session->socket()->send(p_Response->GetHeaderAsString().c_str(), p_Response->GetHeaderAsString().length());
-      CSharedLog::Log(L_DBG, __FILE__, __LINE__, "send header %s\n", p_Response->GetHeaderAsString().c_str());
+      nErr = p_Socket->send(p_Response->GetHeaderAsString().c_str(), p_Response->GetHeaderAsString().length());
+      SHARED_LOG(L_DBG, "send header %s\n", p_Response->GetHeaderAsString().c_str());
     }
 
     
     if(nErr > 0) {
-      CSharedLog::Log(L_DBG, __FILE__, __LINE__,
+      SHARED_LOG(L_DBG,
         "send binary data (bytes %llu to %llu from %llu)", nOffset, nOffset + nRet, p_Response->GetBinContentLength());
       
       if(p_Response->GetTransferEncoding() == HTTP_TRANSFER_ENCODING_CHUNKED) {
         char szSize[10];
         sprintf(szSize, "%X\r\n", nRet);
         //fuppesSocketSend(p_Session->GetConnection(), szSize, strlen(szSize));
-        p_Session->socket()->send(szSize, strlen(szSize));
+        p_Socket->send(szSize, strlen(szSize));
       }     
 
       //nErr = fuppesSocketSend(p_Session->GetConnection(), szChunk, nRet);
-      nErr = p_Session->socket()->send(szChunk, nRet);    
+      nErr = p_Socket->send(szChunk, nRet);    
 
       if(p_Response->GetTransferEncoding() == HTTP_TRANSFER_ENCODING_CHUNKED) {
         string szCRLF = "\r\n";
         //fuppesSocketSend(p_Session->GetConnection(), szCRLF.c_str(), strlen(szCRLF.c_str()));
-        p_Session->socket()->send(szCRLF.c_str(), strlen(szCRLF.c_str()));
+        p_Socket->send(szCRLF.c_str(), strlen(szCRLF.c_str()));
       }
       
     }        
@@ -847,10 +906,10 @@ bool SendResponse(HTTPSession* p_Session, CHTTPMessage* p_Response, CHTTPMessage
         stringstream sLog;
         #ifdef WIN32
         sLog << "send error :: error no. " << WSAGetLastError() << " " << strerror(WSAGetLastError()) << endl;              
-        CSharedLog::Log(L_EXT, __FILE__, __LINE__, sLog.str().c_str());
+        SHARED_LOG(L_EXT, sLog.str().c_str());
         #else          
         sLog << "send error :: error no. " << errno << " " << strerror(errno) << endl;
-        CSharedLog::Log(L_EXT, __FILE__, __LINE__, sLog.str().c_str());
+        SHARED_LOG(L_EXT, sLog.str().c_str());
         #endif  
       }
       
@@ -868,10 +927,48 @@ bool SendResponse(HTTPSession* p_Session, CHTTPMessage* p_Response, CHTTPMessage
   if((nErr > 0) && (p_Response->GetTransferEncoding() == HTTP_TRANSFER_ENCODING_CHUNKED)) {
     string szCRLF = "0\r\n\r\n";
     //fuppesSocketSend(p_Session->GetConnection(), szCRLF.c_str(), strlen(szCRLF.c_str()));
-    p_Session->socket()->send(szCRLF.c_str(), strlen(szCRLF.c_str()));    
+    p_Socket->send(szCRLF.c_str(), strlen(szCRLF.c_str()));    
   }
   
   
   delete [] szChunk;    
   return true;  
 }
+
+#ifndef WIN32
+/** sends the (partial) content of an untranscoded local file
+    using zero-copy sendfile() if available */
+bool SendFileResponse(TCPRemoteSocket* p_Socket, CHTTPMessage* p_Response, CHTTPMessage* p_Request)
+{
+  fuppes_off_t nLength = p_Response->GetBinContentLength();
+  fuppes_off_t nStart  = p_Request->GetRangeStart();
+  fuppes_off_t nSize   = 0;
+
+  // RANGE: BYTES=n-m
+  if((p_Request->GetRangeEnd() > 0) && (p_Request->GetRangeEnd() < nLength))
+    nSize = p_Request->GetRangeEnd() - nStart + 1;
+  // RANGE: BYTES=n- or no range at all
+  else
+    nSize = nLength - nStart;
+
+  std::string sHeader = p_Response->GetHeaderAsString();
+  SHARED_LOG(L_DBG, "send header %s\n", sHeader.c_str());
+  if(p_Socket->send(sHeader) <= 0)
+    return false;
+
+  if(nSize <= 0)
+    return true;
+
+  SHARED_LOG(L_DBG,
+    "sendfile (bytes %llu to %llu from %llu)", nStart, nStart + nSize, nLength);
+
+  fuppes_off_t nSent = p_Socket->sendFile(p_Response->localFile()->descriptor(), nStart, nSize);
+  if(nSent != nSize) {
+    SHARED_LOG(L_EXT, "sendfile error :: error no. %d %s (%llu of %llu bytes sent)",
+      errno, strerror(errno), nSent, nSize);
+    return false;
+  }
+
+  return true;
+}
+#endif
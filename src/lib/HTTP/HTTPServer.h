@@ -50,6 +50,10 @@ using namespace std;
 
 class CHTTPServer;
 class CHTTPMessage;
+class HTTPReactor;
+
+/** sends p_Response via p_Socket. used by the sessions and the reactor's workers */
+bool SendResponse(fuppes::TCPRemoteSocket* p_Socket, CHTTPMessage* p_Response, CHTTPMessage* p_Request);
 
 class IHTTPServer
 {
@@ -105,21 +109,28 @@ class HTTPSessionStore: public fuppes::Thread
   public:
     HTTPSessionStore():Thread("HTTPSessionStore") {
     }
-    static void append(HTTPSession* session);
-    static void finished(HTTPSession* session);
+    static void append(fuppes::Thread* session);
+    static void finished(fuppes::Thread* session);
 
     static void init();
     static void uninit();
+
+    // the number of files that are currently sent or transcoded.
+    // background jobs pause while there are active streams
+    static int activeStreams() { return m_activeStreams; }
+    static void streamStarted();
+    static void streamFinished();
     
   private:
     static HTTPSessionStore* m_instance;
+    static volatile int      m_activeStreams;
   	void run();
 
     fuppes::Mutex                        m_mutex;
-    std::list<HTTPSession*>              m_sessions;
-    std::list<HTTPSession*>::iterator    m_sessionsIterator;
-    std::list<HTTPSession*>              m_finishedSessions;
-    std::list<HTTPSession*>::iterator    m_finishedSessionsIterator;
+    std::list<fuppes::Thread*>           m_sessions;
+    std::list<fuppes::Thread*>::iterator m_sessionsIterator;
+    std::list<fuppes::Thread*>           m_finishedSessions;
+    std::list<fuppes::Thread*>::iterator m_finishedSessionsIterator;
 };
 
 class CHTTPServer: public fuppes::Thread
@@ -148,6 +159,8 @@ class CHTTPServer: public fuppes::Thread
     IHTTPServer* m_pReceiveHandler;
 
     fuppes::TCPServer   m_listenSocket;
+    // event driven connection handling (NULL = one thread per connection)
+    HTTPReactor*        m_reactor;
     //sockaddr_in local_ep;
     bool				do_break;
     bool        m_bIsRunning;
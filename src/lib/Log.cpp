@@ -1,7 +1,9 @@
 #include "Log.h"
+#include "LogWriter.h"
 
 #include <iostream>
 #include <stdio.h>
+#include <string.h>
 
 using namespace std;
 using namespace fuppes;
@@ -105,12 +107,8 @@ void Log::uninit() // static
 
 void Log::log(Log::Sender sender, Log::Level level, const std::string fileName, int lineNo, const char* format, ...) // static
 {
-  bool active = isActiveSender(sender);
-
-  if(!active) {
-    //cout << "Log sender: " << Log::senderToString(sender) << " not active" << endl;
+  if(!isActive(sender, level))
     return;
-  }
   
 	va_list args;
   va_start(args, format);
@@ -121,34 +119,31 @@ void Log::log(Log::Sender sender, Log::Level level, const std::string fileName,
 
 void Log::log(Log::Sender sender, Log::Level level, const std::string fileName, int lineNo, const char* format, va_list args) // static
 {
-  bool active = isActiveSender(sender);
-
-  if(!active) {
-    //cout << "Log sender: " << Log::senderToString(sender) << " not active" << endl;
+  if(!isActive(sender, level))
     return;
-  }
   
-	char buffer[8192 * 10];	
- 	string out = "[" + Log::senderToString(sender) + "] ";
-  vsnprintf(buffer, sizeof(buffer) - 1, format, args);
-	
-	cout << out << buffer << endl;
+	char buffer[8192];
+  int length = snprintf(buffer, sizeof(buffer), "[%s] ", Log::senderToString(sender).c_str());
+
+  // keep one byte for the line break
+  size_t space = sizeof(buffer) - length - 1;
+  int ret = vsnprintf(&buffer[length], space, format, args);
+  if(ret > 0)
+    length += ((size_t)ret < space) ? ret : space - 1;
+
+  buffer[length++] = '\n';
+  LogWriter::write(buffer, length);
 }
 
 
 
 void Log::log(Log::Sender sender, Log::Level level, const std::string fileName, int lineNo, const std::string msg) // static
 {
-  bool active = isActiveSender(sender);
-
-  if(!active) {
-    //cout << "Log sender: " << Log::senderToString(sender) << " not active" << endl;
+  if(!isActive(sender, level))
     return;
-  }
 
-	string out = "[" + Log::senderToString(sender) + "] " + msg;
-	//CSharedLog::Log(0, fileName, lineNo, out);
-  cout << out << endl;
+	string out = "[" + Log::senderToString(sender) + "] " + msg + "\n";
+  LogWriter::write(out.c_str(), out.length());
 }
 
 
@@ -158,10 +153,15 @@ void Log::error(Log::Sender sender, Log::Level level, const std::string fileName
 	va_list args;
   va_start(args, format);
 
-  char buffer[8192 * 10];	
- 	string out = "[" + Log::senderToString(sender) + "] ";
-  vsnprintf(buffer, sizeof(buffer) - 1, format, args);
+  char buffer[8192];
+  int length = snprintf(buffer, sizeof(buffer), "[%s] ", Log::senderToString(sender).c_str());
+
+  size_t space = sizeof(buffer) - length - 1;
+  int ret = vsnprintf(&buffer[length], space, format, args);
 	va_end(args);
-	
-	cout << out << buffer << endl;
+  if(ret > 0)
+    length += ((size_t)ret < space) ? ret : space - 1;
+
+  buffer[length++] = '\n';
+  LogWriter::write(buffer, length);
 }
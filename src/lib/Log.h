@@ -2,10 +2,22 @@
 #ifndef _LOG_H
 #define _LOG_H
 
+#ifdef HAVE_CONFIG_H
+#include "../config.h"
+#endif
+
 #include <list>
 #include <string>
 #include <stdarg.h>
 
+// the arguments are only evaluated if the sender is active.
+// use this instead of calling Log::log() directly in hot paths
+#define FUPPES_LOG(sender, level, ...) \
+  do { \
+    if(fuppes::Log::isActive(sender, level)) \
+      fuppes::Log::log(sender, level, __FILE__, __LINE__, __VA_ARGS__); \
+  } while(0)
+
 namespace fuppes {
 
 	class Exception;
@@ -89,6 +101,19 @@ namespace fuppes {
         return false;*/
       }
 
+      /**
+       * cheap check whether a message would be logged.
+       * if DISABLE_DEBUG_LOG is defined debug messages are never logged and
+       * a FUPPES_LOG(sender, Log::debug, ...) is removed by the compiler
+       */
+      static bool isActive(Log::Sender sender, Log::Level level) {
+        #ifdef DISABLE_DEBUG_LOG
+        if(level >= Log::debug)
+          return false;
+        #endif
+        return (m_instance != NULL && (m_instance->m_logSenders & sender) == sender);
+      }
+
       static void addActiveSender(Log::Sender sender) {
         if(sender == Log::unknown) return;
         m_instance->m_logSenders |= sender; // even if they are the active one
@@ -0,0 +1,178 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            LogWriter.cpp
+ * 
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "LogWriter.h"
+
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+
+using namespace fuppes;
+
+LogWriter*    LogWriter::m_instance = NULL;
+std::ostream* LogWriter::m_out = NULL;
+
+// guards m_instance. write() holds it while it uses the instance
+// so uninit() can't delete the writer in between
+static Mutex  instanceMutex;
+// serializes the writes to m_out
+static Mutex  outputMutex;
+
+void LogWriter::init() // static
+{
+  MutexLocker locker(&instanceMutex);
+  if(m_instance != NULL)
+    return;
+
+  m_instance = new LogWriter();
+  m_instance->start();
+}
+
+void LogWriter::uninit() // static
+{
+  // new messages are written synchronously from now on
+  instanceMutex.lock();
+  LogWriter* instance = m_instance;
+  m_instance = NULL;
+  instanceMutex.unlock();
+
+  if(instance == NULL)
+    return;
+
+  instance->Thread::stop();
+  instance->m_mutex.lock();
+  instance->m_condition->signal();
+  instance->m_mutex.unlock();
+  instance->close();
+  delete instance;
+}
+
+void LogWriter::setOutput(std::ostream* out) // static
+{
+  MutexLocker instanceLocker(&instanceMutex);
+  if(m_instance == NULL) {
+    m_out = out;
+    return;
+  }
+
+  MutexLocker locker(&m_instance->m_mutex);
+  m_out = out;
+}
+
+void LogWriter::write(const char* data, size_t length) // static
+{
+  MutexLocker instanceLocker(&instanceMutex);
+  if(m_instance == NULL) {
+    output(data, length);
+    return;
+  }
+
+  LogWriter* instance = m_instance;
+  MutexLocker locker(&instance->m_mutex);
+
+  // messages are never split
+  if(length > LOG_RING_SIZE - instance->m_used) {
+    instance->m_dropped++;
+    return;
+  }
+
+  size_t tail = (instance->m_head + instance->m_used) % LOG_RING_SIZE;
+  size_t count = LOG_RING_SIZE - tail;
+  if(count > length)
+    count = length;
+  memcpy(&instance->m_ring[tail], data, count);
+  memcpy(&instance->m_ring[0], data + count, length - count);
+  instance->m_used += length;
+
+  instance->m_condition->signal();
+}
+
+void LogWriter::output(const char* data, size_t length) // static
+{
+  // a stopping writer thread may still drain the ring
+  // while new messages are written synchronously
+  MutexLocker locker(&outputMutex);
+  std::ostream* out = (m_out != NULL) ? m_out : &std::cout;
+  out->write(data, length);
+  out->flush();
+}
+
+LogWriter::LogWriter() :
+  Thread("LogWriter")
+{
+  m_condition = new Condition(&m_mutex);
+  m_head = 0;
+  m_used = 0;
+  m_dropped = 0;
+}
+
+LogWriter::~LogWriter()
+{
+  close();
+  delete m_condition;
+}
+
+size_t LogWriter::take()
+{
+  size_t count = LOG_RING_SIZE - m_head;
+  if(count > m_used)
+    count = m_used;
+  memcpy(m_chunk, &m_ring[m_head], count);
+  memcpy(&m_chunk[count], m_ring, m_used - count);
+
+  size_t result = m_used;
+  m_head = 0;
+  m_used = 0;
+  return result;
+}
+
+void LogWriter::run()
+{
+  size_t length;
+  unsigned int dropped;
+  char message[64];
+
+  while(true) {
+
+    m_mutex.lock();
+    if(m_used == 0 && !stopRequested())
+      m_condition->wait(500);
+    length = take();
+    dropped = m_dropped;
+    m_dropped = 0;
+    m_mutex.unlock();
+
+    // the file i/o happens without holding the lock
+    if(length > 0)
+      output(m_chunk, length);
+    if(dropped > 0) {
+      snprintf(message, sizeof(message), "== %u log messages dropped ==\n\n", dropped);
+      output(message, strlen(message));
+    }
+
+    if(length == 0 && stopRequested())
+      break;
+  }
+}
@@ -0,0 +1,92 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            LogWriter.h
+ * 
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _LOGWRITER_H
+#define _LOGWRITER_H
+
+#ifdef HAVE_CONFIG_H
+#include "../config.h"
+#endif
+
+#include "Common/Thread.h"
+
+#include <ostream>
+
+// bytes of formatted messages waiting for the writer thread
+#define LOG_RING_SIZE 262144  // 256 kb
+
+namespace fuppes {
+
+/**
+ * writes the log output from a background thread so the http
+ * sessions never block on the console or the log file.
+ *
+ * messages are copied into a fixed size ring buffer. a message that
+ * does not fit is dropped and the number of dropped messages is
+ * written once there is space again.
+ * without a running writer the messages are written synchronously.
+ */
+class LogWriter: private Thread
+{
+  public:
+    static void init();
+    // writes the pending messages and stops the thread
+    static void uninit();
+
+    // the stream is used by the writer thread and must stay valid
+    // until uninit() or the next call. NULL = stdout
+    static void setOutput(std::ostream* out);
+
+    // the message must be completely formatted including the line breaks
+    static void write(const char* data, size_t length);
+
+  private:
+    LogWriter();
+    ~LogWriter();
+    void run();
+
+    // copies the pending bytes to m_chunk. m_mutex must be locked
+    size_t take();
+    static void output(const char* data, size_t length);
+
+    // guarded by a static mutex in LogWriter.cpp
+    static LogWriter*     m_instance;
+    static std::ostream*  m_out;
+
+    Mutex                 m_mutex;
+    Condition*            m_condition;
+
+    char                  m_ring[LOG_RING_SIZE];
+    size_t                m_head;
+    size_t                m_used;
+    unsigned int          m_dropped;
+
+    // only used by the writer thread
+    char                  m_chunk[LOG_RING_SIZE];
+};
+
+}
+
+#endif // _LOGWRITER_H
@@ -30,6 +30,13 @@
 
 #include "../Log.h"
 #include "../SharedLog.h"
+#include "../ContentDirectory/BrowseCache.h"
+#include "../ContentDirectory/ImageCache.h"
+#include "../GENA/EventDispatcher.h"
+
+#ifndef DISABLE_TRANSCODING
+#include "../Transcoding/TranscodingCache.h"
+#endif
 
 using namespace fuppes;
 
@@ -84,6 +91,42 @@ std::string PageStart::content()
 
   sResult << "<h1>database status</h1>" << endl;  
   sResult << buildObjectStatusTable() << endl;
+  sResult << buildQueryStatsTable() << endl;
+
+  BrowseCache* browseCache = BrowseCache::Shared();
+  sResult << "<p>" << endl;
+  sResult << "browse cache: " << browseCache->count() << " entries " << 
+    (browseCache->size() / 1024) << " / " << (browseCache->maxSize() / 1024) << " kb<br />" << endl;
+  sResult << "hits: " << browseCache->hits() << " misses: " << browseCache->misses() << "<br />" << endl;
+  sResult << "</p>" << endl;
+
+  ImageCache* imageCache = ImageCache::Shared();
+  sResult << "<p>" << endl;
+  sResult << "image cache: " << imageCache->count() << " entries " << 
+    (imageCache->size() / 1024) << " / " << (imageCache->maxSize() / 1024) << " kb (disk: " <<
+    (imageCache->diskSize() / 1024) << " / " << (imageCache->maxDiskSize() / 1024) << " kb)<br />" << endl;
+  sResult << "hits: " << imageCache->hits() << " disk hits: " << imageCache->diskHits() << " misses: " << imageCache->misses() << "<br />" << endl;
+  sResult << "</p>" << endl;
+
+  EventDispatcher* events = EventDispatcher::Shared();
+  sResult << "<h1>events</h1>" << endl;
+  sResult << "<p>" << endl;
+  sResult << "queued: " << events->queueDepth() << " (max: " << events->maxQueueDepth() << ")<br />" << endl;
+  sResult << "sent: " << events->sent() << " coalesced: " << events->coalesced() << " failed: " << events->failed() << 
+    " connections: " << events->connections() << "<br />" << endl;
+  sResult << "</p>" << endl;
+
+  #ifndef DISABLE_TRANSCODING
+  CTranscodingCache* cache = CTranscodingCache::Shared();
+  sResult << "<h1>transcoding</h1>" << endl;
+  sResult << "<p>" << endl;
+  sResult << "sessions: " << cache->SessionCount() << "<br />" << endl;
+  sResult << "time to first byte: " << cache->AvgTimeToFirstByte() << " ms (avg) " << 
+    cache->MaxTimeToFirstByte() << " ms (max)<br />" << endl;
+  sResult << "shared: " << cache->SharedCount() << " of " << cache->RequestCount() << 
+    " requests (" << cache->SharedRatio() << "%)<br />" << endl;
+  sResult << "</p>" << endl;
+  #endif
   
   sResult << buildLogSelection() << endl;
   
@@ -133,6 +176,44 @@ std::string PageStart::buildObjectStatusTable()
 }
 
 
+std::string PageStart::buildQueryStatsTable()
+{
+  std::stringstream sResult;
+  SQLQueryStats stats;
+  
+  sResult << 
+    "<table rules=\"all\" style=\"font-size: 10pt; border-style: solid; border-width: 1px; border-color: #000000;\" cellspacing=\"0\" width=\"400\">" << endl <<
+      "<thead>" << endl <<
+        "<tr>" << endl <<        
+          "<th>Query</th>" << 
+          "<th>Count</th>" << 
+          "<th>Avg (ms)</th>" << 
+          "<th>Max (ms)</th>" << endl <<
+        "</tr>" << endl <<
+      "</thead>" << endl << 
+      "<tbody>" << endl;  
+
+  for(int i = 0; i < SQL_MAX; i++) {
+    stats = SQLQuery::stats((fuppes_sql_no)i);
+    if(stats.count == 0)
+      continue;
+    
+    sResult << "<tr>" << endl;
+    sResult << "<td>" << SQLQuery::queryName((fuppes_sql_no)i) << "</td>" << endl;
+    sResult << "<td>" << stats.count << "</td>" << endl;
+    sResult << "<td>" << ((stats.time / stats.count) / 1000.0) << "</td>" << endl;
+    sResult << "<td>" << (stats.maxTime / 1000.0) << "</td>" << endl;
+    sResult << "</tr>" << endl;
+  }
+    
+  sResult <<
+      "</tbody>" << endl <<   
+    "</table>" << endl;
+
+  return sResult.str();
+}
+
+
 std::string PageStart::buildLogSelection()
 {
   stringstream result;
@@ -0,0 +1,215 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            MSearchResponder.cpp
+ * 
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "MSearchResponder.h"
+#include "../SharedConfig.h"
+#include "../SharedLog.h"
+#include "../Common/Common.h"
+
+#include <sstream>
+#include <stdlib.h>
+#include <time.h>
+
+using namespace std;
+using namespace fuppes;
+
+// UPnP 1.1 limits the MX value to 5 seconds
+#define MSEARCH_MAX_MX  5
+
+MSearchResponder::MSearchResponder(std::string ipAddress, CNotifyMsgFactory* factory)
+:Thread("MSearchResponder")
+{
+  m_ipAddress = ipAddress;
+  m_factory = factory;
+  m_condition = new Condition(&m_mutex);
+  m_wheel.resize(MSEARCH_WHEEL_SIZE);
+  m_current = 0;
+  m_pending = 0;
+  m_dropped = 0;
+  for(int i = 0; i <= MESSAGE_TYPE_MEDIA_SERVER; i++) {
+    m_rendered[i] = 0;
+  }
+
+  srand(time(NULL));
+}
+
+MSearchResponder::~MSearchResponder()
+{
+  stop();
+  delete m_condition;
+}
+
+void MSearchResponder::start()
+{
+  m_socket.SetupSocket(false, m_ipAddress);
+  Thread::start();
+}
+
+void MSearchResponder::stop()
+{
+  if(!running())
+    return;
+
+  Thread::stop();
+  m_mutex.lock();
+  m_condition->broadcast();
+  m_mutex.unlock();
+  close();
+  m_socket.TeardownSocket();
+}
+
+void MSearchResponder::handle(CSSDPMessage* message)
+{
+  sockaddr_in remote = message->GetRemoteEndPoint();
+
+  FUPPES_LOG(Log::ssdp, Log::extended, "received m-search from: \"%s:%d\"", inet_ntoa(remote.sin_addr), ntohs(remote.sin_port));
+  FUPPES_LOG(Log::ssdp, Log::debug, message->GetMessage());
+
+  std::list<MESSAGE_TYPE> types;
+  switch(message->GetMSearchST()) {
+    case M_SEARCH_ST_ALL:
+      types.push_back(MESSAGE_TYPE_USN);
+      types.push_back(MESSAGE_TYPE_ROOT_DEVICE);
+      types.push_back(MESSAGE_TYPE_MEDIA_SERVER);
+      types.push_back(MESSAGE_TYPE_CONTENT_DIRECTORY);
+      types.push_back(MESSAGE_TYPE_CONNECTION_MANAGER);
+      break;
+    case M_SEARCH_ST_ROOT:
+      types.push_back(MESSAGE_TYPE_ROOT_DEVICE);
+      break;
+    case M_SEARCH_ST_DEVICE_MEDIA_SERVER:
+      types.push_back(MESSAGE_TYPE_MEDIA_SERVER);
+      break;
+    case M_SEARCH_ST_SERVICE_CONTENT_DIRECTORY:
+      types.push_back(MESSAGE_TYPE_CONTENT_DIRECTORY);
+      break;
+    case M_SEARCH_ST_SERVICE_CONNECTION_MANAGER:
+      types.push_back(MESSAGE_TYPE_CONNECTION_MANAGER);
+      break;
+    case M_SEARCH_ST_UUID:
+      if(message->GetSTAsString().substr(5).compare(ToLower(CSharedConfig::Shared()->GetUUID())) == 0)
+        types.push_back(MESSAGE_TYPE_USN);
+      break;
+    default:
+      break;
+  }
+  if(types.empty())
+    return;
+
+  // the replies are spread over the MX seconds
+  int mx = message->GetMX();
+  if(mx > MSEARCH_MAX_MX)
+    mx = MSEARCH_MAX_MX;
+
+  MutexLocker locker(&m_mutex);
+  std::list<MESSAGE_TYPE>::iterator iter;
+  for(iter = types.begin(); iter != types.end(); iter++) {
+    schedule(remote, *iter, (mx > 0) ? (rand() % (mx * 1000)) : 0);
+  }
+  m_condition->signal();
+}
+
+void MSearchResponder::schedule(sockaddr_in remote, MESSAGE_TYPE type, unsigned int delay)
+{
+  if(m_pending >= MSEARCH_MAX_PENDING) {
+    m_dropped++;
+    return;
+  }
+
+  // the control point will get this reply anyway
+  std::string replyKey = key(remote, type);
+  if(m_keys.find(replyKey) != m_keys.end())
+    return;
+
+  unsigned int slots = delay / MSEARCH_TICK;
+  if(slots >= MSEARCH_WHEEL_SIZE)
+    slots = MSEARCH_WHEEL_SIZE - 1;
+
+  Reply reply;
+  reply.remote = remote;
+  reply.type = type;
+  m_wheel[(m_current + slots) % MSEARCH_WHEEL_SIZE].push_back(reply);
+  m_keys.insert(replyKey);
+  m_pending++;
+}
+
+std::string MSearchResponder::key(sockaddr_in remote, MESSAGE_TYPE type) // static
+{
+  stringstream result;
+  result << inet_ntoa(remote.sin_addr) << ":" << ntohs(remote.sin_port) << ":" << type;
+  return result.str();
+}
+
+void MSearchResponder::run()
+{
+  std::list<Reply> due;
+  std::list<Reply>::iterator iter;
+  unsigned int next = fuppesTicks() + MSEARCH_TICK;
+  unsigned int now;
+
+  while(!stopRequested()) {
+
+    // nothing scheduled. sleep until the next search
+    m_mutex.lock();
+    if(m_pending == 0) {
+      m_condition->wait(1000);
+      m_mutex.unlock();
+      next = fuppesTicks() + MSEARCH_TICK;
+      continue;
+    }
+    m_mutex.unlock();
+
+    now = fuppesTicks();
+    if((int)(next - now) > 0) {
+      msleep(next - now);
+      continue;
+    }
+    next += MSEARCH_TICK;
+
+    m_mutex.lock();
+    due.swap(m_wheel[m_current]);
+    m_current = (m_current + 1) % MSEARCH_WHEEL_SIZE;
+    for(iter = due.begin(); iter != due.end(); iter++) {
+      m_keys.erase(key(iter->remote, iter->type));
+      m_pending--;
+    }
+    m_mutex.unlock();
+
+    for(iter = due.begin(); iter != due.end(); iter++) {
+      m_socket.SendUnicast(response(iter->type), iter->remote);
+    }
+    due.clear();
+  }
+}
+
+const std::string& MSearchResponder::response(MESSAGE_TYPE type)
+{
+  time_t now = time(NULL);
+  if(m_rendered[type] != now) {
+    m_responses[type] = m_factory->GetMSearchResponse(type);
+    m_rendered[type] = now;
+  }
+  return m_responses[type];
+}
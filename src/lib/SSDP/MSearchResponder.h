@@ -0,0 +1,110 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            MSearchResponder.h
+ * 
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _MSEARCHRESPONDER_H
+#define _MSEARCHRESPONDER_H
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#include "../Common/Thread.h"
+#include "UDPSocket.h"
+#include "SSDPMessage.h"
+#include "NotifyMsgFactory.h"
+
+#include <string>
+#include <list>
+#include <set>
+#include <vector>
+
+// resolution of the timer wheel (ms)
+#define MSEARCH_TICK          100
+// number of slots. covers the max. MX of 5 seconds
+#define MSEARCH_WHEEL_SIZE    64
+// max. number of scheduled replies. further searches are dropped
+#define MSEARCH_MAX_PENDING   512
+
+/**
+ * answers M-SEARCH requests from a single thread.
+ *
+ * every reply is scheduled on a timer wheel with a random delay below
+ * the request's MX and sent from one unicast socket. identical replies
+ * to the same control point that are still pending are not scheduled
+ * again and the number of pending replies is limited. so a flood of
+ * searches needs neither threads nor unbounded memory.
+ *
+ * the replies are rendered by the CNotifyMsgFactory at most once per
+ * second (their DATE header changes) and reused in between
+ */
+class MSearchResponder: private fuppes::Thread
+{
+  public:
+    MSearchResponder(std::string ipAddress, CNotifyMsgFactory* factory);
+    ~MSearchResponder();
+
+    void start();
+    void stop();
+
+    // schedules the replies to a search. called from the receiving thread
+    void handle(CSSDPMessage* message);
+
+    unsigned int pending() { return m_pending; }
+    unsigned int dropped() { return m_dropped; }
+
+  private:
+    struct Reply {
+      sockaddr_in   remote;
+      MESSAGE_TYPE  type;
+    };
+
+    void run();
+
+    // m_mutex must be locked
+    void schedule(sockaddr_in remote, MESSAGE_TYPE type, unsigned int delay);
+    static std::string key(sockaddr_in remote, MESSAGE_TYPE type);
+    // returns the cached reply. rendered again if the second changed
+    const std::string& response(MESSAGE_TYPE type);
+
+    std::string                   m_ipAddress;
+    CNotifyMsgFactory*            m_factory;
+    CUDPSocket                    m_socket;
+
+    fuppes::Mutex                 m_mutex;
+    fuppes::Condition*            m_condition;
+    std::vector<std::list<Reply> > m_wheel;
+    // the slot that is due next
+    unsigned int                  m_current;
+    // pending "address:port:type"
+    std::set<std::string>         m_keys;
+    unsigned int                  m_pending;
+    unsigned int                  m_dropped;
+
+    // only used by the responder thread
+    std::string                   m_responses[MESSAGE_TYPE_MEDIA_SERVER + 1];
+    time_t                        m_rendered[MESSAGE_TYPE_MEDIA_SERVER + 1];
+};
+
+#endif // _MSEARCHRESPONDER_H
@@ -80,34 +80,4 @@ class CMSearchSession: public IUDPSocket, fuppes::ITimer
     CNotifyMsgFactory* m_pNotifyMsgFactory;
 };
 
-class CHandleMSearchSession;
-
-class IHandleMSearchSession
-{
-  public:
-    virtual ~IHandleMSearchSession() {};
-    virtual void OnSessionEnd(CHandleMSearchSession* pSender) = 0;
-};
-  
-class CHandleMSearchSession: private fuppes::Thread
-{
-  public:
-    CHandleMSearchSession(CSSDPMessage* pSSDPMessage, std::string p_sIPAddress, std::string p_sHTTPServerURL);
-    ~CHandleMSearchSession();
-    void Start();
-  
-    bool m_bIsTerminated;
-    std::string m_sIPAddress;
-    std::string m_sHTTPServerURL;
-    CNotifyMsgFactory* m_pNotifyMsgFactory;
-    
-    CSSDPMessage* GetSSDPMessage() { return m_pSSDPMessage; }
-  
-  private:
-    //fuppesThread m_Thread;
-		void run();
-		
-    CSSDPMessage* m_pSSDPMessage;
-};
-
 #endif // _MSEARCHSESSION_H
@@ -36,6 +36,7 @@ CSSDPCtrl::CSSDPCtrl(std::string p_sIPAddress, std::string p_sHTTPServerURL)
   m_pNotifyMsgFactory = new CNotifyMsgFactory(m_sHTTPServerURL);
 
   m_sIPAddress   = p_sIPAddress;
+  m_pMSearchResponder = new MSearchResponder(m_sIPAddress, m_pNotifyMsgFactory);
 	//msearch_thread = (fuppesThread)NULL;
   m_isStarted = false;
 	
@@ -48,12 +49,14 @@ CSSDPCtrl::~CSSDPCtrl()
   //fuppesThreadDestroyMutex(&m_SessionReceiveMutex);
   //fuppesThreadDestroyMutex(&m_SessionTimedOutMutex);
   
+  delete m_pMSearchResponder;
   delete m_pNotifyMsgFactory;
 }
 
 void CSSDPCtrl::Start()
 {	
 	try {
+    m_pMSearchResponder->start();
     m_Listener.SetupSocket(true, m_sIPAddress);
     m_Listener.SetTTL(4);
 	  m_Listener.SetReceiveHandler(this);
@@ -64,14 +67,15 @@ void CSSDPCtrl::Start()
     throw;
   }
   
-  CSharedLog::Log(L_EXT, __FILE__, __LINE__, "SSDPController started");
+  SHARED_LOG(L_EXT, "SSDPController started");
 }
 
 void CSSDPCtrl::Stop()
 {	
   CleanupSessions(true);
 	m_Listener.EndReceive();  
-  CSharedLog::Log(L_EXT, __FILE__, __LINE__, "SSDPController stopped");
+  m_pMSearchResponder->stop();
+  SHARED_LOG(L_EXT, "SSDPController stopped");
 }
 
 CUDPSocket* CSSDPCtrl::get_socket()
@@ -81,34 +85,9 @@ CUDPSocket* CSSDPCtrl::get_socket()
 
 void CSSDPCtrl::CleanupSessions(bool clearRunning /*= false*/)
 {
-  CSharedLog::Log(L_DBG, __FILE__, __LINE__, "CleanupSessions");
+  SHARED_LOG(L_DBG, "CleanupSessions");
   m_SessionTimedOutMutex.lock(); 
       
-  if(m_HandleMSearchThreadList.size() > 0)
-  {    
-    for(m_HandleMSearchThreadListIterator = m_HandleMSearchThreadList.begin();
-        m_HandleMSearchThreadListIterator != m_HandleMSearchThreadList.end(); )
-    {     
-      if(m_HandleMSearchThreadList.size() == 0)
-        break;
-      
-      CHandleMSearchSession* pMSession = *m_HandleMSearchThreadListIterator;
-      if(pMSession->m_bIsTerminated)
-      {
-        std::list<CHandleMSearchSession*>::iterator tmpIt = m_HandleMSearchThreadListIterator;
-        ++tmpIt;        
-        m_HandleMSearchThreadList.erase(m_HandleMSearchThreadListIterator);
-        m_HandleMSearchThreadListIterator = tmpIt;
-        delete pMSession;        
-      }
-      else
-      {
-        ++m_HandleMSearchThreadListIterator;
-      }  
-    }
-  }
-
-
   if(clearRunning && m_RunningSessionList.size() > 0)
   {  
     for(m_RunningSessionListIterator = m_RunningSessionList.begin();
@@ -248,7 +227,7 @@ void CSSDPCtrl::OnUDPSocketReceive(CSSDPMessage* pSSDPMessage)
   sLog << "OnUDPSocketReceive() :: " << inet_ntoa(pSSDPMessage->GetRemoteEndPoint().sin_addr) << ":" << ntohs(pSSDPMessage->GetRemoteEndPoint().sin_port) << endl;
   //sLog << inet_ntoa(m_LastMulticastEp.sin_addr) << ":" << ntohs(m_LastMulticastEp.sin_port);
  
-  CSharedLog::Log(L_DBG, __FILE__, __LINE__, sLog.str().c_str());
+  SHARED_LOG(L_DBG, sLog.str().c_str());
   	
   if((m_LastMulticastEp.sin_addr.s_addr != pSSDPMessage->GetRemoteEndPoint().sin_addr.s_addr) ||
     (m_LastMulticastEp.sin_port != pSSDPMessage->GetRemoteEndPoint().sin_port))
@@ -277,7 +256,7 @@ void CSSDPCtrl::OnSessionReceive(CSSDPMessage* pMessage)
   
   /* logging */
   //CSharedLog::Log(L_DBG, __FILE__, __LINE__, pMessage->GetMessage().c_str());
-	Log::log(Log::ssdp, Log::debug, __FILE__, __LINE__, pMessage->GetMessage());
+	FUPPES_LOG(Log::ssdp, Log::debug, pMessage->GetMessage());
   
   /* pass message to the main fuppes instance */
   if(NULL != m_pReceiveHandler)
@@ -319,24 +298,6 @@ void CSSDPCtrl::OnSessionTimeOut(CMSearchSession* pSender)
 
 void CSSDPCtrl::HandleMSearch(CSSDPMessage* pSSDPMessage)
 {
-  m_SessionTimedOutMutex.lock();      
-
-  stringstream sLog;
-  sLog << "received m-search from: \"" << inet_ntoa(pSSDPMessage->GetRemoteEndPoint().sin_addr) << ":" << ntohs(pSSDPMessage->GetRemoteEndPoint().sin_port) << "\"";
-  Log::log(Log::ssdp, Log::extended, __FILE__, __LINE__, sLog.str());
-  Log::log(Log::ssdp, Log::debug, __FILE__, __LINE__, pSSDPMessage->GetMessage());
-
-  
-  //cout << pSSDPMessage->GetMSearchST() << " - " << M_SEARCH_ST_UNSUPPORTED << endl;
-  
-  if(pSSDPMessage->GetMSearchST() != M_SEARCH_ST_UNSUPPORTED)
-  {
-    CHandleMSearchSession* pHandleMSearch = new CHandleMSearchSession(pSSDPMessage, m_sIPAddress, m_sHTTPServerURL);
-    m_HandleMSearchThreadList.push_back(pHandleMSearch);
-    pHandleMSearch->Start();
-  }
- 
-  m_SessionTimedOutMutex.unlock();   
-  
-  CleanupSessions();
+  // the responder schedules the replies. no thread per search
+  m_pMSearchResponder->handle(pSSDPMessage);
 }
@@ -46,6 +46,7 @@
 #include "SSDPMessage.h"
 #include "MSearchSession.h"
 #include "NotifyMsgFactory.h"
+#include "MSearchResponder.h"
 
 class ISSDPCtrl
 {
@@ -85,6 +86,7 @@ class CSSDPCtrl: public IUDPSocket, IMSearchSession
 		bool							 m_isStarted;
     CUDPSocket         m_Listener;	
     CNotifyMsgFactory* m_pNotifyMsgFactory;
+    MSearchResponder*  m_pMSearchResponder;
     //fuppesThread       msearch_thread;
     sockaddr_in        m_LastMulticastEp;  
     std::string        m_sIPAddress;    
@@ -98,9 +100,6 @@ class CSSDPCtrl: public IUDPSocket, IMSearchSession
     
     std::list<CMSearchSession*> m_SessionList;    
     std::list<CMSearchSession*>::iterator m_SessionListIterator;
-    
-    std::list<CHandleMSearchSession*> m_HandleMSearchThreadList;
-    std::list<CHandleMSearchSession*>::iterator m_HandleMSearchThreadListIterator;
 };
 
 #endif // _SSDPCTRL_H
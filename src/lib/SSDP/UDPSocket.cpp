@@ -161,7 +161,7 @@ void CUDPSocket::SetTTL(int p_nTTL)
 {
   int ret = setsockopt(m_Socket, IPPROTO_IP, IP_TTL, (char *)&p_nTTL, sizeof(p_nTTL)); 	
   if (ret == -1)
-    CSharedLog::Log(L_DBG, __FILE__, __LINE__, "setsockopt: TTL");
+    SHARED_LOG(L_DBG, "setsockopt: TTL");
 }
 
 /* TeardownSocket */
@@ -308,7 +308,7 @@ void CUDPSocket::run()
 
   CUDPSocket* udp_sock = this; //(CUDPSocket*)arg;
 
-	CSharedLog::Log(L_EXT, __FILE__, __LINE__, 
+	SHARED_LOG(L_EXT, 
       "listening on %s:%d", udp_sock->GetIPAddress().c_str(), udp_sock->GetPort());
   
 	char buffer[4096];	
@@ -344,7 +344,7 @@ void CUDPSocket::run()
 			pthread_testcancel();
 			fuppesSleep(100);
 			#else */
-      CSharedLog::Log(L_DBG, __FILE__, __LINE__, "error :: recvfrom()");
+      SHARED_LOG(L_DBG, "error :: recvfrom()");
       //#endif
 			continue;
     }
@@ -362,11 +362,11 @@ void CUDPSocket::run()
 		  	udp_sock->CallOnReceive(&pSSDPMessage);
       }
       else {
-        CSharedLog::Log(L_DBG, __FILE__, __LINE__, "error parsing UDP-message");
+        SHARED_LOG(L_DBG, "error parsing UDP-message");
       }
 		}
 	}
 	
-  CSharedLog::Log(L_EXT, __FILE__, __LINE__, "exiting ReceiveLoop()");
+  SHARED_LOG(L_EXT, "exiting ReceiveLoop()");
   //fuppesThreadExit();
 }
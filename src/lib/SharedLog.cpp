@@ -28,8 +28,10 @@
 #include <sstream>
 #include <time.h>
 #include <string.h>
+#include <stdio.h>
 #include "../config.h"
 #include "Common/Exception.h"
+#include "LogWriter.h"
 
 #ifdef HAVE_LIBNOTIFY
 #include <libnotify/notify.h>
@@ -42,6 +44,7 @@ using namespace std;
 CSharedLog* CSharedLog::m_Instance = 0;
 ofstream*   CSharedLog::m_fsLogFile = NULL;
 std::string CSharedLog::m_sLogFileName = "";
+volatile int CSharedLog::m_nActiveLogLevel = 0;
 
 CSharedLog* CSharedLog::Shared()
 {
@@ -54,6 +57,7 @@ CSharedLog* CSharedLog::Shared()
 CSharedLog::CSharedLog()
 {
   fuppes::Log::init();
+  fuppes::LogWriter::init();
   SetLogLevel(1, false);
   
 	
@@ -81,11 +85,15 @@ CSharedLog::~CSharedLog()
     closelog();
   #endif*/
   
+  // the writer thread might still use the log file
+  fuppes::LogWriter::uninit();
+  fuppes::LogWriter::setOutput(NULL);
+
   if(m_fsLogFile) {
     m_fsLogFile->close();
     delete m_fsLogFile;
     m_fsLogFile = NULL;
-  }
+  }
 }
 
 bool CSharedLog::SetLogFileName(std::string p_sLogFileName)
@@ -96,6 +104,7 @@ bool CSharedLog::SetLogFileName(std::string p_sLogFileName)
   CSharedLog::m_sLogFileName = p_sLogFileName;
   m_fsLogFile = new ofstream();
   m_fsLogFile->open(CSharedLog::m_sLogFileName.c_str(), ios::out | ios::trunc);
+  fuppes::LogWriter::setOutput(m_fsLogFile);
   return true;
 }
 
@@ -106,6 +115,7 @@ void CSharedLog::SetLogLevel(int p_nLogLevel, bool p_bPrintLogLevel)
   m_bShowDebugLog    = false;
 
   m_nLogLevel = p_nLogLevel;  
+  m_nActiveLogLevel = p_nLogLevel;
   switch(m_nLogLevel)
   {
     case 0:
@@ -302,56 +312,55 @@ void CSharedLog::Log(int nLogLevel, std::string p_sMessage, char* p_szFileName,
   CSharedLog::Log(nLogLevel, p_szFileName, p_nLineNumber, p_sMessage.c_str());  
 }
 
+size_t CSharedLog::FormatHeader(char* p_szBuffer, size_t p_nSize, const std::string& p_sFileName, int p_nLineNumber)
+{
+  if(p_sFileName.empty() || p_nLineNumber <= 0)
+    return 0;
+
+  #ifndef WIN32
+  time_t now;
+  char nowtime[26];
+  time(&now);
+  ctime_r(&now, nowtime);
+  nowtime[24] = '\0';
+  #else
+  char nowtime[9];
+  _strtime(nowtime);
+  #endif
+
+  int length = snprintf(p_szBuffer, p_nSize, "== %s (%d) :: %s ==\n", p_sFileName.c_str(), p_nLineNumber, nowtime);
+  if(length < 0)
+    return 0;
+  if((size_t)length >= p_nSize)
+    return p_nSize - 1;
+  return length;
+}
+
 void CSharedLog::Log(int p_nLogLevel, const std::string p_sFileName, int p_nLineNumber, const std::string msg)
 {
-  if(p_nLogLevel >= CSharedLog::Shared()->m_nLogLevel)
+  if(!isActive(p_nLogLevel))
     return;
 
-  if(!m_sLogFileName.empty()) {  
-    if(!p_sFileName.empty() && p_nLineNumber > 0) {
-      #ifndef WIN32
-      time_t now;
-      char nowtime[26];
-      time(&now);  
-      ctime_r(&now, nowtime);
-      nowtime[24] = '\0';
-      string sNowtime = nowtime;
-      #else		
-      char timeStr[9];    
-      _strtime(timeStr);	
-      string sNowtime = timeStr;	
-      #endif 
-          
-      *m_fsLogFile << "== " << p_sFileName << " (" << p_nLineNumber <<  ") :: " <<
-        sNowtime << " ==" << endl;
-    }
-    *m_fsLogFile << msg << endl << endl;
-  }
-  else {
-    if(!p_sFileName.empty() && p_nLineNumber > 0) {
-      #ifndef WIN32
-      time_t now;
-      char nowtime[26];
-      time(&now);  
-      ctime_r(&now, nowtime);
-      nowtime[24] = '\0';
-      string sNowtime = nowtime;
-      #else
-      char timeStr[9];
-      _strtime(timeStr);
-      string sNowtime = timeStr;
-      #endif 
-          
-      cout << "== " << p_sFileName << " (" << p_nLineNumber <<  ") :: " <<
-        sNowtime << " ==" << endl;
-    }      
-    cout << msg << endl << endl;
+  char buffer[8192];
+  size_t length = FormatHeader(buffer, sizeof(buffer), p_sFileName, p_nLineNumber);
+
+  // long messages (e.g. soap responses) are not truncated
+  if(length + msg.length() + 2 > sizeof(buffer)) {
+    string out = string(buffer, length) + msg + "\n\n";
+    fuppes::LogWriter::write(out.c_str(), out.length());
+    return;
   }
+
+  memcpy(&buffer[length], msg.c_str(), msg.length());
+  length += msg.length();
+  buffer[length++] = '\n';
+  buffer[length++] = '\n';
+  fuppes::LogWriter::write(buffer, length);
 }
 
 void CSharedLog::Log(int p_nLogLevel, const std::string p_sFileName, int p_nLineNumber, const char* p_szFormat, ...)
 {
-	if(p_nLogLevel >= CSharedLog::Shared()->m_nLogLevel)
+	if(!isActive(p_nLogLevel))
     return;
 	
 	va_list args;
@@ -362,13 +371,21 @@ void CSharedLog::Log(int p_nLogLevel, const std::string p_sFileName, int p_nLine
 
 void CSharedLog::LogArgs(int p_nLogLevel, const std::string p_sFileName, int p_nLineNumber, const char* p_szFormat, va_list args)
 {
-	if(p_nLogLevel >= CSharedLog::Shared()->m_nLogLevel)
+	if(!isActive(p_nLogLevel))
     return;
 	
-	char buffer[8192];	
-  memset(buffer, 0, sizeof(buffer));
-	vsnprintf(buffer, sizeof(buffer) - 1, p_szFormat, args);
-	Log(p_nLogLevel, p_sFileName, p_nLineNumber, string(buffer));	
+	char buffer[8192];
+  size_t length = FormatHeader(buffer, sizeof(buffer) - 2, p_sFileName, p_nLineNumber);
+
+  // keep two bytes for the line breaks
+  size_t space = sizeof(buffer) - length - 2;
+	int ret = vsnprintf(&buffer[length], space, p_szFormat, args);
+  if(ret > 0)
+    length += ((size_t)ret < space) ? ret : space - 1;
+
+  buffer[length++] = '\n';
+  buffer[length++] = '\n';
+  fuppes::LogWriter::write(buffer, length);
 }
 
 void CSharedLog::Log(int p_nLogLevel, fuppes::Exception exception)
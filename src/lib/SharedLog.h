@@ -42,6 +42,13 @@
 #define L_EXT  2
 #define L_DBG  3
 
+// the arguments are only evaluated if the level is active.
+// use this instead of calling CSharedLog::Log() directly in hot paths
+#define SHARED_LOG(level, ...) \
+  do { \
+    if(CSharedLog::isActive(level)) \
+      CSharedLog::Log(level, __FILE__, __LINE__, __VA_ARGS__); \
+  } while(0)
 
 #include "Log.h"
 
@@ -98,6 +105,19 @@ public:
 	static void LogArgs(int p_nLogLevel, const std::string p_sFileName, int p_nLineNumber, const char* p_szFormat, va_list args);
 	static void Log(int p_nLogLevel, fuppes::Exception exception);
 	static void Print(const char* p_szFormat, ...);
+
+  /**
+   * cheap check whether a message with the level would be logged.
+   * if DISABLE_DEBUG_LOG is defined debug messages are never logged and
+   * a SHARED_LOG(L_DBG, ...) is removed by the compiler
+   */
+  static bool isActive(int p_nLogLevel) {
+    #ifdef DISABLE_DEBUG_LOG
+    if(p_nLogLevel >= L_DBG)
+      return false;
+    #endif
+    return (p_nLogLevel < m_nActiveLogLevel);
+  }
 		
   /** set the level of log verbosity
    *  @param  p_nLogLevel  0 = no log, 1 = std log, 2 = extended log, 3 = debug log
@@ -117,6 +137,9 @@ public:
   */
 
 private:
+
+  // formats the header and the message into a single block for the LogWriter
+  static size_t FormatHeader(char* p_szBuffer, size_t p_nSize, const std::string& p_sFileName, int p_nLineNumber);
 	
   int indentLevel, spacesPerIndent;
 
@@ -127,6 +150,8 @@ private:
   bool                m_bShowExtendedLog;
   bool                m_bShowDebugLog;
   int                 m_nLogLevel;
+  // copy of m_nLogLevel that can be checked without the instance
+  static volatile int m_nActiveLogLevel;
   static std::string  m_sLogFileName;
   static std::ofstream*  m_fsLogFile;
   
@@ -0,0 +1,268 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            TranscodingBuffer.cpp
+ *
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "TranscodingBuffer.h"
+#include "../SharedLog.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#endif
+
+// full memory barrier. the writer publishes m_size after the data
+// and readers pin a block before they check its state
+#define memoryBarrier() __sync_synchronize()
+
+CTranscodingBuffer::CTranscodingBuffer(unsigned int memoryLimit, std::string spillFileName)
+{
+  memset(m_pages, 0, sizeof(m_pages));
+  m_size              = 0;
+  m_full              = false;
+  m_blockCount        = 0;
+  m_firstMemoryBlock  = 0;
+  m_memoryBlocks      = 0;
+  m_memoryLimit       = memoryLimit;
+  m_spillFileName     = spillFileName;
+  m_spillFile         = -1;
+
+  #ifdef WIN32
+  m_memoryLimit = 0;
+  #endif
+  if(m_spillFileName.empty())
+    m_memoryLimit = 0;
+
+  // we always need the block that is currently written
+  if(m_memoryLimit > 0 && m_memoryLimit < TRANSCODING_BLOCK_SIZE * 2)
+    m_memoryLimit = TRANSCODING_BLOCK_SIZE * 2;
+}
+
+CTranscodingBuffer::~CTranscodingBuffer()
+{
+  for(int i = 0; i < TRANSCODING_PAGES; i++) {
+    if(m_pages[i] == NULL)
+      continue;
+    for(int j = 0; j < TRANSCODING_BLOCKS_PER_PAGE; j++) {
+      if(m_pages[i][j].data != NULL)
+        free(m_pages[i][j].data);
+    }
+    delete[] m_pages[i];
+  }
+
+  #ifndef WIN32
+  if(m_spillFile != -1) {
+    ::close(m_spillFile);
+    ::unlink(m_spillFileName.c_str());
+  }
+  #endif
+}
+
+CTranscodingBuffer::Block* CTranscodingBuffer::block(unsigned int index)
+{
+  return &m_pages[index / TRANSCODING_BLOCKS_PER_PAGE][index % TRANSCODING_BLOCKS_PER_PAGE];
+}
+
+CTranscodingBuffer::Block* CTranscodingBuffer::allocateBlock(unsigned int index)
+{
+  if(index >= TRANSCODING_MAX_BLOCKS)
+    return NULL;
+
+  unsigned int page = index / TRANSCODING_BLOCKS_PER_PAGE;
+
+  if(m_pages[page] == NULL) {
+    Block* blocks = new Block[TRANSCODING_BLOCKS_PER_PAGE];
+    memset(blocks, 0, sizeof(Block) * TRANSCODING_BLOCKS_PER_PAGE);
+    m_pages[page] = blocks;
+  }
+
+  Block* result = block(index);
+  result->data = (char*)malloc(TRANSCODING_BLOCK_SIZE);
+  if(result->data == NULL)
+    return NULL;
+
+  m_blockCount++;
+  m_memoryBlocks++;
+  return result;
+}
+
+void CTranscodingBuffer::append(const char* data, unsigned int length)
+{
+  if(m_full)
+    return;
+
+  unsigned int size = m_size;
+  unsigned int offset;
+  unsigned int count;
+  Block* current;
+
+  while(length > 0) {
+
+    offset = size % TRANSCODING_BLOCK_SIZE;
+    if(offset == 0 && (size / TRANSCODING_BLOCK_SIZE) == m_blockCount) {
+      current = allocateBlock(m_blockCount);
+      if(current == NULL) {
+        CSharedLog::Log(L_NORM, __FILE__, __LINE__, "transcoding buffer full (%u bytes)", size);
+        m_full = true;
+        break;
+      }
+    }
+    else {
+      current = block(size / TRANSCODING_BLOCK_SIZE);
+    }
+
+    count = TRANSCODING_BLOCK_SIZE - offset;
+    if(count > length)
+      count = length;
+
+    memcpy(&current->data[offset], data, count);
+    data   += count;
+    length -= count;
+    size   += count;
+  }
+
+  // publish the new data
+  memoryBarrier();
+  m_size = size;
+
+  if(m_memoryLimit > 0) {
+    releaseSpilled();
+    spill();
+  }
+}
+
+unsigned int CTranscodingBuffer::size() const
+{
+  return m_size;
+}
+
+unsigned int CTranscodingBuffer::read(char* buffer, unsigned int offset, unsigned int length)
+{
+  unsigned int size = m_size;
+  memoryBarrier();
+
+  if(offset >= size)
+    return 0;
+  if(length > size - offset)
+    length = size - offset;
+
+  unsigned int result = 0;
+  unsigned int blockOffset;
+  unsigned int count;
+  Block* current;
+
+  while(result < length) {
+
+    current     = block(offset / TRANSCODING_BLOCK_SIZE);
+    blockOffset = offset % TRANSCODING_BLOCK_SIZE;
+    count       = TRANSCODING_BLOCK_SIZE - blockOffset;
+    if(count > length - result)
+      count = length - result;
+
+    __sync_fetch_and_add(&current->pins, 1);
+    if(!current->spilled) {
+      memcpy(&buffer[result], &current->data[blockOffset], count);
+    }
+    #ifndef WIN32
+    else {
+      ssize_t ret = pread(m_spillFile, &buffer[result], count, (off_t)offset);
+      if(ret <= 0) {
+        __sync_fetch_and_sub(&current->pins, 1);
+        break;
+      }
+      count = ret;
+    }
+    #endif
+    __sync_fetch_and_sub(&current->pins, 1);
+
+    result += count;
+    offset += count;
+  }
+
+  return result;
+}
+
+void CTranscodingBuffer::spill()
+{
+  #ifndef WIN32
+  if(m_spillFile == -1) {
+    m_spillFile = ::open(m_spillFileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if(m_spillFile == -1) {
+      CSharedLog::Log(L_NORM, __FILE__, __LINE__, "unable to create transcoding spill file %s. keeping data in memory", m_spillFileName.c_str());
+      m_memoryLimit = 0;
+      return;
+    }
+  }
+
+  Block* oldest;
+  ssize_t written;
+
+  // never spill the block that is currently written
+  while((m_memoryBlocks * TRANSCODING_BLOCK_SIZE) > m_memoryLimit &&
+        m_firstMemoryBlock < m_blockCount - 1) {
+
+    oldest = block(m_firstMemoryBlock);
+
+    written = pwrite(m_spillFile, oldest->data, TRANSCODING_BLOCK_SIZE,
+                     (off_t)m_firstMemoryBlock * TRANSCODING_BLOCK_SIZE);
+    if(written != TRANSCODING_BLOCK_SIZE) {
+      CSharedLog::Log(L_NORM, __FILE__, __LINE__, "error writing transcoding spill file %s: %s. keeping data in memory", m_spillFileName.c_str(), strerror(errno));
+      m_memoryLimit = 0;
+      return;
+    }
+
+    oldest->spilled = true;
+    memoryBarrier();
+    if(oldest->pins == 0) {
+      free(oldest->data);
+      oldest->data = NULL;
+      m_memoryBlocks--;
+    }
+    else {
+      m_pendingRelease.push_back(oldest);
+    }
+
+    m_firstMemoryBlock++;
+  }
+  #endif
+}
+
+void CTranscodingBuffer::releaseSpilled()
+{
+  std::list<Block*>::iterator iter = m_pendingRelease.begin();
+  while(iter != m_pendingRelease.end()) {
+    if((*iter)->pins == 0) {
+      free((*iter)->data);
+      (*iter)->data = NULL;
+      m_memoryBlocks--;
+      iter = m_pendingRelease.erase(iter);
+    }
+    else {
+      iter++;
+    }
+  }
+}
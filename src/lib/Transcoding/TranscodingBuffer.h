@@ -0,0 +1,103 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+/***************************************************************************
+ *            TranscodingBuffer.h
+ *
+ *  FUPPES - Free UPnP Entertainment Service
+ *
+ *  Copyright (C) 2010 Ulrich Völkel <u-voelkel@users.sourceforge.net>
+ ****************************************************************************/
+
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _TRANSCODINGBUFFER_H
+#define _TRANSCODINGBUFFER_H
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#include <string>
+#include <list>
+
+#define TRANSCODING_BLOCK_SIZE      262144  // 256 kb
+#define TRANSCODING_BLOCKS_PER_PAGE 1024
+#define TRANSCODING_PAGES           16      // 16 * 1024 * 256 kb = 4 gb
+// the sizes and offsets are unsigned ints. we leave out the last block
+// so the size stays below 4 gb and can't wrap
+#define TRANSCODING_MAX_BLOCKS      (TRANSCODING_PAGES * TRANSCODING_BLOCKS_PER_PAGE - 1)
+
+/**
+ * the output of a transcoding session.
+ *
+ * the data is stored in fixed size blocks that are never moved once they
+ * are allocated. there is exactly one writer (the transcoding thread) and
+ * any number of readers (the http sessions).
+ * the writer publishes the number of valid bytes after the data has been
+ * copied so readers never need a lock.
+ *
+ * if a memory limit is set the oldest blocks are written to a spill file
+ * and released. readers pin a block while copying from it so the writer
+ * only releases blocks that are not in use.
+ */
+class CTranscodingBuffer
+{
+  public:
+    // memoryLimit in bytes. 0 = keep everything in memory
+    CTranscodingBuffer(unsigned int memoryLimit = 0, std::string spillFileName = "");
+    ~CTranscodingBuffer();
+
+    // writer. data beyond TRANSCODING_MAX_BLOCKS is dropped
+    void          append(const char* data, unsigned int length);
+
+    // readers
+    unsigned int  size() const;
+    // copies up to length bytes starting at offset. returns the number of bytes copied
+    unsigned int  read(char* buffer, unsigned int offset, unsigned int length);
+
+    // bytes currently held in memory
+    unsigned int  memoryUsage() const { return m_memoryBlocks * TRANSCODING_BLOCK_SIZE; }
+
+  private:
+    struct Block {
+      char*         data;
+      volatile int  pins;
+      volatile bool spilled;
+    };
+
+    Block*        block(unsigned int index);
+    Block*        allocateBlock(unsigned int index);
+    // moves the oldest blocks to the spill file until we are below the limit
+    void          spill();
+    // releases spilled blocks that were still in use by a reader
+    void          releaseSpilled();
+
+    Block*                  m_pages[TRANSCODING_PAGES];
+    volatile unsigned int   m_size;
+
+    // only used by the writer
+    bool                    m_full;
+    unsigned int            m_blockCount;
+    unsigned int            m_firstMemoryBlock;
+    unsigned int            m_memoryBlocks;
+    unsigned int            m_memoryLimit;
+    std::list<Block*>       m_pendingRelease;
+
+    std::string             m_spillFileName;
+    int                     m_spillFile;
+};
+
+#endif // _TRANSCODINGBUFFER_H
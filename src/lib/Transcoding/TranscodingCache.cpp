@@ -29,7 +29,9 @@
 #include "TranscodingMgr.h"
 
 #include "../Common/Common.h"
+#include "../Common/File.h"
 #include "../SharedLog.h"
+#include "../SharedConfig.h"
 #include "../ContentDirectory/FileDetails.h"
 
 #ifdef HAVE_LAME
@@ -38,6 +40,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string.h>
 
 using namespace std;
@@ -48,9 +51,8 @@ CTranscodingCacheObject::CTranscodingCacheObject()
 :fuppes::Thread("TranscodingCacheObject")
 {
   m_nRefCount       = 0;    
-  m_sBuffer         = NULL;
+  m_pBuffer         = NULL;
   m_pPcmOut         = NULL;
-  m_nBufferSize     = 0;
   m_nValidBytes     = 0;
   m_bIsTranscoding  = false;  
   //m_TranscodeThread = (fuppesThread)NULL; 
@@ -68,7 +70,7 @@ CTranscodingCacheObject::CTranscodingCacheObject()
   
   m_bLocked = false;
   
-  
+  m_pDataCondition = new fuppes::Condition(&m_Mutex);
   //fuppesThreadInitMutex(&m_Mutex);
 }
 
@@ -91,9 +93,8 @@ CTranscodingCacheObject::~CTranscodingCacheObject()
   //}
     
   //fuppesThreadDestroyMutex(&m_Mutex);  
-  if(m_sBuffer) {
-    free(m_sBuffer);
-  }
+  delete m_pBuffer;
+  delete m_pDataCondition;
   
   if(m_pPcmOut)
     delete[] m_pPcmOut;
@@ -109,6 +110,8 @@ CTranscodingCacheObject::~CTranscodingCacheObject()
 
 bool CTranscodingCacheObject::Init(CTranscodeSessionInfo* pSessionInfo, CDeviceSettings* pDeviceSettings)
 {
+  fuppes::MutexLocker locker(&m_InitMutex);
+
   std::string sExt = ExtractFileExt(pSessionInfo->m_sInFileName);
   
   ReleaseCount(pDeviceSettings->ReleaseDelay(sExt));
@@ -144,7 +147,7 @@ bool CTranscodingCacheObject::Init(CTranscodeSessionInfo* pSessionInfo, CDeviceS
       pSessionInfo->m_nGuessContentLength = m_pAudioEncoder->GuessContentLength(m_pDecoder->NumPcmSamples());
     }
     else {
-      pSessionInfo->m_nGuessContentLength = m_nBufferSize;
+      pSessionInfo->m_nGuessContentLength = m_pBuffer->size();
     }
     return true;
   }
@@ -152,6 +155,7 @@ bool CTranscodingCacheObject::Init(CTranscodeSessionInfo* pSessionInfo, CDeviceS
   
   CSharedLog::Log(L_EXT, __FILE__, __LINE__, "Init %s", pSessionInfo->m_sInFileName.c_str());  
   m_pDeviceSettings = pDeviceSettings;
+  m_SessionInfo = *pSessionInfo;
     
   
   CAudioDetails AudioDetails;
@@ -194,7 +198,7 @@ bool CTranscodingCacheObject::Init(CTranscodeSessionInfo* pSessionInfo, CDeviceS
     
     m_pAudioEncoder->SetAudioDetails(&AudioDetails);
     m_pAudioEncoder->SetTranscodingSettings(pDeviceSettings->FileSettings(sExt)->pTranscodingSettings);    
-    m_pAudioEncoder->SetSessionInfo(pSessionInfo);   
+    m_pAudioEncoder->SetSessionInfo(&m_SessionInfo);   
          
     pSessionInfo->m_nGuessContentLength = m_pAudioEncoder->GuessContentLength(m_pDecoder->NumPcmSamples());
     //cout << "guess content: " << pSessionInfo->m_nGuessContentLength << endl;
@@ -211,13 +215,8 @@ bool CTranscodingCacheObject::Init(CTranscodeSessionInfo* pSessionInfo, CDeviceS
   m_bInitialized = true;
 
   
-  if(pSessionInfo->m_nGuessContentLength > 0) {    
-    m_nBufferSize = pSessionInfo->m_nGuessContentLength;  
-    m_sBuffer = (char*)malloc(m_nBufferSize * sizeof(char*));
-    if(!m_sBuffer) {      
-      m_nBufferSize = 0;
-    }
-  }
+  unsigned int nMemoryLimit = CSharedConfig::Shared()->globalSettings->TranscodingMemoryLimit();
+  m_pBuffer = new CTranscodingBuffer(nMemoryLimit * 1024 * 1024, CSharedConfig::Shared()->CreateTempFileName());
   
   return true;
 }
@@ -266,11 +265,44 @@ unsigned int CTranscodingCacheObject::GetValidBytes()
 
     return nFileSize;
   }
-  else {    
-    return m_nValidBytes;
+  else if(m_pBuffer != NULL) {    
+    return m_pBuffer->size();
+  }
+  else {
+    return 0;
   }
 }
 
+bool CTranscodingCacheObject::WaitForData(unsigned int p_nSize, unsigned int p_nTimeout)
+{
+  unsigned int nStart = fuppesTicks();
+  unsigned int nElapsed = 0;
+  unsigned int nWait;
+  
+  m_Mutex.lock();
+  while(m_bIsTranscoding && !m_bIsComplete && (GetValidBytes() < p_nSize) && (nElapsed < p_nTimeout)) {
+    
+    nWait = p_nTimeout - nElapsed;
+    // external transcoders write to a file and can't signal us
+    if(m_pTranscoder != NULL && nWait > 100)
+      nWait = 100;
+    
+    m_pDataCondition->wait(nWait);
+    nElapsed = fuppesTicks() - nStart;
+  }
+  bool bResult = (GetValidBytes() >= p_nSize) || m_bIsComplete || !m_bIsTranscoding;
+  m_Mutex.unlock();
+  
+  return bResult;
+}
+
+unsigned int CTranscodingCacheObject::Read(char* p_szBuffer, unsigned int p_nOffset, unsigned int p_nSize)
+{
+  if(m_pBuffer == NULL)
+    return 0;  
+  return m_pBuffer->read(p_szBuffer, p_nOffset, p_nSize);
+}
+
 bool CTranscodingCacheObject::TranscodeToFile()
 {
   if(m_pTranscoder != NULL) {
@@ -283,38 +315,56 @@ bool CTranscodingCacheObject::TranscodeToFile()
 
 unsigned int CTranscodingCacheObject::Transcode(CDeviceSettings* pDeviceSettings)
 {  
+  unsigned int nDeadline = CSharedConfig::Shared()->globalSettings->TranscodingDeadline() * 1000;
+
+  // only the first session starts the transcoding.
+  // sessions that attach later use the output of the running one
+  m_Mutex.lock();
+  bool bStart = !m_bIsComplete && !m_bIsTranscoding && !this->running();
+  if(bStart)
+    m_bIsTranscoding = true;
+  m_Mutex.unlock();
   
   if(!m_bThreaded) {
-    std::string sExt = ExtractFileExt(m_sInFileName);
-    m_pTranscoder->TranscodeFile(pDeviceSettings->FileSettings(sExt), m_sInFileName, &m_sOutFileName);
-    
-    m_bIsComplete    = true;
-    m_bIsTranscoding = false;
+
+    if(bStart) {
+      std::string sExt = ExtractFileExt(m_sInFileName);
+      m_pTranscoder->TranscodeFile(pDeviceSettings->FileSettings(sExt), m_sInFileName, &m_sOutFileName);
+
+      Lock();
+      m_bIsComplete    = true;
+      m_bIsTranscoding = false;
+      m_pDataCondition->broadcast();
+      Unlock();
+    }
+    else {
+      // the file is written by another session
+      m_Mutex.lock();
+      while(m_bIsTranscoding && !m_bIsComplete)
+        m_pDataCondition->wait(1000);
+      m_Mutex.unlock();
+    }
+
     return GetValidBytes();
   }
   
   
   /* start new transcoding thread */
-  //if(!m_TranscodeThread && !m_bIsComplete)
-	if(!this->running() && !m_bIsComplete)
+	if(bStart)
   {
-    m_bIsTranscoding = true;
-    //fuppesThreadStartArg(m_TranscodeThread, TranscodeThread, *this);
 		this->start();
-    while(m_bIsTranscoding && (GetValidBytes() == 0))
-      fuppesSleep(100);
+    WaitForData(1, nDeadline);
     
     return GetValidBytes();
   }
   
-  /* transcoding is already running */
+  /* transcoding is already running. a session that attaches
+     late can start with the data that is already there */
   if(m_bIsTranscoding)
   {    
-    unsigned int nSize = GetValidBytes();
-    while(m_bIsTranscoding && (nSize == GetValidBytes()))
-      fuppesSleep(100);
-    if(m_bIsTranscoding)
-      return GetValidBytes();
+    if(GetValidBytes() == 0)
+      WaitForData(1, nDeadline);
+    return GetValidBytes();
   }
   
   /* object is already transcoded completely */  
@@ -338,6 +388,7 @@ void CTranscodingCacheObject::run()
     pCacheObj->Lock();
     pCacheObj->m_bIsComplete = true;
 		pCacheObj->m_bIsTranscoding = false;  
+    pCacheObj->m_pDataCondition->broadcast();
 		pCacheObj->Unlock();   
     
     //fuppesThreadExit();
@@ -347,18 +398,8 @@ void CTranscodingCacheObject::run()
   // threaded de-/encoder 
   long          samplesRead     = 0;    
   int           nEncRet         = 0;  
-  unsigned int  nAppendCount    = 0;
-  char*         szTmpBuff       = NULL;
-  unsigned int  nTmpBuffSize    = 0;
-  unsigned int  nTmpValidBytes  = 0;
-    
   int           nBytesConsumed  = 0;
   
-  #define APPEND_BUFFER_SIZE 65536 // 64 kb
-  
-  szTmpBuff    = (char*)malloc(APPEND_BUFFER_SIZE * sizeof(char*));
-  nTmpBuffSize = APPEND_BUFFER_SIZE;
-  
   pCacheObj->m_pAudioEncoder->Init();
     
   // transcode loop
@@ -367,49 +408,15 @@ void CTranscodingCacheObject::run()
     // encode
     nEncRet = pCacheObj->m_pAudioEncoder->EncodeInterleaved(pCacheObj->m_pPcmOut, samplesRead, nBytesConsumed);
     nBytesConsumed = 0;
-        
-    // reallocate temporary buffer ...
-    if((nTmpValidBytes + nEncRet) > nTmpBuffSize) {
-      szTmpBuff = (char*)realloc(szTmpBuff, (nTmpBuffSize + nEncRet) * sizeof(char));
-      nTmpBuffSize += nEncRet;
-    }
     
-    // ... store encoded frames ...
-    memcpy(&szTmpBuff[nTmpValidBytes], pCacheObj->m_pAudioEncoder->GetEncodedBuffer(), nEncRet);    
-    
-    // ... and set new temporary valid bytes count
-    nTmpValidBytes += nEncRet;
-    
-    nAppendCount++;  
-    
-    
-    // append frames to the cache-object's buffer
-    if(((nAppendCount % 50) == 0) || (nTmpBuffSize >= APPEND_BUFFER_SIZE)) {      
-      
-      if(pCacheObj->Locked())
-        continue;
+    // append the encoded frames to the cache-object's buffer.
+    // readers don't block the transcoding thread
+    if(nEncRet > 0) {
+      m_pBuffer->append((char*)pCacheObj->m_pAudioEncoder->GetEncodedBuffer(), nEncRet);
       
       pCacheObj->Lock();
-      
-      // create new buffer
-      if(!pCacheObj->m_sBuffer) {        
-        pCacheObj->m_sBuffer = (char*)malloc(nTmpValidBytes * sizeof(char));        
-        pCacheObj->m_nBufferSize = nTmpValidBytes;        
-      }
-      // enlarge buffer if neccessary
-      else if(pCacheObj->m_nBufferSize < (pCacheObj->m_nValidBytes + nTmpValidBytes)) {        
-        pCacheObj->m_sBuffer = (char*)realloc(pCacheObj->m_sBuffer, (pCacheObj->m_nValidBytes + nTmpValidBytes) * sizeof(char));        
-        pCacheObj->m_nBufferSize = pCacheObj->m_nValidBytes + nTmpValidBytes;        
-      }
-      
-      // copy data
-      memcpy(&pCacheObj->m_sBuffer[pCacheObj->m_nValidBytes], szTmpBuff, nTmpValidBytes);
-      pCacheObj->m_nValidBytes += nTmpValidBytes;
-                       
+      m_pDataCondition->broadcast();
       pCacheObj->Unlock();
-
-      // reset valid bytes count
-      nTmpValidBytes = 0;
     }
     
   } // while decode
@@ -417,60 +424,21 @@ void CTranscodingCacheObject::run()
   // transcoding loop exited
   if(!stopRequested() && !pCacheObj->m_bBreakTranscoding)
   {
-    // append remaining frames
-    if(nTmpValidBytes > 0) {
-      pCacheObj->Lock();
-      
-      if(!pCacheObj->m_sBuffer) {
-        pCacheObj->m_sBuffer = (char*)malloc(nTmpValidBytes * sizeof(char));
-        pCacheObj->m_nBufferSize = nTmpValidBytes;
-      }
-      else if ((pCacheObj->m_nValidBytes + nTmpValidBytes) > pCacheObj->m_nBufferSize) {
-        pCacheObj->m_sBuffer = (char*)realloc(pCacheObj->m_sBuffer, (pCacheObj->m_nValidBytes + nTmpValidBytes) * sizeof(char));
-        pCacheObj->m_nBufferSize = pCacheObj->m_nValidBytes + nTmpValidBytes;
-      }
-        
-      memcpy(&pCacheObj->m_sBuffer[pCacheObj->m_nValidBytes], szTmpBuff, nTmpValidBytes);      
-      pCacheObj->m_nValidBytes += nTmpValidBytes;
-      nTmpValidBytes = 0;
-      
-      pCacheObj->Unlock();
-    }
-
-    // flush and end transcoding
-
     // flush mp3
-    nTmpValidBytes = pCacheObj->m_pAudioEncoder->Flush();
-    pCacheObj->Lock();
-
-    if(nTmpValidBytes > 0) {
-      if(!pCacheObj->m_sBuffer) {
-        pCacheObj->m_sBuffer = (char*)malloc(nTmpValidBytes * sizeof(char));
-        pCacheObj->m_nBufferSize = nTmpValidBytes;
-      }
-      else if ((pCacheObj->m_nValidBytes + nTmpValidBytes) > pCacheObj->m_nBufferSize) {
-        pCacheObj->m_sBuffer = (char*)realloc(pCacheObj->m_sBuffer, (pCacheObj->m_nValidBytes + nTmpValidBytes) * sizeof(char));
-        pCacheObj->m_nBufferSize = pCacheObj->m_nValidBytes + nTmpValidBytes;
-      }
-      
-      memcpy(&pCacheObj->m_sBuffer[pCacheObj->m_nValidBytes], pCacheObj->m_pAudioEncoder->GetEncodedBuffer(), nTmpValidBytes);
-      pCacheObj->m_nValidBytes += nTmpValidBytes;
+    nEncRet = pCacheObj->m_pAudioEncoder->Flush();
+    if(nEncRet > 0) {
+      m_pBuffer->append((char*)pCacheObj->m_pAudioEncoder->GetEncodedBuffer(), nEncRet);
     }
       
+    pCacheObj->Lock();
     pCacheObj->m_bIsComplete = true;          
     pCacheObj->Unlock();    
   }
     
   pCacheObj->Lock();
   pCacheObj->m_bIsTranscoding = false;  
+  m_pDataCondition->broadcast();
   pCacheObj->Unlock();
-  
-  // delete temporary buffer
-  if(szTmpBuff)
-    free(szTmpBuff);  
-  
-  /*fuppesThreadExit();  
-  return 0;*/
 }
 
 
@@ -526,6 +494,12 @@ CTranscodingCache* CTranscodingCache::Shared()
 CTranscodingCache::CTranscodingCache()
 :fuppes::Thread("TranscodingCache")
 {
+  m_nRequestCount         = 0;
+  m_nSharedCount          = 0;
+  m_nSessionCount         = 0;
+  m_nTotalTimeToFirstByte = 0;
+  m_nMaxTimeToFirstByte   = 0;
+
   //m_ReleaseThread = (fuppesThread)NULL;
   //fuppesThreadInitMutex(&m_Mutex); 
 }
@@ -543,18 +517,28 @@ CTranscodingCache::~CTranscodingCache()
 }
 
 
-CTranscodingCacheObject* CTranscodingCache::GetCacheObject(std::string p_sFileName)
+CTranscodingCacheObject* CTranscodingCache::GetCacheObject(CTranscodeSessionInfo* pSessionInfo, CDeviceSettings* pDeviceSettings)
 {
+  std::string sKey = SessionKey(pSessionInfo, pDeviceSettings);
+
   m_Mutex.lock();
   
   CTranscodingCacheObject* pResult = NULL;  
+  m_nRequestCount++;
   
   /* check if object exists */
-  pResult = m_CachedObjects[p_sFileName];  
-  if(!pResult) {
+  m_CachedObjectsIterator = m_CachedObjects.find(sKey);
+  if(m_CachedObjectsIterator != m_CachedObjects.end()) {
+    pResult = m_CachedObjectsIterator->second;
+    m_nSharedCount++;
+    CSharedLog::Log(L_EXT, __FILE__, __LINE__, "attach to transcoding session \"%s\" (%u sessions)",
+                    pResult->m_sInFileName.c_str(), pResult->m_nRefCount + 1);
+  }
+  else {
     pResult = new CTranscodingCacheObject();    
-    m_CachedObjects[p_sFileName] = pResult;
-    pResult->m_sInFileName = p_sFileName;
+    m_CachedObjects[sKey] = pResult;
+    pResult->m_sInFileName = pSessionInfo->m_sInFileName;
+    pResult->m_sKey = sKey;
   }
   
   pResult->m_nRefCount++;
@@ -565,6 +549,38 @@ CTranscodingCacheObject* CTranscodingCache::GetCacheObject(std::string p_sFileNa
   return pResult;
 }
 
+// static
+std::string CTranscodingCache::SessionKey(CTranscodeSessionInfo* pSessionInfo, CDeviceSettings* pDeviceSettings)
+{
+  std::string sExt = ExtractFileExt(pSessionInfo->m_sInFileName);
+
+  stringstream sKey;
+  sKey << pSessionInfo->m_sInFileName << "|" <<
+    fuppes::File::lastModified(pSessionInfo->m_sInFileName) << "|" <<
+    pSessionInfo->sACodec << "|" << pSessionInfo->sVCodec;
+
+  CTranscodingSettings* pSettings = pDeviceSettings->FileSettings(sExt)->pTranscodingSettings;
+  if(pSettings == NULL)
+    return sKey.str();
+
+  sKey << "|" << pSettings->TranscodingType() <<
+    "|" << pSettings->TranscoderType() <<
+    "|" << pSettings->DecoderType() <<
+    "|" << pSettings->EncoderType() <<
+    "|" << pSettings->Extension() <<
+    "|" << pSettings->AudioCodec() <<
+    "|" << pSettings->VideoCodec(pSessionInfo->sVCodec) <<
+    "|" << pSettings->AudioBitRate() <<
+    "|" << pSettings->AudioSampleRate() <<
+    "|" << pSettings->VideoBitRate() <<
+    "|" << pSettings->LameQuality() <<
+    "|" << pSettings->sOutParams <<
+    "|" << pSettings->FFmpegParams() <<
+    "|" << pSettings->ExternalCmd();
+
+  return sKey.str();
+}
+
 void CTranscodingCache::ReleaseCacheObject(CTranscodingCacheObject* pCacheObj)
 {
   m_Mutex.lock();
@@ -589,6 +605,32 @@ void CTranscodingCache::ReleaseCacheObject(CTranscodingCacheObject* pCacheObj)
   m_Mutex.unlock();
 }
 
+void CTranscodingCache::AddTimeToFirstByte(unsigned int p_nMilliseconds)
+{
+  m_Mutex.lock();
+  m_nSessionCount++;
+  m_nTotalTimeToFirstByte += p_nMilliseconds;
+  if(p_nMilliseconds > m_nMaxTimeToFirstByte)
+    m_nMaxTimeToFirstByte = p_nMilliseconds;
+  m_Mutex.unlock();
+}
+
+unsigned int CTranscodingCache::SharedRatio()
+{
+  fuppes::MutexLocker locker(&m_Mutex);
+  if(m_nRequestCount == 0)
+    return 0;
+  return (m_nSharedCount * 100) / m_nRequestCount;
+}
+
+unsigned int CTranscodingCache::AvgTimeToFirstByte()
+{
+  fuppes::MutexLocker locker(&m_Mutex);
+  if(m_nSessionCount == 0)
+    return 0;
+  return m_nTotalTimeToFirstByte / m_nSessionCount;
+}
+
 //fuppesThreadCallback ReleaseLoop(void* arg)
 void CTranscodingCache::run()
 {
@@ -33,6 +33,7 @@
 #include "../Common/Common.h"
 #include "../Common/Thread.h"
 #include "WrapperBase.h"
+#include "TranscodingBuffer.h"
 #include "../DeviceSettings/DeviceSettings.h"
 #include <map>
 #endif
@@ -55,16 +56,15 @@ class CTranscodingCacheObject: public fuppes::Thread
     void Unlock();
     bool Locked() { return m_bLocked; }
   
-    // the buffer that stores the transcoded bytes
-    char* m_sBuffer; 
-    // valid bytes in buffer
+    // valid bytes of the transcoded file (TranscodeToFile() only)
     unsigned int m_nValidBytes;
-    
-    // the buffer's size
-    unsigned int m_nBufferSize;  
-  
   
     unsigned int GetValidBytes();
+    // copies transcoded data without locking the transcoding thread
+    unsigned int Read(char* p_szBuffer, unsigned int p_nOffset, unsigned int p_nSize);
+    // waits until p_nSize bytes are available, the transcoding finished
+    // or p_nTimeout ms elapsed. returns false on timeout
+    bool WaitForData(unsigned int p_nSize, unsigned int p_nTimeout);
   
     bool TranscodeToFile();
   
@@ -124,10 +124,24 @@ class CTranscodingCacheObject: public fuppes::Thread
   
     CDeviceSettings* DeviceSettings() { return m_pDeviceSettings; }
   
+    // the key of the session in the cache (see CTranscodingCache::SessionKey())
+    std::string m_sKey;
+  
   private:
 
 		void run();
 
+    // a copy of the first session's info. the encoder keeps a pointer
+    // to it and the session that created the object may end first
+    CTranscodeSessionInfo m_SessionInfo;
+    // serializes Init() of sessions that attach at the same time
+    fuppes::Mutex       m_InitMutex;
+
+    // the buffer that stores the transcoded bytes
+    CTranscodingBuffer* m_pBuffer;
+    // signaled (with m_Mutex) when new data is appended or the transcoding ends
+    fuppes::Condition*  m_pDataCondition;
+
     bool m_bLocked;
     
     bool m_bThreaded;
@@ -152,9 +166,27 @@ class CTranscodingCache: private fuppes::Thread
  
   
   public:
-    CTranscodingCacheObject* GetCacheObject(std::string p_sFileName);
+    // returns the transcoding session for the file and the device's target profile.
+    // sessions with the same key share the transcoded output
+    CTranscodingCacheObject* GetCacheObject(CTranscodeSessionInfo* pSessionInfo, CDeviceSettings* pDeviceSettings);
     void ReleaseCacheObject(CTranscodingCacheObject* pCacheObj);
 
+    // file name, modification time and everything in the device's
+    // settings that changes the transcoded output
+    static std::string SessionKey(CTranscodeSessionInfo* pSessionInfo, CDeviceSettings* pDeviceSettings);
+
+    // shared session statistics
+    unsigned int RequestCount() { return m_nRequestCount; }
+    unsigned int SharedCount() { return m_nSharedCount; }
+    // percentage of requests that attached to an existing session
+    unsigned int SharedRatio();
+
+    // time to first byte statistics (in ms)
+    void AddTimeToFirstByte(unsigned int p_nMilliseconds);
+    unsigned int SessionCount() { return m_nSessionCount; }
+    unsigned int AvgTimeToFirstByte();
+    unsigned int MaxTimeToFirstByte() { return m_nMaxTimeToFirstByte; }
+
 
     fuppes::Mutex         m_Mutex; 
     std::map<std::string, CTranscodingCacheObject*>           m_CachedObjects;
@@ -163,6 +195,13 @@ class CTranscodingCache: private fuppes::Thread
   private:
     //fuppesThread       m_ReleaseThread;
 		void run();
+
+    unsigned int          m_nRequestCount;
+    unsigned int          m_nSharedCount;
+
+    unsigned int          m_nSessionCount;
+    unsigned int          m_nTotalTimeToFirstByte;
+    unsigned int          m_nMaxTimeToFirstByte;
 };
 #endif // DISABLE_TRANSCODING
 #endif // _TRANSCODINGCACHE_H
@@ -28,12 +28,24 @@
 #include "../Common/RegEx.h"
 #include "../ContentDirectory/UPnPObjectTypes.h"
 #include "../ContentDirectory/DatabaseConnection.h"
+#include "../ContentDirectory/DatabaseObject.h"
+#include "../ContentDirectory/ContentDatabase.h"
 
 #include <sstream>
 #include <iostream>
 
 using namespace std;
 
+// builds the condition matching value as a substring of column.
+// the full text index holds a case and diacritic folded copy of the
+// column and the value is folded the same way by the database
+static std::string fullTextMatch(std::string column, std::string value)
+{
+  std::string sql = CDatabase::connection()->getStatement(SQL_SEARCH_FULL_TEXT);
+  sql = StringReplace(sql, "%COLUMN%", column);
+  return StringReplace(sql, "%VALUE%", SQLEscape(value));
+}
+
 CUPnPSearch::CUPnPSearch(std::string message)
 :CUPnPBrowseSearchBase(UPNP_SERVICE_CONTENT_DIRECTORY, UPNP_SEARCH, message)
 {
@@ -53,38 +65,6 @@ std::string CUPnPSearch::getQuery(bool count /*= false*/)
 
 
 
-void BuildParentIdList(SQLQuery* qry, std::string p_sIds, std::string p_sDevice, std::string* m_sParentIds)
-{
-  // read child ids of p_sIds
-/*  stringstream sSql;
-  sSql << 
-    "select OBJECT_ID from OBJECTS " <<
-    "where " <<
-    "  PARENT_ID in (" << p_sIds << ") and " <<
-    "  DEVICE " << p_sDevice;  */
-
-  string sql = qry->build(SQL_SEARCH_GET_CHILDREN_OBJECT_IDS, p_sIds, p_sDevice);  
-  qry->select(sql);
-  if(qry->eof()) {
-    return;
-  }
-  
-  string sResult = "";
-  while(!qry->eof()) {    
-    sResult += qry->result()->asString("OBJECT_ID") + ", ";
-    qry->next();
-  }
-
-  // append to list
-  (*m_sParentIds) += sResult;
-    
-  // remove trailing ", "
-  sResult = sResult.substr(0, sResult.length() - 2);
-    
-  // recursively read child objects
-  BuildParentIdList(qry, sResult, p_sDevice, m_sParentIds);
-}
-
 bool CUPnPSearch::prepareSQL()
 {
 	if(m_query.length() > 0 && m_queryCount.length() > 0) {
@@ -112,16 +92,11 @@ bool CUPnPSearch::prepareSQL()
 
   stringstream tmp;
   
+  // all descendants of the container share the same TREE_PATH prefix
+  // so a container search is a single range query on the TREE_PATH index
   unsigned int nContainerId = GetObjectIDAsUInt(); //GetContainerIdAsUInt();
   if(nContainerId > 0) {
-    
-    if(m_sParentIds.length() == 0) {
-      stringstream sIds;
-      sIds << nContainerId;    
-      BuildParentIdList(&qry, sIds.str(), sDevice, &m_sParentIds);      
-      m_sParentIds = m_sParentIds + sIds.str();      
-      //cout << "PARENT ID LIST: " << m_sParentIds << endl; fflush(stdout);
-    }
+    m_sTreePath = fuppes::DbObject::subtreePrefix(nContainerId, sDevice, &qry);
   }
   
   
@@ -142,9 +117,16 @@ bool CUPnPSearch::prepareSQL()
 
   sSql << qry.build(SQL_SEARCH_PART_FROM, 0, sDevice);
   
-  if(m_sParentIds.length() > 0) {
-    sSql << " and " <<
-      "  PARENT_ID in (" << m_sParentIds << ") ";        
+  if(nContainerId > 0) {
+    if(m_sTreePath.length() > 0) {
+      sSql << " and " <<
+        "  TREE_PATH >= '" << SQLEscape(m_sTreePath) << "' and " <<
+        "  TREE_PATH < '" << SQLEscape(fuppes::DbObject::subtreeEnd(m_sTreePath)) << "' ";
+    }
+    else {
+      // unknown container
+      sSql << " and 0 = 1 ";
+    }
   }
   
 	m_sSearchCriteria = StringReplace(m_sSearchCriteria, "&quot;", "\"");
@@ -288,7 +270,16 @@ bool CUPnPSearch::prepareSQL()
           tmp.str("");          
 				} 
 				else if (!bNumericProp) {
-				  if(bLikeOp)
+          std::string match;
+          if(bLikeOp && CContentDatabase::fullTextSearch())
+            match = fullTextMatch(sProp, sVal);
+
+          if(!match.empty()) {
+            sVal = match;
+            sProp = "";
+            sOp = "";
+          }
+				  else if(bLikeOp)
 				    sVal = "'%" + sVal + "%'";
 					else
 						sVal = "'" + sVal + "'";
@@ -42,7 +42,8 @@ class CUPnPSearch: public CUPnPBrowseSearchBase
 		std::string		getQuery(bool count = false);
 		  
   private:
-    std::string   m_sParentIds;
+    // TREE_PATH prefix of the searched container's descendants
+    std::string   m_sTreePath;
     std::string   m_sSearchCriteria;
 		
 		bool 					prepareSQL();		
@@ -44,6 +44,8 @@
 #ifdef WIN32
 #include <shellapi.h>
 #include <windows.h>
+#else
+#include <signal.h>
 #endif
 
 #include <string.h>
@@ -278,7 +280,8 @@ int fuppes_init(int argc, char* argv[], void(*p_log_cb)(const char* sz_log))
     // check Directory::writable(CSharedConfig::Shared()->databaseSettings->dbConnectionParams().filename)
   }
     
-	if(!CDatabase::connect(CSharedConfig::Shared()->databaseSettings->dbConnectionParams())) {
+	if(!CDatabase::connect(CSharedConfig::Shared()->databaseSettings->dbConnectionParams(),
+                         CSharedConfig::Shared()->databaseSettings->readConnections())) {
     Log::error(Log::unknown, Log::normal, __FILE__, __LINE__, "error opening database %s", CSharedConfig::Shared()->databaseSettings->dbConnectionParams().type.c_str());
 		return FUPPES_FALSE;
   }
@@ -312,7 +315,8 @@ int fuppes_start()
   if(pFuppes)
     return FUPPES_FALSE;
 
-	#if !defined(WIN32) && !defined(MSG_NOSIGNAL) && !(SO_NOSIGPIPE)
+	// sendfile() has no MSG_NOSIGNAL equivalent
+	#if !defined(WIN32) && ((!defined(MSG_NOSIGNAL) && !(SO_NOSIGPIPE)) || defined(HAVE_SENDFILE))
 	signal(SIGPIPE, SIG_IGN);
 	#endif
 
@@ -41,6 +41,9 @@ otherwise it uses a single connection per query
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <vector>
+#include <ctype.h>
 
 using namespace std;
 
@@ -179,9 +182,26 @@ class CMySQLQuery: public ISQLQuery
       return m_ResultList.size();
     }
 
-    void  prepare(const std::string sql) {
+    // the statement is not prepared on the server. execute()
+    // replaces the parameters and runs the statement via select()
+    bool prepare(const std::string sql) {
+      clear();
       m_sqlPrepare = sql;
+      m_params.clear();
+      return true;
     }
+
+    void bind(int index, const std::string value) {
+      m_params[index] = "'" + escape(value) + "'";
+    }
+
+    void bind(int index, fuppes_off_t value) {
+      std::stringstream str;
+      str << value;
+      m_params[index] = str.str();
+    }
+
+    bool execute();
     
 	private:
 		CMySQLQuery(CDatabaseConnection* connection, MYSQL* handle);		
@@ -195,6 +215,9 @@ class CMySQLQuery: public ISQLQuery
 		fuppes_off_t m_rowsReturned;
 
     std::string   m_sqlPrepare;
+    std::map<int, std::string>  m_params;
+
+    std::string escape(const std::string value);
 };
 
 
@@ -228,6 +251,38 @@ class CMySQLResult: public CSQLResult
 		  }
 			return 0;
 		}
+
+    int column(const std::string fieldName) {
+      for(size_t i = 0; i < m_FieldNames.size(); i++) {
+        if(m_FieldNames[i] == fieldName)
+          return i;
+      }
+      return -1;
+    }
+
+    bool isNull(int column) {
+      if(column < 0 || column >= (int)m_FieldNames.size())
+        return true;
+      return isNull(m_FieldNames[column]);
+    }
+
+    std::string asString(int column) {
+      if(column < 0 || column >= (int)m_FieldNames.size())
+        return "";
+      return asString(m_FieldNames[column]);
+    }
+
+    unsigned int asUInt(int column) {
+      if(isNull(column))
+        return 0;
+      return asUInt(m_FieldNames[column]);
+    }
+
+    int asInt(int column) {
+      if(isNull(column))
+        return 0;
+      return asInt(m_FieldNames[column]);
+    }
 		
 		CSQLResult* clone() {
 			
@@ -238,10 +293,13 @@ class CMySQLResult: public CSQLResult
 
 				result->m_FieldValues[m_FieldValuesIterator->first] = m_FieldValuesIterator->second;
 			}			
+      result->m_FieldNames = m_FieldNames;
 			return result;
 		}
     
   private:
+    // in select order. the index is the column index
+    std::vector<std::string> m_FieldNames;
     std::map<std::string, std::string> m_FieldValues;
     std::map<std::string, std::string>::iterator m_FieldValuesIterator;  
 };
@@ -436,6 +494,8 @@ bool CMySQLQuery::select(const std::string sql)
 		pResult = new CMySQLResult();		
 		for(i = 0; i < num_fields; i++)	{
 
+      pResult->m_FieldNames.push_back(fields[i].name);
+
 			if(!row[i]) {			
 				pResult->m_FieldValues[std::string(fields[i].name)] = "NULL";	
 				continue;
@@ -462,6 +522,53 @@ bool CMySQLQuery::select(const std::string sql)
 	return true;
 }
 
+std::string CMySQLQuery::escape(const std::string value)
+{
+  char* buffer = new char[value.length() * 2 + 1];
+  mysql_real_escape_string(m_handle, buffer, value.c_str(), value.length());
+  std::string result = buffer;
+  delete[] buffer;
+  return result;
+}
+
+bool CMySQLQuery::execute()
+{
+  std::string sql;
+  std::map<int, std::string>::iterator param;
+  size_t pos = 0;
+  size_t end;
+  bool quoted = false;
+
+  // replace ?1, ?2 ... outside of string literals with the bound values.
+  // unbound parameters are NULL
+  while(pos < m_sqlPrepare.length()) {
+    if(m_sqlPrepare[pos] == '\'')
+      quoted = !quoted;
+    if(quoted || m_sqlPrepare[pos] != '?') {
+      sql += m_sqlPrepare[pos++];
+      continue;
+    }
+
+    end = pos + 1;
+    while(end < m_sqlPrepare.length() && isdigit(m_sqlPrepare[end]))
+      end++;
+
+    param = m_params.find(atoi(m_sqlPrepare.substr(pos + 1, end - pos - 1).c_str()));
+    sql += (param != m_params.end()) ? param->second : "NULL";
+    pos = end;
+  }
+
+  std::string lower = sql.substr(0, 6);
+  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+  if(lower.compare("select") == 0)
+    return select(sql);
+  
+  if(!exec(sql))
+    return false;
+  m_lastInsertId = mysql_insert_id(m_handle);
+  return true;
+}
+
 bool CMySQLQuery::exec(const std::string sql)
 {
   m_connection->check();
@@ -57,7 +57,7 @@ static const fuppes_sql mysql_sql[] = {
   },
 
   {SQL_GET_OBJECT_TYPE,
-  "select TYPE from OBJECTS "
+  "select TYPE, UPDATE_ID from OBJECTS "
   "where OBJECT_ID = %OBJECT_ID% and %DEVICE%"
   },
 
@@ -150,6 +150,11 @@ static const fuppes_sql mysql_sql[] = {
     "  VCONTAINER_PATH TEXT DEFAULT NULL, "
    	"  VREF_ID BIGINT DEFAULT 0, "
 	  "  VISIBLE INTEGER DEFAULT 1, "
+    "  UPDATE_ID INTEGER DEFAULT 0, "
+    "  TREE_PATH TEXT DEFAULT NULL, "
+    "  FILE_SIZE BIGINT DEFAULT 0, "
+    "  FILE_MTIME INTEGER DEFAULT 0, "
+    "  FILE_INODE BIGINT DEFAULT 0, "
     "  CHANGED_AT INTEGER, "
     "  UPDATED_AT INTEGER ) "
     "ENGINE=MyISAM  DEFAULT CHARSET=utf8;"
@@ -192,6 +197,24 @@ static const fuppes_sql mysql_sql[] = {
   {SQL_GET_OBJECT_TYPE_COUNT,
     "select TYPE, count(*) as VALUE from OBJECTS group by TYPE"
   },
+
+
+  // full text search is not supported
+  {SQL_FULL_TEXT_INDEX_EXISTS,
+    ""
+  },
+
+  {SQL_CREATE_FULL_TEXT_INDEX,
+    ""
+  },
+
+  {SQL_DROP_FULL_TEXT_INDEX,
+    ""
+  },
+
+  {SQL_SEARCH_FULL_TEXT,
+    ""
+  },
   
 
   
@@ -31,6 +31,9 @@
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <map>
+#include <vector>
+#include <string.h>
 
 #include <sqlite3.h>
 
@@ -38,6 +41,138 @@
 #include <windows.h>
 #endif
 
+// max. number of prepared statements cached per connection
+#define SQLITE_STATEMENT_CACHE_SIZE 64
+
+// how long sqlite waits for a lock before it returns SQLITE_BUSY
+#define SQLITE_BUSY_TIMEOUT 1000  // ms
+// how often a transaction is started again after SQLITE_BUSY
+#define SQLITE_BUSY_RETRIES 30
+
+// lowercase base letters of U+00C0 - U+017F and U+0370 - U+045F.
+// e.g. 0x00C9 (E acute) -> 0x0065 (e)
+static const unsigned short foldLatin[] = {
+  0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x00E6, 0x0063,
+  0x0065, 0x0065, 0x0065, 0x0065, 0x0069, 0x0069, 0x0069, 0x0069,
+  0x00F0, 0x006E, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x00D7,
+  0x006F, 0x0075, 0x0075, 0x0075, 0x0075, 0x0079, 0x00FE, 0x00DF,
+  0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x00E6, 0x0063,
+  0x0065, 0x0065, 0x0065, 0x0065, 0x0069, 0x0069, 0x0069, 0x0069,
+  0x00F0, 0x006E, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x00F7,
+  0x006F, 0x0075, 0x0075, 0x0075, 0x0075, 0x0079, 0x00FE, 0x0079,
+  0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0063, 0x0063,
+  0x0063, 0x0063, 0x0063, 0x0063, 0x0063, 0x0063, 0x0064, 0x0064,
+  0x0064, 0x0064, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065,
+  0x0065, 0x0065, 0x0065, 0x0065, 0x0067, 0x0067, 0x0067, 0x0067,
+  0x0067, 0x0067, 0x0067, 0x0067, 0x0068, 0x0068, 0x0068, 0x0068,
+  0x0069, 0x0069, 0x0069, 0x0069, 0x0069, 0x0069, 0x0069, 0x0069,
+  0x0069, 0x0069, 0x0133, 0x0133, 0x006A, 0x006A, 0x006B, 0x006B,
+  0x0138, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C,
+  0x006C, 0x006C, 0x006C, 0x006E, 0x006E, 0x006E, 0x006E, 0x006E,
+  0x006E, 0x0149, 0x014B, 0x014B, 0x006F, 0x006F, 0x006F, 0x006F,
+  0x006F, 0x006F, 0x0153, 0x0153, 0x0072, 0x0072, 0x0072, 0x0072,
+  0x0072, 0x0072, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073,
+  0x0073, 0x0073, 0x0074, 0x0074, 0x0074, 0x0074, 0x0074, 0x0074,
+  0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075,
+  0x0075, 0x0075, 0x0075, 0x0075, 0x0077, 0x0077, 0x0079, 0x0079,
+  0x0079, 0x007A, 0x007A, 0x007A, 0x007A, 0x007A, 0x007A, 0x017F
+};
+
+static const unsigned short foldGreekCyrillic[] = {
+  0x0371, 0x0371, 0x0373, 0x0373, 0x02B9, 0x0375, 0x0377, 0x0377,
+  0x0378, 0x0379, 0x037A, 0x037B, 0x037C, 0x037D, 0x003B, 0x03F3,
+  0x0380, 0x0381, 0x0382, 0x0383, 0x0384, 0x00A8, 0x03B1, 0x00B7,
+  0x03B5, 0x03B7, 0x03B9, 0x038B, 0x03BF, 0x038D, 0x03C5, 0x03C9,
+  0x03B9, 0x03B1, 0x03B2, 0x03B3, 0x03B4, 0x03B5, 0x03B6, 0x03B7,
+  0x03B8, 0x03B9, 0x03BA, 0x03BB, 0x03BC, 0x03BD, 0x03BE, 0x03BF,
+  0x03C0, 0x03C1, 0x03A2, 0x03C3, 0x03C4, 0x03C5, 0x03C6, 0x03C7,
+  0x03C8, 0x03C9, 0x03B9, 0x03C5, 0x03B1, 0x03B5, 0x03B7, 0x03B9,
+  0x03C5, 0x03B1, 0x03B2, 0x03B3, 0x03B4, 0x03B5, 0x03B6, 0x03B7,
+  0x03B8, 0x03B9, 0x03BA, 0x03BB, 0x03BC, 0x03BD, 0x03BE, 0x03BF,
+  0x03C0, 0x03C1, 0x03C2, 0x03C3, 0x03C4, 0x03C5, 0x03C6, 0x03C7,
+  0x03C8, 0x03C9, 0x03B9, 0x03C5, 0x03BF, 0x03C5, 0x03C9, 0x03D7,
+  0x03D0, 0x03D1, 0x03D2, 0x03D2, 0x03D2, 0x03D5, 0x03D6, 0x03D7,
+  0x03D9, 0x03D9, 0x03DB, 0x03DB, 0x03DD, 0x03DD, 0x03DF, 0x03DF,
+  0x03E1, 0x03E1, 0x03E3, 0x03E3, 0x03E5, 0x03E5, 0x03E7, 0x03E7,
+  0x03E9, 0x03E9, 0x03EB, 0x03EB, 0x03ED, 0x03ED, 0x03EF, 0x03EF,
+  0x03F0, 0x03F1, 0x03F2, 0x03F3, 0x03B8, 0x03F5, 0x03F6, 0x03F8,
+  0x03F8, 0x03F2, 0x03FB, 0x03FB, 0x03FC, 0x037B, 0x037C, 0x037D,
+  0x0435, 0x0435, 0x0452, 0x0433, 0x0454, 0x0455, 0x0456, 0x0456,
+  0x0458, 0x0459, 0x045A, 0x045B, 0x043A, 0x0438, 0x0443, 0x045F,
+  0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437,
+  0x0438, 0x0438, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E, 0x043F,
+  0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+  0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F,
+  0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437,
+  0x0438, 0x0438, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E, 0x043F,
+  0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+  0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F,
+  0x0435, 0x0435, 0x0452, 0x0433, 0x0454, 0x0455, 0x0456, 0x0456,
+  0x0458, 0x0459, 0x045A, 0x045B, 0x043A, 0x0438, 0x0443, 0x045F
+};
+
+static unsigned int foldCodepoint(unsigned int c)
+{
+  if(c < 0x80)
+    return (c >= 'A' && c <= 'Z') ? c + 0x20 : c;
+  if(c >= 0xC0 && c <= 0x17F)
+    return foldLatin[c - 0xC0];
+  if(c >= 0x370 && c <= 0x45F)
+    return foldGreekCyrillic[c - 0x370];
+  return c;
+}
+
+// fuppes_fold(value) folds the case and removes the diacritics of latin,
+// greek and cyrillic letters. the full text index stores the folded
+// values and the searches fold the search value the same way
+static void foldFunction(sqlite3_context* context, int argc, sqlite3_value** argv)
+{
+  const unsigned char* value = sqlite3_value_text(argv[0]);
+  if(value == NULL) {
+    sqlite3_result_null(context);
+    return;
+  }
+
+  std::string result;
+  unsigned int c;
+  int length;
+  for(const unsigned char* pos = value; *pos != '\0'; pos += length) {
+
+    // decode the utf-8 sequence. invalid bytes are copied
+    if(*pos < 0x80) { c = *pos; length = 1; }
+    else if((*pos & 0xE0) == 0xC0 && (pos[1] & 0xC0) == 0x80) {
+      c = ((pos[0] & 0x1F) << 6) | (pos[1] & 0x3F);
+      length = 2;
+    }
+    else {
+      result += *pos;
+      length = 1;
+      continue;
+    }
+
+    // everything we fold is encoded in one or two bytes
+    c = foldCodepoint(c);
+    if(c < 0x80) {
+      result += (char)c;
+    }
+    else {
+      result += (char)(0xC0 | (c >> 6));
+      result += (char)(0x80 | (c & 0x3F));
+    }
+  }
+  sqlite3_result_text(context, result.c_str(), result.length(), SQLITE_TRANSIENT);
+}
+
+/**
+ * a prepared statement together with the index of its result columns
+ */
+struct CSQLiteStatement
+{
+  sqlite3_stmt*               stmt;
+  std::string                 sql;
+  std::map<std::string, int>  columns;
+};
+
 class CSQLiteConnection: public CDatabaseConnection
 {
 	public:
@@ -60,6 +195,25 @@ class CSQLiteConnection: public CDatabaseConnection
     plugin_info* plugin() { return m_plugin; }
 
     void vacuum();
+
+    // takes a prepared statement from the cache or prepares a new one.
+    // the statement is owned by the caller until it is released
+    CSQLiteStatement* acquireStatement(const std::string sql);
+    // resets the statement and puts it back into the cache
+    void releaseStatement(CSQLiteStatement* statement);
+
+    /**
+     * called when a statement returned SQLITE_BUSY.
+     * outside of a transaction the statement was a transaction of its own
+     * and has been rolled back by sqlite. so it can be run again.
+     * inside a transaction a single statement can't be repeated.
+     * the transaction is rolled back and commit() fails.
+     * returns true if the statement should be run again
+     */
+    bool retry(int tries);
+    // the statements of a rolled back transaction fail until commit() or
+    // rollback() so the rest of the batch does not run in autocommit
+    bool transactionFailed() { return m_transactionFailed; }
     
 	private:
 		bool				connect(const CConnectionParams params);
@@ -67,6 +221,37 @@ class CSQLiteConnection: public CDatabaseConnection
 
 		sqlite3*			m_handle;
 		plugin_info*	m_plugin;
+    // the current transaction has been rolled back by retry()
+    bool          m_transactionFailed;
+
+    sqlite3_mutex*                              m_statementsMutex;
+    std::map<std::string, CSQLiteStatement*>    m_statements;
+    std::list<CSQLiteStatement*>                m_statementsLru;
+};
+
+class CSQLiteRow;
+class CSQLiteResult;
+
+/**
+ * the rows of a select(). the values of all rows are stored in a single
+ * buffer and terminated by a '\0' so they can be parsed in place
+ */
+struct CSQLiteTable
+{
+  std::map<std::string, int>  columns;
+  int                         columnCount;
+  std::string                 data;
+  // the start of every value in data. rows * columnCount + 1 entries
+  std::vector<unsigned int>   offsets;
+  std::vector<bool>           nulls;
+
+  const char* value(int row, int col) const {
+    return data.c_str() + offsets[(row * columnCount) + col];
+  }
+  unsigned int length(int row, int col) const {
+    int index = (row * columnCount) + col;
+    return offsets[index + 1] - offsets[index] - 1;
+  }
 };
 
 class CSQLiteQuery: public ISQLQuery
@@ -74,54 +259,36 @@ class CSQLiteQuery: public ISQLQuery
 	friend class CSQLiteConnection;
 	
 	public:		
-		~CSQLiteQuery() {
-			clear();
-		}
+		~CSQLiteQuery();
 		
-		virtual bool select(const std::string sql = "");
-		virtual bool exec(const std::string sql = "");
-		virtual fuppes_off_t insert(const std::string sql = "");
+		virtual bool select(const std::string sql);
+		virtual bool exec(const std::string sql);
+		virtual fuppes_off_t insert(const std::string sql);
 		
-		bool eof() { return (m_ResultListIterator == m_ResultList.end()); }
-		void next() {
-		  if(m_ResultListIterator != m_ResultList.end()) {
-		    m_ResultListIterator++;
-		  }
-		}
-		CSQLResult* result() { return *m_ResultListIterator; }	
+		bool eof();
+		void next();
+		CSQLResult* result();
 		
 		fuppes_off_t lastInsertId() { return m_lastInsertId; }
 		
-		void clear() {
-			for(m_ResultListIterator = m_ResultList.begin(); m_ResultListIterator != m_ResultList.end();) {
-				CSQLResult* pResult = *m_ResultListIterator;
-				delete pResult;				
-				m_ResultListIterator++;
-			}		
-			m_ResultList.clear();
-			m_rowsReturned = 0;
-			m_ResultListIterator = m_ResultList.end();
-		}
+		void clear();
 
 		CDatabaseConnection* connection() { return m_connection; }
 
-
+    // in cursor mode the number of rows is unknown
+    // so this returns the number of rows fetched so far
     unsigned int size() {
-      return m_ResultList.size();
+      if(m_statement)
+        return m_rowsReturned;
+      return m_rows.size();
     }
 
+    bool prepare(const std::string sql);
+    void bind(int index, const std::string value);
+    void bind(int index, fuppes_off_t value);
+    bool execute();
 
     static std::string escape(std::string value);
-
-    void  prepare(const std::string sql) {
-      m_sqlPrepare = sql;
-      m_sqlPrepared = "";
-    }
-
-    void bind(const std::string field, const std::string value) {
-      std::string format = "'" + CSQLiteQuery::escape(value) + "'";
-      setValue(field, format);
-    }
     
 	private:
 		CSQLiteQuery(CDatabaseConnection* connection, sqlite3* handle);		
@@ -129,24 +296,21 @@ class CSQLiteQuery: public ISQLQuery
 		
 		off_t		m_lastInsertId;
 		
-		std::list<CSQLResult*> m_ResultList;
-    std::list<CSQLResult*>::iterator m_ResultListIterator;
+    // the result of select()
+    CSQLiteTable*               m_table;
+    std::vector<CSQLiteResult>  m_rows;
+    size_t                      m_rowIndex;
 		off_t m_rowsReturned;
 
-    std::string   m_sqlPrepare;
-    std::string   m_sqlPrepared;
+    // fetches the next row of the prepared statement
+    void step();
+    // resets the statement if it has already been executed
+    void reset();
 
-    void setValue(std::string field, std::string value) {
-
-      std::string tmp = m_sqlPrepare;
-      field = ":" + field;
-      
-      while(tmp.find(field) != std::string::npos)	{
-	      m_sqlPrepared += tmp.substr(0, tmp.find(field)) + value;
-		    tmp   = tmp.substr(tmp.find(field) + value.length(), tmp.length());
-	    }
-      m_sqlPrepared += tmp;
-    }
+    CSQLiteStatement*   m_statement;
+    CSQLiteRow*         m_row;
+    int                 m_stepResult;
+    bool                m_executed;
 		
 		CDatabaseConnection* m_connection;
 };
@@ -155,58 +319,212 @@ class CSQLiteQuery: public ISQLQuery
 class CSQLiteResult: public CSQLResult
 {	
 	friend class CSQLiteQuery;
+	friend class CSQLiteRow;
 	
   public:
-    bool isNull(std::string fieldName){			
-			std::string sValue = asString(fieldName);
-			if((sValue.length() == 0) || (sValue.compare("NULL") == 0))
-				return true;
-			else
-				return false;
+    CSQLiteResult(const CSQLiteTable* table, int row, bool ownsTable = false) {
+      m_table = table;
+      m_row = row;
+      m_ownsTable = ownsTable;
+    }
+
+    ~CSQLiteResult() {
+      if(m_ownsTable)
+        delete m_table;
+    }
+
+    bool isNull(std::string fieldName) {
+      return isNull(column(fieldName, true));
 		}
 
     std::string	asString(std::string fieldName) {
+      return asString(column(fieldName, true));
+		}
+
+		unsigned int asUInt(std::string fieldName) {	
+      return asUInt(column(fieldName, true));
+		}
+			
+		int asInt(std::string fieldName) {
+      return asInt(column(fieldName, true));
+		}
 
-      m_FieldValuesIterator = m_FieldValues.find(fieldName);
-      if(m_FieldValuesIterator == m_FieldValues.end()) {
-        fprintf(stderr, "[sqlite] unknown field: %s\n", fieldName.c_str());
+    int column(const std::string fieldName) {
+      return column(fieldName, false);
+    }
+
+    bool isNull(int column) {
+      if(column < 0 || m_table->nulls[(m_row * m_table->columnCount) + column])
+        return true;
+      return (m_table->length(m_row, column) == 0 || strcmp(m_table->value(m_row, column), "NULL") == 0);
+    }
+
+    std::string asString(int column) {
+      if(column < 0)
         return "";
-      }      
-		  return m_FieldValues[fieldName];
+      return std::string(m_table->value(m_row, column), m_table->length(m_row, column));
+    }
+
+    unsigned int asUInt(int column) {
+      if(isNull(column))
+        return 0;
+      return strtoul(m_table->value(m_row, column), NULL, 0);
+    }
+
+    int asInt(int column) {
+      if(isNull(column))
+        return 0;
+      return atoi(m_table->value(m_row, column));
+    }
+		
+		CSQLResult* clone() {
+      CSQLiteTable* table = new CSQLiteTable();
+      table->columns = m_table->columns;
+      table->columnCount = m_table->columnCount;
+      table->offsets.push_back(0);
+      for(int i = 0; i < m_table->columnCount; i++) {
+        table->data.append(m_table->value(m_row, i), m_table->length(m_row, i) + 1);
+        table->offsets.push_back(table->data.length());
+        table->nulls.push_back(m_table->nulls[(m_row * m_table->columnCount) + i]);
+      }
+			return new CSQLiteResult(table, 0, true);
+		}
+    
+    // the copies in the query's row vector never own the table
+    CSQLiteResult(const CSQLiteResult& result) : CSQLResult() {
+      m_table = result.m_table;
+      m_row = result.m_row;
+      m_ownsTable = false;
+    }
+
+    CSQLiteResult& operator=(const CSQLiteResult& result) {
+      m_table = result.m_table;
+      m_row = result.m_row;
+      m_ownsTable = false;
+      return *this;
+    }
+
+  private:
+    int column(const std::string& fieldName, bool warn) {
+      std::map<std::string, int>::const_iterator iter = m_table->columns.find(fieldName);
+      if(iter == m_table->columns.end()) {
+        if(warn)
+          fprintf(stderr, "[sqlite] unknown field: %s\n", fieldName.c_str());
+        return -1;
+      }
+      return iter->second;
+    }
+
+    const CSQLiteTable*   m_table;
+    int                   m_row;
+    bool                  m_ownsTable;
+};
+
+
+/**
+ * the current row of a prepared statement.
+ * the values are read directly from the statement
+ */
+class CSQLiteRow: public CSQLResult
+{	
+	friend class CSQLiteQuery;
+	
+  public:
+    bool isNull(std::string fieldName) {
+      return isNull(column(fieldName, true));
+		}
+
+    std::string	asString(std::string fieldName) {
+      return asString(column(fieldName, true));
 		}
 
 		unsigned int asUInt(std::string fieldName) {	
-			if(!isNull(fieldName)) {
-				return strtoul(asString(fieldName).c_str(), NULL, 0);
-			}
-			return 0;
+      return asUInt(column(fieldName, true));
 		}
 			
 		int asInt(std::string fieldName) {
-			
-			if(!isNull(fieldName)) {
-  			return atoi(asString(fieldName).c_str());
-		  }
-			return 0;
+      return asInt(column(fieldName, true));
 		}
+
+    int column(const std::string fieldName) {
+      return column(fieldName, false);
+    }
+
+    bool isNull(int column) {
+      if(column < 0 || sqlite3_column_type(m_statement->stmt, column) == SQLITE_NULL)
+        return true;
+      return (sqlite3_column_bytes(m_statement->stmt, column) == 0);
+    }
+
+    std::string asString(int column) {
+      if(column < 0)
+        return "";
+      const char* value = (const char*)sqlite3_column_text(m_statement->stmt, column);
+      if(value == NULL)
+        return "";
+      return std::string(value, sqlite3_column_bytes(m_statement->stmt, column));
+    }
+
+    unsigned int asUInt(int column) {
+      if(column < 0)
+        return 0;
+      switch(sqlite3_column_type(m_statement->stmt, column)) {
+        case SQLITE_NULL:
+          return 0;
+        case SQLITE_INTEGER:
+          return (unsigned int)sqlite3_column_int64(m_statement->stmt, column);
+        default:
+          return strtoul((const char*)sqlite3_column_text(m_statement->stmt, column), NULL, 0);
+      }
+    }
+
+    int asInt(int column) {
+      if(column < 0)
+        return 0;
+      switch(sqlite3_column_type(m_statement->stmt, column)) {
+        case SQLITE_NULL:
+          return 0;
+        case SQLITE_INTEGER:
+          return (int)sqlite3_column_int64(m_statement->stmt, column);
+        default:
+          return atoi((const char*)sqlite3_column_text(m_statement->stmt, column));
+      }
+    }
 		
 		CSQLResult* clone() {
-			
-			CSQLiteResult* result = new CSQLiteResult();			
-			for(m_FieldValuesIterator = m_FieldValues.begin();
-					m_FieldValuesIterator != m_FieldValues.end();
-					m_FieldValuesIterator++) {
-				
-				result->m_FieldValues[m_FieldValuesIterator->first] = m_FieldValuesIterator->second;
-			}			
-			return result;
+      CSQLiteTable* table = new CSQLiteTable();
+      table->columns = m_statement->columns;
+      table->columnCount = sqlite3_column_count(m_statement->stmt);
+      table->offsets.push_back(0);
+      const char* value;
+      for(int i = 0; i < table->columnCount; i++) {
+        value = (const char*)sqlite3_column_text(m_statement->stmt, i);
+        if(value != NULL)
+          table->data.append(value, sqlite3_column_bytes(m_statement->stmt, i));
+        table->data.push_back('\0');
+        table->offsets.push_back(table->data.length());
+        table->nulls.push_back(value == NULL);
+      }
+			return new CSQLiteResult(table, 0, true);
 		}
     
   private:
-    std::map<std::string, std::string> m_FieldValues;
-    std::map<std::string, std::string>::iterator m_FieldValuesIterator;  
-};
+    CSQLiteRow(CSQLiteStatement* statement) {
+      m_statement = statement;
+    }
 
+    int column(const std::string& fieldName, bool warn) {
+      std::map<std::string, int>::iterator iter = m_statement->columns.find(fieldName);
+      if(iter == m_statement->columns.end()) {
+        if(warn)
+          fprintf(stderr, "[sqlite] unknown field: %s\n", fieldName.c_str());
+        return -1;
+      }
+      return iter->second;
+    }
+
+    CSQLiteStatement* m_statement;
+};
 
 
 
@@ -214,11 +532,22 @@ CSQLiteConnection::CSQLiteConnection(plugin_info* plugin) //:CDatabaseConnection
 {
 	m_handle = NULL;
 	m_plugin = plugin;
+  m_transactionFailed = false;
+  m_statementsMutex = sqlite3_mutex_alloc(SQLITE_MUTEX_FAST);
 }
 
 CSQLiteConnection::~CSQLiteConnection()
 {
   //std::cout << "~CSQLiteConnection" << std::endl;
+  std::map<std::string, CSQLiteStatement*>::iterator iter;
+  for(iter = m_statements.begin(); iter != m_statements.end(); iter++) {
+    sqlite3_finalize(iter->second->stmt);
+    delete iter->second;
+  }
+  m_statements.clear();
+  m_statementsLru.clear();
+  sqlite3_mutex_free(m_statementsMutex);
+
 	if(!m_handle)
 		return;
 	
@@ -229,17 +558,29 @@ bool CSQLiteConnection::connect(const CConnectionParams params)
 {
   //std::cout << "open sqlite3 db file: " << params.filename << ":" << std::endl;
   
-	if(sqlite3_open(params.filename.c_str(), &m_handle) != SQLITE_OK) {
+  int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+  if(params.readonly)
+    flags = SQLITE_OPEN_READONLY;
+
+	if(sqlite3_open_v2(params.filename.c_str(), &m_handle, flags, NULL) != SQLITE_OK) {
     fprintf(stderr, "[sqlite] can't create/open database: %s :: %s\n", sqlite3_errmsg(m_handle), params.filename.c_str());
     sqlite3_close(m_handle);
+    m_handle = NULL;
     return false;
   }
-  //JM: Tell sqlite3 to retry queries for up to 1 second if the database is locked.
-  sqlite3_busy_timeout(m_handle, 1000);
+  // sqlite waits for a lock held by another connection before it returns SQLITE_BUSY
+  sqlite3_busy_timeout(m_handle, SQLITE_BUSY_TIMEOUT);
+  // used by the full text index triggers and searches
+  sqlite3_create_function(m_handle, "fuppes_fold", 1, SQLITE_UTF8, NULL, foldFunction, NULL, NULL);
 	
 	CSQLiteQuery qry(this, m_handle);
 	qry.exec("pragma temp_store = MEMORY");
-  qry.exec("pragma synchronous = OFF;");
+  if(!params.readonly) {
+    qry.exec("pragma synchronous = OFF;");
+    // readers don't block the writer and vice versa.
+    // the journal mode is stored in the database file
+    qry.exec("pragma journal_mode = WAL");
+  }
 
 	return true;
 }
@@ -256,25 +597,64 @@ ISQLQuery* CSQLiteConnection::query()
 
 bool CSQLiteConnection::startTransaction()
 {
-	ISQLQuery* qry = query();
-	bool result = qry->exec("begin transaction");
-	delete qry;
-	return result;
+  // the write lock is taken when the transaction starts. a deferred
+  // transaction reads first and can't be upgraded to a write transaction
+  // if another connection committed in the meantime (SQLITE_BUSY_SNAPSHOT).
+  // nothing has been done yet so on SQLITE_BUSY we simply start again
+  m_transactionFailed = false;
+  int result;
+  int tries = 0;
+  while((result = sqlite3_exec(m_handle, "begin immediate transaction", NULL, NULL, NULL)) == SQLITE_BUSY &&
+        ++tries < SQLITE_BUSY_RETRIES) {
+  }
+
+  if(result != SQLITE_OK) {
+    m_plugin->cb.log(m_plugin, 0, __FILE__, __LINE__, "begin transaction failed: %s", sqlite3_errmsg(m_handle));
+    return false;
+  }
+	return true;
 }
 
 bool CSQLiteConnection::commit()
 {
-	ISQLQuery* qry = query();
-	bool result = qry->exec("commit transaction");
-	delete qry;
-	return result;
+  // the transaction has been rolled back by retry()
+  if(m_transactionFailed) {
+    m_transactionFailed = false;
+    return false;
+  }
+
+  // a commit that failed with SQLITE_BUSY keeps the transaction open
+  // and can be repeated
+  int result;
+  int tries = 0;
+  while((result = sqlite3_exec(m_handle, "commit transaction", NULL, NULL, NULL)) == SQLITE_BUSY &&
+        ++tries < SQLITE_BUSY_RETRIES) {
+  }
+
+  if(result != SQLITE_OK) {
+    m_plugin->cb.log(m_plugin, 0, __FILE__, __LINE__, "commit failed: %s", sqlite3_errmsg(m_handle));
+    rollback();
+    return false;
+  }
+	return true;
 }
 
 void CSQLiteConnection::rollback()
 {
-	ISQLQuery* qry = query();
-	qry->exec("rollback transaction");
-	delete qry;
+  m_transactionFailed = false;
+  if(!sqlite3_get_autocommit(m_handle))
+    sqlite3_exec(m_handle, "rollback transaction", NULL, NULL, NULL);
+}
+
+bool CSQLiteConnection::retry(int tries)
+{
+  if(sqlite3_get_autocommit(m_handle))
+    return (tries < SQLITE_BUSY_RETRIES);
+
+  std::cout << "SQL busy: rolling back the transaction" << std::endl;
+  sqlite3_exec(m_handle, "rollback transaction", NULL, NULL, NULL);
+  m_transactionFailed = true;
+  return false;
 }
 
 void CSQLiteConnection::vacuum()
@@ -283,135 +663,331 @@ void CSQLiteConnection::vacuum()
   qry.exec("vacuum");
 }
 
+CSQLiteStatement* CSQLiteConnection::acquireStatement(const std::string sql)
+{
+  CSQLiteStatement* statement = NULL;
+
+  sqlite3_mutex_enter(m_statementsMutex);
+  std::map<std::string, CSQLiteStatement*>::iterator iter = m_statements.find(sql);
+  if(iter != m_statements.end()) {
+    statement = iter->second;
+    m_statements.erase(iter);
+    m_statementsLru.remove(statement);
+  }
+  sqlite3_mutex_leave(m_statementsMutex);
+
+  if(statement)
+    return statement;
+
+  m_plugin->cb.log(m_plugin, 0, __FILE__, __LINE__, "prepare: %s", sql.c_str());
+
+  sqlite3_stmt* stmt = NULL;
+  int nResult;
+  int tries = 0;
+  while((nResult = sqlite3_prepare_v2(m_handle, sql.c_str(), sql.length(), &stmt, NULL)) == SQLITE_BUSY &&
+        retry(++tries)) {
+  }
+
+  if(nResult != SQLITE_OK || stmt == NULL) {
+		std::cout << "SQL prepare error: " << sqlite3_errmsg(m_handle) << " :: " << sql << std::endl;
+    return NULL;
+  }
+
+  statement = new CSQLiteStatement();
+  statement->stmt = stmt;
+  statement->sql = sql;
+
+  // if a column name occurs more than once the last one wins.
+  // same as for select()
+  int count = sqlite3_column_count(stmt);
+  for(int i = 0; i < count; i++) {
+    statement->columns[std::string(sqlite3_column_name(stmt, i))] = i;
+  }
+  
+  return statement;
+}
+
+void CSQLiteConnection::releaseStatement(CSQLiteStatement* statement)
+{
+  sqlite3_reset(statement->stmt);
+  sqlite3_clear_bindings(statement->stmt);
+
+  CSQLiteStatement* evicted = NULL;
+
+  sqlite3_mutex_enter(m_statementsMutex);
+  if(m_statements.find(statement->sql) != m_statements.end()) {
+    // another query already returned the same statement
+    evicted = statement;
+  }
+  else {
+    m_statements[statement->sql] = statement;
+    m_statementsLru.push_back(statement);
+
+    // drop the least recently used statement
+    if(m_statementsLru.size() > SQLITE_STATEMENT_CACHE_SIZE) {
+      evicted = m_statementsLru.front();
+      m_statementsLru.pop_front();
+      m_statements.erase(evicted->sql);
+    }
+  }
+  sqlite3_mutex_leave(m_statementsMutex);
+
+  if(evicted) {
+    sqlite3_finalize(evicted->stmt);
+    delete evicted;
+  }
+}
+
 
 CSQLiteQuery::CSQLiteQuery(CDatabaseConnection* connection, sqlite3* handle)
 {
 	m_handle = handle;
 	m_connection = connection;
+  m_lastInsertId = 0;
+  m_rowsReturned = 0;
+  m_statement = NULL;
+  m_row = NULL;
+  m_stepResult = SQLITE_DONE;
+  m_executed = false;
+  m_table = NULL;
+  m_rowIndex = 0;
 }
 
-bool CSQLiteQuery::select(const std::string sql /* = "" */)
+CSQLiteQuery::~CSQLiteQuery()
 {
-	clear();
-  
-  if(m_sqlPrepared.length() == 0 && sql.length() == 0)
+  clear();
+}
+
+bool CSQLiteQuery::eof()
+{
+  if(m_statement)
+    return (m_stepResult != SQLITE_ROW);
+  return (m_rowIndex >= m_rows.size());
+}
+
+void CSQLiteQuery::next()
+{
+  if(m_statement) {
+    if(m_stepResult == SQLITE_ROW)
+      step();
+    return;
+  }
+
+  if(m_rowIndex < m_rows.size()) {
+    m_rowIndex++;
+  }
+}
+
+CSQLResult* CSQLiteQuery::result()
+{
+  if(m_statement)
+    return (m_stepResult == SQLITE_ROW) ? m_row : NULL;
+  return (m_rowIndex < m_rows.size()) ? &m_rows[m_rowIndex] : NULL;
+}
+
+void CSQLiteQuery::clear()
+{
+  if(m_statement) {
+    ((CSQLiteConnection*)m_connection)->releaseStatement(m_statement);
+    m_statement = NULL;
+    delete m_row;
+    m_row = NULL;
+    m_stepResult = SQLITE_DONE;
+    m_executed = false;
+  }
+
+  m_rows.clear();
+  delete m_table;
+  m_table = NULL;
+  m_rowsReturned = 0;
+  m_rowIndex = 0;
+}
+
+bool CSQLiteQuery::prepare(const std::string sql)
+{
+  clear();
+
+  m_statement = ((CSQLiteConnection*)m_connection)->acquireStatement(sql);
+  if(m_statement == NULL)
     return false;
 
-  if(m_sqlPrepared.length() > 0 && sql.length() > 0)
+  m_row = new CSQLiteRow(m_statement);
+  return true;
+}
+
+void CSQLiteQuery::reset()
+{
+  if(!m_executed)
+    return;
+  sqlite3_reset(m_statement->stmt);
+  m_stepResult = SQLITE_DONE;
+  m_rowsReturned = 0;
+  m_executed = false;
+}
+
+void CSQLiteQuery::bind(int index, const std::string value)
+{
+  if(m_statement == NULL)
+    return;
+  reset();
+  sqlite3_bind_text(m_statement->stmt, index, value.c_str(), value.length(), SQLITE_TRANSIENT);
+}
+
+void CSQLiteQuery::bind(int index, fuppes_off_t value)
+{
+  if(m_statement == NULL)
+    return;
+  reset();
+  sqlite3_bind_int64(m_statement->stmt, index, value);
+}
+
+bool CSQLiteQuery::execute()
+{
+  if(m_statement == NULL)
     return false;
+  reset();
 
-  std::string statement = m_sqlPrepared;
-  if(statement.length() == 0)
-    statement = sql;
-  
+  CSQLiteConnection* connection = (CSQLiteConnection*)m_connection;
+  if(connection->transactionFailed())
+    return false;
+  connection->plugin()->cb.log(connection->plugin(), 0, __FILE__, __LINE__, "execute: %s", m_statement->sql.c_str());
 
+  m_executed = true;
+  step();
+
+  if(m_stepResult != SQLITE_ROW && m_stepResult != SQLITE_DONE) {
+		std::cout << "SQL execute error: " << sqlite3_errmsg(m_handle) << " :: " << m_statement->sql << std::endl;
+    return false;
+  }
+
+  if(m_stepResult == SQLITE_DONE)
+    m_lastInsertId = sqlite3_last_insert_rowid(m_handle);
+
+  return true;
+}
+
+void CSQLiteQuery::step()
+{
+  // a statement can only be run again before it returned rows
+  CSQLiteConnection* connection = (CSQLiteConnection*)m_connection;
+  int tries = 0;
+  while((m_stepResult = sqlite3_step(m_statement->stmt)) == SQLITE_BUSY &&
+        m_rowsReturned == 0 && connection->retry(++tries)) {
+    sqlite3_reset(m_statement->stmt);
+  }
+
+  if(m_stepResult == SQLITE_ROW)
+    m_rowsReturned++;
+}
+
+bool CSQLiteQuery::select(const std::string sql)
+{
+	clear();
   
-  char* szErr = NULL;
-  char** szResult;
-  int nRows = 0;
-  int nCols = 0;
-  
-  int nResult = SQLITE_OK;  
-  int nTry = 0;
-  
+  if(sql.length() == 0)
+    return false;
 
   CSQLiteConnection* connection = (CSQLiteConnection*)m_connection;
-  connection->plugin()->cb.log(connection->plugin(), 0, __FILE__, __LINE__, "query: %s", statement.c_str());
-	
-  do {
-    nResult = sqlite3_get_table(m_handle, statement.c_str(), &szResult, &nRows, &nCols, &szErr);
-    if(nTry > 0) {
-#ifdef WIN32
-      Sleep(1);
-#else
-      usleep(100);
-#endif
-    }
-    nTry++;
-  } while (nResult == SQLITE_BUSY);
+  if(connection->transactionFailed())
+    return false;
+  connection->plugin()->cb.log(connection->plugin(), 0, __FILE__, __LINE__, "query: %s", sql.c_str());
 
+  sqlite3_stmt* stmt = NULL;
+  int nResult;
+  int tries = 0;
+  while((nResult = sqlite3_prepare_v2(m_handle, sql.c_str(), sql.length(), &stmt, NULL)) == SQLITE_BUSY &&
+        connection->retry(++tries)) {
+  }
 
-  // select error
   if(nResult != SQLITE_OK) {
-		std::cout << "SQL select error: " << szErr << " :: " << statement << std::endl;
-    sqlite3_free(szErr);
+		std::cout << "SQL select error: " << sqlite3_errmsg(m_handle) << " :: " << sql << std::endl;
     return false;
   }
+  if(stmt == NULL) // empty statement
+    return true;
+
+  // the column names are resolved once for all rows
+  m_table = new CSQLiteTable();
+  m_table->columnCount = sqlite3_column_count(stmt);
+  for(int i = 0; i < m_table->columnCount; i++) {
+    m_table->columns[sqlite3_column_name(stmt, i)] = i;
+  }
+  m_table->offsets.push_back(0);
+
+  // the rows are copied into the table's buffer
+  const char* value;
+  int rows = 0;
+  tries = 0;
+  while(true) {
+
+    nResult = sqlite3_step(stmt);
+    if(nResult == SQLITE_BUSY && rows == 0 && connection->retry(++tries)) {
+      sqlite3_reset(stmt);
+      continue;
+    }
+    if(nResult != SQLITE_ROW)
+      break;
+
+    for(int i = 0; i < m_table->columnCount; i++) {
+      value = (const char*)sqlite3_column_text(stmt, i);
+      if(value != NULL)
+        m_table->data.append(value, sqlite3_column_bytes(stmt, i));
+      m_table->data.push_back('\0');
+      m_table->offsets.push_back(m_table->data.length());
+      m_table->nulls.push_back(value == NULL);
+    }
+    rows++;
+  }
 
+  if(nResult != SQLITE_DONE) {
+		std::cout << "SQL select error: " << sqlite3_errmsg(m_handle) << " :: " << sql << std::endl;
+    sqlite3_finalize(stmt);
+    clear();
+    return false;
+  }
+  sqlite3_finalize(stmt);
 
-  // get the result
-  CSQLiteResult* pResult;     
-  for(int i = 1; i < nRows + 1; i++) {
-    pResult = new CSQLiteResult();
-          
-    for(int j = 0; j < nCols; j++) {        
-      pResult->m_FieldValues[std::string(szResult[j])] =  std::string(szResult[(i * nCols) + j] ? szResult[(i * nCols) + j] : "");
-    }
-    
-    m_ResultList.push_back(pResult);
-		m_rowsReturned++;
+  // the row objects only point into the table
+  m_rows.reserve(rows);
+  for(int i = 0; i < rows; i++) {
+    m_rows.push_back(CSQLiteResult(m_table, i));
   }
-  m_ResultListIterator = m_ResultList.begin();     
-  sqlite3_free_table(szResult);
+  m_rowsReturned = rows;
+  m_rowIndex = 0;
 
 	return true;
 }
 
-bool CSQLiteQuery::exec(const std::string sql /* = "" */)
+bool CSQLiteQuery::exec(const std::string sql)
 {
-  if(m_sqlPrepared.length() == 0 && sql.length() == 0)
+  if(sql.length() == 0)
     return false;
 
-  if(m_sqlPrepared.length() > 0 && sql.length() > 0)
+  CSQLiteConnection* connection = (CSQLiteConnection*)m_connection;
+  if(connection->transactionFailed())
     return false;
-
-  std::string statement = m_sqlPrepared;
-  if(statement.length() == 0)
-    statement = sql;
-
-  
-  char* szErr  = NULL;
-  bool  bRetry = true;
-  bool	result = false;
-  int nResult;  
+  char* szErr = NULL;
+  int nResult;
+  int tries = 0;
 
 	//std::cout << "exec: " << sql << std::endl;
 	
-  while(bRetry) {  
-    
-    nResult = sqlite3_exec(m_handle, statement.c_str(), NULL, NULL, &szErr);
-    switch(nResult) {
-      case SQLITE_BUSY:
-        bRetry = true;
-#ifdef WIN32
-        Sleep(1);
-#else
-				usleep(50);
-#endif
-        break;
-      
-      case SQLITE_OK:
-        bRetry  = false;
-				result = true;
-        //nResult = sqlite3_last_insert_rowid(m_pDbHandle);
-        break;
-      
-      default:
-        bRetry = false;
-				result = false;
-				std::cout << "SQL exec error: " << szErr << " :: " << statement << std::endl;
-        //CSharedLog::Log(L_NORM, __FILE__, __LINE__, "CContentDatabase::Insert - insert :: SQL error: %s\nStatement: %s", szErr, p_sStatement.c_str());
-        sqlite3_free(szErr);
-        //nResult = 0;
-        break;
-    }
-    
+  while((nResult = sqlite3_exec(m_handle, sql.c_str(), NULL, NULL, &szErr)) == SQLITE_BUSY &&
+        connection->retry(++tries)) {
+    sqlite3_free(szErr);
+    szErr = NULL;
+  }
+
+  if(nResult != SQLITE_OK) {
+    std::cout << "SQL exec error: " << (szErr ? szErr : sqlite3_errmsg(m_handle)) << " :: " << sql << std::endl;
+    sqlite3_free(szErr);
+    return false;
   }
 	
-	return result;
+	return true;
 }
 
-fuppes_off_t CSQLiteQuery::insert(const std::string sql /* = "" */)
+fuppes_off_t CSQLiteQuery::insert(const std::string sql)
 {
 	if(!exec(sql)) {
 		m_lastInsertId = 0;
@@ -64,7 +64,7 @@ static const fuppes_sql sqlite3_statements[] = {
   },
 
   {SQL_GET_OBJECT_TYPE,
-  "select TYPE from OBJECTS "
+  "select TYPE, UPDATE_ID from OBJECTS "
   "where OBJECT_ID = %OBJECT_ID% and %DEVICE%"
   },
 
@@ -179,6 +179,11 @@ static const fuppes_sql sqlite3_statements[] = {
     "  VCONTAINER_PATH TEXT DEFAULT NULL, "
    	"  VREF_ID BIGINT DEFAULT 0, "
 	  "  VISIBLE INTEGER DEFAULT 1, "
+    "  UPDATE_ID INTEGER DEFAULT 0, "
+    "  TREE_PATH TEXT DEFAULT NULL, "
+    "  FILE_SIZE BIGINT DEFAULT 0, "
+    "  FILE_MTIME INTEGER DEFAULT 0, "
+    "  FILE_INODE BIGINT DEFAULT 0, "
     "  MODIFIED_AT INTEGER, "
     "  UPDATED_AT INTEGER, "
     "  unique(OBJECT_ID, DEVICE) "
@@ -236,6 +241,7 @@ static const fuppes_sql sqlite3_statements[] = {
     "CREATE INDEX IDX_OBJECTS_PATH ON OBJECTS(PATH);"
     "CREATE INDEX IDX_OBJECTS_FILE_NAME ON OBJECTS(FILE_NAME);"
     "CREATE INDEX IDX_OBJECTS_TITLE ON OBJECTS(TITLE);"
+    "CREATE INDEX IDX_OBJECTS_TREE_PATH ON OBJECTS(TREE_PATH);"
     "CREATE INDEX IDX_OBJECT_DETAILS_ID ON OBJECT_DETAILS(ID);"
   },
 
@@ -243,6 +249,65 @@ static const fuppes_sql sqlite3_statements[] = {
   {SQL_GET_OBJECT_TYPE_COUNT,
     "select TYPE, count(*) as VALUE from OBJECTS group by TYPE"
   },
+
+
+  // the index holds a case and diacritic folded copy (fuppes_fold()) of
+  // the columns. the trigram tokenizer (fts5, sqlite >= 3.34) uses the
+  // index for like '%...%' patterns of three or more characters.
+  // the index is kept up to date by triggers so everything that writes
+  // OBJECTS or OBJECT_DETAILS (scanner, UpdateThread, fam) maintains it
+  {SQL_FULL_TEXT_INDEX_EXISTS,
+    "SELECT name FROM sqlite_master WHERE name='OBJECTS_FTS_INSERT' AND sql LIKE '%fuppes_fold%'"
+  },
+
+  {SQL_CREATE_FULL_TEXT_INDEX,
+    "CREATE VIRTUAL TABLE OBJECTS_FTS USING fts5(TITLE, AV_ARTIST, AV_ALBUM, AV_GENRE, tokenize='trigram');"
+
+    "INSERT INTO OBJECTS_FTS (rowid, TITLE, AV_ARTIST, AV_ALBUM, AV_GENRE) "
+    "  SELECT o.ID, fuppes_fold(o.TITLE), fuppes_fold(d.AV_ARTIST), fuppes_fold(d.AV_ALBUM), fuppes_fold(d.AV_GENRE) "
+    "  FROM OBJECTS o LEFT JOIN OBJECT_DETAILS d ON (d.ID = o.DETAIL_ID);"
+
+    "CREATE TRIGGER OBJECTS_FTS_INSERT AFTER INSERT ON OBJECTS BEGIN "
+    "  INSERT INTO OBJECTS_FTS (rowid, TITLE, AV_ARTIST, AV_ALBUM, AV_GENRE) VALUES ("
+    "    new.ID, fuppes_fold(new.TITLE), "
+    "    (SELECT fuppes_fold(AV_ARTIST) FROM OBJECT_DETAILS WHERE ID = new.DETAIL_ID), "
+    "    (SELECT fuppes_fold(AV_ALBUM) FROM OBJECT_DETAILS WHERE ID = new.DETAIL_ID), "
+    "    (SELECT fuppes_fold(AV_GENRE) FROM OBJECT_DETAILS WHERE ID = new.DETAIL_ID)); "
+    "END;"
+
+    "CREATE TRIGGER OBJECTS_FTS_UPDATE AFTER UPDATE OF TITLE, DETAIL_ID ON OBJECTS "
+    "WHEN old.TITLE IS NOT new.TITLE OR old.DETAIL_ID IS NOT new.DETAIL_ID BEGIN "
+    "  DELETE FROM OBJECTS_FTS WHERE rowid = old.ID; "
+    "  INSERT INTO OBJECTS_FTS (rowid, TITLE, AV_ARTIST, AV_ALBUM, AV_GENRE) VALUES ("
+    "    new.ID, fuppes_fold(new.TITLE), "
+    "    (SELECT fuppes_fold(AV_ARTIST) FROM OBJECT_DETAILS WHERE ID = new.DETAIL_ID), "
+    "    (SELECT fuppes_fold(AV_ALBUM) FROM OBJECT_DETAILS WHERE ID = new.DETAIL_ID), "
+    "    (SELECT fuppes_fold(AV_GENRE) FROM OBJECT_DETAILS WHERE ID = new.DETAIL_ID)); "
+    "END;"
+
+    "CREATE TRIGGER OBJECTS_FTS_DELETE AFTER DELETE ON OBJECTS BEGIN "
+    "  DELETE FROM OBJECTS_FTS WHERE rowid = old.ID; "
+    "END;"
+
+    "CREATE TRIGGER OBJECT_DETAILS_FTS_UPDATE AFTER UPDATE OF AV_ARTIST, AV_ALBUM, AV_GENRE ON OBJECT_DETAILS "
+    "WHEN old.AV_ARTIST IS NOT new.AV_ARTIST OR old.AV_ALBUM IS NOT new.AV_ALBUM OR old.AV_GENRE IS NOT new.AV_GENRE BEGIN "
+    "  UPDATE OBJECTS_FTS SET AV_ARTIST = fuppes_fold(new.AV_ARTIST), AV_ALBUM = fuppes_fold(new.AV_ALBUM), AV_GENRE = fuppes_fold(new.AV_GENRE) "
+    "  WHERE rowid IN (SELECT ID FROM OBJECTS WHERE DETAIL_ID = new.ID); "
+    "END;"
+  },
+
+  {SQL_DROP_FULL_TEXT_INDEX,
+    "DROP TRIGGER IF EXISTS OBJECTS_FTS_INSERT;"
+    "DROP TRIGGER IF EXISTS OBJECTS_FTS_UPDATE;"
+    "DROP TRIGGER IF EXISTS OBJECTS_FTS_DELETE;"
+    "DROP TRIGGER IF EXISTS OBJECT_DETAILS_FTS_UPDATE;"
+    "DROP TABLE IF EXISTS OBJECTS_FTS;"
+  },
+
+  // %COLUMN% is replaced by the column and %VALUE% by the escaped search value
+  {SQL_SEARCH_FULL_TEXT,
+    "o.ID in (select rowid from OBJECTS_FTS where %COLUMN% like ('%' || fuppes_fold('%VALUE%') || '%'))"
+  },
   
 
 };
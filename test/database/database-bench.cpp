@@ -0,0 +1,324 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+
+/*
+ * measures the browse and search throughput while the database is written.
+ * a writer thread inserts objects with DbObject::save() in batched
+ * transactions on its own connection (like a rebuild) while a number of
+ * reader threads run the statements of CContentDirectory's Browse and
+ * Search handlers. the actions are built by CUPnPActionFactory from soap
+ * requests and the queries use SQLQuery::ReadOnly.
+ *
+ * shared: no read pool, all readers use the shared connection
+ * pool  : every reader gets a connection from CDatabase's read pool
+ *
+ * usage: database-bench [plugin] [db file] [seconds] [objects]
+ */
+
+#include "../../src/lib/ContentDirectory/DatabaseConnection.h"
+#include "../../src/lib/ContentDirectory/DatabaseObject.h"
+#include "../../src/lib/ContentDirectory/UPnPObjectTypes.h"
+#include "../../src/lib/UPnPActions/UPnPActionFactory.h"
+#include "../../src/lib/UPnPActions/UPnPBrowse.h"
+#include "../../src/lib/UPnPActions/UPnPSearch.h"
+#include "../../src/lib/DeviceSettings/DeviceSettings.h"
+#include "../../src/lib/Common/Thread.h"
+#include "../../src/lib/Plugins/Plugin.h"
+
+#include <sys/time.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+using namespace fuppes;
+
+#define FOLDERS 100
+#define BATCH   500
+
+static double now()
+{
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
+
+static object_id_t insert(SQLQuery* qry, object_id_t objectId, object_id_t parentId, OBJECT_TYPE type)
+{
+  stringstream title;
+  title << "title " << objectId;
+
+  DbObject object;
+  object.setObjectId(objectId);
+  object.setParentId(parentId);
+  object.setType(type);
+  object.setPath("/bench/");
+  object.setFileName(title.str());
+  object.setTitle(title.str());
+  object.save(qry);
+  return objectId;
+}
+
+static std::string browseRequest(object_id_t objectId)
+{
+  stringstream request;
+  request <<
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+    "<s:Envelope s:encodingStyle=\"http://schemas.xmlsoap.org/soap/encoding/\" xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\">"
+    "<s:Body>"
+    "<u:Browse xmlns:u=\"urn:schemas-upnp-org:service:ContentDirectory:1\">"
+    "<ObjectID>" << objectId << "</ObjectID>"
+    "<BrowseFlag>BrowseDirectChildren</BrowseFlag>"
+    "<Filter>*</Filter>"
+    "<StartingIndex>0</StartingIndex>"
+    "<RequestedCount>30</RequestedCount>"
+    "<SortCriteria>+dc:title</SortCriteria>"
+    "</u:Browse>"
+    "</s:Body>"
+    "</s:Envelope>";
+  return request.str();
+}
+
+static std::string searchRequest(object_id_t containerId, std::string criteria)
+{
+  stringstream request;
+  request <<
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+    "<s:Envelope s:encodingStyle=\"http://schemas.xmlsoap.org/soap/encoding/\" xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\">"
+    "<s:Body>"
+    "<u:Search xmlns:u=\"urn:schemas-upnp-org:service:ContentDirectory:1\">"
+    "<ContainerID>" << containerId << "</ContainerID>"
+    "<SearchCriteria>" << criteria << "</SearchCriteria>"
+    "<Filter>*</Filter>"
+    "<StartingIndex>0</StartingIndex>"
+    "<RequestedCount>30</RequestedCount>"
+    "<SortCriteria></SortCriteria>"
+    "</u:Search>"
+    "</s:Body>"
+    "</s:Envelope>";
+  return request.str();
+}
+
+// the statements of CContentDirectory::BrowseDirectChildren()
+static unsigned int browse(CUPnPBrowse* browse)
+{
+  SQLQuery qry(SQLQuery::ReadOnly);
+
+  qry.execute(SQL_COUNT_CHILD_OBJECTS, browse->GetObjectIDAsUInt(), browse->virtualFolderLayout());
+  if(!qry.eof())
+    qry.result()->asInt("COUNT");
+
+  qry.prepare(SQL_GET_CHILD_OBJECTS, browse->GetObjectIDAsUInt(), browse->virtualFolderLayout(),
+              browse->m_sortCriteriaSQL + " limit ?3, ?4");
+  qry.bind(3, (fuppes_off_t)browse->m_nStartingIndex);
+  qry.bind(4, (fuppes_off_t)browse->m_nRequestedCount);
+  qry.execute();
+
+  unsigned int rows = 0;
+  while(!qry.eof()) {
+    rows++;
+    qry.next();
+  }
+  return rows;
+}
+
+// the statements of CContentDirectory::HandleUPnPSearch()
+static unsigned int search(CUPnPSearch* search)
+{
+  SQLQuery qry(SQLQuery::ReadOnly);
+
+  qry.select(search->getQuery(true));
+  if(!qry.eof())
+    qry.result()->asInt("COUNT");
+
+  qry.prepare(search->getQuery());
+  qry.execute();
+
+  unsigned int rows = 0;
+  while(!qry.eof()) {
+    rows++;
+    qry.next();
+  }
+  return rows;
+}
+
+class Writer: public Thread
+{
+  public:
+    Writer(object_id_t nextId) : Thread("database-bench writer") {
+      m_nextId = nextId;
+      m_written = 0;
+      m_failed = 0;
+    }
+
+    unsigned int written() { return m_written; }
+    unsigned int failed() { return m_failed; }
+
+  private:
+    void run() {
+      // the rebuild writes on a private connection
+      CDatabaseConnection* connection = CDatabase::connection(true);
+      SQLQuery qry(connection);
+
+      while(!stopRequested()) {
+        connection->startTransaction();
+        for(int i = 0; i < BATCH; i++) {
+          object_id_t objectId = m_nextId++;
+          insert(&qry, objectId, 1 + (objectId % FOLDERS), ITEM_AUDIO_ITEM_MUSIC_TRACK);
+        }
+        if(connection->commit())
+          m_written += BATCH;
+        else
+          m_failed++;
+      }
+
+      qry.clear();
+      delete connection;
+    }
+
+    object_id_t   m_nextId;
+    unsigned int  m_written;
+    unsigned int  m_failed;
+};
+
+class Reader: public Thread
+{
+  public:
+    Reader(unsigned int seed) : Thread("database-bench reader"), m_settings("bench") {
+      m_seed = seed;
+      m_browses = 0;
+      m_searches = 0;
+      m_rows = 0;
+    }
+
+    unsigned int browses() { return m_browses; }
+    unsigned int searches() { return m_searches; }
+
+  private:
+    void run() {
+      while(!stopRequested()) {
+
+        object_id_t folder = 1 + rand_r(&m_seed) % FOLDERS;
+
+        // every 10th request is a search
+        if((m_browses + m_searches) % 10 == 9) {
+          stringstream criteria;
+          criteria << "dc:title contains \"" << folder << "7\"";
+          CUPnPSearch* action = (CUPnPSearch*)CUPnPActionFactory::buildActionFromString(searchRequest(0, criteria.str()), &m_settings, "");
+          m_rows += search(action);
+          delete action;
+          m_searches++;
+        }
+        else {
+          CUPnPBrowse* action = (CUPnPBrowse*)CUPnPActionFactory::buildActionFromString(browseRequest(folder), &m_settings, "");
+          m_rows += browse(action);
+          delete action;
+          m_browses++;
+        }
+      }
+    }
+
+    CDeviceSettings m_settings;
+    unsigned int    m_seed;
+    unsigned int    m_browses;
+    unsigned int    m_searches;
+    unsigned int    m_rows;
+};
+
+static void removeDatabase(std::string fileName)
+{
+  unlink(fileName.c_str());
+  unlink((fileName + "-wal").c_str());
+  unlink((fileName + "-shm").c_str());
+}
+
+static bool bench(std::string fileName, bool pool, int readers, int seconds, int objects)
+{
+  removeDatabase(fileName);
+
+  CConnectionParams params;
+  params.type = "sqlite3";
+  params.filename = fileName;
+  params.readonly = false;
+  if(!CDatabase::connect(params, pool ? readers : 0) || !CDatabase::setup()) {
+    cout << "unable to create the database " << fileName << endl;
+    return false;
+  }
+
+  {
+    SQLQuery qry;
+    qry.connection()->startTransaction();
+    for(int i = 1; i <= FOLDERS + objects; i++) {
+      if(i <= FOLDERS)
+        insert(&qry, i, 0, CONTAINER_STORAGE_FOLDER);
+      else
+        insert(&qry, i, 1 + (i % FOLDERS), ITEM_AUDIO_ITEM_MUSIC_TRACK);
+    }
+    qry.connection()->commit();
+    qry.exec("analyze");
+  }
+
+  Writer writer(FOLDERS + objects + 1);
+  std::vector<Reader*> readerThreads;
+  for(int i = 0; i < readers; i++)
+    readerThreads.push_back(new Reader(i + 1));
+
+  double start = now();
+  writer.start();
+  for(int i = 0; i < readers; i++)
+    readerThreads[i]->start();
+
+  sleep(seconds);
+
+  unsigned int browses = 0;
+  unsigned int searches = 0;
+  for(int i = 0; i < readers; i++) {
+    readerThreads[i]->stop();
+    readerThreads[i]->close();
+    browses += readerThreads[i]->browses();
+    searches += readerThreads[i]->searches();
+    delete readerThreads[i];
+  }
+  writer.stop();
+  writer.close();
+  double time = now() - start;
+
+  cout << (pool ? "  pool  " : "  shared") << " readers: " << readers << ": " <<
+    (int)(browses / time) << " browse/s, " <<
+    (int)(searches / time) << " search/s, " <<
+    (int)(writer.written() / time) << " writes/s";
+  if(writer.failed() > 0)
+    cout << " (" << writer.failed() << " batches failed)";
+  cout << endl;
+
+  CDatabase::close();
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  std::string plugin = (argc > 1) ? argv[1] : "../src/plugins/.libs/libdatabase_sqlite3.so";
+  std::string fileName = (argc > 2) ? argv[2] : "/tmp/database-bench.db";
+  int seconds = (argc > 3) ? atoi(argv[3]) : 3;
+  int objects = (argc > 4) ? atoi(argv[4]) : 50000;
+
+  CPluginMgr::try_init(plugin);
+  if(CPluginMgr::databasePlugin("sqlite3") == NULL) {
+    cout << "unable to load the sqlite3 plugin from " << plugin << endl;
+    return 1;
+  }
+
+  cout << "objects: " << objects << ", seconds per run: " << seconds << ", batch: " << BATCH << endl;
+
+  for(int readers = 1; readers <= 8; readers *= 2) {
+    if(!bench(fileName, false, readers, seconds, objects) ||
+       !bench(fileName, true, readers, seconds, objects))
+      break;
+  }
+
+  removeDatabase(fileName);
+  return 0;
+}
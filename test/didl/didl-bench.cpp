@@ -0,0 +1,243 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+
+/*
+ * compares the serialization of a Browse response with a nested DIDL-Lite
+ * document (escaped into the soap envelope afterwards) against the single
+ * pass DIDLResultWriter. reports latency and allocations per response.
+ *
+ * usage: didl-bench [runs]
+ */
+
+#include "../../src/lib/ContentDirectory/DIDLResultWriter.h"
+
+#include <libxml/xmlwriter.h>
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+
+#include <sys/time.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <new>
+
+#include <iostream>
+#include <string>
+using namespace std;
+
+static unsigned long allocations = 0;
+static unsigned long allocatedBytes = 0;
+
+void* operator new(size_t size)
+{
+  allocations++;
+  allocatedBytes += size;
+  void* result = malloc(size);
+  if(result == NULL)
+    throw std::bad_alloc();
+  return result;
+}
+
+void operator delete(void* ptr) throw()
+{
+  free(ptr);
+}
+
+static void* countingMalloc(size_t size)
+{
+  allocations++;
+  allocatedBytes += size;
+  return malloc(size);
+}
+
+static void* countingRealloc(void* ptr, size_t size)
+{
+  allocations++;
+  allocatedBytes += size;
+  return realloc(ptr, size);
+}
+
+static char* countingStrdup(const char* str)
+{
+  allocations++;
+  allocatedBytes += strlen(str) + 1;
+  return strdup(str);
+}
+
+static double now()
+{
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
+
+// roughly what CContentDirectory::BuildItemDescription() writes for an audio item
+static void buildItem(xmlTextWriterPtr writer, unsigned int id)
+{
+  char objId[11];
+  sprintf(objId, "%010X", id);
+
+  xmlTextWriterStartElement(writer, BAD_CAST "item");
+  xmlTextWriterWriteAttribute(writer, BAD_CAST "id", BAD_CAST objId);
+  xmlTextWriterWriteAttribute(writer, BAD_CAST "parentID", BAD_CAST "0000000001");
+  xmlTextWriterWriteAttribute(writer, BAD_CAST "restricted", BAD_CAST "true");
+
+  xmlTextWriterStartElement(writer, BAD_CAST "dc:title");
+  xmlTextWriterWriteFormatString(writer, "Track %u - Rock & Roll <live>", id);
+  xmlTextWriterEndElement(writer);
+
+  xmlTextWriterStartElement(writer, BAD_CAST "upnp:class");
+  xmlTextWriterWriteString(writer, BAD_CAST "object.item.audioItem.musicTrack");
+  xmlTextWriterEndElement(writer);
+
+  xmlTextWriterStartElement(writer, BAD_CAST "upnp:artist");
+  xmlTextWriterWriteString(writer, BAD_CAST "Simon & Garfunkel");
+  xmlTextWriterEndElement(writer);
+
+  xmlTextWriterStartElement(writer, BAD_CAST "upnp:album");
+  xmlTextWriterWriteString(writer, BAD_CAST "Bookends");
+  xmlTextWriterEndElement(writer);
+
+  xmlTextWriterStartElement(writer, BAD_CAST "res");
+  xmlTextWriterWriteAttribute(writer, BAD_CAST "protocolInfo", BAD_CAST "http-get:*:audio/mpeg:DLNA.ORG_PN=MP3;DLNA.ORG_OP=01;DLNA.ORG_CI=0");
+  xmlTextWriterWriteAttribute(writer, BAD_CAST "duration", BAD_CAST "0:03:12.000");
+  xmlTextWriterWriteAttribute(writer, BAD_CAST "size", BAD_CAST "4608000");
+  xmlTextWriterWriteFormatString(writer, "http://192.168.0.2:49152/MediaServer/AudioItems/%s.mp3", objId);
+  xmlTextWriterEndElement(writer);
+
+  xmlTextWriterEndElement(writer);
+}
+
+// the serialization used before DIDLResultWriter
+static std::string nested(unsigned int count)
+{
+  xmlBufferPtr buf = xmlBufferCreate();
+  xmlTextWriterPtr writer = xmlNewTextWriterMemory(buf, 0);
+  xmlTextWriterStartDocument(writer, NULL, "UTF-8", NULL);
+
+  xmlTextWriterStartElementNS(writer, BAD_CAST "s", BAD_CAST "Envelope", NULL);
+  xmlTextWriterWriteAttributeNS(writer, BAD_CAST "s", BAD_CAST "encodingStyle",
+    BAD_CAST "http://schemas.xmlsoap.org/soap/envelope/", BAD_CAST "http://schemas.xmlsoap.org/soap/encoding/");
+  xmlTextWriterStartElementNS(writer, BAD_CAST "s", BAD_CAST "Body", NULL);
+  xmlTextWriterStartElementNS(writer, BAD_CAST "u", BAD_CAST "BrowseResponse", BAD_CAST "urn:schemas-upnp-org:service:ContentDirectory:1");
+  xmlTextWriterStartElement(writer, BAD_CAST "Result");
+
+  xmlBufferPtr resBuf = xmlBufferCreate();
+  xmlTextWriterPtr resWriter = xmlNewTextWriterMemory(resBuf, 0);
+  xmlTextWriterStartDocument(resWriter, NULL, "UTF-8", NULL);
+  xmlTextWriterStartElementNS(resWriter, NULL, BAD_CAST "DIDL-Lite", BAD_CAST "urn:schemas-upnp-org:metadata-1-0/DIDL-Lite/");
+  xmlTextWriterWriteAttribute(resWriter, BAD_CAST "xmlns:dc", BAD_CAST "http://purl.org/dc/elements/1.1/");
+  xmlTextWriterWriteAttribute(resWriter, BAD_CAST "xmlns:upnp", BAD_CAST "urn:schemas-upnp-org:metadata-1-0/upnp/");
+  xmlTextWriterWriteAttribute(resWriter, BAD_CAST "xmlns:sec", BAD_CAST "http://www.sec.co.kr/");
+  for(unsigned int i = 0; i < count; i++)
+    buildItem(resWriter, i);
+  xmlTextWriterEndElement(resWriter);
+  xmlTextWriterEndDocument(resWriter);
+  xmlFreeTextWriter(resWriter);
+
+  std::string sResOutput = (const char*)resBuf->content;
+  xmlBufferFree(resBuf);
+  sResOutput = sResOutput.substr(strlen("<?xml version=\"1.0\" encoding=\"UTF-8\"?> "));
+  xmlTextWriterWriteString(writer, BAD_CAST sResOutput.c_str());
+  xmlTextWriterEndElement(writer);
+
+  xmlTextWriterStartElement(writer, BAD_CAST "NumberReturned");
+  xmlTextWriterWriteFormatString(writer, "%u", count);
+  xmlTextWriterEndElement(writer);
+  xmlTextWriterStartElement(writer, BAD_CAST "TotalMatches");
+  xmlTextWriterWriteFormatString(writer, "%u", count);
+  xmlTextWriterEndElement(writer);
+  xmlTextWriterStartElement(writer, BAD_CAST "UpdateID");
+  xmlTextWriterWriteFormatString(writer, "%u", 1);
+  xmlTextWriterEndElement(writer);
+
+  xmlTextWriterEndElement(writer);
+  xmlTextWriterEndElement(writer);
+  xmlTextWriterEndElement(writer);
+  xmlTextWriterEndDocument(writer);
+  xmlFreeTextWriter(writer);
+
+  std::string result = (const char*)buf->content;
+  xmlBufferFree(buf);
+  return result;
+}
+
+static std::string singlePass(unsigned int count)
+{
+  DIDLResultWriter result("Browse");
+  for(unsigned int i = 0; i < count; i++)
+    buildItem(result.writer(), i);
+
+  std::string output;
+  output.swap(result.finish(count, count, 1));
+  return output;
+}
+
+// parses the envelope and the embedded DIDL-Lite and counts the items
+static int countItems(const std::string& response)
+{
+  int items = -1;
+  xmlDocPtr doc = xmlReadMemory(response.c_str(), response.length(), NULL, NULL, 0);
+  if(doc == NULL)
+    return -1;
+
+  xmlNodePtr node = xmlDocGetRootElement(doc);  // Envelope
+  node = node ? xmlFirstElementChild(node) : NULL; // Body
+  node = node ? xmlFirstElementChild(node) : NULL; // BrowseResponse
+  node = node ? xmlFirstElementChild(node) : NULL; // Result
+  if(node != NULL) {
+    xmlChar* didl = xmlNodeGetContent(node);
+    xmlDocPtr didlDoc = xmlReadMemory((const char*)didl, strlen((const char*)didl), NULL, NULL, 0);
+    if(didlDoc != NULL) {
+      items = xmlChildElementCount(xmlDocGetRootElement(didlDoc));
+      xmlFreeDoc(didlDoc);
+    }
+    xmlFree(didl);
+  }
+
+  xmlFreeDoc(doc);
+  return items;
+}
+
+typedef std::string (*Serializer)(unsigned int count);
+
+static void measure(Serializer serializer, unsigned int count, int runs, double* ms, double* allocs, double* kbytes)
+{
+  allocations = 0;
+  allocatedBytes = 0;
+
+  double start = now();
+  for(int i = 0; i < runs; i++) {
+    std::string response = serializer(count);
+  }
+  double elapsed = now() - start;
+
+  *ms = (elapsed * 1000) / runs;
+  *allocs = (double)allocations / runs;
+  *kbytes = ((double)allocatedBytes / 1024) / runs;
+}
+
+int main(int argc, char* argv[])
+{
+  int runs = (argc > 1) ? atoi(argv[1]) : 20;
+  unsigned int sizes[] = { 10, 100, 1000, 5000 };
+
+  xmlMemSetup(free, countingMalloc, countingRealloc, countingStrdup);
+  xmlInitParser();
+
+  if(countItems(singlePass(100)) != 100) {
+    cout << "error: single pass result is not valid" << endl;
+    return 1;
+  }
+
+  printf("%8s | %28s | %28s\n", "items", "nested (ms / allocs / kb)", "single pass (ms / allocs / kb)");
+  for(unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    double ms1, allocs1, kb1;
+    double ms2, allocs2, kb2;
+    measure(&nested, sizes[i], runs, &ms1, &allocs1, &kb1);
+    measure(&singlePass, sizes[i], runs, &ms2, &allocs2, &kb2);
+    printf("%8u | %8.2f %8.0f %10.0f | %8.2f %8.0f %10.0f\n", sizes[i], ms1, allocs1, kb1, ms2, allocs2, kb2);
+  }
+
+  xmlCleanupParser();
+  return 0;
+}
@@ -0,0 +1,317 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+
+/*
+ * compares the old regex based header parsing with CHTTPParser::parseHeader().
+ *
+ * the baseline is the old CHTTPParser::parseHeader() and
+ * CHTTPMessage::BuildFromString(): a RegEx per header field and request
+ * that fills a CHTTPMessage and identifies the device. the new parser
+ * is run on the complete header and fed in recv() sized pieces as the
+ * HTTPReactor does.
+ *
+ * usage: http-parser-bench [iterations] [recv size]
+ */
+
+#include "../../src/lib/HTTP/HTTPParser.h"
+#include "../../src/lib/HTTP/HTTPMessage.h"
+#include "../../src/lib/HTTP/HTTPHeaderTokenizer.h"
+#include "../../src/lib/DeviceSettings/DeviceIdentificationMgr.h"
+#include "../../src/lib/Common/RegEx.h"
+#include "../../src/lib/Common/Common.h"
+
+#include <sys/time.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <iostream>
+#include <map>
+#include <string>
+using namespace std;
+
+static const char* requests[] = {
+  "POST /UPnPServices/ContentDirectory/control/ HTTP/1.1\r\n"
+  "HOST: 192.168.0.3:49152\r\n"
+  "CONTENT-LENGTH: 467\r\n"
+  "CONTENT-TYPE: text/xml; charset=\"utf-8\"\r\n"
+  "SOAPACTION: \"urn:schemas-upnp-org:service:ContentDirectory:1#Browse\"\r\n"
+  "USER-AGENT: Linux/2.6.31-1.0 UPnP/1.0 DLNADOC/1.50 INTEL_NMPR/2.0 LGE_DLNA_SDK/1.5.0\r\n"
+  "\r\n",
+
+  "GET /MediaServer/AudioItems/1A2B.mp3 HTTP/1.1\r\n"
+  "Host: 192.168.0.3:49152\r\n"
+  "User-Agent: SEC_HHP_[TV]UE40C6000/1.0 DLNADOC/1.50\r\n"
+  "Accept: */*\r\n"
+  "Range: bytes=1048576-\r\n"
+  "getcontentFeatures.dlna.org: 1\r\n"
+  "transferMode.dlna.org: Streaming\r\n"
+  "getCaptionInfo.sec: 1\r\n"
+  "Connection: keep-alive\r\n"
+  "\r\n",
+
+  "SUBSCRIBE /UPnPServices/ContentDirectory/event/ HTTP/1.1\r\n"
+  "HOST: 192.168.0.3:49152\r\n"
+  "CALLBACK: <http://192.168.0.7:42577/>\r\n"
+  "NT: upnp:event\r\n"
+  "TIMEOUT: Second-1800\r\n"
+  "Content-Length: 0\r\n"
+  "\r\n",
+
+  NULL
+};
+
+static double now()
+{
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
+
+// the values the baseline stored in private members of CHTTPMessage
+struct Baseline
+{
+  std::string request;
+  std::string soapTarget;
+  std::string soapAction;
+  std::string callback;
+  std::string nt;
+  std::string layout;
+  fuppes_off_t contentLength;
+  bool        close;
+  std::map<std::string, std::string> getVars;
+
+  Baseline() { contentLength = 0; close = false; }
+};
+
+static HTTP_VERSION version(std::string match)
+{
+  if(match.compare("0") == 0)
+    return HTTP_VERSION_1_0;
+  if(match.compare("1") == 0)
+    return HTTP_VERSION_1_1;
+  return HTTP_VERSION_UNKNOWN;
+}
+
+// the old CHTTPParser::parseHeader()
+static bool parseHeaderBaseline(std::string header, CHTTPMessage* message, Baseline* baseline)
+{
+  std::string sType;
+
+  RegEx rxRequest("([GET|HEAD|POST|SUBSCRIBE|UNSUBSCRIBE|NOTIFY]+) +(.+) +HTTP/1\\.([1|0])", PCRE_CASELESS);
+  RegEx rxResponse("HTTP/1\\.([1|0]) +(\\d+) +(.+)", PCRE_CASELESS);
+  if(rxRequest.Search(header)) {
+    sType = rxRequest.Match(1);
+    message->SetVersion(version(rxRequest.Match(3)));
+    baseline->request = rxRequest.Match(2);
+  }
+  else if(rxResponse.Search(header)) {
+    sType = rxResponse.Match(2);
+    message->SetVersion(version(rxResponse.Match(1)));
+  }
+  else {
+    return false;
+  }
+  if(message->GetVersion() == HTTP_VERSION_UNKNOWN)
+    return false;
+
+  sType = ToUpper(sType);
+  if(sType.compare("GET") == 0)
+    message->SetMessageType(HTTP_MESSAGE_TYPE_GET);
+  else if(sType.compare("HEAD") == 0)
+    message->SetMessageType(HTTP_MESSAGE_TYPE_HEAD);
+  else if(sType.compare("POST") == 0)
+    message->SetMessageType(HTTP_MESSAGE_TYPE_POST);
+  else if(sType.compare("200") == 0)
+    message->SetMessageType(HTTP_MESSAGE_TYPE_200_OK);
+  else if(sType.compare("403") == 0)
+    message->SetMessageType(HTTP_MESSAGE_TYPE_403_FORBIDDEN);
+  else if(sType.compare("404") == 0)
+    message->SetMessageType(HTTP_MESSAGE_TYPE_404_NOT_FOUND);
+
+  // parseCommonValues()
+  RegEx rxUserAgent("USER-AGENT: *(.*)\r\n", PCRE_CASELESS);
+  if(rxUserAgent.Search(header.c_str()))
+    message->m_sUserAgent = rxUserAgent.Match(1);
+
+  RegEx rxTransferEncoding("Transfer-Encoding: *(\\w+)\r\n", PCRE_CASELESS);
+  if(rxTransferEncoding.Search(header)) {
+    if(ToLower(rxTransferEncoding.Match(1)) == "chunked")
+      message->SetTransferEncoding(HTTP_TRANSFER_ENCODING_CHUNKED);
+  }
+
+  // parseGetVars()
+  size_t pos;
+  if((pos = baseline->request.find_first_of("?")) != std::string::npos) {
+    std::string get = baseline->request.substr(pos + 1) + "&";
+    size_t amp;
+    while(get.length() > 0) {
+      std::string key = get.substr(0, (pos = get.find_first_of("=")));
+      baseline->getVars[key] = get.substr(pos + 1, (amp = get.find_first_of("&")) - pos - 1);
+      get = get.substr(amp + 1);
+    }
+  }
+
+  // parseDlnaHeader()
+  RegEx rxGetCF("getcontentFeatures\\.dlna\\.org: *(\\d+) *\r\n", PCRE_CASELESS);
+  if(rxGetCF.Search(header.c_str()) && rxGetCF.match(1).compare("1") == 0)
+    message->dlnaGetContentFeatures(true);
+  RegEx rxTM("transferMode\\.dlna\\.org: *(\\w+) *\r\n", PCRE_CASELESS);
+  if(rxTM.Search(header.c_str()))
+    message->dlnaTransferMode(rxTM.match(1));
+  RegEx rxCF("contentFeatures\\.dlna\\.org: *(\\w+) *\r\n", PCRE_CASELESS);
+  if(rxCF.Search(header.c_str()))
+    message->dlnaContentFeatures(rxCF.match(1));
+
+  // CDeviceIdentificationMgr::IdentifyDevice() searched the header again
+  RegEx rxVirtualLayout("VIRTUAL-LAYOUT: *(\\w+)", PCRE_CASELESS);
+  if(rxVirtualLayout.search(header))
+    baseline->layout = rxVirtualLayout.match(1);
+  CDeviceIdentificationMgr::Shared()->IdentifyDevice(message);
+  return true;
+}
+
+// the old CHTTPMessage::BuildFromString()
+static void buildFromStringBaseline(std::string msg, CHTTPMessage* message, Baseline* baseline)
+{
+  RegEx rxGET("GET +(.+) +HTTP/1\\.([1|0])", PCRE_CASELESS);
+  if(rxGET.Search(msg.c_str())) {
+    message->SetMessageType(HTTP_MESSAGE_TYPE_GET);
+    message->SetVersion(version(rxGET.Match(2)));
+    baseline->request = rxGET.Match(1);
+  }
+
+  RegEx rxHEAD("HEAD +(.+) +HTTP/1\\.([1|0])", PCRE_CASELESS);
+  if(rxHEAD.Search(msg.c_str())) {
+    message->SetMessageType(HTTP_MESSAGE_TYPE_HEAD);
+    message->SetVersion(version(rxHEAD.Match(2)));
+    baseline->request = rxHEAD.Match(1);
+  }
+
+  RegEx rxPOST("POST +(.+) +HTTP/1\\.([1|0])", PCRE_CASELESS);
+  if(rxPOST.Search(msg.c_str())) {
+    message->SetVersion(version(rxPOST.Match(2)));
+    baseline->request = rxPOST.Match(1);
+
+    // ParsePOSTMessage()
+    RegEx rxSOAP("SOAPACTION: *\"(.*)#(.+)\"", PCRE_CASELESS);
+    if(rxSOAP.Search(msg.c_str())) {
+      baseline->soapTarget = rxSOAP.Match(1);
+      baseline->soapAction = rxSOAP.Match(2);
+      message->SetMessageType(HTTP_MESSAGE_TYPE_POST_SOAP_ACTION);
+    }
+    else {
+      message->SetMessageType(HTTP_MESSAGE_TYPE_POST);
+    }
+    RegEx rxContentLength("CONTENT-LENGTH: *(\\d+)", PCRE_CASELESS);
+    if(rxContentLength.Search(msg.c_str()))
+      baseline->contentLength = atoll(rxContentLength.Match(1).c_str());
+  }
+
+  RegEx rxSUBSCRIBE("[SUBSCRIBE|UNSUBSCRIBE]+ +(.+) +HTTP/1\\.([1|0])", PCRE_CASELESS);
+  if(rxSUBSCRIBE.Search(msg.c_str())) {
+    message->SetMessageType(HTTP_MESSAGE_TYPE_SUBSCRIBE);
+    message->SetVersion(version(rxSUBSCRIBE.Match(2)));
+    baseline->request = rxSUBSCRIBE.Match(1);
+
+    // ParseSUBSCRIBEMessage()
+    RegEx rxCallBack("CALLBACK: *(.+)", PCRE_CASELESS);
+    if(rxCallBack.Search(msg.c_str()))
+      baseline->callback = rxCallBack.Match(1);
+    RegEx rxNT("NT: *(.+)", PCRE_CASELESS);
+    if(rxNT.Search(msg.c_str()))
+      baseline->nt = rxNT.Match(1);
+  }
+
+  RegEx rxRANGE("RANGE: +BYTES=(\\d*)(-\\d*)", PCRE_CASELESS);
+  if(rxRANGE.Search(msg.c_str())) {
+    std::string start = rxRANGE.Match(1);
+    std::string end = (rxRANGE.SubStrings() > 2) ? rxRANGE.Match(2) : "";
+    message->SetRangeStart(start.substr(0, 1) != "-" ? strToOffT(start) : 0);
+    message->SetRangeEnd(end.length() > 1 ? strToOffT(end.substr(1)) : 0);
+  }
+
+  RegEx rxCONNECTION("CONNECTION: +(close|keep-alive)", PCRE_CASELESS);
+  if(rxCONNECTION.Search(msg.c_str()))
+    baseline->close = (ToLower(rxCONNECTION.Match(1)).compare("close") == 0);
+}
+
+int main(int argc, char* argv[])
+{
+  int iterations  = (argc > 1) ? atoi(argv[1]) : 20000;
+  size_t recvSize = (argc > 2) ? atoi(argv[2]) : 64;
+
+  cout << "iterations: " << iterations << ", recv size: " << recvSize << endl;
+
+  for(int i = 0; requests[i] != NULL; i++) {
+
+    std::string message = requests[i];
+    std::string header = message.substr(0, message.find("\r\n\r\n") + 4);
+    CHTTPMessage* regex = NULL;
+    CHTTPMessage* parsed = NULL;
+    CHTTPMessage* pieces = NULL;
+    Baseline baseline;
+    HTTPHeaderTokenizer tokenizer;
+    HTTPHeaderTokenizer::Token token = HTTPHeaderTokenizer::Incomplete;
+
+    double start = now();
+    for(int j = 0; j < iterations; j++) {
+      delete regex;
+      regex = new CHTTPMessage();
+      baseline = Baseline();
+      parseHeaderBaseline(header, regex, &baseline);
+      buildFromStringBaseline(message, regex, &baseline);
+    }
+    double regexTime = (now() - start) / iterations;
+
+    start = now();
+    for(int j = 0; j < iterations; j++) {
+      delete parsed;
+      parsed = new CHTTPMessage();
+      tokenizer.reset();
+      token = CHTTPParser::parseHeader(&tokenizer, message.c_str(), message.length(), parsed);
+    }
+    double parseTime = (now() - start) / iterations;
+    bool complete = (token == HTTPHeaderTokenizer::End);
+
+    // the data arrives in pieces. the tokenizer resumes where it stopped
+    start = now();
+    for(int j = 0; j < iterations; j++) {
+      delete pieces;
+      pieces = new CHTTPMessage();
+      tokenizer.reset();
+      for(size_t length = recvSize; ; length += recvSize) {
+        if(length > message.length())
+          length = message.length();
+        token = CHTTPParser::parseHeader(&tokenizer, message.c_str(), length, pieces);
+        if(token != HTTPHeaderTokenizer::Incomplete || length == message.length())
+          break;
+      }
+    }
+    double pieceTime = (now() - start) / iterations;
+    complete &= (token == HTTPHeaderTokenizer::End);
+
+    bool same = complete &&
+      parsed->GetMessageType() == regex->GetMessageType() &&
+      parsed->GetVersion() == regex->GetVersion() &&
+      parsed->GetRequest() == baseline.request &&
+      parsed->GetContentLength() == baseline.contentLength &&
+      parsed->GetRangeStart() == regex->GetRangeStart() &&
+      parsed->m_sUserAgent == regex->m_sUserAgent &&
+      parsed->dlnaTransferMode() == regex->dlnaTransferMode() &&
+      parsed->soapAction() == baseline.soapAction &&
+      pieces->GetMessageType() == parsed->GetMessageType() &&
+      pieces->GetRequest() == parsed->GetRequest() &&
+      pieces->GetContentLength() == parsed->GetContentLength() &&
+      pieces->m_sUserAgent == parsed->m_sUserAgent;
+
+    cout << message.substr(0, message.find("\r\n")) << endl <<
+      "  regex                : " << (regexTime * 1000000) << " us" << endl <<
+      "  parseHeader          : " << (parseTime * 1000000) << " us" << endl <<
+      "  parseHeader (pieces) : " << (pieceTime * 1000000) << " us" << (same ? "" : " (MISMATCH)") << endl;
+
+    delete regex;
+    delete parsed;
+    delete pieces;
+  }
+
+  return 0;
+}
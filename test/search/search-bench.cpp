@@ -0,0 +1,225 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+
+/*
+ * compares container scoped searches using the recursively expanded
+ * PARENT_ID in (...) list with the TREE_PATH range query.
+ *
+ * a synthetic folder tree is inserted with DbObject::save() into a
+ * database created by the sqlite3 plugin for every depth. the search
+ * on the topmost container is built by CUPnPSearch from a soap request.
+ * the parent id list variant runs the same statement with the TREE_PATH
+ * range replaced by the list the old BuildParentIdList() created.
+ *
+ * usage: search-bench [plugin] [max depth] [folders per folder] [files per folder] [runs]
+ */
+
+#include "../../src/lib/ContentDirectory/DatabaseConnection.h"
+#include "../../src/lib/ContentDirectory/DatabaseObject.h"
+#include "../../src/lib/ContentDirectory/UPnPObjectTypes.h"
+#include "../../src/lib/UPnPActions/UPnPActionFactory.h"
+#include "../../src/lib/UPnPActions/UPnPSearch.h"
+#include "../../src/lib/Plugins/Plugin.h"
+
+#include <sys/time.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+using namespace std;
+using namespace fuppes;
+
+static double now()
+{
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
+
+class Tree
+{
+  public:
+    Tree(SQLQuery* qry, int fanout, int files) {
+      m_qry = qry;
+      m_fanout = fanout;
+      m_files = files;
+      m_objectId = 0;
+      m_folders = 0;
+    }
+
+    // creates a folder and its content. returns the folder's object id
+    object_id_t create(object_id_t parentId, int depth) {
+      object_id_t objectId = insert(parentId, CONTAINER_STORAGE_FOLDER);
+      m_folders++;
+
+      for(int i = 0; i < m_files; i++)
+        insert(objectId, ITEM_AUDIO_ITEM_MUSIC_TRACK);
+      if(depth > 1) {
+        for(int i = 0; i < m_fanout; i++)
+          create(objectId, depth - 1);
+      }
+      return objectId;
+    }
+
+    int objects() { return m_objectId; }
+    int folders() { return m_folders; }
+
+  private:
+    object_id_t insert(object_id_t parentId, OBJECT_TYPE type) {
+      stringstream title;
+      title << "title " << ++m_objectId;
+
+      DbObject object;
+      object.setObjectId(m_objectId);
+      object.setParentId(parentId);
+      object.setType(type);
+      object.setPath("/bench/");
+      object.setFileName(title.str());
+      object.setTitle(title.str());
+      object.save(m_qry);
+      return m_objectId;
+    }
+
+    SQLQuery*     m_qry;
+    int           m_fanout;
+    int           m_files;
+    int           m_objectId;
+    int           m_folders;
+};
+
+static std::string searchRequest(object_id_t containerId, std::string criteria)
+{
+  stringstream request;
+  request <<
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+    "<s:Envelope s:encodingStyle=\"http://schemas.xmlsoap.org/soap/encoding/\" xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\">"
+    "<s:Body>"
+    "<u:Search xmlns:u=\"urn:schemas-upnp-org:service:ContentDirectory:1\">"
+    "<ContainerID>" << containerId << "</ContainerID>"
+    "<SearchCriteria>" << criteria << "</SearchCriteria>"
+    "<Filter>*</Filter>"
+    "<StartingIndex>0</StartingIndex>"
+    "<RequestedCount>0</RequestedCount>"
+    "<SortCriteria></SortCriteria>"
+    "</u:Search>"
+    "</s:Body>"
+    "</s:Envelope>";
+  return request.str();
+}
+
+static int count(std::string sql)
+{
+  SQLQuery qry;
+  qry.select(sql);
+  if(qry.eof())
+    return 0;
+  return qry.result()->asUInt("COUNT");
+}
+
+// CUPnPSearch::prepareSQL() using DbObject::subtreePrefix()
+static int searchTreePath(std::string request, std::string* sql)
+{
+  CUPnPSearch* search = (CUPnPSearch*)CUPnPActionFactory::buildActionFromString(request, NULL, "");
+  *sql = search->getQuery(true);
+  delete search;
+  return count(*sql);
+}
+
+// the old BuildParentIdList(). one query per tree level
+static int searchParentIdList(object_id_t containerId, std::string treePathSql, size_t* sqlLength)
+{
+  stringstream ids;
+  ids << containerId;
+  std::string parentIds;
+  std::string level = ids.str();
+
+  SQLQuery qry;
+  while(!level.empty()) {
+    qry.select("select OBJECT_ID from OBJECTS where PARENT_ID in (" + level + ") and DEVICE is NULL");
+    level = "";
+    while(!qry.eof()) {
+      if(!level.empty())
+        level += ", ";
+      level += qry.result()->asString("OBJECT_ID");
+      qry.next();
+    }
+    if(!level.empty())
+      parentIds += level + ", ";
+  }
+  parentIds += ids.str();
+
+  // replace the TREE_PATH range of the generated statement
+  std::string sql = treePathSql;
+  size_t start = sql.find("TREE_PATH >= ");
+  size_t end = sql.find("'", sql.find("TREE_PATH < '", start) + 13) + 1;
+  sql.replace(start, end - start, "PARENT_ID in (" + parentIds + ")");
+
+  *sqlLength = sql.length();
+  return count(sql);
+}
+
+int main(int argc, char* argv[])
+{
+  std::string plugin = (argc > 1) ? argv[1] : "../src/plugins/.libs/libdatabase_sqlite3.so";
+  int maxDepth = (argc > 2) ? atoi(argv[2]) : 6;
+  int fanout   = (argc > 3) ? atoi(argv[3]) : 5;
+  int files    = (argc > 4) ? atoi(argv[4]) : 10;
+  int runs     = (argc > 5) ? atoi(argv[5]) : 5;
+
+  CPluginMgr::try_init(plugin);
+  if(CPluginMgr::databasePlugin("sqlite3") == NULL) {
+    cout << "unable to load the sqlite3 plugin from " << plugin << endl;
+    return 1;
+  }
+
+  // a title matches on every 10th object
+  std::string criteria = "upnp:class derivedfrom \"object.item\" and dc:title contains \"7\"";
+
+  cout << "folders per folder: " << fanout << ", files per folder: " << files << ", runs: " << runs << endl;
+
+  for(int depth = 1; depth <= maxDepth; depth++) {
+
+    CConnectionParams params;
+    params.type = "sqlite3";
+    params.filename = ":memory:";
+    params.readonly = false;
+    if(!CDatabase::connect(params) || !CDatabase::setup()) {
+      cout << "unable to create the database" << endl;
+      return 1;
+    }
+
+    SQLQuery qry;
+    qry.connection()->startTransaction();
+    Tree tree(&qry, fanout, files);
+    object_id_t containerId = tree.create(0, depth);
+    qry.connection()->commit();
+    qry.exec("analyze");
+
+    std::string request = searchRequest(containerId, criteria);
+    std::string rangeSql;
+    size_t listSql = 0;
+    int listCount = 0;
+    int rangeCount = 0;
+
+    double start = now();
+    for(int i = 0; i < runs; i++)
+      rangeCount = searchTreePath(request, &rangeSql);
+    double range = (now() - start) / runs;
+
+    start = now();
+    for(int i = 0; i < runs; i++)
+      listCount = searchParentIdList(containerId, rangeSql, &listSql);
+    double list = (now() - start) / runs;
+
+    cout << "depth " << depth << ": " <<
+      tree.folders() << " folders, " << tree.objects() << " objects, " << rangeCount << " matches" <<
+      (listCount != rangeCount ? " (MISMATCH)" : "") << endl <<
+      "  parent id list: " << (list * 1000) << " ms (" << listSql << " bytes sql)" << endl <<
+      "  tree path     : " << (range * 1000) << " ms (" << rangeSql.length() << " bytes sql)" << endl;
+
+    CDatabase::close();
+  }
+
+  return 0;
+}
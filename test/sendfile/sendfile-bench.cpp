@@ -0,0 +1,136 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 2; tab-width: 2 -*- */
+
+/*
+ * compares the throughput of the chunked read/send loop used for binary
+ * responses with SocketBase::sendFile() (zero-copy sendfile() on linux)
+ *
+ * usage: sendfile-bench [file size in mb] [runs]
+ */
+
+#include "../../src/lib/Common/Socket.h"
+#include "../../src/lib/Common/File.h"
+#include "../../src/lib/Common/Thread.h"
+#include "../../src/lib/Common/Exception.h"
+
+#include <sys/time.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+using namespace std;
+
+#define CHUNK_SIZE 1048576 // same as MAX_BUFFER_SIZE in HTTPServer.cpp
+
+static double now()
+{
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
+
+class Drain: public fuppes::Thread
+{
+  public:
+    Drain(fuppes::TCPRemoteSocket* socket, fuppes_off_t expected)
+      :Thread("drain") {
+      m_socket = socket;
+      m_expected = expected;
+    }
+
+  private:
+    void run() {
+      char buffer[65536];
+      fuppes_off_t received = 0;
+      int ret;
+      while(received < m_expected) {
+        ret = ::recv(m_socket->socket(), buffer, sizeof(buffer), 0);
+        if(ret <= 0)
+          break;
+        received += ret;
+      }
+    }
+
+    fuppes::TCPRemoteSocket* m_socket;
+    fuppes_off_t             m_expected;
+};
+
+static double transfer(std::string fileName, fuppes_off_t size, bool zeroCopy)
+{
+  fuppes::TCPServer server;
+  server.init("127.0.0.1", 0);
+  server.listen();
+
+  fuppes::TCPSocket client("127.0.0.1");
+  client.remoteAddress("127.0.0.1");
+  client.remotePort(server.localPort());
+  client.connect();
+
+  fuppes::TCPRemoteSocket* remote = server.accept(2000);
+  if(remote == NULL)
+    throw fuppes::Exception(__FILE__, __LINE__, "accept failed");
+
+  // the sending side is the client, the accepted socket drains
+  Drain drain(remote, size);
+  drain.start();
+
+  fuppes::File file(fileName);
+  file.open(fuppes::File::Read);
+
+  double start = now();
+  if(zeroCopy) {
+    client.sendFile(file.descriptor(), 0, size);
+  }
+  else {
+    char* chunk = new char[CHUNK_SIZE];
+    fuppes_off_t offset = 0;
+    fuppes_off_t read;
+    while(offset < size && (read = file.read(chunk, CHUNK_SIZE)) > 0) {
+      client.send(chunk, read);
+      offset += read;
+    }
+    delete[] chunk;
+  }
+  drain.close();
+  double elapsed = now() - start;
+
+  file.close();
+  delete remote;
+  return elapsed;
+}
+
+int main(int argc, char* argv[])
+{
+  int sizeMb = (argc > 1) ? atoi(argv[1]) : 512;
+  int runs   = (argc > 2) ? atoi(argv[2]) : 3;
+  fuppes_off_t size = (fuppes_off_t)sizeMb * 1048576;
+
+  // create the test file
+  char fileName[] = "/tmp/fuppes-sendfile-XXXXXX";
+  int fd = mkstemp(fileName);
+  char* buffer = new char[CHUNK_SIZE];
+  memset(buffer, 'x', CHUNK_SIZE);
+  for(int i = 0; i < sizeMb; i++) {
+    if(write(fd, buffer, CHUNK_SIZE) != CHUNK_SIZE)
+      break;
+  }
+  ::close(fd);
+  delete[] buffer;
+
+  cout << "file size: " << sizeMb << " mb, runs: " << runs << endl;
+
+  try {
+    for(int i = 0; i < runs; i++) {
+      double loop = transfer(fileName, size, false);
+      double zero = transfer(fileName, size, true);
+      cout << "run " << (i + 1) << ": "
+           << "read/send loop " << (sizeMb / loop) << " mb/s, "
+           << "sendFile " << (sizeMb / zero) << " mb/s" << endl;
+    }
+  } catch(fuppes::Exception ex) {
+    cout << ex.what() << endl;
+  }
+
+  ::unlink(fileName);
+  return 0;
+}